@@ -39,81 +39,8 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 			       arch_regs_t *regs,
 			       physical_addr_t fipa)
 {
-	int rc, rc1;
-	u32 reg_flags = 0x0, pg_reg_flags = 0x0;
-	struct mmu_page pg;
-	physical_addr_t inaddr, outaddr;
-	physical_size_t size, availsz;
-
-	memset(&pg, 0, sizeof(pg));
-
-	inaddr = fipa & TTBL_L3_MAP_MASK;
-	size = TTBL_L3_BLOCK_SIZE;
-
-	rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-	if (rc) {
-		vmm_printf("%s: IPA=0x%lx size=0x%lx map failed\n",
-			   __func__, inaddr, size);
-		return rc;
-	}
-
-	if (availsz < TTBL_L3_BLOCK_SIZE) {
-		vmm_printf("%s: availsz=0x%lx insufficent for IPA=0x%lx\n",
-			   __func__, availsz, inaddr);
-		return VMM_EFAIL;
-	}
-
-	pg.ia = inaddr;
-	pg.sz = size;
-	pg.oa = outaddr;
-	pg_reg_flags = reg_flags;
-
-	if (reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) {
-		inaddr = fipa & TTBL_L2_MAP_MASK;
-		size = TTBL_L2_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE)) {
-			pg.ia = inaddr;
-			pg.sz = size;
-			pg.oa = outaddr;
-			pg_reg_flags = reg_flags;
-		}
-		inaddr = fipa & TTBL_L1_MAP_MASK;
-		size = TTBL_L1_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE)) {
-			pg.ia = inaddr;
-			pg.sz = size;
-			pg.oa = outaddr;
-			pg_reg_flags = reg_flags;
-		}
-	}
-
-	arch_mmu_pgflags_set(&pg.flags, MMU_STAGE2, pg_reg_flags);
-
-	/* Try to map the page in Stage2 */
-	rc = mmu_map_page(arm_guest_priv(vcpu->guest)->ttbl, &pg);
-	if (rc) {
-		/* On SMP Guest, two different VCPUs may try to map same
-		 * Guest region in Stage2 at the same time. This may cause
-		 * mmu_lpae_map_page() to fail for one of the Guest VCPUs.
-		 *
-		 * To take care of this situation, we recheck Stage2 mapping
-		 * when mmu_lpae_map_page() fails.
-		 */
-		memset(&pg, 0, sizeof(pg));
-		rc1 = mmu_get_page(arm_guest_priv(vcpu->guest)->ttbl,
-				   fipa, &pg);
-		if (rc1) {
-			return rc1;
-		}
-		rc = VMM_OK;
-	}
-
-	return rc;
+	return mmu_stage2_map_guest_fault(arm_guest_priv(vcpu->guest)->ttbl,
+					  vcpu->guest, fipa);
 }
 
 int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
@@ -25,6 +25,7 @@
 #include <vmm_heap.h>
 #include <vmm_smp.h>
 #include <vmm_stdio.h>
+#include <vmm_guest_aspace.h>
 #include <arch_barrier.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
@@ -343,6 +344,13 @@ int arch_guest_deinit(struct vmm_guest *guest)
 
 int arch_guest_add_region(struct vmm_guest *guest, struct vmm_region *region)
 {
+	/* Populate Stage2 for RAM regions in advance if required */
+	if (vmm_guest_stage2_map_policy(guest) ==
+	    VMM_GUEST_STAGE2_MAP_PREFAULT) {
+		return mmu_stage2_map_guest_region(arm_guest_priv(guest)->ttbl,
+						   guest, region);
+	}
+
 	return VMM_OK;
 }
 
@@ -746,7 +754,7 @@ void arch_vcpu_switch(struct vmm_vcpu *tvcpu,
 			arm_vgic_save(tvcpu);
 			/* Save sysregs context */
 			cpu_vcpu_sysregs_save(tvcpu);
-			/* Save VFP and SIMD context */
+			/* Save VFP and SIMD context (if accessed) */
 			cpu_vcpu_vfp_save(tvcpu);
 			/* Save PTRAUTH context */
 			cpu_vcpu_ptrauth_save(tvcpu);
@@ -773,7 +781,7 @@ void arch_vcpu_switch(struct vmm_vcpu *tvcpu,
 		}
 		/* Restore PTRAUTH context */
 		cpu_vcpu_ptrauth_restore(vcpu);
-		/* Restore VFP and SIMD context */
+		/* Restore VFP and SIMD context lazily */
 		cpu_vcpu_vfp_restore(vcpu);
 		/* Restore sysregs context */
 		cpu_vcpu_sysregs_restore(vcpu);
@@ -33,6 +33,12 @@
 
 #include <arm_features.h>
 
+/*
+ * Upto 16 VCPUs per Aff1 cluster because ICC_SGI1R_EL1 TargetList
+ * can only address Aff0 values 0 to 15 of one cluster at a time.
+ */
+#define VCPU_MPIDR_AFFINITY(subid)	((((subid) >> 4) << 8) | ((subid) & 0xF))
+
 bool cpu_vcpu_cp15_read(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
 			u32 opc1, u32 opc2, u32 CRn, u32 CRm,
@@ -320,6 +326,16 @@ bool cpu_vcpu_sysregs_write(struct vmm_vcpu *vcpu,
 		 * as RAZ/WI.
 		 */
 		break;
+	case ISS_SGI1R_EL1:
+		/*
+		 * With HCR_EL2.IMO set, Guest writes to ICC_SGI1R_EL1
+		 * always trap so SGIs of Guest with GICv3 are delivered
+		 * by VGIC emulator using affinity routing.
+		 */
+		if (!arm_vgic_sgi1r(vcpu, data)) {
+			goto bad_reg;
+		}
+		break;
 	default:
 		vmm_printf("Guest MSR/MRS Emulation @ PC:0x%"PRIx64"\n",
 			   regs->pc);
@@ -436,11 +452,11 @@ int cpu_vcpu_sysregs_init(struct vmm_vcpu *vcpu, u32 cpuid)
 	case ARM_CPUID_ARMV7:
 	case ARM_CPUID_ARMV8:
 		s->midr_el1 = mrs(midr_el1);
-		s->mpidr_el1 = vcpu->subid;
+		s->mpidr_el1 = VCPU_MPIDR_AFFINITY(vcpu->subid);
 		break;
 	default:
 		s->midr_el1 = cpuid;
-		s->mpidr_el1 = vcpu->subid;
+		s->mpidr_el1 = VCPU_MPIDR_AFFINITY(vcpu->subid);
 		break;
 	};
 
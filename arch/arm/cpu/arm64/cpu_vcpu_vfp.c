@@ -24,13 +24,25 @@
 
 #include <vmm_error.h>
 #include <vmm_stdio.h>
+#include <vmm_smp.h>
+#include <vmm_percpu.h>
+#include <vmm_cpumask.h>
 #include <arch_regs.h>
+#include <arch_barrier.h>
 #include <cpu_inline_asm.h>
 #include <cpu_vcpu_switch.h>
 #include <cpu_vcpu_vfp.h>
 
 #include <arm_features.h>
 
+/* Normal VCPU owning VFP registers of each host CPU
+ *
+ * VFP registers are never used by hypervisor (or Orphan VCPUs) so
+ * VFP registers of a Normal VCPU remain loaded on a host CPU until
+ * some other Normal VCPU accesses VFP on the same host CPU.
+ */
+static DEFINE_PER_CPU(struct vmm_vcpu *, vfp_owner);
+
 void cpu_vcpu_vfp_save(struct vmm_vcpu *vcpu)
 {
 	struct arm_priv *p = arm_priv(vcpu);
@@ -38,19 +50,27 @@ void cpu_vcpu_vfp_save(struct vmm_vcpu *vcpu)
 
 	/* Do nothing if:
 	 * 1. VCPU does not have VFPv3 feature
+	 * 2. VCPU did not access VFP since it was switched-in
 	 */
-	if (!arm_feature(vcpu, ARM_FEATURE_VFP3)) {
+	if (!arm_feature(vcpu, ARM_FEATURE_VFP3) ||
+	    (p->cptr & CPTR_TFP_MASK)) {
 		return;
 	}
 
-	/* Low-level VFP register save */
+	/* Low-level VFP register save
+	 *
+	 * Note: We always save accessed VFP registers so that VCPU
+	 * can be migrated to some other host CPU. The VFP registers
+	 * stay loaded hence restore is skipped if VCPU comes back to
+	 * this host CPU and nobody else accessed VFP in-between.
+	 */
 	cpu_vcpu_vfp_regs_save(vfp);
 }
 
 void cpu_vcpu_vfp_restore(struct vmm_vcpu *vcpu)
 {
+	u32 hcpu = vmm_smp_processor_id();
 	struct arm_priv *p = arm_priv(vcpu);
-	struct arm_priv_vfp *vfp = &p->vfp;
 
 	/* Do nothing if:
 	 * 1. VCPU does not have VFPv3 feature
@@ -59,22 +79,59 @@ void cpu_vcpu_vfp_restore(struct vmm_vcpu *vcpu)
 		return;
 	}
 
-	/* Low-level VFP register restore */
-	cpu_vcpu_vfp_regs_restore(vfp);
+	/* If VFP registers of this VCPU are still loaded then allow
+	 * VFP access otherwise trap first VFP access of VCPU.
+	 */
+	if (p->vfp_loaded && (p->vfp_hcpu == hcpu) &&
+	    (this_cpu(vfp_owner) == vcpu)) {
+		p->cptr &= ~CPTR_TFP_MASK;
+		p->vfp_lazy_hit++;
+	} else {
+		p->cptr |= CPTR_TFP_MASK;
+	}
 }
 
 int cpu_vcpu_vfp_trap(struct vmm_vcpu *vcpu,
 		      arch_regs_t *regs,
 		      u32 il, u32 iss)
 {
-	/* For now we don't handle VFP trap so just return failure. */
-	return VMM_EFAIL;
+	struct arm_priv *p = arm_priv(vcpu);
+
+	/* Fail if:
+	 * 1. VCPU does not have VFPv3 feature
+	 * 2. VFP access trapped even though VCPU owns VFP registers
+	 */
+	if (!arm_feature(vcpu, ARM_FEATURE_VFP3) ||
+	    !(p->cptr & CPTR_TFP_MASK)) {
+		return VMM_EFAIL;
+	}
+
+	/* Allow VFP access for VCPU and hypervisor */
+	p->cptr &= ~CPTR_TFP_MASK;
+	msr(cptr_el2, p->cptr);
+	isb();
+
+	/* Load VFP registers of this VCPU
+	 *
+	 * Note: VFP registers of previous owner need not be saved
+	 * because cpu_vcpu_vfp_save() already saved them when the
+	 * previous owner was switched-out.
+	 */
+	cpu_vcpu_vfp_regs_restore(&p->vfp);
+	this_cpu(vfp_owner) = vcpu;
+	p->vfp_hcpu = vmm_smp_processor_id();
+	p->vfp_loaded = TRUE;
+	p->vfp_lazy_miss++;
+
+	/* Retry the trapped instruction */
+	return VMM_OK;
 }
 
 void cpu_vcpu_vfp_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 {
 	u32 i;
-	struct arm_priv_vfp *vfp = &arm_priv(vcpu)->vfp;
+	struct arm_priv *p = arm_priv(vcpu);
+	struct arm_priv_vfp *vfp = &p->vfp;
 
 	/* Do nothing if:
 	 * 1. VCPU does not have VFPv3 feature
@@ -83,6 +140,10 @@ void cpu_vcpu_vfp_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 		return;
 	}
 
+	vmm_cprintf(cdev, "VFP Lazy Switching\n");
+	vmm_cprintf(cdev, " %11s=%-18"PRIu64" %11s=%"PRIu64"\n",
+		    "LAZY_HIT", p->vfp_lazy_hit,
+		    "LAZY_MISS", p->vfp_lazy_miss);
 	vmm_cprintf(cdev, "VFP Feature Registers\n");
 	vmm_cprintf(cdev, " %11s=0x%08"PRIx32"         %11s=0x%08"PRIx32"\n",
 		    "MVFR0_EL1", vfp->mvfr0,
@@ -113,6 +174,10 @@ int cpu_vcpu_vfp_init(struct vmm_vcpu *vcpu)
 
 	/* Clear VCPU VFP context */
 	memset(vfp, 0, sizeof(struct arm_priv_vfp));
+	p->vfp_loaded = FALSE;
+	p->vfp_hcpu = 0;
+	p->vfp_lazy_hit = 0;
+	p->vfp_lazy_miss = 0;
 
 	/* If host HW does not have VFP (i.e. software VFP) then
 	 * clear all VFP feature flags so that VCPU always gets
@@ -151,6 +216,15 @@ no_vfp_for_vcpu:
 
 int cpu_vcpu_vfp_deinit(struct vmm_vcpu *vcpu)
 {
-	/* For now nothing to do here. */
+	u32 hcpu;
+
+	/* Forget VFP registers owned by this VCPU */
+	for_each_online_cpu(hcpu) {
+		if (per_cpu(vfp_owner, hcpu) == vcpu) {
+			per_cpu(vfp_owner, hcpu) = NULL;
+		}
+	}
+	arm_priv(vcpu)->vfp_loaded = FALSE;
+
 	return VMM_OK;
 }
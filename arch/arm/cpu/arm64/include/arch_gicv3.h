@@ -47,6 +47,7 @@
 #define ICC_SRE_EL2			sys_reg(3, 4, 12, 9, 5)
 
 #define ISS_SRE_EL1			ISS_SYSREG_ENC(3, 5, 0, 12, 12)
+#define ISS_SGI1R_EL1			ISS_SYSREG_ENC(3, 5, 0, 12, 11)
 
 /*
  * System register definitions
@@ -148,6 +148,12 @@ struct arm_priv {
 	vmm_cpumask_t dflush_needed;
 	/* VFP & SMID context */
 	struct arm_priv_vfp vfp;
+	/* VFP registers of this VCPU are loaded on vfp_hcpu */
+	bool vfp_loaded;
+	u32 vfp_hcpu;
+	/* Lazy VFP switching stats */
+	u64 vfp_lazy_hit;
+	u64 vfp_lazy_miss;
 	/* Pointer Authentication context */
 	struct arm_priv_ptrauth ptrauth;
 	/* Last host CPU on which this VCPU ran */
@@ -159,6 +165,7 @@ struct arm_priv {
 	void (*vgic_save)(void *vcpu_ptr);
 	void (*vgic_restore)(void *vcpu_ptr);
 	bool (*vgic_irq_pending)(void *vcpu_ptr);
+	void (*vgic_sgi1r)(void *vcpu_ptr, u64 val);
 	void *vgic_priv;
 };
 
@@ -213,8 +220,13 @@ struct arm_guest_priv {
 		arm_priv(vcpu)->vgic_save = NULL; \
 		arm_priv(vcpu)->vgic_restore = NULL; \
 		arm_priv(vcpu)->vgic_irq_pending = NULL; \
+		arm_priv(vcpu)->vgic_sgi1r = NULL; \
 		arm_priv(vcpu)->vgic_priv = NULL; \
 	} while (0)
+#define arm_vgic_setup_sgi1r(vcpu, __sgi1r_func) \
+	do { \
+		arm_priv(vcpu)->vgic_sgi1r = __sgi1r_func; \
+	} while (0)
 #define arm_vgic_avail(vcpu)	(arm_priv(vcpu)->vgic_avail)
 #define arm_vgic_save(vcpu)	\
 	if (arm_vgic_avail(vcpu)) { \
@@ -232,6 +244,15 @@ struct arm_guest_priv {
 		} \
 		__r; \
 	})
+#define arm_vgic_sgi1r(vcpu, val)	\
+	({ \
+		bool __r = FALSE; \
+		if (arm_vgic_avail(vcpu) && arm_priv(vcpu)->vgic_sgi1r) { \
+			arm_priv(vcpu)->vgic_sgi1r(vcpu, val); \
+			__r = TRUE; \
+		} \
+		__r; \
+	})
 #define arm_vgic_priv(vcpu)	(arm_priv(vcpu)->vgic_priv)
 
 #endif
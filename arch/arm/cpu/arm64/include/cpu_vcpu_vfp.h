@@ -28,10 +28,18 @@
 #include <vmm_chardev.h>
 #include <vmm_manager.h>
 
-/** Save VFP context for given VCPU */
+/** Save VFP context for given VCPU
+ *  Note: VFP registers are saved only if VCPU accessed VFP
+ *  after it was switched-in.
+ */
 void cpu_vcpu_vfp_save(struct vmm_vcpu *vcpu);
 
-/** Restore VFP context for given VCPU */
+/** Restore VFP context for given VCPU
+ *  Note: VFP registers are not restored here instead first VFP
+ *  access of VCPU is trapped (unless VFP registers of VCPU are
+ *  still loaded on current host CPU) and handled by
+ *  cpu_vcpu_vfp_trap().
+ */
 void cpu_vcpu_vfp_restore(struct vmm_vcpu *vcpu);
 
 /** Handle VFP trap for given VCPU */
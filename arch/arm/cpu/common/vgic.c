@@ -18,10 +18,16 @@
  *
  * @file vgic.c
  * @author Anup Patel (anup@brainfault.org)
- * @brief Hardware assisted GICv2 emulator using GIC virt extensions.
+ * @brief Hardware assisted GICv2/GICv3 emulator using GIC virt extensions.
  *
  * This source is based on GICv2 software emulator located at:
  * emulators/pic/gic.c
+ *
+ * The GICv3 guest view ("arm,vgic-v3") is single region having the
+ * distributor followed by one redistributor (RD_base and SGI_base
+ * frames) per VCPU. It always uses affinity routing and only Group1
+ * interrupts. Guest SGIs are generated using ICC_SGI1R_EL1 writes
+ * which are trapped and forwarded here by arm64 sysregs emulation.
  */
 
 #include <vmm_error.h>
@@ -36,11 +42,12 @@
 #include <vmm_devemu.h>
 #include <vmm_modules.h>
 #include <arch_regs.h>
+#include <cpu_emulate_psci.h>
 #include <libs/bitmap.h>
 
 #include <vgic.h>
 
-#define MODULE_DESC			"GICv2 HW-assisted Emulator"
+#define MODULE_DESC			"GICv2/GICv3 HW-assisted Emulator"
 #define MODULE_AUTHOR			"Anup Patel"
 #define MODULE_LICENSE			"GPL"
 #define MODULE_IPRIORITY		0
@@ -55,10 +62,33 @@
 #define DPRINTF(msg...)
 #endif
 
-#define VGIC_MAX_NCPU			8
+#define VGIC_V2_MAX_NCPU		8
+#define VGIC_MAX_NCPU			32
 #define VGIC_MAX_NIRQ			256
 #define VGIC_LR_UNKNOWN			0xFF
 
+/* Guest view of GICv3 */
+#define VGIC_V3_DIST_SIZE		0x10000
+#define VGIC_V3_REDIST_SIZE		0x20000
+#define VGIC_V3_REDIST_SGI_BASE		0x10000
+#define VGIC_V3_IIDR			0x0000043B
+#define VGIC_V3_PIDR2			0x0000003B
+#define VGIC_V3_IDBITS			10
+#define VGIC_V3_CTLR_ENABLE_MASK	0x00000003
+#define VGIC_V3_CTLR_ARE		0x00000010
+#define VGIC_V3_CTLR_DS			0x00000040
+#define VGIC_V3_TYPER_LAST		0x00000010
+#define VGIC_V3_WAKER_PSLEEP		0x00000002
+#define VGIC_V3_WAKER_CASLEEP		0x00000004
+#define VGIC_V3_IROUTER_IRM		0x80000000ULL
+#define VGIC_V3_SGI1R_TARGETS(v)	((u32)(v) & 0xFFFF)
+#define VGIC_V3_SGI1R_INTID(v)		((u32)((v) >> 24) & 0xF)
+#define VGIC_V3_SGI1R_IRM		(1ULL << 40)
+#define VGIC_V3_SGI1R_RS(v)		((u32)((v) >> 44) & 0xF)
+#define VGIC_V3_SGI1R_AFF(v)		((((u32)((v) >> 48) & 0xFF) << 24) | \
+					 (((u32)((v) >> 32) & 0xFF) << 16) | \
+					 (((u32)((v) >> 16) & 0xFF) << 8))
+
 struct vgic_host_ctrl {
 	bool avail;
 	struct vgic_ops ops;
@@ -68,8 +98,8 @@ struct vgic_host_ctrl {
 static struct vgic_host_ctrl vgich;
 
 struct vgic_irq_state {
-	u32 active:VGIC_MAX_NCPU;
-	u32 level:VGIC_MAX_NCPU;
+	u32 active;
+	u32 level;
 	u32 model:1; /* 0 = N:N, 1 = 1:N */
 	u32 trigger:1; /* nonzero = edge triggered.  */
 	u32 host_irq; /* If UINT_MAX then not mapped to host irq else mapped */
@@ -87,6 +117,10 @@ struct vgic_vcpu_state {
 	u32 lr_used_count;
 	u32 lr_used[VGIC_MAX_LRS / 32];
 	u8 irq_lr[VGIC_MAX_NIRQ];
+
+	/* GICv3 redistributor (Aff3.Aff2.Aff1.Aff0 and GICR_WAKER) */
+	u32 affinity;
+	u32 redist_waker;
 };
 
 struct vgic_guest_state {
@@ -94,9 +128,11 @@ struct vgic_guest_state {
 	struct vmm_guest *guest;
 
 	/* Configuration */
+	enum vgic_model_type model;
 	u8 id[8];
 	u32 num_cpu;
 	u32 num_irq;
+	u32 redist_offset;
 
 	/* Context of each VCPU */
 	struct vgic_vcpu_state vstate[VGIC_MAX_NCPU];
@@ -111,6 +147,7 @@ struct vgic_guest_state {
 	struct vgic_irq_state irq_state[VGIC_MAX_NIRQ];
 	u32 sgi_source[VGIC_MAX_NCPU][16];
 	u32 irq_target[VGIC_MAX_NIRQ];
+	u64 irq_route[VGIC_MAX_NIRQ];
 	u32 priority1[32][VGIC_MAX_NCPU];
 	u32 priority2[VGIC_MAX_NIRQ - 32];
 	u32 irq_enabled[VGIC_MAX_NCPU][VGIC_MAX_NIRQ / 32];
@@ -124,7 +161,7 @@ static void __vgic_set_enabled(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		s->irq_enabled[i][irq >> 5] |= (1 << (irq & 0x1f));
 	}
@@ -137,7 +174,7 @@ static void __vgic_clear_enabled(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		s->irq_enabled[i][irq >> 5] &= ~(1 << (irq & 0x1f));
 	}
@@ -150,7 +187,7 @@ static bool __vgic_test_enabled(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		if (s->irq_enabled[i][irq >> 5] & (1 << (irq & 0x1f)))
 			return TRUE;
@@ -165,7 +202,7 @@ static void __vgic_set_pending(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		s->irq_pending[i][irq >> 5] |= (1 << (irq & 0x1f));
 	}
@@ -178,7 +215,7 @@ static void __vgic_clear_pending(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		s->irq_pending[i][irq >> 5] &= ~(1 << (irq & 0x1f));
 	}
@@ -191,7 +228,7 @@ static bool __vgic_test_pending(struct vgic_guest_state *s, u32 irq, u32 cm)
 {
 	u32 i;
 	for (i = 0; i < s->num_cpu; i++) {
-		if (!(cm & (1 << i)))
+		if (!(cm & (1U << i)))
 			continue;
 		if (s->irq_pending[i][irq >> 5] & (1 << (irq & 0x1f)))
 			return TRUE;
@@ -199,7 +236,7 @@ static bool __vgic_test_pending(struct vgic_guest_state *s, u32 irq, u32 cm)
 	return FALSE;
 }
 
-#define VGIC_ALL_CPU_MASK(s) ((1 << (s)->num_cpu) - 1)
+#define VGIC_ALL_CPU_MASK(s) ((u32)((1ULL << (s)->num_cpu) - 1))
 #define VGIC_NUM_CPU(s) ((s)->num_cpu)
 #define VGIC_NUM_IRQ(s) ((s)->num_irq)
 #define VGIC_SET_ENABLED(s, irq, cm) __vgic_set_enabled(s, irq, cm)
@@ -278,10 +315,10 @@ static bool __vgic_queue_irq(struct vgic_guest_state *s,
 	lr = VGIC_GET_LR_MAP(vs, irq);
 	if ((lr < vgich.params.lr_cnt) &&
 	    VGIC_TEST_LR_USED(vs, lr)) {
-		vgich.ops.get_lr(lr, &lrv, VGIC_MODEL_V2);
+		vgich.ops.get_lr(lr, &lrv, s->model);
 		if (lrv.virtid == irq) {
 			lrv.flags |= VGIC_LR_STATE_PENDING;
-			vgich.ops.set_lr(lr, &lrv, VGIC_MODEL_V2);
+			vgich.ops.set_lr(lr, &lrv, s->model);
 			return TRUE;
 		}
 	}
@@ -313,7 +350,7 @@ static bool __vgic_queue_irq(struct vgic_guest_state *s,
 		lrv.physid = hirq;
 	}
 
-	vgich.ops.set_lr(lr, &lrv, VGIC_MODEL_V2);
+	vgich.ops.set_lr(lr, &lrv, s->model);
 
 	return TRUE;
 }
@@ -329,18 +366,18 @@ static bool __vgic_queue_sgi(struct vgic_guest_state *s,
 	u32 c, source = s->sgi_source[vs->vcpu->subid][irq];
 
 	for (c = 0; c < VGIC_NUM_CPU(s); c++) {
-		if (!(source & (1 << c))) {
+		if (!(source & (1U << c))) {
 			continue;
 		}
 		if (__vgic_queue_irq(s, vs, irq)) {
-			source &= ~(1 << c);
+			source &= ~(1U << c);
 		}
 	}
 
 	s->sgi_source[vs->vcpu->subid][irq] = source;
 
 	if (!source) {
-		VGIC_CLEAR_PENDING(s, irq, (1 << vs->vcpu->subid));
+		VGIC_CLEAR_PENDING(s, irq, (1U << vs->vcpu->subid));
 		return TRUE;
 	}
 
@@ -355,7 +392,7 @@ static bool __vgic_queue_hwirq(struct vgic_guest_state *s,
 			       struct vgic_vcpu_state *vs,
 			       u32 irq)
 {
-	u32 cm = (1 << vs->vcpu->subid);
+	u32 cm = (1U << vs->vcpu->subid);
 
 	if (VGIC_TEST_ACTIVE(s, irq, cm)) {
 		return TRUE; /* level interrupt, already queued */
@@ -481,7 +518,7 @@ static void __vgic_sync_vcpu_hwstate(struct vgic_guest_state *s,
 	u32 elrsr[2], eisr[2];
 	struct vgic_lr lrv = { .virtid = 0, .physid = 0,
 			       .prio = 0, .flags = 0 };
-	register u32 lr, irq, cm = (1 << vs->vcpu->subid);
+	register u32 lr, irq, cm = (1U << vs->vcpu->subid);
 
 	/* If no LR used then skip */
 	if (!VGIC_HAVE_LR_USED(vs)) {
@@ -513,7 +550,7 @@ static void __vgic_sync_vcpu_hwstate(struct vgic_guest_state *s,
 		}
 
 		/* Read and clear the LR register */
-		vgich.ops.get_lr(lr, &lrv, VGIC_MODEL_V2);
+		vgich.ops.get_lr(lr, &lrv, s->model);
 		vgich.ops.clear_lr(lr);
 
 		/* Determine irq number */
@@ -583,7 +620,8 @@ static void __vgic_irq_handle(struct vgic_guest_state *s, u32 irq, int cpu,
 {
 	irq_flags_t flags;
 	bool irq_pending;
-	int i, cm, target, level;
+	int i, level;
+	u32 cm, target;
 	struct vgic_vcpu_state *vs;
 
 	/* Lock VGIC distributor state */
@@ -596,13 +634,13 @@ static void __vgic_irq_handle(struct vgic_guest_state *s, u32 irq, int cpu,
 
 	if (irq < 32) {
 		/* In case of PPIs and SGIs */
-		cm = target = (1 << cpu);
+		cm = target = (1U << cpu);
 	} else {
 		/* In case of SPIs */
 		cm = VGIC_ALL_CPU_MASK(s);
 		target = VGIC_TARGET(s, irq);
 		for (cpu = 0; cpu < VGIC_NUM_CPU(s); cpu++) {
-			if (target & (1 << cpu)) {
+			if (target & (1U << cpu)) {
 				break;
 			}
 		}
@@ -802,7 +840,7 @@ static void vgic_save_vcpu_context(void *vcpu_ptr)
 	vmm_spin_unlock_irqrestore_lite(&s->dist_lock, flags);
 
 	/* Save VGIC HW registers for VCPU */
-	vgich.ops.save_state(&vs->hw, VGIC_MODEL_V2);
+	vgich.ops.save_state(&vs->hw, s->model);
 }
 
 /* Restore VCPU context for current VCPU */
@@ -819,7 +857,7 @@ static void vgic_restore_vcpu_context(void *vcpu_ptr)
 	vs = &s->vstate[vcpu->subid];
 
 	/* Restore VGIC HW registers for VCPU */
-	vgich.ops.restore_state(&vs->hw, VGIC_MODEL_V2);
+	vgich.ops.restore_state(&vs->hw, s->model);
 
 	/* Lock VGIC distributor state */
 	vmm_spin_lock_irqsave_lite(&s->dist_lock, flags);
@@ -875,7 +913,7 @@ static int __vgic_dist_readb(struct vgic_guest_state *s, int cpu,
 		}
 		*dst = 0;
 		for (i = 0; i < 8; i++) {
-			*dst |= VGIC_TEST_ENABLED(s, irq + i, (1 << cpu)) ?
+			*dst |= VGIC_TEST_ENABLED(s, irq + i, (1U << cpu)) ?
 				(1 << i) : 0x0;
 		}
 		break;
@@ -885,7 +923,7 @@ static int __vgic_dist_readb(struct vgic_guest_state *s, int cpu,
 			done = 0;
 			break;
 		}
-		mask = (irq < 32) ? (1 << cpu) : VGIC_ALL_CPU_MASK(s);
+		mask = (irq < 32) ? (1U << cpu) : VGIC_ALL_CPU_MASK(s);
 		*dst = 0;
 		for (i = 0; i < 8; i++) {
 			*dst |= VGIC_TEST_PENDING(s, irq + i, mask) ?
@@ -898,7 +936,7 @@ static int __vgic_dist_readb(struct vgic_guest_state *s, int cpu,
 			done = 0;
 			break;
 		}
-		mask = (irq < 32) ? (1 << cpu) : VGIC_ALL_CPU_MASK(s);
+		mask = (irq < 32) ? (1U << cpu) : VGIC_ALL_CPU_MASK(s);
 		*dst = 0;
 		for (i = 0; i < 8; i++) {
 			*dst |= VGIC_TEST_ACTIVE(s, irq + i, mask) ?
@@ -920,7 +958,7 @@ static int __vgic_dist_readb(struct vgic_guest_state *s, int cpu,
 			break;
 		}
 		if (irq < 32) {
-			*dst = 1 << cpu;
+			*dst = 1U << cpu;
 		} else {
 			*dst = VGIC_TARGET(s, irq);
 		}
@@ -1001,9 +1039,9 @@ static int __vgic_dist_writeb(struct vgic_guest_state *s, int cpu,
 					continue;
 				}
 				mask = ((irq + i) < 32) ?
-					(1 << cpu) : VGIC_TARGET(s, (irq + i));
+					(1U << cpu) : VGIC_TARGET(s, (irq + i));
 				cm = ((irq + i) < 32) ?
-					(1 << cpu) : VGIC_ALL_CPU_MASK(s);
+					(1U << cpu) : VGIC_ALL_CPU_MASK(s);
 				VGIC_SET_ENABLED(s, irq + i, cm);
 				if (cm == VGIC_ALL_CPU_MASK(s)) {
 					vmm_devemu_notify_irq_enabled(
@@ -1029,7 +1067,7 @@ static int __vgic_dist_writeb(struct vgic_guest_state *s, int cpu,
 					continue;
 				}
 				cm = ((irq + i) < 32) ?
-					(1 << cpu) : VGIC_ALL_CPU_MASK(s);
+					(1U << cpu) : VGIC_ALL_CPU_MASK(s);
 				VGIC_CLEAR_ENABLED(s, irq + i, cm);
 				if (cm == VGIC_ALL_CPU_MASK(s)) {
 					vmm_devemu_notify_irq_disabled(
@@ -1156,13 +1194,74 @@ static int vgic_dist_read(struct vgic_guest_state *s, int cpu,
 	return VMM_OK;
 }
 
+/* Make SGI pending for VCPUs in given mask
+ * Note: Must be called with VGIC distributor lock held
+ */
+static void __vgic_send_sgi(struct vgic_guest_state *s, int cpu,
+			    u32 irq, u32 sgi_mask)
+{
+	u32 i;
+
+	VGIC_SET_PENDING(s, irq, sgi_mask);
+	for (i = 0; (irq < 16) && (i < VGIC_NUM_CPU(s)); i++) {
+		if (!(sgi_mask & (1U << i))) {
+			continue;
+		}
+		/* GICv3 guests do use SGIs targeted to self */
+		if ((s->model == VGIC_MODEL_V2) && (i == cpu)) {
+			continue;
+		}
+		s->sgi_source[i][irq] |= (1U << cpu);
+		DPRINTF("%s: VCPU=%s IRQ%d SRC_ID=0x%d pending\n",
+			__func__, s->vstate[i].vcpu->name, irq, cpu);
+	}
+}
+
+/* Sync & Flush given VCPU and find VCPUs (out of given VCPU mask)
+ * having pending interrupts
+ * Note: Must be called only when given VCPU is current VCPU
+ * Note: Must be called with VGIC distributor lock held
+ */
+static u32 __vgic_sync_and_pending_mask(struct vgic_guest_state *s,
+					struct vgic_vcpu_state *vs,
+					u32 vcpu_mask)
+{
+	u32 i, pending_mask = 0;
+
+	/* Sync & Flush VGIC state changes to VGIC HW */
+	__vgic_sync_and_flush_vcpu(s, vs);
+
+	/* Check for pending interrupts */
+	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
+		if (!(vcpu_mask & (1U << i)))
+			continue;
+		if (__vgic_vcpu_irq_pending(s, &s->vstate[i]))
+			pending_mask |= (1U << i);
+	}
+
+	return pending_mask;
+}
+
+/* Assert/Deassert interrupt of VCPUs in given VCPU mask */
+static void vgic_vcpus_irq_update(struct vgic_guest_state *s,
+				  u32 vcpu_mask, u32 pending_mask)
+{
+	u32 i;
+
+	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
+		if (!(vcpu_mask & (1U << i)))
+			continue;
+		vgic_vcpu_irq_update(s->vstate[i].vcpu,
+				     (pending_mask & (1U << i)) ? TRUE : FALSE);
+	}
+}
+
 static int vgic_dist_write(struct vgic_guest_state *s, int cpu,
 			   u32 offset, u32 src_mask, u32 src)
 {
 	int rc = VMM_OK;
-	u32 i, irq, sgi_mask, update_mask = 0;
+	u32 i, irq, sgi_mask, update_mask;
 	irq_flags_t flags;
-	struct vgic_vcpu_state *vs;
 
 	if (!s) {
 		return VMM_EFAIL;
@@ -1170,8 +1269,6 @@ static int vgic_dist_write(struct vgic_guest_state *s, int cpu,
 
 	vmm_spin_lock_irqsave_lite(&s->dist_lock, flags);
 
-	vs = &s->vstate[cpu];
-
 	if (offset == 0xF00) {
 		/* Software Interrupt */
 		irq = src & 0x3FF;
@@ -1180,27 +1277,16 @@ static int vgic_dist_write(struct vgic_guest_state *s, int cpu,
 			sgi_mask = (src >> 16) & VGIC_ALL_CPU_MASK(s);
 			break;
 		case 1:
-			sgi_mask = VGIC_ALL_CPU_MASK(s) ^ (1 << cpu);
+			sgi_mask = VGIC_ALL_CPU_MASK(s) ^ (1U << cpu);
 			break;
 		case 2:
-			sgi_mask = 1 << cpu;
+			sgi_mask = 1U << cpu;
 			break;
 		default:
 			sgi_mask = VGIC_ALL_CPU_MASK(s);
 			break;
 		};
-		VGIC_SET_PENDING(s, irq, sgi_mask);
-		for (i = 0; (irq < 16) && (i < VGIC_NUM_CPU(s)); i++) {
-			if (!(sgi_mask & (1 << i))) {
-				continue;
-			}
-			if (s->vstate[i].vcpu->subid == vs->vcpu->subid) {
-				continue;
-			}
-			s->sgi_source[i][irq] |= (1 << cpu);
-			DPRINTF("%s: VCPU=%s IRQ%d SRC_ID=0x%d pending\n",
-				__func__, s->vstate[i].vcpu->name, irq, cpu);
-		}
+		__vgic_send_sgi(s, cpu, irq, sgi_mask);
 	} else {
 		sgi_mask = 0x0;
 		src_mask = ~src_mask;
@@ -1217,21 +1303,13 @@ static int vgic_dist_write(struct vgic_guest_state *s, int cpu,
 	}
 
 	/* Sync & Flush VGIC state changes to VGIC HW */
-	__vgic_sync_and_flush_vcpu(s, vs);
-
-	/* Check for pending interrupts */
-	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
-		if (__vgic_vcpu_irq_pending(s, &s->vstate[i]))
-			update_mask |= (1U << i);
-	}
+	update_mask = __vgic_sync_and_pending_mask(s, &s->vstate[cpu],
+						   VGIC_ALL_CPU_MASK(s));
 
 	vmm_spin_unlock_irqrestore_lite(&s->dist_lock, flags);
 
 	/* Update VCPU irqs */
-	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
-		vgic_vcpu_irq_update(s->vstate[i].vcpu,
-				     (update_mask & (1U << i)) ? TRUE : FALSE);
-	}
+	vgic_vcpus_irq_update(s, VGIC_ALL_CPU_MASK(s), update_mask);
 
 	return rc;
 }
@@ -1269,6 +1347,395 @@ static int vgic_dist_reg_write(struct vgic_guest_state *s,
 			       offset & 0xFFC, regmask, regval);
 }
 
+/* Find target VCPU mask of GICv3 affinity route
+ * Note: 1 of N routing is treated same as GICv2 multiple targets
+ */
+static u32 __vgic_v3_route2target(struct vgic_guest_state *s, u64 route)
+{
+	u32 i, aff;
+
+	if (route & VGIC_V3_IROUTER_IRM) {
+		return VGIC_ALL_CPU_MASK(s);
+	}
+
+	aff = ((u32)route & 0xFFFFFF) | (((u32)(route >> 32) & 0xFF) << 24);
+	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
+		if (s->vstate[i].affinity == aff) {
+			return (1U << i);
+		}
+	}
+
+	return 0x0;
+}
+
+/*
+ * Guest GICv3 is only available for AArch64 because SGIs are generated
+ * by guest using ICC_SGI1R_EL1 which is trapped by arm64 sysregs code.
+ */
+#ifdef CONFIG_ARM64
+/* First interrupt described by a byte-wise distributor register */
+static u32 __vgic_dist_reg_irq(u32 offset)
+{
+	switch (offset >> 8) {
+	case 0x1: /* Enable */
+	case 0x2: /* Pending */
+	case 0x3: /* Active */
+		return (offset & 0x7F) * 8;
+	case 0x4: /* Priority */
+		return offset - 0x400;
+	case 0xC: /* Configuration */
+		return (offset - 0xC00) * 4;
+	default:
+		break;
+	};
+
+	return UINT_MAX;
+}
+
+/* Read GICv3 distributor register
+ * Note: Must be called with VGIC distributor lock held
+ */
+static void __vgic_v3_dist_read(struct vgic_guest_state *s, int cpu,
+				u32 offset, u32 *dst)
+{
+	u32 i, irq;
+	u8 val;
+
+	*dst = 0x0;
+
+	switch (offset) {
+	case 0x0000: /* Distributor control */
+		*dst = s->enabled | VGIC_V3_CTLR_ARE | VGIC_V3_CTLR_DS;
+		return;
+	case 0x0004: /* Interrupt controller type */
+		*dst = ((VGIC_V3_IDBITS - 1) << 19) |
+		       ((VGIC_NUM_IRQ(s) / 32) - 1);
+		return;
+	case 0x0008: /* Implementer identification */
+		*dst = VGIC_V3_IIDR;
+		return;
+	case 0xFFE8: /* Peripheral ID2 */
+		*dst = VGIC_V3_PIDR2;
+		return;
+	default:
+		break;
+	};
+
+	if ((0x0080 <= offset) && (offset < 0x0100)) {
+		/* Group (all interrupts are Group1) */
+		irq = (offset - 0x0080) * 8;
+		if ((32 <= irq) && (irq < VGIC_NUM_IRQ(s))) {
+			*dst = 0xFFFFFFFF;
+		}
+	} else if ((0x6000 <= offset) && (offset < 0x8000)) {
+		/* Affinity routing */
+		irq = (offset - 0x6000) >> 3;
+		if ((32 <= irq) && (irq < VGIC_NUM_IRQ(s))) {
+			*dst = (offset & 0x4) ?
+				(u32)(s->irq_route[irq] >> 32) :
+				(u32)s->irq_route[irq];
+		}
+	} else {
+		/* SGIs and PPIs are only visible in redistributors */
+		irq = __vgic_dist_reg_irq(offset);
+		if ((irq < 32) || (VGIC_NUM_IRQ(s) <= irq)) {
+			return;
+		}
+		for (i = 0; i < 4; i++) {
+			if (__vgic_dist_readb(s, cpu, offset + i, &val)) {
+				break;
+			}
+			*dst |= (u32)val << (i * 8);
+		}
+	}
+}
+
+/* Write GICv3 distributor register
+ * Note: Must be called with VGIC distributor lock held
+ */
+static void __vgic_v3_dist_write(struct vgic_guest_state *s, int cpu,
+				 u32 offset, u32 src_mask, u32 src)
+{
+	u32 i, irq, val;
+	u64 route;
+
+	if (offset == 0x0000) {
+		/* Distributor control (ARE and DS are RAO/WI) */
+		if (!(src_mask & 0xFF)) {
+			s->enabled = src & VGIC_V3_CTLR_ENABLE_MASK;
+		}
+	} else if ((0x6000 <= offset) && (offset < 0x8000)) {
+		/* Affinity routing */
+		irq = (offset - 0x6000) >> 3;
+		if ((irq < 32) || (VGIC_NUM_IRQ(s) <= irq)) {
+			return;
+		}
+		route = s->irq_route[irq];
+		if (offset & 0x4) {
+			val = ((u32)(route >> 32) & src_mask) | (src & ~src_mask);
+			route = (route & 0xFFFFFFFFULL) | ((u64)val << 32);
+		} else {
+			val = ((u32)route & src_mask) | (src & ~src_mask);
+			route = (route & ~0xFFFFFFFFULL) | val;
+		}
+		route &= 0xFF80FFFFFFULL;
+		s->irq_route[irq] = route;
+		s->irq_target[irq] = __vgic_v3_route2target(s, route);
+	} else {
+		/* SGIs and PPIs are only visible in redistributors */
+		irq = __vgic_dist_reg_irq(offset);
+		if ((irq < 32) || (VGIC_NUM_IRQ(s) <= irq)) {
+			return;
+		}
+		src_mask = ~src_mask;
+		for (i = 0; i < 4; i++) {
+			if (src_mask & 0xFF) {
+				if (__vgic_dist_writeb(s, cpu,
+						offset + i, src & 0xFF)) {
+					break;
+				}
+			}
+			src_mask = src_mask >> 8;
+			src = src >> 8;
+		}
+	}
+}
+
+/* Read GICv3 redistributor register of given VCPU
+ * Note: Must be called with VGIC distributor lock held
+ */
+static void __vgic_v3_redist_read(struct vgic_guest_state *s, int cpu,
+				  u32 offset, u32 *dst)
+{
+	u32 i, irq;
+	u8 val;
+	struct vgic_vcpu_state *vs = &s->vstate[cpu];
+
+	*dst = 0x0;
+
+	if (offset < VGIC_V3_REDIST_SGI_BASE) {
+		switch (offset) {
+		case 0x0004: /* Implementer identification */
+			*dst = VGIC_V3_IIDR;
+			break;
+		case 0x0008: /* Redistributor type (lower) */
+			*dst = (u32)cpu << 8;
+			if ((u32)cpu == (VGIC_NUM_CPU(s) - 1)) {
+				*dst |= VGIC_V3_TYPER_LAST;
+			}
+			break;
+		case 0x000C: /* Redistributor type (upper) */
+			*dst = vs->affinity;
+			break;
+		case 0x0014: /* Redistributor wake */
+			*dst = vs->redist_waker;
+			if (vs->redist_waker & VGIC_V3_WAKER_PSLEEP) {
+				*dst |= VGIC_V3_WAKER_CASLEEP;
+			}
+			break;
+		case 0xFFE8: /* Peripheral ID2 */
+			*dst = VGIC_V3_PIDR2;
+			break;
+		default:
+			break;
+		};
+		return;
+	}
+
+	offset -= VGIC_V3_REDIST_SGI_BASE;
+	if (offset == 0x0080) {
+		/* Group (all interrupts are Group1) */
+		*dst = 0xFFFFFFFF;
+		return;
+	}
+
+	irq = __vgic_dist_reg_irq(offset);
+	if (32 <= irq) {
+		return;
+	}
+	for (i = 0; i < 4; i++) {
+		if (__vgic_dist_readb(s, cpu, offset + i, &val)) {
+			break;
+		}
+		*dst |= (u32)val << (i * 8);
+	}
+}
+
+/* Write GICv3 redistributor register of given VCPU
+ * Note: Must be called with VGIC distributor lock held
+ */
+static void __vgic_v3_redist_write(struct vgic_guest_state *s, int cpu,
+				   u32 offset, u32 src_mask, u32 src)
+{
+	u32 i, irq;
+	struct vgic_vcpu_state *vs = &s->vstate[cpu];
+
+	if (offset < VGIC_V3_REDIST_SGI_BASE) {
+		if (offset == 0x0014) { /* Redistributor wake */
+			vs->redist_waker = (vs->redist_waker & src_mask) |
+					   (src & ~src_mask);
+			vs->redist_waker &= VGIC_V3_WAKER_PSLEEP;
+		}
+		return;
+	}
+
+	offset -= VGIC_V3_REDIST_SGI_BASE;
+	irq = __vgic_dist_reg_irq(offset);
+	if (32 <= irq) {
+		return;
+	}
+	src_mask = ~src_mask;
+	for (i = 0; i < 4; i++) {
+		if (src_mask & 0xFF) {
+			if (__vgic_dist_writeb(s, cpu, offset + i, src & 0xFF)) {
+				break;
+			}
+		}
+		src_mask = src_mask >> 8;
+		src = src >> 8;
+	}
+}
+
+/* Find redistributor for given offset and convert offset to
+ * redistributor frame offset. Returns -1 if there is no such
+ * redistributor.
+ */
+static int vgic_v3_redist_index(struct vgic_guest_state *s, u32 *offset)
+{
+	u32 redist;
+
+	if (*offset < s->redist_offset) {
+		return -1;
+	}
+
+	redist = (*offset - s->redist_offset) / VGIC_V3_REDIST_SIZE;
+	if (VGIC_NUM_CPU(s) <= redist) {
+		return -1;
+	}
+	*offset = (*offset - s->redist_offset) & (VGIC_V3_REDIST_SIZE - 1);
+
+	return redist;
+}
+
+static int vgic_v3_reg_read(struct vgic_guest_state *s,
+			    u32 offset, u32 *dst)
+{
+	int redist, rc = VMM_OK;
+	irq_flags_t flags;
+	struct vmm_vcpu *vcpu;
+
+	vcpu = vmm_scheduler_current_vcpu();
+	if (!vcpu || !vcpu->guest) {
+		return VMM_EFAIL;
+	}
+	if (s->guest->id != vcpu->guest->id) {
+		return VMM_EFAIL;
+	}
+
+	vmm_spin_lock_irqsave_lite(&s->dist_lock, flags);
+
+	if (offset < VGIC_V3_DIST_SIZE) {
+		__vgic_v3_dist_read(s, vcpu->subid, offset, dst);
+	} else if ((redist = vgic_v3_redist_index(s, &offset)) >= 0) {
+		__vgic_v3_redist_read(s, redist, offset, dst);
+	} else {
+		rc = VMM_EFAIL;
+	}
+
+	vmm_spin_unlock_irqrestore_lite(&s->dist_lock, flags);
+
+	return rc;
+}
+
+static int vgic_v3_reg_write(struct vgic_guest_state *s,
+			     u32 offset, u32 src_mask, u32 src)
+{
+	int redist, rc = VMM_OK;
+	u32 update_mask;
+	irq_flags_t flags;
+	struct vmm_vcpu *vcpu;
+
+	vcpu = vmm_scheduler_current_vcpu();
+	if (!vcpu || !vcpu->guest) {
+		return VMM_EFAIL;
+	}
+	if (s->guest->id != vcpu->guest->id) {
+		return VMM_EFAIL;
+	}
+
+	vmm_spin_lock_irqsave_lite(&s->dist_lock, flags);
+
+	if (offset < VGIC_V3_DIST_SIZE) {
+		__vgic_v3_dist_write(s, vcpu->subid, offset, src_mask, src);
+	} else if ((redist = vgic_v3_redist_index(s, &offset)) >= 0) {
+		__vgic_v3_redist_write(s, redist, offset, src_mask, src);
+	} else {
+		rc = VMM_EFAIL;
+	}
+
+	/* Sync & Flush VGIC state changes to VGIC HW */
+	update_mask = __vgic_sync_and_pending_mask(s,
+				&s->vstate[vcpu->subid], VGIC_ALL_CPU_MASK(s));
+
+	vmm_spin_unlock_irqrestore_lite(&s->dist_lock, flags);
+
+	/* Update VCPU irqs */
+	vgic_vcpus_irq_update(s, VGIC_ALL_CPU_MASK(s), update_mask);
+
+	return rc;
+}
+
+/* Process ICC_SGI1R_EL1 write trapped from current VCPU */
+static void vgic_v3_sgi1r_write(void *vcpu_ptr, u64 val)
+{
+	irq_flags_t flags;
+	u32 i, aff, targets, sgi_mask = 0x0, update_mask, vcpu_mask;
+	struct vgic_guest_state *s;
+	struct vmm_vcpu *vcpu = vcpu_ptr;
+
+	BUG_ON(!vcpu);
+
+	s = arm_vgic_priv(vcpu);
+
+	if (val & VGIC_V3_SGI1R_IRM) {
+		/* All VCPUs other than self */
+		sgi_mask = VGIC_ALL_CPU_MASK(s) & ~(1U << vcpu->subid);
+	} else {
+		/* VCPUs of Aff3.Aff2.Aff1 cluster selected by TargetList */
+		targets = VGIC_V3_SGI1R_TARGETS(val);
+		for (i = 0; i < VGIC_NUM_CPU(s); i++) {
+			aff = s->vstate[i].affinity;
+			if (((aff & ~0xFF) != VGIC_V3_SGI1R_AFF(val)) ||
+			    (((aff & 0xFF) >> 4) != VGIC_V3_SGI1R_RS(val))) {
+				continue;
+			}
+			if (targets & (1U << (aff & 0xF))) {
+				sgi_mask |= (1U << i);
+			}
+		}
+	}
+
+	DPRINTF("%s: VCPU=%s IRQ%d sgi_mask=0x%x\n",
+		__func__, vcpu->name, VGIC_V3_SGI1R_INTID(val), sgi_mask);
+
+	/* Only target VCPUs and self need update */
+	vcpu_mask = sgi_mask | (1U << vcpu->subid);
+
+	vmm_spin_lock_irqsave_lite(&s->dist_lock, flags);
+
+	__vgic_send_sgi(s, vcpu->subid, VGIC_V3_SGI1R_INTID(val), sgi_mask);
+
+	/* Sync & Flush VGIC state changes to VGIC HW */
+	update_mask = __vgic_sync_and_pending_mask(s,
+					&s->vstate[vcpu->subid], vcpu_mask);
+
+	vmm_spin_unlock_irqrestore_lite(&s->dist_lock, flags);
+
+	/* Update VCPU irqs */
+	vgic_vcpus_irq_update(s, vcpu_mask, update_mask);
+}
+#endif
+
 static int vgic_dist_emulator_read8(struct vmm_emudev *edev,
 				    physical_addr_t offset,
 				    u8 *dst)
@@ -1327,11 +1794,10 @@ static int vgic_dist_emulator_write32(struct vmm_emudev *edev,
 	return vgic_dist_reg_write(edev->priv, offset, 0x00000000, src);
 }
 
-static int vgic_dist_emulator_reset(struct vmm_emudev *edev)
+static int vgic_state_reset(struct vgic_guest_state *s)
 {
 	u32 i, j;
 	irq_flags_t flags;
-	struct vgic_guest_state *s = edev->priv;
 
 	DPRINTF("%s: guest=%s\n", __func__, s->guest->name);
 
@@ -1344,7 +1810,7 @@ static int vgic_dist_emulator_reset(struct vmm_emudev *edev)
 	 * 2. Deactivate host/HW interrupts for pending LRs.
 	 */
 	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
-		vgich.ops.reset_state(&s->vstate[i].hw, VGIC_MODEL_V2);
+		vgich.ops.reset_state(&s->vstate[i].hw, s->model);
 		s->vstate[i].lr_used_count = 0x0;
 		for (j = 0; j < ((vgich.params.lr_cnt + 31) / 32); j++) {
 			s->vstate[i].lr_used[j] = 0x0;
@@ -1380,6 +1846,17 @@ static int vgic_dist_emulator_reset(struct vmm_emudev *edev)
 		VGIC_SET_TRIGGER(s, i);
 	}
 
+	/* Reset redistributors and affinity routing of GICv3 */
+	if (s->model == VGIC_MODEL_V3) {
+		for (i = 0; i < VGIC_NUM_CPU(s); i++) {
+			s->vstate[i].redist_waker = VGIC_V3_WAKER_PSLEEP;
+		}
+		for (i = 32; i < VGIC_NUM_IRQ(s); i++) {
+			s->irq_route[i] = 0x0;
+			s->irq_target[i] = __vgic_v3_route2target(s, 0x0);
+		}
+	}
+
 	/* Disable guest dist interface */
 	s->enabled = 0;
 
@@ -1388,6 +1865,11 @@ static int vgic_dist_emulator_reset(struct vmm_emudev *edev)
 	return VMM_OK;
 }
 
+static int vgic_dist_emulator_reset(struct vmm_emudev *edev)
+{
+	return vgic_state_reset(edev->priv);
+}
+
 static struct vmm_devemu_irqchip vgic_irqchip = {
 	.name = "VGIC",
 	.handle = vgic_irq_handle,
@@ -1398,11 +1880,13 @@ static struct vmm_devemu_irqchip vgic_irqchip = {
 
 static struct vgic_guest_state *vgic_state_alloc(const char *name,
 						 struct vmm_guest *guest,
+						 enum vgic_model_type model,
 						 u32 num_cpu,
 						 u32 num_irq,
 						 u32 parent_irq)
 {
 	u32 i;
+	u64 mpidr;
 	struct vmm_vcpu *vcpu;
 	struct vgic_guest_state *s = NULL;
 
@@ -1414,6 +1898,7 @@ static struct vgic_guest_state *vgic_state_alloc(const char *name,
 
 	s->guest = guest;
 
+	s->model = model;
 	s->num_cpu = num_cpu;
 	s->num_irq = num_irq;
 	s->id[0] = 0x90 /* id0 */;
@@ -1432,6 +1917,9 @@ static struct vgic_guest_state *vgic_state_alloc(const char *name,
 	for (i = 0; i < VGIC_NUM_CPU(s); i++) {
 		s->vstate[i].vcpu = vmm_manager_guest_vcpu(guest, i);
 		s->vstate[i].parent_irq = parent_irq;
+		mpidr = emulate_psci_get_mpidr(s->vstate[i].vcpu);
+		s->vstate[i].affinity = ((u32)mpidr & 0xFFFFFF) |
+					(((u32)(mpidr >> 32) & 0xFF) << 24);
 	}
 
 	INIT_SPIN_LOCK(&s->dist_lock);
@@ -1447,6 +1935,11 @@ static struct vgic_guest_state *vgic_state_alloc(const char *name,
 			vgic_save_vcpu_context,
 			vgic_restore_vcpu_context,
 			vgic_irq_pending, s);
+#ifdef CONFIG_ARM64
+		if (model == VGIC_MODEL_V3) {
+			arm_vgic_setup_sgi1r(vcpu, vgic_v3_sgi1r_write);
+		}
+#endif
 	}
 
 	return s;
@@ -1491,7 +1984,7 @@ static int vgic_dist_emulator_probe(struct vmm_guest *guest,
 	if (!vgich.params.can_emulate_gic_v2) {
 		return VMM_ENODEV;
 	}
-	if (guest->vcpu_count > VGIC_MAX_NCPU) {
+	if (guest->vcpu_count > VGIC_V2_MAX_NCPU) {
 		return VMM_ENODEV;
 	}
 
@@ -1508,7 +2001,7 @@ static int vgic_dist_emulator_probe(struct vmm_guest *guest,
 	}
 
 	s = vgic_state_alloc(edev->node->name,
-			     guest, guest->vcpu_count,
+			     guest, VGIC_MODEL_V2, guest->vcpu_count,
 			     num_irq, parent_irq);
 	if (!s) {
 		return VMM_ENOMEM;
@@ -1569,7 +2062,7 @@ static int vgic_cpu_emulator_probe(struct vmm_guest *guest,
 	if (!vgich.params.can_emulate_gic_v2) {
 		return VMM_ENODEV;
 	}
-	if (guest->vcpu_count > VGIC_MAX_NCPU) {
+	if (guest->vcpu_count > VGIC_V2_MAX_NCPU) {
 		return VMM_ENODEV;
 	}
 	if (!(edev->reg->flags & VMM_REGION_REAL)) {
@@ -1603,6 +2096,204 @@ static struct vmm_emulator vgic_cpu_emulator = {
 	.reset = vgic_cpu_emulator_reset,
 };
 
+#ifdef CONFIG_ARM64
+static int vgic_v3_emulator_read8(struct vmm_emudev *edev,
+				  physical_addr_t offset,
+				  u8 *dst)
+{
+	int rc;
+	u32 regval = 0x0;
+
+	rc = vgic_v3_reg_read(edev->priv, offset & ~0x3, &regval);
+	if (!rc) {
+		*dst = (regval >> ((offset & 0x3) * 8)) & 0xFF;
+	}
+
+	return rc;
+}
+
+static int vgic_v3_emulator_read16(struct vmm_emudev *edev,
+				   physical_addr_t offset,
+				   u16 *dst)
+{
+	int rc;
+	u32 regval = 0x0;
+
+	rc = vgic_v3_reg_read(edev->priv, offset & ~0x3, &regval);
+	if (!rc) {
+		*dst = (regval >> ((offset & 0x2) * 8)) & 0xFFFF;
+	}
+
+	return rc;
+}
+
+static int vgic_v3_emulator_read32(struct vmm_emudev *edev,
+				   physical_addr_t offset,
+				   u32 *dst)
+{
+	return vgic_v3_reg_read(edev->priv, offset & ~0x3, dst);
+}
+
+static int vgic_v3_emulator_read64(struct vmm_emudev *edev,
+				   physical_addr_t offset,
+				   u64 *dst)
+{
+	int rc;
+	u32 lo = 0x0, hi = 0x0;
+
+	rc = vgic_v3_reg_read(edev->priv, offset & ~0x7, &lo);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vgic_v3_reg_read(edev->priv, (offset & ~0x7) + 4, &hi);
+	if (!rc) {
+		*dst = ((u64)hi << 32) | lo;
+	}
+
+	return rc;
+}
+
+static int vgic_v3_emulator_write8(struct vmm_emudev *edev,
+				   physical_addr_t offset,
+				   u8 src)
+{
+	u32 shift = (offset & 0x3) * 8;
+
+	return vgic_v3_reg_write(edev->priv, offset & ~0x3,
+				 ~(0xFFU << shift), (u32)src << shift);
+}
+
+static int vgic_v3_emulator_write16(struct vmm_emudev *edev,
+				    physical_addr_t offset,
+				    u16 src)
+{
+	u32 shift = (offset & 0x2) * 8;
+
+	return vgic_v3_reg_write(edev->priv, offset & ~0x3,
+				 ~(0xFFFFU << shift), (u32)src << shift);
+}
+
+static int vgic_v3_emulator_write32(struct vmm_emudev *edev,
+				    physical_addr_t offset,
+				    u32 src)
+{
+	return vgic_v3_reg_write(edev->priv, offset & ~0x3, 0x00000000, src);
+}
+
+static int vgic_v3_emulator_write64(struct vmm_emudev *edev,
+				    physical_addr_t offset,
+				    u64 src)
+{
+	int rc;
+
+	rc = vgic_v3_reg_write(edev->priv, offset & ~0x7,
+			       0x00000000, (u32)src);
+	if (rc) {
+		return rc;
+	}
+
+	return vgic_v3_reg_write(edev->priv, (offset & ~0x7) + 4,
+				 0x00000000, (u32)(src >> 32));
+}
+
+static int vgic_v3_emulator_reset(struct vmm_emudev *edev)
+{
+	return vgic_state_reset(edev->priv);
+}
+
+static int vgic_v3_emulator_probe(struct vmm_guest *guest,
+				  struct vmm_emudev *edev,
+				  const struct vmm_devtree_nodeid *eid)
+{
+	int rc;
+	u32 parent_irq, num_irq, redist_offset;
+	struct vgic_guest_state *s;
+
+	if (!vgich.avail) {
+		return VMM_ENODEV;
+	}
+	if (!vgich.params.can_emulate_gic_v3) {
+		return VMM_ENODEV;
+	}
+	if (guest->vcpu_count > VGIC_MAX_NCPU) {
+		return VMM_ENODEV;
+	}
+
+	rc = vmm_devtree_read_u32(edev->node, "parent_irq", &parent_irq);
+	if (rc) {
+		return rc;
+	}
+
+	if (vmm_devtree_read_u32(edev->node, "num_irq", &num_irq)) {
+		num_irq = VGIC_MAX_NIRQ;
+	}
+	if (num_irq > VGIC_MAX_NIRQ) {
+		num_irq = VGIC_MAX_NIRQ;
+	}
+
+	/* Redistributors of all VCPUs follow distributor in same region */
+	if (vmm_devtree_read_u32(edev->node, "redist_offset",
+				 &redist_offset)) {
+		redist_offset = VGIC_V3_DIST_SIZE;
+	}
+	if ((redist_offset < VGIC_V3_DIST_SIZE) ||
+	    (VMM_REGION_PHYS_SIZE(edev->reg) <
+	     ((physical_size_t)redist_offset +
+	      (physical_size_t)guest->vcpu_count * VGIC_V3_REDIST_SIZE))) {
+		return VMM_EINVALID;
+	}
+
+	s = vgic_state_alloc(edev->node->name,
+			     guest, VGIC_MODEL_V3, guest->vcpu_count,
+			     num_irq, parent_irq);
+	if (!s) {
+		return VMM_ENOMEM;
+	}
+	s->redist_offset = redist_offset;
+
+	edev->priv = s;
+
+	return VMM_OK;
+}
+
+static int vgic_v3_emulator_remove(struct vmm_emudev *edev)
+{
+	struct vgic_guest_state *s = edev->priv;
+
+	if (!s) {
+		return VMM_EFAIL;
+	}
+
+	vgic_state_free(s);
+	edev->priv = NULL;
+
+	return VMM_OK;
+}
+
+static struct vmm_devtree_nodeid vgic_v3_emuid_table[] = {
+	{ .type = "pic", .compatible = "arm,vgic-v3", },
+	{ /* end of list */ },
+};
+
+static struct vmm_emulator vgic_v3_emulator = {
+	.name = "vgic-v3",
+	.match_table = vgic_v3_emuid_table,
+	.endian = VMM_DEVEMU_LITTLE_ENDIAN,
+	.probe = vgic_v3_emulator_probe,
+	.remove = vgic_v3_emulator_remove,
+	.reset = vgic_v3_emulator_reset,
+	.read8 = vgic_v3_emulator_read8,
+	.write8 = vgic_v3_emulator_write8,
+	.read16 = vgic_v3_emulator_read16,
+	.write16 = vgic_v3_emulator_write16,
+	.read32 = vgic_v3_emulator_read32,
+	.write32 = vgic_v3_emulator_write32,
+	.read64 = vgic_v3_emulator_read64,
+	.write64 = vgic_v3_emulator_write64,
+};
+#endif
+
 static void vgic_enable_maint_irq(void *arg0, void *arg1, void *arg3)
 {
 	int rc;
@@ -1649,6 +2340,13 @@ static int __init vgic_emulator_init(void)
 		goto fail_unreg_dist;
 	}
 
+#ifdef CONFIG_ARM64
+	rc = vmm_devemu_register_emulator(&vgic_v3_emulator);
+	if (rc) {
+		goto fail_unreg_cpu;
+	}
+#endif
+
 	vmm_smp_ipi_async_call(cpu_online_mask, vgic_enable_maint_irq,
 			       (void *)(unsigned long)vgich.params.maint_irq,
 			       vgic_maint_irq, NULL);
@@ -1659,6 +2357,10 @@ static int __init vgic_emulator_init(void)
 
 	return VMM_OK;
 
+#ifdef CONFIG_ARM64
+fail_unreg_cpu:
+	vmm_devemu_unregister_emulator(&vgic_cpu_emulator);
+#endif
 fail_unreg_dist:
 	vmm_devemu_unregister_emulator(&vgic_dist_emulator);
 fail_unprobe:
@@ -1692,6 +2394,10 @@ static void __exit vgic_emulator_exit(void)
 			       (void *)(unsigned long)vgich.params.maint_irq,
 			       NULL, NULL);
 
+#ifdef CONFIG_ARM64
+	vmm_devemu_unregister_emulator(&vgic_v3_emulator);
+#endif
+
 	vmm_devemu_unregister_emulator(&vgic_cpu_emulator);
 
 	vmm_devemu_unregister_emulator(&vgic_dist_emulator);
@@ -28,6 +28,7 @@
 #include <vmm_stdio.h>
 #include <vmm_heap.h>
 #include <vmm_host_aspace.h>
+#include <vmm_guest_aspace.h>
 #include <libs/stringlib.h>
 #include <libs/radix-tree.h>
 #include <arch_config.h>
@@ -990,6 +991,231 @@ int mmu_idmap_nested_pgtbl(struct mmu_pgtbl *s2_pgtbl,
 	return iw.error;
 }
 
+/* Largest Stage2 block level used for guest RAM/ROM
+ * (i.e. 1GB block with 4KB granule)
+ */
+#define MMU_STAGE2_GUEST_MAX_LEVEL	2
+
+static int mmu_stage2_guest_max_level(void)
+{
+	int level = arch_mmu_start_level(MMU_STAGE2);
+
+	return (level < MMU_STAGE2_GUEST_MAX_LEVEL) ?
+			level : MMU_STAGE2_GUEST_MAX_LEVEL;
+}
+
+static bool mmu_stage2_guest_block(struct vmm_guest *guest,
+				   physical_addr_t ia, physical_size_t sz,
+				   struct mmu_page *pg, u32 *reg_flags)
+{
+	physical_addr_t oa;
+	physical_size_t availsz;
+
+	if (vmm_guest_physical_map(guest, ia, sz, &oa, &availsz, reg_flags)) {
+		return FALSE;
+	}
+	if ((availsz < sz) || (oa & (sz - 1))) {
+		return FALSE;
+	}
+
+	pg->ia = ia;
+	pg->oa = oa;
+	pg->sz = sz;
+
+	return TRUE;
+}
+
+static u32 mmu_stage2_guest_fault_around(struct mmu_pgtbl *s2_pgtbl,
+					 struct vmm_guest *guest,
+					 struct mmu_page *fpg, u32 fpg_flags)
+{
+	u32 i, reg_flags, count, map_count = 0;
+	physical_addr_t start;
+	struct mmu_page pg;
+
+	/* Fault-around window is naturally aligned and has power-of-2
+	 * blocks of same size as the faulting block.
+	 */
+	count = vmm_guest_stage2_fault_around(guest);
+
+	/* Don't populate extra hugepages of on-demand RAM regions */
+	if (fpg_flags & VMM_REGION_ISONDEMAND) {
+		while (count && (fpg->sz * count > vmm_host_hugepage_size())) {
+			count = count >> 1;
+		}
+	}
+
+	if (count < 2) {
+		return 0;
+	}
+	start = fpg->ia & ~((physical_addr_t)fpg->sz * count - 1);
+
+	for (i = 0; i < count; i++) {
+		memset(&pg, 0, sizeof(pg));
+		if ((start + i * fpg->sz) == fpg->ia) {
+			continue;
+		}
+		if (!mmu_stage2_guest_block(guest, start + i * fpg->sz,
+					    fpg->sz, &pg, &reg_flags)) {
+			continue;
+		}
+		if (reg_flags != fpg_flags) {
+			continue;
+		}
+		arch_mmu_pgflags_set(&pg.flags, MMU_STAGE2, reg_flags);
+		if (!mmu_map_page(s2_pgtbl, &pg)) {
+			map_count++;
+		}
+	}
+
+	return map_count;
+}
+
+int mmu_stage2_map_guest_fault(struct mmu_pgtbl *s2_pgtbl,
+			       struct vmm_guest *guest,
+			       physical_addr_t fault_addr)
+{
+	int rc, level;
+	u32 reg_flags = 0x0, pg_reg_flags = 0x0, map_count = 0;
+	struct mmu_page pg, tpg;
+	physical_addr_t ia;
+	physical_size_t sz, availsz;
+
+	memset(&pg, 0, sizeof(pg));
+
+	ia = fault_addr & arch_mmu_level_map_mask(MMU_STAGE2, 0);
+	sz = arch_mmu_level_block_size(MMU_STAGE2, 0);
+
+	rc = vmm_guest_physical_map(guest, ia, sz,
+				    &pg.oa, &availsz, &pg_reg_flags);
+	if (rc) {
+		vmm_printf("%s: guest_phys=0x%"PRIPADDR" size=0x%"PRIPSIZE
+			   " map failed\n", __func__, ia, sz);
+		goto done;
+	}
+
+	if (availsz < sz) {
+		vmm_printf("%s: availsz=0x%"PRIPSIZE" insufficent for "
+			   "guest_phys=0x%"PRIPADDR"\n",
+			   __func__, availsz, ia);
+		rc = VMM_ENOSPC;
+		goto done;
+	}
+
+	pg.ia = ia;
+	pg.sz = sz;
+
+	/* Use largest possible block for RAM/ROM regions */
+	if (pg_reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) {
+		for (level = mmu_stage2_guest_max_level(); level > 0; level--) {
+			memset(&tpg, 0, sizeof(tpg));
+			ia = fault_addr &
+				arch_mmu_level_map_mask(MMU_STAGE2, level);
+			sz = arch_mmu_level_block_size(MMU_STAGE2, level);
+			if ((pg_reg_flags & VMM_REGION_ISONDEMAND) &&
+			    (sz > vmm_host_hugepage_size())) {
+				continue;
+			}
+			if (mmu_stage2_guest_block(guest, ia, sz,
+						   &tpg, &reg_flags)) {
+				pg = tpg;
+				pg_reg_flags = reg_flags;
+				break;
+			}
+		}
+	}
+
+	arch_mmu_pgflags_set(&pg.flags, MMU_STAGE2, pg_reg_flags);
+
+	/* Try to map the page in Stage2 */
+	rc = mmu_map_page(s2_pgtbl, &pg);
+	if (rc) {
+		/* On SMP Guest, two different VCPUs may try to map same
+		 * Guest region in Stage2 at the same time. This may cause
+		 * mmu_map_page() to fail for one of the Guest VCPUs.
+		 *
+		 * To take care of this situation, we recheck Stage2 mapping
+		 * when mmu_map_page() fails.
+		 */
+		rc = mmu_get_page(s2_pgtbl, fault_addr, &tpg);
+		goto done;
+	}
+	map_count++;
+
+	/* Map neighbouring blocks of RAM regions if required */
+	if ((vmm_guest_stage2_map_policy(guest) ==
+	     VMM_GUEST_STAGE2_MAP_FAULT_AROUND) &&
+	    (pg_reg_flags & VMM_REGION_ISRAM)) {
+		map_count += mmu_stage2_guest_fault_around(s2_pgtbl, guest,
+							   &pg, pg_reg_flags);
+	}
+
+done:
+	vmm_guest_stage2_fault_account(guest, map_count);
+	return rc;
+}
+
+int mmu_stage2_map_guest_region(struct mmu_pgtbl *s2_pgtbl,
+				struct vmm_guest *guest,
+				struct vmm_region *reg)
+{
+	int level, max_level;
+	u32 map_count = 0;
+	struct mmu_page pg;
+	physical_addr_t gpa, hpa;
+	physical_size_t sz, availsz;
+	const u32 mask = VMM_REGION_REAL | VMM_REGION_MEMORY |
+			 VMM_REGION_ISRAM;
+
+	if (!s2_pgtbl || !guest || !reg) {
+		return VMM_EINVALID;
+	}
+
+	/* Only real RAM regions are mapped in advance and
+	 * on-demand RAM regions are always mapped on faults.
+	 */
+	if (((reg->flags & mask) != mask) ||
+	    (reg->flags & VMM_REGION_ISONDEMAND)) {
+		return VMM_OK;
+	}
+
+	max_level = mmu_stage2_guest_max_level();
+	gpa = VMM_REGION_GPHYS_START(reg);
+	while (gpa < VMM_REGION_GPHYS_END(reg)) {
+		vmm_guest_find_mapping(guest, reg, gpa, &hpa, &availsz);
+
+		/* Find largest block aligned at both addresses */
+		for (level = max_level; level >= 0; level--) {
+			sz = arch_mmu_level_block_size(MMU_STAGE2, level);
+			if (!(gpa & (sz - 1)) && !(hpa & (sz - 1)) &&
+			    (sz <= availsz)) {
+				break;
+			}
+		}
+		if (level < 0) {
+			/* Remaining part of region will be mapped
+			 * on Stage2 translation faults.
+			 */
+			break;
+		}
+
+		memset(&pg, 0, sizeof(pg));
+		pg.ia = gpa;
+		pg.oa = hpa;
+		pg.sz = sz;
+		arch_mmu_pgflags_set(&pg.flags, MMU_STAGE2, reg->flags);
+		if (!mmu_map_page(s2_pgtbl, &pg)) {
+			map_count++;
+		}
+
+		gpa += sz;
+	}
+
+	vmm_guest_stage2_prefault_account(guest, map_count);
+
+	return VMM_OK;
+}
+
 int mmu_test_nested_pgtbl(struct mmu_pgtbl *s2_pgtbl,
 			  struct mmu_pgtbl *s1_pgtbl,
 			  u32 flags, virtual_addr_t addr,
@@ -143,6 +143,17 @@ int mmu_idmap_nested_pgtbl(struct mmu_pgtbl *s2_pgtbl,
 			   struct mmu_pgtbl *s1_pgtbl,
 			   physical_size_t map_size, u32 reg_flags);
 
+struct vmm_guest;
+struct vmm_region;
+
+int mmu_stage2_map_guest_fault(struct mmu_pgtbl *s2_pgtbl,
+			       struct vmm_guest *guest,
+			       physical_addr_t fault_addr);
+
+int mmu_stage2_map_guest_region(struct mmu_pgtbl *s2_pgtbl,
+				struct vmm_guest *guest,
+				struct vmm_region *reg);
+
 #define MMU_TEST_WIDTH_8BIT		(1UL << 0)
 #define MMU_TEST_WIDTH_16BIT		(1UL << 1)
 #define MMU_TEST_WIDTH_32BIT		(1UL << 2)
@@ -32,6 +32,7 @@
 
 #include <cpu_hwcap.h>
 #include <cpu_sbi.h>
+#include <cpu_string.h>
 #include <cpu_tlb.h>
 #include <riscv_csr.h>
 #include <riscv_encoding.h>
@@ -59,6 +60,18 @@ virtual_size_t arch_code_size(void)
 /* Host ISA bitmap */
 static DECLARE_BITMAP(riscv_isa, RISCV_ISA_EXT_MAX) = { 0 };
 
+/* Multi-letter ISA extensions known to us */
+static const struct {
+	const char *name;
+	int bit;
+} riscv_isa_ext_names[] = {
+	{ "zicsr", RISCV_ISA_EXT_zicsr },
+	{ "zifencei", RISCV_ISA_EXT_zifencei },
+	{ "zam", RISCV_ISA_EXT_zam },
+	{ "ztso", RISCV_ISA_EXT_ztso },
+	{ "sstc", RISCV_ISA_EXT_sstc },
+};
+
 int riscv_isa_populate_string(unsigned long xlen,
 			      const unsigned long *isa_bitmap,
 			      char *out, size_t out_sz)
@@ -86,6 +99,17 @@ int riscv_isa_populate_string(unsigned long xlen,
 	}
 	out[pos] = '\0';
 
+	for (i = 0; i < array_size(riscv_isa_ext_names); i++) {
+		if (!test_bit(riscv_isa_ext_names[i].bit, bmap))
+			continue;
+		if ((pos + 1 + strlen(riscv_isa_ext_names[i].name)) >=
+		    out_sz)
+			break;
+		out[pos++] = '_';
+		strcpy(&out[pos], riscv_isa_ext_names[i].name);
+		pos += strlen(riscv_isa_ext_names[i].name);
+	}
+
 	return VMM_OK;
 }
 
@@ -94,7 +118,7 @@ int riscv_isa_parse_string(const char *isa,
 			   unsigned long *out_bitmap,
 			   size_t out_bitmap_sz)
 {
-	size_t i, isa_len;
+	size_t i, j, start, isa_len;
 
 	if (!isa || !out_xlen || !out_bitmap ||
 	    (out_bitmap_sz < __riscv_xlen))
@@ -126,13 +150,31 @@ int riscv_isa_parse_string(const char *isa,
 		return VMM_EINVALID;
 	}
 
-	for (; i < isa_len; ++i) {
+	/* Single-letter extensions upto first underscore */
+	for (; (i < isa_len) && (isa[i] != '_'); ++i) {
 		if ('a' <= isa[i] && isa[i] <= 'z')
 			__set_bit(isa[i] - 'a', out_bitmap);
 		if ('A' <= isa[i] && isa[i] <= 'Z')
 			__set_bit(isa[i] - 'A', out_bitmap);
 	}
 
+	/* Multi-letter extensions separated by underscores */
+	while (i < isa_len) {
+		start = ++i;
+		while ((i < isa_len) && (isa[i] != '_'))
+			i++;
+		for (j = 0; j < array_size(riscv_isa_ext_names); j++) {
+			if ((strlen(riscv_isa_ext_names[j].name) ==
+			     (i - start)) &&
+			    !strncmp(riscv_isa_ext_names[j].name,
+				     &isa[start], i - start)) {
+				__set_bit(riscv_isa_ext_names[j].bit,
+					  out_bitmap);
+				break;
+			}
+		}
+	}
+
 	return VMM_OK;
 }
 
@@ -268,6 +310,9 @@ int __init arch_cpu_nascent_init(void)
 		__hfence_gvma_all();
 	}
 
+	/* Select memory functions based on ISA features */
+	cpu_string_init();
+
 	return rc;
 }
 
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * @file cpu_string.c
+ * @author agent (agent@local)
+ * @brief source of RISC-V memory functions
+ *
+ * The memcpy(), memmove(), and memset() use word-aligned unrolled
+ * assembly by default. When host has vector extension, large buffers
+ * are handled in chunks by vector versions which disable interrupts
+ * for each chunk.
+ */
+
+#include <vmm_types.h>
+#include <cpu_hwcap.h>
+#include <cpu_string.h>
+
+#ifdef CONFIG_RISCV_ISA_V
+
+/* Vector versions are used only for these many bytes or more */
+#define STRING_VECTOR_MIN		256
+
+/* Max. bytes handled with interrupts disabled */
+#define STRING_VECTOR_CHUNK		4096
+
+static bool string_vector = FALSE;
+
+static void string_vector_copy(u8 *dst, const u8 *src, size_t count)
+{
+	size_t len;
+
+	while (count) {
+		len = (count < STRING_VECTOR_CHUNK) ?
+			count : STRING_VECTOR_CHUNK;
+		__memcpy_vector(dst, src, len);
+		dst += len;
+		src += len;
+		count -= len;
+	}
+}
+
+static void string_vector_set(u8 *dst, int c, size_t count)
+{
+	size_t len;
+
+	while (count) {
+		len = (count < STRING_VECTOR_CHUNK) ?
+			count : STRING_VECTOR_CHUNK;
+		__memset_vector(dst, c, len);
+		dst += len;
+		count -= len;
+	}
+}
+
+#endif
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+#ifdef CONFIG_RISCV_ISA_V
+	if (string_vector && (count >= STRING_VECTOR_MIN)) {
+		string_vector_copy(dest, src, count);
+		return dest;
+	}
+#endif
+
+	return __memcpy_scalar(dest, src, count);
+}
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+	/* Forward copy works unless dest is within src buffer */
+	if (((unsigned long)dest - (unsigned long)src) >= count) {
+		return memcpy(dest, src, count);
+	}
+
+	return __memmove_scalar(dest, src, count);
+}
+
+void *memset(void *dest, int c, size_t count)
+{
+#ifdef CONFIG_RISCV_ISA_V
+	if (string_vector && (count >= STRING_VECTOR_MIN)) {
+		string_vector_set(dest, c, count);
+		return dest;
+	}
+#endif
+
+	return __memset_scalar(dest, c, count);
+}
+
+void cpu_string_init(void)
+{
+#ifdef CONFIG_RISCV_ISA_V
+	if (riscv_isa_extension_available(NULL, v)) {
+		string_vector = TRUE;
+	}
+#endif
+}
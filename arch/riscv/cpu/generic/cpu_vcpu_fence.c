@@ -0,0 +1,228 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cpu_vcpu_fence.c
+ * @author agent (agent@local)
+ * @brief source of VCPU remote fence functions
+ *
+ * Each VCPU has "fence pending" flags which are set for every remote
+ * fence targeting it. A VCPU consumes its pending flags when it is
+ * scheduled in so a descheduled VCPU is never IPIed. Only host CPUs
+ * on which targeted VCPUs are RUNNING get a (single, batched) remote
+ * fence from SBI firmware.
+ *
+ * The pending flags are set before checking VCPU state and consumed
+ * after VCPU is marked RUNNING so a VCPU which is being scheduled in
+ * concurrently is either IPIed or sees its pending flags.
+ *
+ * All VCPUs of a Guest share one VMID so VS-stage TLB entries left on
+ * a host CPU by a descheduled VCPU can be used by a sibling VCPU. To
+ * avoid this, the last VCPU of each Guest which ran on each host CPU
+ * is tracked and VS-stage TLB is flushed when a different VCPU of same
+ * Guest enters on that host CPU.
+ */
+
+#include <vmm_smp.h>
+#include <vmm_cpumask.h>
+#include <vmm_host_aspace.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
+#include <cpu_sbi.h>
+#include <cpu_tlb.h>
+#include <cpu_vcpu_fence.h>
+
+/* Larger ranges are flushed by a full VS-stage flush */
+#define FENCE_RANGE_MAX_PAGES		64
+
+static bool fence_range_is_all(unsigned long start, unsigned long size)
+{
+	return ((!start && !size) || (size == -1UL) ||
+		(size > (FENCE_RANGE_MAX_PAGES * VMM_PAGE_SIZE))) ?
+		TRUE : FALSE;
+}
+
+static void fence_local(enum cpu_vcpu_fence_type type,
+			unsigned long start, unsigned long size,
+			unsigned long asid)
+{
+	unsigned long va, end = start + size;
+
+	switch (type) {
+	case CPU_VCPU_FENCE_I:
+		__fence_i();
+		break;
+	case CPU_VCPU_FENCE_VVMA:
+		if (fence_range_is_all(start, size)) {
+			__hfence_vvma_all();
+			break;
+		}
+		for (va = VMM_PAGE_ADDR(start); va < end; va += VMM_PAGE_SIZE)
+			__hfence_vvma_va(va);
+		break;
+	case CPU_VCPU_FENCE_VVMA_ASID:
+		if (fence_range_is_all(start, size)) {
+			__hfence_vvma_asid(asid);
+			break;
+		}
+		for (va = VMM_PAGE_ADDR(start); va < end; va += VMM_PAGE_SIZE)
+			__hfence_vvma_asid_va(va, asid);
+		break;
+	case CPU_VCPU_FENCE_VVMA_ALL:
+	default:
+		__hfence_vvma_all();
+		break;
+	};
+}
+
+void cpu_vcpu_fence_guest_init(struct vmm_guest *guest)
+{
+	u32 c;
+	struct riscv_guest_priv *gpriv = riscv_guest_priv(guest);
+
+	for (c = 0; c < CONFIG_CPU_COUNT; c++)
+		gpriv->last_vcpu_ran[c] = -1U;
+}
+
+void cpu_vcpu_fence_init(struct vmm_vcpu *vcpu)
+{
+	struct riscv_priv *priv = riscv_priv(vcpu);
+
+	ARCH_ATOMIC_INIT(&priv->fence_i_pending, 0);
+	ARCH_ATOMIC_INIT(&priv->hfence_vvma_pending, 0);
+	/* Flush everything on first run */
+	priv->last_hcpu = -1U;
+}
+
+void cpu_vcpu_fence_process(struct vmm_vcpu *vcpu)
+{
+	bool fence_i, hfence_vvma;
+	u32 hcpu = vmm_smp_processor_id();
+	struct riscv_priv *priv = riscv_priv(vcpu);
+	struct riscv_guest_priv *gpriv = riscv_guest_priv(vcpu->guest);
+
+	/* Order RUNNING state of VCPU before reading pending flags */
+	arch_smp_mb();
+
+	fence_i = arch_atomic_xchg(&priv->fence_i_pending, 0) ? TRUE : FALSE;
+	hfence_vvma =
+		arch_atomic_xchg(&priv->hfence_vvma_pending, 0) ? TRUE : FALSE;
+
+	/*
+	 * Stale entries of this VCPU (from an older run) can be present
+	 * on a host CPU where it did not run last time.
+	 */
+	if (priv->last_hcpu != hcpu) {
+		priv->last_hcpu = hcpu;
+		fence_i = TRUE;
+		hfence_vvma = TRUE;
+	}
+
+	/*
+	 * Entries of a sibling VCPU (sharing same VMID) can be present
+	 * on this host CPU when it ran here after this VCPU.
+	 */
+	if (gpriv->last_vcpu_ran[hcpu] != vcpu->subid) {
+		gpriv->last_vcpu_ran[hcpu] = vcpu->subid;
+		hfence_vvma = TRUE;
+	}
+
+	if (fence_i)
+		__fence_i();
+	if (hfence_vvma)
+		__hfence_vvma_all();
+}
+
+void cpu_vcpu_fence_remote(struct vmm_vcpu *vcpu,
+			   unsigned long hmask, unsigned long hbase,
+			   enum cpu_vcpu_fence_type type,
+			   unsigned long start, unsigned long size,
+			   unsigned long asid)
+{
+	u32 hcpu, chcpu = vmm_smp_processor_id();
+	bool local = FALSE;
+	struct vmm_vcpu *rvcpu;
+	struct riscv_priv *rpriv;
+	struct vmm_cpumask cm, hm;
+	struct vmm_guest *guest = vcpu->guest;
+
+	vmm_cpumask_clear(&cm);
+	vmm_manager_for_each_guest_vcpu(rvcpu, guest) {
+		if (!(vmm_manager_vcpu_get_state(rvcpu) &
+		      VMM_VCPU_STATE_INTERRUPTIBLE))
+			continue;
+		if (hbase != -1UL) {
+			if (rvcpu->subid < hbase)
+				continue;
+			if ((rvcpu->subid - hbase) >= BITS_PER_LONG)
+				continue;
+			if (!(hmask & (1UL << (rvcpu->subid - hbase))))
+				continue;
+		}
+		if (rvcpu == vcpu) {
+			local = TRUE;
+			continue;
+		}
+
+		/*
+		 * Remote HFENCE.VVMA done by SBI firmware applies to
+		 * hgatp.VMID of calling host CPU (not of target host
+		 * CPU) so it may not cover target VCPU. Always mark
+		 * fence as pending so that target VCPU does it on its
+		 * next entry.
+		 */
+		rpriv = riscv_priv(rvcpu);
+		if (type == CPU_VCPU_FENCE_I)
+			arch_atomic_write(&rpriv->fence_i_pending, 1);
+		else
+			arch_atomic_write(&rpriv->hfence_vvma_pending, 1);
+		arch_smp_mb();
+
+		/* Descheduled VCPU will do pending fence on next entry */
+		if (vmm_manager_vcpu_get_state(rvcpu) != VMM_VCPU_STATE_RUNNING)
+			continue;
+		if (vmm_manager_vcpu_get_hcpu(rvcpu, &hcpu))
+			continue;
+		if (hcpu == chcpu)
+			continue;
+		vmm_cpumask_set_cpu(hcpu, &cm);
+	}
+
+	if (local)
+		fence_local(type, start, size, asid);
+
+	if (vmm_cpumask_empty(&cm))
+		return;
+	sbi_cpumask_to_hartmask(&cm, &hm);
+
+	switch (type) {
+	case CPU_VCPU_FENCE_I:
+		sbi_remote_fence_i(vmm_cpumask_bits(&hm));
+		break;
+	case CPU_VCPU_FENCE_VVMA:
+		sbi_remote_hfence_vvma(vmm_cpumask_bits(&hm), start, size);
+		break;
+	case CPU_VCPU_FENCE_VVMA_ASID:
+		sbi_remote_hfence_vvma_asid(vmm_cpumask_bits(&hm),
+					    start, size, asid);
+		break;
+	case CPU_VCPU_FENCE_VVMA_ALL:
+	default:
+		sbi_remote_hfence_vvma(vmm_cpumask_bits(&hm), 0, -1UL);
+		break;
+	};
+}
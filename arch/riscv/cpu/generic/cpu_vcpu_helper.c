@@ -29,6 +29,7 @@
 #include <vmm_pagepool.h>
 #include <vmm_timer.h>
 #include <vmm_host_aspace.h>
+#include <vmm_guest_aspace.h>
 #include <arch_barrier.h>
 #include <arch_guest.h>
 #include <arch_vcpu.h>
@@ -38,6 +39,7 @@
 #include <cpu_hwcap.h>
 #include <cpu_tlb.h>
 #include <cpu_sbi.h>
+#include <cpu_vcpu_fence.h>
 #include <cpu_vcpu_fp.h>
 #include <cpu_vcpu_helper.h>
 #include <cpu_vcpu_timer.h>
@@ -53,7 +55,8 @@
 				 riscv_isa_extension_mask(i) | \
 				 riscv_isa_extension_mask(m) | \
 				 riscv_isa_extension_mask(s) | \
-				 riscv_isa_extension_mask(u))
+				 riscv_isa_extension_mask(u) | \
+				 riscv_isa_extension_mask(sstc))
 
 static char *guest_fdt_find_serial_node(char *guest_name)
 {
@@ -117,6 +120,8 @@ int arch_guest_init(struct vmm_guest *guest)
 
 		priv->time_delta = -get_cycles64();
 
+		cpu_vcpu_fence_guest_init(guest);
+
 		priv->pgtbl = mmu_pgtbl_alloc(MMU_STAGE2, -1);
 		if (!priv->pgtbl) {
 			vmm_free(guest->arch_priv);
@@ -168,6 +173,13 @@ int arch_guest_deinit(struct vmm_guest *guest)
 
 int arch_guest_add_region(struct vmm_guest *guest, struct vmm_region *region)
 {
+	/* Populate Stage2 for RAM regions in advance if required */
+	if (vmm_guest_stage2_map_policy(guest) ==
+	    VMM_GUEST_STAGE2_MAP_PREFAULT) {
+		return mmu_stage2_map_guest_region(riscv_guest_priv(guest)->pgtbl,
+						   guest, region);
+	}
+
 	return VMM_OK;
 }
 
@@ -269,6 +281,9 @@ int arch_vcpu_init(struct vmm_vcpu *vcpu)
 			goto done;
 		}
 		riscv_priv(vcpu)->isa[0] &= RISCV_ISA_ALLOWED;
+		/* Sstc is available to VCPU only if Host has it */
+		if (!riscv_isa_extension_available(NULL, sstc))
+			__clear_bit(RISCV_ISA_EXT_sstc, riscv_priv(vcpu)->isa);
 	}
 
 	/* Set a0 to VCPU sub-id (i.e. virtual HARTID) */
@@ -298,6 +313,9 @@ int arch_vcpu_init(struct vmm_vcpu *vcpu)
 	/* Initialize FP state */
 	cpu_vcpu_fp_init(vcpu);
 
+	/* Initialize fence state */
+	cpu_vcpu_fence_init(vcpu);
+
 	riscv_timer_event_init(vcpu, &riscv_timer_priv(vcpu));
 done:
 	return rc;
@@ -362,6 +380,7 @@ void arch_vcpu_switch(struct vmm_vcpu *tvcpu,
 			priv->vsatp = csr_read(CSR_VSATP);
 			priv->scounteren = csr_read(CSR_SCOUNTEREN);
 			cpu_vcpu_fp_save(tvcpu, regs);
+			riscv_timer_event_save(tvcpu);
 		}
 		clrx();
 	}
@@ -389,6 +408,7 @@ void arch_vcpu_switch(struct vmm_vcpu *tvcpu,
 		csr_write(CSR_VSATP, priv->vsatp);
 		csr_write(CSR_SCOUNTEREN, priv->scounteren);
 		cpu_vcpu_fp_restore(vcpu, regs);
+		riscv_timer_event_restore(vcpu);
 		if (CONFIG_MAX_GUEST_COUNT <= (1UL << riscv_stage2_vmid_bits)) {
 			mmu_stage2_change_pgtbl(vcpu->guest->id,
 					riscv_guest_priv(vcpu->guest)->pgtbl);
@@ -403,7 +423,10 @@ void arch_vcpu_switch(struct vmm_vcpu *tvcpu,
 void arch_vcpu_post_switch(struct vmm_vcpu *vcpu,
 			   arch_regs_t *regs)
 {
-	/* Nothing to do here */
+	/* Fences requested while VCPU was not running */
+	if (vcpu->is_normal) {
+		cpu_vcpu_fence_process(vcpu);
+	}
 }
 
 void cpu_vcpu_dump_general_regs(struct vmm_chardev *cdev,
@@ -27,6 +27,7 @@
 #include <vmm_vcpu_irq.h>
 #include <vio/vmm_vserial.h>
 #include <cpu_guest_serial.h>
+#include <cpu_vcpu_fence.h>
 #include <cpu_vcpu_sbi.h>
 #include <cpu_vcpu_trap.h>
 #include <cpu_vcpu_timer.h>
@@ -41,11 +42,9 @@ static int vcpu_sbi_legacy_ecall(struct vmm_vcpu *vcpu,
 				 struct cpu_vcpu_trap *out_trap)
 {
 	u8 send;
-	u32 hcpu;
 	int i, ret = 0;
-	unsigned long hmask;
+	unsigned long hmask, hbase;
 	struct vmm_vcpu *rvcpu;
-	struct vmm_cpumask cm, hm;
 	struct vmm_guest *guest = vcpu->guest;
 	struct riscv_guest_serial *gs = riscv_guest_serial(guest);
 
@@ -96,32 +95,27 @@ static int vcpu_sbi_legacy_ecall(struct vmm_vcpu *vcpu,
 	case SBI_EXT_0_1_REMOTE_FENCE_I:
 	case SBI_EXT_0_1_REMOTE_SFENCE_VMA:
 	case SBI_EXT_0_1_REMOTE_SFENCE_VMA_ASID:
-		if (args[0])
+		if (args[0]) {
 			hmask = __cpu_vcpu_unpriv_read_ulong(args[0], out_trap);
-		else
-			hmask = (1UL << guest->vcpu_count) - 1;
+			hbase = 0;
+		} else {
+			hmask = 0;
+			hbase = -1UL;
+		}
 		if (out_trap->scause) {
 			break;
 		}
-		vmm_cpumask_clear(&cm);
-		for_each_set_bit(i, &hmask, BITS_PER_LONG) {
-			rvcpu = vmm_manager_guest_vcpu(guest, i);
-			if (!(vmm_manager_vcpu_get_state(rvcpu) &
-			      VMM_VCPU_STATE_INTERRUPTIBLE))
-				continue;
-			if (vmm_manager_vcpu_get_hcpu(rvcpu, &hcpu))
-				continue;
-			vmm_cpumask_set_cpu(hcpu, &cm);
-		}
-		sbi_cpumask_to_hartmask(&cm, &hm);
 		if (ext_id == SBI_EXT_0_1_REMOTE_FENCE_I) {
-			sbi_remote_fence_i(vmm_cpumask_bits(&hm));
+			cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+					      CPU_VCPU_FENCE_I, 0, 0, 0);
 		} else if (ext_id == SBI_EXT_0_1_REMOTE_SFENCE_VMA) {
-			sbi_remote_hfence_vvma(vmm_cpumask_bits(&hm),
-					       args[1], args[2]);
+			cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+					      CPU_VCPU_FENCE_VVMA,
+					      args[1], args[2], 0);
 		} else if (ext_id == SBI_EXT_0_1_REMOTE_SFENCE_VMA_ASID) {
-			sbi_remote_hfence_vvma_asid(vmm_cpumask_bits(&hm),
-						    args[1], args[2], args[3]);
+			cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+					      CPU_VCPU_FENCE_VVMA_ASID,
+					      args[1], args[2], args[3]);
 		}
 		break;
 	default:
@@ -27,6 +27,7 @@
 #include <vmm_stdio.h>
 #include <vmm_vcpu_irq.h>
 #include <cpu_sbi.h>
+#include <cpu_vcpu_fence.h>
 #include <cpu_vcpu_sbi.h>
 #include <cpu_vcpu_timer.h>
 #include <riscv_sbi.h>
@@ -59,49 +60,36 @@ static int vcpu_sbi_rfence_ecall(struct vmm_vcpu *vcpu,
 				 unsigned long *args, unsigned long *out_val,
 				 struct cpu_vcpu_trap *out_trap)
 {
-	u32 hcpu;
-	struct vmm_vcpu *rvcpu;
-	struct vmm_cpumask cm, hm;
-	struct vmm_guest *guest = vcpu->guest;
 	unsigned long hmask = args[0], hbase = args[1];
 
-	vmm_cpumask_clear(&cm);
-	vmm_manager_for_each_guest_vcpu(rvcpu, guest) {
-		if (!(vmm_manager_vcpu_get_state(rvcpu) &
-		      VMM_VCPU_STATE_INTERRUPTIBLE))
-			continue;
-		if (hbase != -1UL) {
-			if (rvcpu->subid < hbase)
-				continue;
-			if (!(hmask & (1UL << (rvcpu->subid - hbase))))
-				continue;
-		}
-		if (vmm_manager_vcpu_get_hcpu(rvcpu, &hcpu))
-			continue;
-		vmm_cpumask_set_cpu(hcpu, &cm);
-	}
-	sbi_cpumask_to_hartmask(&cm, &hm);
-
+	/*
+	 * Without nested virtualization, the VS-stage of Guest is its
+	 * only stage so HFENCE.VVMA variants are same as SFENCE.VMA and
+	 * HFENCE.GVMA variants (i.e. change in guest physical mappings)
+	 * conservatively flush whole VS-stage of target VCPUs.
+	 */
 	switch (func_id) {
 	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
-		sbi_remote_fence_i(vmm_cpumask_bits(&hm));
+		cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+				      CPU_VCPU_FENCE_I, 0, 0, 0);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
-		sbi_remote_hfence_vvma(vmm_cpumask_bits(&hm),
-					args[2], args[3]);
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA:
+		cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+				      CPU_VCPU_FENCE_VVMA,
+				      args[2], args[3], 0);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID:
-		sbi_remote_hfence_vvma_asid(vmm_cpumask_bits(&hm),
-					    args[2], args[3], args[4]);
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA_ASID:
+		cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+				      CPU_VCPU_FENCE_VVMA_ASID,
+				      args[2], args[3], args[4]);
 		break;
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA:
 	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA_VMID:
-	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA:
-	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA_ASID:
-		/*
-		 * TODO: these SBI calls will be implemented as part
-		 * of nested virtualization support.
-		 */
+		cpu_vcpu_fence_remote(vcpu, hmask, hbase,
+				      CPU_VCPU_FENCE_VVMA_ALL, 0, 0, 0);
+		break;
 	default:
 		return SBI_ERR_NOT_SUPPORTED;
 	};
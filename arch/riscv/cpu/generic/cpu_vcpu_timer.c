@@ -26,8 +26,10 @@
 #include <vmm_limits.h>
 #include <vmm_stdio.h>
 #include <vmm_vcpu_irq.h>
+#include <cpu_hwcap.h>
 #include <cpu_vcpu_timer.h>
 
+#include <riscv_csr.h>
 #include <riscv_encoding.h>
 
 static void riscv_timer_event_expired(struct vmm_timer_event *ev)
@@ -36,14 +38,52 @@ static void riscv_timer_event_expired(struct vmm_timer_event *ev)
 	struct riscv_timer_event *tevent = riscv_timer_priv(vcpu);
 
 	BUG_ON(!tevent);
+
+	/*
+	 * With Sstc, VSTIMECMP restored upon VCPU entry raises the
+	 * interrupt so we only need to wakeup descheduled VCPU.
+	 */
+	if (tevent->sstc) {
+		vmm_vcpu_irq_wait_resume(vcpu);
+		return;
+	}
+
 	vmm_vcpu_irq_assert(vcpu, IRQ_VS_TIMER, 0x0);
 }
 
+static void riscv_timer_write_vstimecmp(u64 val)
+{
+#ifdef CONFIG_64BIT
+	csr_write(CSR_VSTIMECMP, val);
+#else
+	/* Avoid spurious interrupt while updating two halves */
+	csr_write(CSR_VSTIMECMP, -1UL);
+	csr_write(CSR_VSTIMECMPH, (u32)(val >> 32));
+	csr_write(CSR_VSTIMECMP, (u32)val);
+#endif
+}
+
+static u64 riscv_timer_read_vstimecmp(void)
+{
+#ifdef CONFIG_64BIT
+	return csr_read(CSR_VSTIMECMP);
+#else
+	return ((u64)csr_read(CSR_VSTIMECMPH) << 32) |
+		(u64)csr_read(CSR_VSTIMECMP);
+#endif
+}
+
 void riscv_timer_event_start(struct vmm_vcpu *vcpu, u64 next_cycle)
 {
 	u64 delta_ns;
 	struct riscv_timer_event *tevent = riscv_timer_priv(vcpu);
 
+	/* Called for current VCPU so program VSTIMECMP directly */
+	if (tevent->sstc) {
+		riscv_timer_write_vstimecmp(next_cycle);
+		return;
+	}
+
 	if (next_cycle == U64_MAX) {
 		vmm_timer_event_stop(&tevent->time_ev);
 		vmm_vcpu_irq_clear(vcpu, IRQ_VS_TIMER);
@@ -62,6 +102,51 @@ void riscv_timer_event_start(struct vmm_vcpu *vcpu, u64 next_cycle)
 	vmm_timer_event_start(&tevent->time_ev, delta_ns);
 }
 
+void riscv_timer_event_save(struct vmm_vcpu *vcpu)
+{
+	u64 next_cycle, delta_ns;
+	struct riscv_timer_event *tevent = riscv_timer_priv(vcpu);
+
+	if (!tevent->sstc)
+		return;
+
+	tevent->vstimecmp = riscv_timer_read_vstimecmp();
+
+	/* Software timer event to wakeup VCPU while it is descheduled */
+	if (tevent->vstimecmp == U64_MAX)
+		return;
+	next_cycle = tevent->vstimecmp -
+			riscv_guest_priv(vcpu->guest)->time_delta;
+	delta_ns = vmm_timer_delta_cycles_to_ns(next_cycle);
+	vmm_timer_event_start(&tevent->time_ev, delta_ns);
+}
+
+void riscv_timer_event_restore(struct vmm_vcpu *vcpu)
+{
+	struct riscv_timer_event *tevent = riscv_timer_priv(vcpu);
+
+	/* HENVCFG is only available when Host has Sstc */
+	if (!riscv_isa_extension_available(NULL, sstc))
+		return;
+
+	if (!tevent->sstc) {
+#ifdef CONFIG_64BIT
+		csr_clear(CSR_HENVCFG, ENVCFG_STCE);
+#else
+		csr_clear(CSR_HENVCFGH, ENVCFGH_STCE);
+#endif
+		return;
+	}
+
+	vmm_timer_event_stop(&tevent->time_ev);
+#ifdef CONFIG_64BIT
+	csr_set(CSR_HENVCFG, ENVCFG_STCE);
+#else
+	csr_set(CSR_HENVCFGH, ENVCFGH_STCE);
+#endif
+	riscv_timer_write_vstimecmp(tevent->vstimecmp);
+}
+
 int riscv_timer_event_init(struct vmm_vcpu *vcpu, void **timer_event)
 {
 	struct riscv_timer_event *tevent;
@@ -81,6 +166,9 @@ int riscv_timer_event_init(struct vmm_vcpu *vcpu, void **timer_event)
 	}
 
 	vmm_timer_event_stop(&tevent->time_ev);
+	tevent->sstc = riscv_isa_extension_available(riscv_priv(vcpu)->isa,
+						     sstc);
+	tevent->vstimecmp = U64_MAX;
 
 	return VMM_OK;
 }
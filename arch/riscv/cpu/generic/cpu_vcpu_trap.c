@@ -71,84 +71,8 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 				arch_regs_t *regs,
 				physical_addr_t fault_addr)
 {
-	int rc, rc1;
-	u32 reg_flags = 0x0, pg_reg_flags = 0x0;
-	struct mmu_page pg;
-	physical_addr_t inaddr, outaddr;
-	physical_size_t size, availsz;
-
-	memset(&pg, 0, sizeof(pg));
-
-	inaddr = fault_addr & PGTBL_L0_MAP_MASK;
-	size = PGTBL_L0_BLOCK_SIZE;
-
-	rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-	if (rc) {
-		vmm_printf("%s: guest_phys=0x%"PRIPADDR" size=0x%"PRIPSIZE
-			   " map failed\n", __func__, inaddr, size);
-		return rc;
-	}
-
-	if (availsz < PGTBL_L0_BLOCK_SIZE) {
-		vmm_printf("%s: availsz=0x%"PRIPSIZE" insufficent for "
-			   "guest_phys=0x%"PRIPADDR"\n",
-			   __func__, availsz, inaddr);
-		return VMM_ENOSPC;
-	}
-
-	pg.ia = inaddr;
-	pg.sz = size;
-	pg.oa = outaddr;
-	pg_reg_flags = reg_flags;
-
-	if (reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) {
-		inaddr = fault_addr & PGTBL_L1_MAP_MASK;
-		size = PGTBL_L1_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= PGTBL_L1_BLOCK_SIZE)) {
-			pg.ia = inaddr;
-			pg.sz = size;
-			pg.oa = outaddr;
-			pg_reg_flags = reg_flags;
-		}
-#ifdef CONFIG_64BIT
-		inaddr = fault_addr & PGTBL_L2_MAP_MASK;
-		size = PGTBL_L2_BLOCK_SIZE;
-		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
-				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= PGTBL_L2_BLOCK_SIZE)) {
-			pg.ia = inaddr;
-			pg.sz = size;
-			pg.oa = outaddr;
-			pg_reg_flags = reg_flags;
-		}
-#endif
-	}
-
-	arch_mmu_pgflags_set(&pg.flags, MMU_STAGE2, pg_reg_flags);
-
-	/* Try to map the page in Stage2 */
-	rc = mmu_map_page(riscv_guest_priv(vcpu->guest)->pgtbl, &pg);
-	if (rc) {
-		/* On SMP Guest, two different VCPUs may try to map same
-		 * Guest region in Stage2 at the same time. This may cause
-		 * mmu_map_page() to fail for one of the Guest VCPUs.
-		 *
-		 * To take care of this situation, we recheck Stage2 mapping
-		 * when mmu_map_page() fails.
-		 */
-		memset(&pg, 0, sizeof(pg));
-		rc1 = mmu_get_page(riscv_guest_priv(vcpu->guest)->pgtbl,
-				   fault_addr, &pg);
-		if (rc1) {
-			return rc1;
-		}
-		rc = VMM_OK;
-	}
-
-	return rc;
+	return mmu_stage2_map_guest_fault(riscv_guest_priv(vcpu->guest)->pgtbl,
+					  vcpu->guest, fault_addr);
 }
 
 static int cpu_vcpu_emulate_load(struct vmm_vcpu *vcpu,
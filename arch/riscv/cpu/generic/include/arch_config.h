@@ -27,7 +27,8 @@
 #define ARCH_HAS_MEMORY_READWRITE
 #define ARCH_HAS_DIVISON_OPERATION
 
-#undef ARCH_HAS_MEMCPY
-#undef ARCH_HAS_MEMSET
+#define ARCH_HAS_MEMCPY
+#define ARCH_HAS_MEMMOVE
+#define ARCH_HAS_MEMSET
 
 #endif /* _ARCH_CONFIG_H__ */
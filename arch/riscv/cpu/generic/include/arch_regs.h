@@ -173,6 +173,11 @@ struct riscv_priv {
 	unsigned long scounteren;
 	/* FP state */
 	union riscv_priv_fp fp;
+	/* Fences pending for next entry (see cpu_vcpu_fence.c) */
+	atomic_t fence_i_pending;
+	atomic_t hfence_vvma_pending;
+	/* Host CPU on which VCPU ran last time */
+	u32 last_hcpu;
 	/* Opaque pointer to timer data */
 	void *timer_priv;
 };
@@ -182,6 +187,8 @@ struct riscv_guest_priv {
 	u64 time_delta;
 	/* Stage2 pagetable */
 	struct mmu_pgtbl *pgtbl;
+	/* Last VCPU (subid) of this guest which ran on each host CPU */
+	u32 last_vcpu_ran[CONFIG_CPU_COUNT];
 	/* Opaque pointer to vserial data */
 	void *guest_serial;
 };
@@ -36,11 +36,13 @@
 #define RISCV_ISA_EXT_m		('m' - 'a')
 #define RISCV_ISA_EXT_s		('s' - 'a')
 #define RISCV_ISA_EXT_u		('u' - 'a')
+#define RISCV_ISA_EXT_v		('v' - 'a')
 
 #define RISCV_ISA_EXT_zicsr	(('z' - 'a') + 1)
 #define RISCV_ISA_EXT_zifencei	(('z' - 'a') + 2)
 #define RISCV_ISA_EXT_zam	(('z' - 'a') + 3)
 #define RISCV_ISA_EXT_ztso	(('z' - 'a') + 4)
+#define RISCV_ISA_EXT_sstc	(('z' - 'a') + 5)
 
 #define RISCV_ISA_EXT_MAX	256
 
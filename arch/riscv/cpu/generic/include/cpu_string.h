@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ * @file cpu_string.h
+ * @author agent (agent@local)
+ * @brief header of RISC-V memory functions
+ */
+
+#ifndef _CPU_STRING_H__
+#define _CPU_STRING_H__
+
+#include <vmm_types.h>
+
+/** Low-level scalar memory functions */
+void *__memcpy_scalar(void *dest, const void *src, size_t count);
+void *__memmove_scalar(void *dest, const void *src, size_t count);
+void *__memset_scalar(void *dest, int c, size_t count);
+
+/** Low-level vector memory functions (count must be non-zero) */
+void *__memcpy_vector(void *dest, const void *src, size_t count);
+void *__memset_vector(void *dest, int c, size_t count);
+
+/** Select memory functions based on Host ISA features */
+void cpu_string_init(void);
+
+#endif
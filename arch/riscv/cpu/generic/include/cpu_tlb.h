@@ -50,6 +50,12 @@ void __hfence_vvma_va(unsigned long va);
 /** Invalidate all possible Stage2 TLBs */
 void __hfence_vvma_all(void);
 
+/** Synchronize instruction and data streams of current host CPU */
+static inline void __fence_i(void)
+{
+	__asm__ __volatile__("fence.i" : : : "memory");
+}
+
 inline void __sfence_vma_asid_va(unsigned long asid, unsigned long va)
 {
 	__asm__ __volatile__("sfence.vma %0 %1"
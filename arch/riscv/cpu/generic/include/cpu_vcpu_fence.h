@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cpu_vcpu_fence.h
+ * @author agent (agent@local)
+ * @brief header of VCPU remote fence functions
+ */
+
+#ifndef _CPU_VCPU_FENCE_H__
+#define _CPU_VCPU_FENCE_H__
+
+#include <vmm_types.h>
+#include <vmm_manager.h>
+
+/** Types of fences which a VCPU can request on other VCPUs */
+enum cpu_vcpu_fence_type {
+	CPU_VCPU_FENCE_I = 0,
+	CPU_VCPU_FENCE_VVMA,
+	CPU_VCPU_FENCE_VVMA_ASID,
+	CPU_VCPU_FENCE_VVMA_ALL,
+};
+
+/** Function to initialize fence state of Guest */
+void cpu_vcpu_fence_guest_init(struct vmm_guest *guest);
+
+/** Function to initialize fence state of VCPU */
+void cpu_vcpu_fence_init(struct vmm_vcpu *vcpu);
+
+/** Function to do fences pending for VCPU on current host CPU
+ *  Note: This must be called after VCPU is marked RUNNING and before
+ *  it enters guest mode.
+ */
+void cpu_vcpu_fence_process(struct vmm_vcpu *vcpu);
+
+/** Function to fence VCPUs of a Guest selected by hart mask
+ *  Note: hbase == -1UL selects all VCPUs of the Guest
+ */
+void cpu_vcpu_fence_remote(struct vmm_vcpu *vcpu,
+			   unsigned long hmask, unsigned long hbase,
+			   enum cpu_vcpu_fence_type type,
+			   unsigned long start, unsigned long size,
+			   unsigned long asid);
+
+#endif
@@ -30,9 +30,15 @@
 
 struct riscv_timer_event {
 	struct vmm_timer_event time_ev;
+	/* VCPU timer is programmed directly using Sstc */
+	bool sstc;
+	/* Saved VSTIMECMP of VCPU (Sstc only) */
+	u64 vstimecmp;
 };
 
 void riscv_timer_event_start(struct vmm_vcpu *vcpu, u64 next_cycle);
+void riscv_timer_event_save(struct vmm_vcpu *vcpu);
+void riscv_timer_event_restore(struct vmm_vcpu *vcpu);
 int riscv_timer_event_init(struct vmm_vcpu *vcpu, void **timer_event);
 int riscv_timer_event_deinit(struct vmm_vcpu *vcpu, void **timer_event);
 
@@ -45,6 +45,7 @@
 #define MSTATUS_MPIE			_UL(0x00000080)
 #define MSTATUS_SPP_SHIFT		8
 #define MSTATUS_SPP			(_UL(1) << MSTATUS_SPP_SHIFT)
+#define MSTATUS_VS			_UL(0x00000600)
 #define MSTATUS_MPP_SHIFT		11
 #define MSTATUS_MPP			(_UL(3) << MSTATUS_MPP_SHIFT)
 #define MSTATUS_FS			_UL(0x00006000)
@@ -105,6 +106,8 @@
 #define SSTATUS_SD			SSTATUS32_SD
 #endif
 
+#define SSTATUS_VS			MSTATUS_VS
+
 #define SSTATUS_FS			MSTATUS_FS
 #define SSTATUS_FS_OFF			MSTATUS_FS_OFF
 #define SSTATUS_FS_INITIAL		MSTATUS_FS_INITIAL
@@ -244,6 +247,10 @@
 #define HGATP_MODE_SHIFT		HGATP32_MODE_SHIFT
 #endif
 
+/* Environment configuration (Sstc timer enable) */
+#define ENVCFG_STCE			_ULL(0x8000000000000000)
+#define ENVCFGH_STCE			_UL(0x80000000)
+
 
 /* Exception Cause */
 #ifdef CONFIG_64BIT
@@ -358,6 +365,8 @@
 #define CSR_HCOUNTEREN			0x606
 #define CSR_HGEIE			0x607
 #define CSR_HTIMEDELTAH			0x615
+#define CSR_HENVCFG			0x60a
+#define CSR_HENVCFGH			0x61a
 #define CSR_HTVAL			0x643
 #define CSR_HIP				0x644
 #define CSR_HVIP			0x645
@@ -373,6 +382,8 @@
 #define CSR_VSCAUSE			0x242
 #define CSR_VSTVAL			0x243
 #define CSR_VSIP			0x244
+#define CSR_VSTIMECMP			0x24d
+#define CSR_VSTIMECMPH			0x25d
 #define CSR_VSATP			0x280
 
 #define CSR_MSTATUS			0x300
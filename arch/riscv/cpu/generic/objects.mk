@@ -43,6 +43,9 @@ endif
 ifeq ($(CONFIG_RISCV_ISA_C),y)
 	arch-c-y = c
 endif
+ifeq ($(CONFIG_RISCV_ISA_V),y)
+	arch-v-y = v
+endif
 
 arch-cflags-y += -fno-omit-frame-pointer -fno-optimize-sibling-calls
 arch-cflags-y += -mno-save-restore -mstrict-align
@@ -57,7 +60,7 @@ endif
 cpu-cppflags+=-DTEXT_START=0x10000000
 cpu-cflags += $(arch-cflags-y) -march=$(march-y)$(arch-a-y)$(arch-c-y)
 cpu-cflags += -fno-strict-aliasing -O2
-cpu-asflags += $(arch-cflags-y) -march=$(march-y)$(arch-a-y)fd$(arch-c-y)
+cpu-asflags += $(arch-cflags-y) -march=$(march-y)$(arch-a-y)fd$(arch-c-y)$(arch-v-y)
 cpu-ldflags += $(arch-ldflags-y) -march=$(march-y)$(arch-a-y)$(arch-c-y)
 
 cpu-objs-y+= cpu_entry.o
@@ -68,6 +71,10 @@ cpu-objs-y+= cpu_init.o
 cpu-objs-y+= cpu_mmu_initial_pgtbl.o
 cpu-objs-y+= cpu_mmu.o
 cpu-objs-y+= cpu_delay.o
+cpu-objs-y+= cpu_memcpy.o
+cpu-objs-y+= cpu_memset.o
+cpu-objs-$(CONFIG_RISCV_ISA_V)+= cpu_memvec.o
+cpu-objs-y+= cpu_string.o
 cpu-objs-$(CONFIG_MODULES)+= cpu_elf.o
 cpu-objs-$(CONFIG_RISCV_STACKTRACE)+= cpu_stacktrace.o
 cpu-objs-$(CONFIG_SMP)+= cpu_locks.o
@@ -79,6 +86,7 @@ cpu-objs-$(CONFIG_SMP)+=cpu_smp_ops_default.o
 cpu-objs-$(CONFIG_SMP)+=cpu_smp_ops_sbi.o
 cpu-objs-y+= cpu_vcpu_helper.o
 cpu-objs-y+= cpu_vcpu_csr.o
+cpu-objs-y+= cpu_vcpu_fence.o
 cpu-objs-y+= cpu_vcpu_fp.o
 cpu-objs-y+= cpu_vcpu_irq.o
 cpu-objs-y+= cpu_vcpu_sbi.o
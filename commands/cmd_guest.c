@@ -31,6 +31,7 @@
 #include <vmm_cmdmgr.h>
 #include <vmm_devemu.h>
 #include <libs/stringlib.h>
+#include <libs/bitmap.h>
 
 #define MODULE_DESC			"Command guest"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -55,6 +56,7 @@ static void cmd_guest_usage(struct vmm_chardev *cdev)
 			  "[mem_sz]\n");
 	vmm_cprintf(cdev, "   guest region_list <guest_name>\n");
 	vmm_cprintf(cdev, "   guest region  <guest_name> <gphys_addr>\n");
+	vmm_cprintf(cdev, "   guest stage2_stats <guest_name>\n");
 	vmm_cprintf(cdev, "Note:\n");
 	vmm_cprintf(cdev, "   <guest_name> = node name under /guests "
 			  "device tree node\n");
@@ -328,6 +330,12 @@ static void cmd_guest_print_region(struct vmm_guest *guest,
 	vmm_cprintf(cdev, "Region maps count            : %u\n",
 		    VMM_REGION_MAPS_COUNT(reg));
 
+	if (VMM_REGION_FLAGS(reg) & VMM_REGION_ISONDEMAND) {
+		vmm_cprintf(cdev, "Region populated maps count  : %d\n",
+			    bitmap_weight(reg->ondemand_bmap,
+					  VMM_REGION_MAPS_COUNT(reg)));
+	}
+
 	vmm_cprintf(cdev, "Region mappings              :\n");
 
 	vmm_guest_iterate_mapping(guest, reg,
@@ -377,6 +385,66 @@ static int cmd_guest_region(struct vmm_chardev *cdev, const char *name,
 	return VMM_OK;
 }
 
+static int cmd_guest_stage2_stats(struct vmm_chardev *cdev, const char *name)
+{
+	int rc;
+	char str[16];
+	const char *policy;
+	physical_size_t used, limit;
+	struct vmm_guest_stage2_stats stats;
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	rc = vmm_guest_stage2_stats(guest, &stats);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to get stage2 stats\n");
+		return rc;
+	}
+
+	switch (vmm_guest_stage2_map_policy(guest)) {
+	case VMM_GUEST_STAGE2_MAP_FAULT_AROUND:
+		policy = VMM_DEVTREE_STAGE2_MAP_VAL_FAULT_AROUND;
+		break;
+	case VMM_GUEST_STAGE2_MAP_PREFAULT:
+		policy = VMM_DEVTREE_STAGE2_MAP_VAL_PREFAULT;
+		break;
+	default:
+		policy = VMM_DEVTREE_STAGE2_MAP_VAL_FAULT;
+		break;
+	};
+
+	vmm_cprintf(cdev, "Map Policy     : %s", policy);
+	if (vmm_guest_stage2_map_policy(guest) ==
+	    VMM_GUEST_STAGE2_MAP_FAULT_AROUND) {
+		vmm_cprintf(cdev, " (%d blocks)",
+			    vmm_guest_stage2_fault_around(guest));
+	}
+	vmm_cprintf(cdev, "\n");
+	vmm_cprintf(cdev, "Faults         : %"PRIu64"\n", stats.fault_count);
+	vmm_cprintf(cdev, "Fault Maps     : %"PRIu64"\n", stats.fault_map_count);
+	vmm_cprintf(cdev, "Prefault Maps  : %"PRIu64"\n",
+		    stats.prefault_map_count);
+
+	if (!vmm_guest_ondemand_ram_usage(guest, &used, NULL)) {
+		str[0] = '\0';
+		u64_to_size_str(used, str, sizeof(str));
+		vmm_cprintf(cdev, "OnDemand RAM   : %s", str);
+		vmm_guest_ondemand_ram_usage(NULL, &used, &limit);
+		str[0] = '\0';
+		u64_to_size_str(used, str, sizeof(str));
+		vmm_cprintf(cdev, " (all guests %s", str);
+		str[0] = '\0';
+		u64_to_size_str(limit, str, sizeof(str));
+		vmm_cprintf(cdev, " of %s limit)\n", str);
+	}
+
+	return VMM_OK;
+}
+
 static int cmd_guest_param(struct vmm_chardev *cdev, int argc, char **argv,
 			   physical_addr_t *src_addr, u32 *size)
 {
@@ -441,6 +509,8 @@ static int cmd_guest_exec(struct vmm_chardev *cdev, int argc, char **argv)
 			return ret;
 		}
 		return cmd_guest_region(cdev, argv[2], src_addr);
+	} else if (strcmp(argv[1], "stage2_stats") == 0) {
+		return cmd_guest_stage2_stats(cdev, argv[2]);
 	} else {
 		cmd_guest_usage(cdev);
 		return VMM_EFAIL;
@@ -50,7 +50,8 @@ static void cmd_heap_usage(struct vmm_chardev *cdev)
 
 static int heap_info(struct vmm_chardev *cdev,
 		     bool is_normal, virtual_addr_t heap_va,
-		     u64 heap_sz, u64 heap_hksz, u64 heap_freesz)
+		     u64 heap_sz, u64 heap_hksz, u64 heap_freesz,
+		     struct vmm_heap_cache_stats *cstats)
 {
 	int rc;
 	physical_addr_t heap_pa;
@@ -95,16 +96,37 @@ static int heap_info(struct vmm_chardev *cdev,
 	vmm_cprintf(cdev, "%"PRId64".%03"PRId64" KB\n",
 		    udiv64(heap_sz, pre), umod64(heap_sz, pre));
 
+	if (!cstats->slab_pages && !cstats->alloc_hit && !cstats->alloc_miss) {
+		return VMM_OK;
+	}
+
+	vmm_cprintf(cdev, "Cached Free Size   : ");
+	heap_freesz = ((u64)cstats->cached_size * pre) >> 10;
+	vmm_cprintf(cdev, "%"PRId64".%03"PRId64" KB\n",
+		    udiv64(heap_freesz, pre), umod64(heap_freesz, pre));
+
+	vmm_cprintf(cdev, "Slab Pages         : %d\n", cstats->slab_pages);
+
+	vmm_cprintf(cdev, "Magazine Alloc     : %"PRIu64" hit, %"PRIu64" miss\n",
+		    cstats->alloc_hit, cstats->alloc_miss);
+
+	vmm_cprintf(cdev, "Magazine Free      : %"PRIu64" hit, %"PRIu64" miss\n",
+		    cstats->free_hit, cstats->free_miss);
+
 	return VMM_OK;
 }
 
 static int cmd_heap_info(struct vmm_chardev *cdev)
 {
+	struct vmm_heap_cache_stats cstats;
+
+	vmm_normal_heap_cache_stats(&cstats);
+
 	return heap_info(cdev, TRUE,
 			 vmm_normal_heap_start_va(),
 			 vmm_normal_heap_size(),
 			 vmm_normal_heap_hksize(),
-			 vmm_normal_heap_free_size());
+			 vmm_normal_heap_free_size(), &cstats);
 }
 
 static int cmd_heap_state(struct vmm_chardev *cdev)
@@ -114,11 +136,15 @@ static int cmd_heap_state(struct vmm_chardev *cdev)
 
 static int cmd_heap_dma_info(struct vmm_chardev *cdev)
 {
+	struct vmm_heap_cache_stats cstats;
+
+	vmm_dma_heap_cache_stats(&cstats);
+
 	return heap_info(cdev, FALSE,
 			 vmm_dma_heap_start_va(),
 			 vmm_dma_heap_size(),
 			 vmm_dma_heap_hksize(),
-			 vmm_dma_heap_free_size());
+			 vmm_dma_heap_free_size(), &cstats);
 }
 
 static int cmd_heap_dma_state(struct vmm_chardev *cdev)
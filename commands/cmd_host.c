@@ -23,6 +23,7 @@
 
 #include <vmm_error.h>
 #include <vmm_smp.h>
+#include <vmm_heap.h>
 #include <vmm_stdio.h>
 #include <vmm_cpumask.h>
 #include <vmm_resource.h>
@@ -58,6 +59,11 @@ static void cmd_host_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "   host info\n");
 	vmm_cprintf(cdev, "   host cpu info\n");
 	vmm_cprintf(cdev, "   host cpu stats\n");
+	vmm_cprintf(cdev, "   host ipi stats\n");
+	vmm_cprintf(cdev, "   host migrate stats\n");
+	vmm_cprintf(cdev, "   host sched stats\n");
+	vmm_cprintf(cdev, "   host sched hist <hcpu>\n");
+	vmm_cprintf(cdev, "   host sched reset [<hcpu>]\n");
 	vmm_cprintf(cdev, "   host irq stats\n");
 	vmm_cprintf(cdev, "   host irq set_affinity <hirq> <hcpu>\n");
 	vmm_cprintf(cdev, "   host extirq stats\n");
@@ -209,6 +215,241 @@ static int cmd_host_cpu_stats(struct vmm_chardev *cdev)
 	return VMM_OK;
 }
 
+static int cmd_host_ipi_stats(struct vmm_chardev *cdev)
+{
+	int rc;
+	u32 c;
+	struct vmm_smp_ipi_stats stats;
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %4s %11s %11s %11s %11s %7s %7s\n",
+			  "CPU#", "Sync", "Async", "Triggers",
+			  "Full", "SyncQ", "AsyncQ");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	for_each_online_cpu(c) {
+		rc = vmm_smp_ipi_stats(c, &stats);
+		if (rc) {
+			vmm_cprintf(cdev, "Failed to get IPI stats of CPU%d "
+				    "(error %d)\n", c, rc);
+			return rc;
+		}
+
+		vmm_cprintf(cdev, " %4d %11"PRIu64" %11"PRIu64" %11"PRIu64
+			    " %11"PRIu64" %7d %7d\n", c,
+			    stats.sync_count, stats.async_count,
+			    stats.trigger_count, stats.full_count,
+			    stats.sync_pending, stats.async_pending);
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	return VMM_OK;
+}
+
+static int cmd_host_migrate_stats(struct vmm_chardev *cdev)
+{
+	int rc;
+	u32 c;
+	struct vmm_scheduler_migrate_stats stats;
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %4s %15s %15s %15s\n",
+			  "CPU#", "Migrated In", "Migrated Out", "Pulled");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	for_each_online_cpu(c) {
+		rc = vmm_scheduler_migrate_stats(c, &stats);
+		if (rc) {
+			vmm_cprintf(cdev, "Failed to get migrate stats of "
+				    "CPU%d (error %d)\n", c, rc);
+			return rc;
+		}
+
+		vmm_cprintf(cdev, " %4d %15"PRIu64" %15"PRIu64" %15"PRIu64"\n",
+			    c, stats.in_count, stats.out_count,
+			    stats.pull_count);
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	return VMM_OK;
+}
+
+static u64 sched_stats_avg(u64 total, u64 count)
+{
+	return (count) ? udiv64(total, count) : 0;
+}
+
+static int cmd_host_sched_stats(struct vmm_chardev *cdev)
+{
+	int rc;
+	u32 c, p;
+	u64 count, total, max;
+	struct vmm_scheduler_rq_stats *stats;
+
+	stats = vmm_zalloc(sizeof(*stats));
+	if (!stats) {
+		return VMM_ENOMEM;
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %4s %11s %6s %6s %11s %11s %11s %11s\n",
+			  "CPU#", "Switches", "AvgRQ", "MaxRQ", "AvgIRQ(ns)",
+			  "MaxIRQ(ns)", "AvgLat(ns)", "MaxLat(ns)");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	for_each_online_cpu(c) {
+		rc = vmm_scheduler_rq_stats(c, stats);
+		if (rc) {
+			vmm_cprintf(cdev, "Failed to get sched stats of "
+				    "CPU%d (error %d)\n", c, rc);
+			goto done;
+		}
+
+		count = total = max = 0;
+		for (p = VMM_VCPU_MIN_PRIORITY;
+		     p <= VMM_VCPU_MAX_PRIORITY; p++) {
+			count += stats->latency_count[p];
+			total += stats->latency_total_nsecs[p];
+			if (max < stats->latency_max_nsecs[p]) {
+				max = stats->latency_max_nsecs[p];
+			}
+		}
+
+		vmm_cprintf(cdev, " %4d %11"PRIu64" %6"PRIu64" %6d"
+			    " %11"PRIu64" %11"PRIu64" %11"PRIu64
+			    " %11"PRIu64"\n", c, stats->switch_count,
+			    sched_stats_avg(stats->rq_len_total,
+					    stats->switch_count),
+			    stats->rq_len_max,
+			    sched_stats_avg(stats->irq_total_nsecs,
+					    stats->switch_count),
+			    stats->irq_max_nsecs,
+			    sched_stats_avg(total, count), max);
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	rc = VMM_OK;
+
+done:
+	vmm_free(stats);
+	return rc;
+}
+
+static u64 sched_hist_bucket_start(u32 b)
+{
+	return (b) ? (1ULL << (b - 1)) : 0;
+}
+
+static int cmd_host_sched_hist(struct vmm_chardev *cdev, u32 hcpu)
+{
+	int rc;
+	u32 b, p;
+	struct vmm_scheduler_rq_stats *stats;
+
+	stats = vmm_zalloc(sizeof(*stats));
+	if (!stats) {
+		return VMM_ENOMEM;
+	}
+
+	rc = vmm_scheduler_rq_stats(hcpu, stats);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to get sched stats of "
+			    "CPU%d (error %d)\n", hcpu, rc);
+		goto done;
+	}
+
+	vmm_cprintf(cdev, "CPU%d statistics since %"PRIu64" msecs "
+		    "(bucket N counts samples from N to next bucket)\n",
+		    hcpu, udiv64(stats->since_nsecs, 1000000ULL));
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-11s READY to RUNNING latency for each "
+			  "VCPU priority\n", "Nanosecs");
+	vmm_cprintf(cdev, " %11s", "");
+	for (p = VMM_VCPU_MIN_PRIORITY; p <= VMM_VCPU_MAX_PRIORITY; p++) {
+		vmm_cprintf(cdev, " %6s%d", "Prio", p);
+	}
+	vmm_cprintf(cdev, "\n");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	for (b = 0; b < VMM_SCHEDULER_HIST_BUCKETS; b++) {
+		for (p = VMM_VCPU_MIN_PRIORITY;
+		     p <= VMM_VCPU_MAX_PRIORITY; p++) {
+			if (stats->latency_hist[p][b]) {
+				break;
+			}
+		}
+		if (VMM_VCPU_MAX_PRIORITY < p) {
+			continue;
+		}
+		vmm_cprintf(cdev, " %11"PRIu64, sched_hist_bucket_start(b));
+		for (p = VMM_VCPU_MIN_PRIORITY;
+		     p <= VMM_VCPU_MAX_PRIORITY; p++) {
+			vmm_cprintf(cdev, " %7d", stats->latency_hist[p][b]);
+		}
+		vmm_cprintf(cdev, "\n");
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %11s %15s %15s\n",
+			  "Bucket", "Ready Queue", "IRQ Nanosecs");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	for (b = 0; b < VMM_SCHEDULER_HIST_BUCKETS; b++) {
+		if (!stats->rq_len_hist[b] && !stats->irq_hist[b]) {
+			continue;
+		}
+		vmm_cprintf(cdev, " %11"PRIu64" %15d %15d\n",
+			    sched_hist_bucket_start(b),
+			    stats->rq_len_hist[b], stats->irq_hist[b]);
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+done:
+	vmm_free(stats);
+	return rc;
+}
+
+static int cmd_host_sched_reset(struct vmm_chardev *cdev, int hcpu)
+{
+	int rc;
+	u32 c;
+
+	if (0 <= hcpu) {
+		rc = vmm_scheduler_rq_stats_reset(hcpu);
+		if (rc) {
+			vmm_cprintf(cdev, "Failed to reset sched stats of "
+				    "CPU%d (error %d)\n", hcpu, rc);
+		}
+		return rc;
+	}
+
+	for_each_online_cpu(c) {
+		rc = vmm_scheduler_rq_stats_reset(c);
+		if (rc) {
+			vmm_cprintf(cdev, "Failed to reset sched stats of "
+				    "CPU%d (error %d)\n", c, rc);
+			return rc;
+		}
+	}
+
+	return VMM_OK;
+}
+
 static void irq_stats_print(struct vmm_chardev *cdev, u32 irqno)
 {
 	struct vmm_host_irq *irq;
@@ -677,6 +918,24 @@ static int cmd_host_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		} else if (strcmp(argv[2], "stats") == 0) {
 			return cmd_host_cpu_stats(cdev);
 		}
+	} else if ((strcmp(argv[1], "ipi") == 0) && (2 < argc)) {
+		if (strcmp(argv[2], "stats") == 0) {
+			return cmd_host_ipi_stats(cdev);
+		}
+	} else if ((strcmp(argv[1], "migrate") == 0) && (2 < argc)) {
+		if (strcmp(argv[2], "stats") == 0) {
+			return cmd_host_migrate_stats(cdev);
+		}
+	} else if ((strcmp(argv[1], "sched") == 0) && (2 < argc)) {
+		if (strcmp(argv[2], "stats") == 0) {
+			return cmd_host_sched_stats(cdev);
+		} else if ((strcmp(argv[2], "hist") == 0) && (3 < argc)) {
+			hcpu = atoi(argv[3]);
+			return cmd_host_sched_hist(cdev, hcpu);
+		} else if (strcmp(argv[2], "reset") == 0) {
+			hcpu = (3 < argc) ? atoi(argv[3]) : -1;
+			return cmd_host_sched_reset(cdev, hcpu);
+		}
 	} else if ((strcmp(argv[1], "irq") == 0) && (2 < argc)) {
 		if (strcmp(argv[2], "stats") == 0) {
 			cmd_host_irq_stats(cdev);
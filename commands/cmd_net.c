@@ -31,7 +31,9 @@
 #include <net/vmm_netport.h>
 #include <net/vmm_netswitch.h>
 #include <net/vmm_protocol.h>
+#include <net/vmm_bridge.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 
 #define MODULE_DESC			"Command net"
 #define MODULE_AUTHOR			"Sukanto Ghosh"
@@ -49,6 +51,11 @@ static void cmd_net_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "   net switch create <policy_name> <switch_name> ...\n");
 	vmm_cprintf(cdev, "   net switch destroy <switch_name>\n");
 	vmm_cprintf(cdev, "   net port list\n");
+	vmm_cprintf(cdev, "   net bridge fdb <switch_name>\n");
+	vmm_cprintf(cdev, "   net bridge fdb_add <switch_name> <port_name> "
+			  "<mac_addr>\n");
+	vmm_cprintf(cdev, "   net bridge fdb_del <switch_name> <mac_addr>\n");
+	vmm_cprintf(cdev, "   net bridge ageing <switch_name> [<seconds>]\n");
 }
 
 struct cmd_net_list_priv {
@@ -203,6 +210,161 @@ static int cmd_net_port_list(struct vmm_chardev *cdev,
 	return VMM_OK;
 }
 
+static struct vmm_netswitch *cmd_net_bridge_find(struct vmm_chardev *cdev,
+						 const char *switch_name)
+{
+	struct vmm_netswitch *nsw = vmm_netswitch_find(switch_name);
+
+	if (!nsw) {
+		vmm_cprintf(cdev, "Failed to find %s switch\n", switch_name);
+		return NULL;
+	}
+
+	if (!vmm_bridge_check(nsw)) {
+		vmm_cprintf(cdev, "Switch %s is not a bridge\n", switch_name);
+		return NULL;
+	}
+
+	return nsw;
+}
+
+static int cmd_net_bridge_fdb_iter(struct vmm_netswitch *nsw,
+				   struct vmm_bridge_fdb_info *info,
+				   void *data)
+{
+	char hwaddr[20];
+	struct cmd_net_list_priv *p = data;
+
+	vmm_cprintf(p->cdev, " %-5d %-22s %-19s %-8s %-10"PRIu64"\n",
+		    p->num++, ethaddr_to_str(hwaddr, info->macaddr),
+		    info->port->name, (info->is_static) ? "static" : "learned",
+		    udiv64(info->age_nsecs, 1000000000ULL));
+
+	return VMM_OK;
+}
+
+static int cmd_net_bridge_fdb(struct vmm_chardev *cdev,
+			      const char *switch_name)
+{
+	int rc;
+	u32 ageing;
+	struct vmm_netswitch *nsw;
+	struct cmd_net_list_priv p = { .num = 0, .cdev = cdev };
+
+	nsw = cmd_net_bridge_find(cdev, switch_name);
+	if (!nsw) {
+		return VMM_EINVALID;
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-5s %-22s %-19s %-8s %-10s\n",
+		    "Num#", "HW-Address", "Port", "Type", "Age(secs)");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	rc = vmm_bridge_fdb_iterate(nsw, &p, cmd_net_bridge_fdb_iter);
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	if (!rc && !vmm_bridge_get_ageing(nsw, &ageing)) {
+		vmm_cprintf(cdev, " Total %d entries, ageing %d seconds\n",
+			    p.num, ageing);
+	}
+
+	return rc;
+}
+
+static int cmd_net_bridge_fdb_add(struct vmm_chardev *cdev,
+				  const char *switch_name,
+				  const char *port_name,
+				  const char *mac_str)
+{
+	int rc;
+	u8 mac[6];
+	struct vmm_netport *port;
+	struct vmm_netswitch *nsw;
+
+	nsw = cmd_net_bridge_find(cdev, switch_name);
+	if (!nsw) {
+		return VMM_EINVALID;
+	}
+
+	port = vmm_netport_find(port_name);
+	if (!port) {
+		vmm_cprintf(cdev, "Failed to find %s port\n", port_name);
+		return VMM_EINVALID;
+	}
+
+	if (!str2ethaddr(mac, mac_str)) {
+		vmm_cprintf(cdev, "Invalid MAC address %s\n", mac_str);
+		return VMM_EINVALID;
+	}
+
+	rc = vmm_bridge_fdb_add_static(nsw, port, mac);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to add %s on %s (error %d)\n",
+			    mac_str, port_name, rc);
+	}
+
+	return rc;
+}
+
+static int cmd_net_bridge_fdb_del(struct vmm_chardev *cdev,
+				  const char *switch_name,
+				  const char *mac_str)
+{
+	int rc;
+	u8 mac[6];
+	struct vmm_netswitch *nsw;
+
+	nsw = cmd_net_bridge_find(cdev, switch_name);
+	if (!nsw) {
+		return VMM_EINVALID;
+	}
+
+	if (!str2ethaddr(mac, mac_str)) {
+		vmm_cprintf(cdev, "Invalid MAC address %s\n", mac_str);
+		return VMM_EINVALID;
+	}
+
+	rc = vmm_bridge_fdb_del(nsw, mac);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to delete %s (error %d)\n",
+			    mac_str, rc);
+	}
+
+	return rc;
+}
+
+static int cmd_net_bridge_ageing(struct vmm_chardev *cdev,
+				 const char *switch_name,
+				 int argc, char **argv)
+{
+	int rc;
+	u32 secs;
+	struct vmm_netswitch *nsw;
+
+	nsw = cmd_net_bridge_find(cdev, switch_name);
+	if (!nsw) {
+		return VMM_EINVALID;
+	}
+
+	if (argc > 0) {
+		rc = vmm_bridge_set_ageing(nsw, strtoul(argv[0], NULL, 10));
+		if (rc) {
+			return rc;
+		}
+	}
+
+	rc = vmm_bridge_get_ageing(nsw, &secs);
+	if (rc) {
+		return rc;
+	}
+
+	vmm_cprintf(cdev, "%s: ageing %d seconds\n", nsw->name, secs);
+
+	return VMM_OK;
+}
+
 static int cmd_net_exec(struct vmm_chardev *cdev, int argc, char **argv)
 {
 	if (argc <= 1) {
@@ -234,6 +396,23 @@ static int cmd_net_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		   (strcmp(argv[1], "port") == 0) &&
 		   (strcmp(argv[2], "list") == 0)) {
 		return cmd_net_port_list(cdev, argc - 3, &argv[3]);
+	} else if ((argc >= 4) &&
+		   (strcmp(argv[1], "bridge") == 0) &&
+		   (strcmp(argv[2], "fdb") == 0)) {
+		return cmd_net_bridge_fdb(cdev, argv[3]);
+	} else if ((argc >= 6) &&
+		   (strcmp(argv[1], "bridge") == 0) &&
+		   (strcmp(argv[2], "fdb_add") == 0)) {
+		return cmd_net_bridge_fdb_add(cdev, argv[3], argv[4], argv[5]);
+	} else if ((argc >= 5) &&
+		   (strcmp(argv[1], "bridge") == 0) &&
+		   (strcmp(argv[2], "fdb_del") == 0)) {
+		return cmd_net_bridge_fdb_del(cdev, argv[3], argv[4]);
+	} else if ((argc >= 4) &&
+		   (strcmp(argv[1], "bridge") == 0) &&
+		   (strcmp(argv[2], "ageing") == 0)) {
+		return cmd_net_bridge_ageing(cdev, argv[3],
+					     argc - 4, &argv[4]);
 	}
 
 fail:
@@ -61,6 +61,7 @@ static void cmd_vcpu_usage(struct vmm_chardev *cdev)
 			  "<hcpu0> <hcpu1> <hcpu2> ...\n");
 	vmm_cprintf(cdev, "   vcpu dumpreg <vcpu_id>\n");
 	vmm_cprintf(cdev, "   vcpu dumpstat <vcpu_id>\n");
+	vmm_cprintf(cdev, "   vcpu resetstat <vcpu_id>\n");
 }
 
 static int cmd_vcpu_help(struct vmm_chardev *cdev,
@@ -537,6 +538,7 @@ static int cmd_vcpu_dumpstat(struct vmm_chardev *cdev,
 	u64 last_reset_nsecs, total_nsecs;
 	u64 ready_nsecs, running_nsecs, paused_nsecs;
 	u64 halted_nsecs, system_nsecs;
+	u64 latency_count, latency_nsecs, latency_max_nsecs;
 	struct vmm_vcpu *vcpu;
 
 	if (!argc) {
@@ -623,6 +625,17 @@ static int cmd_vcpu_dumpstat(struct vmm_chardev *cdev,
 	vmm_cprintf(cdev, "Last Reset Since : %d:%02d:%02d:%03d\n",
 			  h, m, s, ms);
 	vmm_cprintf(cdev, "\n");
+	if (!vmm_scheduler_latency_stats(vcpu, &latency_count,
+					 &latency_nsecs, &latency_max_nsecs)) {
+		vmm_cprintf(cdev, "Dispatch Count   : %"PRIu64"\n",
+				  latency_count);
+		vmm_cprintf(cdev, "Avg Ready Latency: %"PRIu64" ns\n",
+			    (latency_count) ?
+			    udiv64(latency_nsecs, latency_count) : 0);
+		vmm_cprintf(cdev, "Max Ready Latency: %"PRIu64" ns\n",
+				  latency_max_nsecs);
+		vmm_cprintf(cdev, "\n");
+	}
 
 	/* Architecture specific dumpstat */
 	arch_vcpu_stat_dump(cdev, vcpu);
@@ -630,6 +643,36 @@ static int cmd_vcpu_dumpstat(struct vmm_chardev *cdev,
 	return ret;
 }
 
+static int cmd_vcpu_resetstat(struct vmm_chardev *cdev,
+			      int argc, char **argv)
+{
+	int ret, id;
+	struct vmm_vcpu *vcpu;
+
+	if (!argc) {
+		vmm_cprintf(cdev, "Must provide vcpu ID\n");
+		cmd_vcpu_usage(cdev);
+		return VMM_EINVALID;
+	}
+	id = atoi(argv[0]);
+
+	vcpu = vmm_manager_vcpu(id);
+	if (!vcpu) {
+		vmm_cprintf(cdev, "Failed to find vcpu\n");
+		return VMM_EFAIL;
+	}
+
+	ret = vmm_scheduler_latency_stats_reset(vcpu);
+	if (ret) {
+		vmm_cprintf(cdev, "%s: Failed to reset stats\n",
+				  vcpu->name);
+	} else {
+		vmm_cprintf(cdev, "%s: Reset stats done\n", vcpu->name);
+	}
+
+	return ret;
+}
+
 static const struct {
 	char *name;
 	int (*function) (struct vmm_chardev *, int, char **);
@@ -649,6 +692,7 @@ static const struct {
 	{"set_affinity", cmd_vcpu_set_affinity, 2},
 	{"dumpreg", cmd_vcpu_dumpreg, 1},
 	{"dumpstat", cmd_vcpu_dumpstat, 1},
+	{"resetstat", cmd_vcpu_resetstat, 1},
 	{NULL, NULL, 0},
 };
 
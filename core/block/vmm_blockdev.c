@@ -28,6 +28,7 @@
 #include <vmm_scheduler.h>
 #include <vmm_devdrv.h>
 #include <vmm_completion.h>
+#include <vmm_host_aspace.h>
 #include <block/vmm_blockdev.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
@@ -53,6 +54,55 @@ int vmm_blockdev_unregister_client(struct vmm_notifier_block *nb)
 }
 VMM_EXPORT_SYMBOL(vmm_blockdev_unregister_client);
 
+static void __blockdev_sg_copy(struct vmm_request *r, bool to_sg)
+{
+	u32 i, pos = 0;
+
+	for (i = 0; i < r->sg_count; i++) {
+		if (to_sg) {
+			vmm_host_memory_write(r->sg[i].addr, r->data + pos,
+					      r->sg[i].len, TRUE);
+		} else {
+			vmm_host_memory_read(r->sg[i].addr, r->data + pos,
+					     r->sg[i].len, TRUE);
+		}
+		pos += r->sg[i].len;
+	}
+}
+
+static int __blockdev_sg_bounce(struct vmm_request_queue *rq,
+				struct vmm_request *r)
+{
+	if (!r->sg_count || rq->sg_supported) {
+		return VMM_OK;
+	}
+
+	r->data = vmm_malloc(vmm_request_sg_len(r));
+	if (!r->data) {
+		return VMM_ENOMEM;
+	}
+
+	if (r->type == VMM_REQUEST_WRITE) {
+		__blockdev_sg_copy(r, FALSE);
+	}
+
+	return VMM_OK;
+}
+
+static void __blockdev_sg_unbounce(struct vmm_request *r, bool success)
+{
+	if (!r->sg_count || !r->data) {
+		return;
+	}
+
+	if (success && (r->type == VMM_REQUEST_READ)) {
+		__blockdev_sg_copy(r, TRUE);
+	}
+
+	vmm_free(r->data);
+	r->data = NULL;
+}
+
 static int __blockdev_peek_cache(struct vmm_blockdev *bdev,
 				 struct vmm_request *r)
 {
@@ -133,6 +183,8 @@ int vmm_blockdev_complete_request(struct vmm_request *r)
 	rq = r->bdev->rq;
 	r->bdev = NULL;
 
+	__blockdev_sg_unbounce(r, TRUE);
+
 	if (r->completed) {
 		r->completed(r);
 	}
@@ -155,6 +207,8 @@ int vmm_blockdev_fail_request(struct vmm_request *r)
 	rq = r->bdev->rq;
 	r->bdev = NULL;
 
+	__blockdev_sg_unbounce(r, FALSE);
+
 	if (r->failed) {
 		r->failed(r);
 	}
@@ -198,17 +252,32 @@ int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 		rc = VMM_ERANGE;
 		goto failed;
 	}
+	if (r->sg_count && (!r->sg || r->data)) {
+		rc = VMM_EINVALID;
+		goto failed;
+	}
+	if (r->sg_count &&
+	    (vmm_request_sg_len(r) != ((u64)r->bcnt * bdev->block_size))) {
+		rc = VMM_EINVALID;
+		goto failed;
+	}
+
+	if ((rc = __blockdev_sg_bounce(rq, r))) {
+		goto failed;
+	}
 
 	if (rq->peek_cache) {
 		vmm_spin_lock_irqsave(&rq->lock, flags);
 		rc = __blockdev_peek_cache(bdev, r);
 		vmm_spin_unlock_irqrestore(&rq->lock, flags);
 		if (rc == VMM_OK) {
+			__blockdev_sg_unbounce(r, TRUE);
 			if (r->completed) {
 				r->completed(r);
 			}
 			return VMM_OK;
 		} else if (rc != VMM_ENOTAVAIL) {
+			__blockdev_sg_unbounce(r, FALSE);
 			if (r->failed) {
 				r->failed(r);
 			}
@@ -223,9 +292,11 @@ int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 		rc = __blockdev_make_request(bdev, r, TRUE);
 		vmm_spin_unlock_irqrestore(&rq->lock, flags);
 		if (rc) {
+			__blockdev_sg_unbounce(r, FALSE);
 			return rc;
 		}
 	} else {
+		__blockdev_sg_unbounce(r, FALSE);
 		rc = VMM_EFAIL;
 		goto failed;
 	}
@@ -326,6 +397,8 @@ static int blockdev_rw_blocks(struct vmm_blockdev *bdev,
 	rw.req.lba = bdev->start_lba + lba;
 	rw.req.bcnt = bcnt;
 	rw.req.data = buf;
+	rw.req.sg = NULL;
+	rw.req.sg_count = 0;
 	rw.req.priv = &rw;
 	rw.req.completed = blockdev_rw_completed;
 	rw.req.failed = blockdev_rw_failed;
@@ -41,6 +41,14 @@ enum vmm_request_type {
 	VMM_REQUEST_WRITE=2
 };
 
+/** Representation of a scatter-gather segment of block IO request
+ *  Note: addr is a host physical address of normal (non-IO) memory
+ */
+struct vmm_request_sg {
+	physical_addr_t addr;
+	u32 len;
+};
+
 /** Representation of a block IO request */
 struct vmm_request {
 	struct dlist head;
@@ -54,6 +62,14 @@ struct vmm_request {
 	u32 bcnt;
 	void *data;
 
+	/* Note: If sg_count is non-zero then data must be NULL and
+	 * request data is described by sg[0..sg_count-1] instead.
+	 * The block device framework will use a bounce buffer for
+	 * such requests if request queue does not support it.
+	 */
+	struct vmm_request_sg *sg;
+	u32 sg_count;
+
 	void (*completed)(struct vmm_request *);
 	void (*failed)(struct vmm_request *);
 	void *priv;
@@ -76,6 +92,12 @@ struct vmm_request_queue {
 	/* Backlog request list */
 	struct dlist backlog_list;
 
+	/* Note: if sg_supported is TRUE then make_request() and
+	 * peek_cache() must handle requests with non-zero sg_count
+	 * (i.e. requests having NULL data pointer).
+	 */
+	bool sg_supported;
+
 	/* Note: if peek_cache succeeds then we assume
 	 * request completed successfully.
 	 *
@@ -122,6 +144,7 @@ struct vmm_request_queue {
 		(__rq)->pending_count = 0; \
 		(__rq)->backlog_count = 0; \
 		INIT_LIST_HEAD(&(__rq)->backlog_list); \
+		(__rq)->sg_supported = FALSE; \
 		(__rq)->peek_cache = (__peek_cache); \
 		(__rq)->make_request = (__make_request); \
 		(__rq)->abort_request = (__abort_request); \
@@ -186,6 +209,19 @@ static inline u64 vmm_blockdev_total_size(struct vmm_blockdev *bdev)
 	return (bdev) ? bdev->num_blocks * bdev->block_size : 0;
 }
 
+/** Total data length of scatter-gather segments of a request */
+static inline u64 vmm_request_sg_len(struct vmm_request *r)
+{
+	u32 i;
+	u64 ret = 0;
+
+	for (i = 0; i < r->sg_count; i++) {
+		ret += r->sg[i].len;
+	}
+
+	return ret;
+}
+
 /** Generic block IO complete request */
 int vmm_blockdev_complete_request(struct vmm_request *r);
 
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_bridge.h
+ * @author agent (agent@local)
+ * @brief Interface to forwarding database of bridge netswitch.
+ */
+
+#ifndef __VMM_BRIDGE_H_
+#define __VMM_BRIDGE_H_
+
+#include <vmm_types.h>
+
+#define VMM_BRIDGE_POLICY_NAME		"bridge"
+
+struct vmm_netswitch;
+struct vmm_netport;
+
+/** Snapshot of a bridge forwarding database entry */
+struct vmm_bridge_fdb_info {
+	struct vmm_netport *port;
+	u8 macaddr[6];
+	bool is_static;
+	/* Nanoseconds since the entry was last refreshed */
+	u64 age_nsecs;
+};
+
+/** Check whether given netswitch was created by bridge policy */
+bool vmm_bridge_check(struct vmm_netswitch *nsw);
+
+/** Iterate over forwarding database entries of a bridge
+ *  Note: The callback gets a snapshot of entry hence it is
+ *  allowed to add/delete forwarding database entries.
+ */
+int vmm_bridge_fdb_iterate(struct vmm_netswitch *nsw, void *data,
+			   int (*fn)(struct vmm_netswitch *nsw,
+				     struct vmm_bridge_fdb_info *info,
+				     void *data));
+
+/** Add a static (never aged) forwarding database entry */
+int vmm_bridge_fdb_add_static(struct vmm_netswitch *nsw,
+			      struct vmm_netport *port,
+			      const u8 *macaddr);
+
+/** Delete a forwarding database entry (learned or static) */
+int vmm_bridge_fdb_del(struct vmm_netswitch *nsw, const u8 *macaddr);
+
+/** Get ageing time (in seconds) of learned entries */
+int vmm_bridge_get_ageing(struct vmm_netswitch *nsw, u32 *secs);
+
+/** Set ageing time (in seconds) of learned entries
+ *  Note: Zero ageing time means learned entries never expire.
+ */
+int vmm_bridge_set_ageing(struct vmm_netswitch *nsw, u32 secs);
+
+#endif /* __VMM_BRIDGE_H_ */
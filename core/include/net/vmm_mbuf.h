@@ -111,6 +111,10 @@ struct m_hdr {
  */
 struct m_pkthdr {
 	int	len;			/* total packet length */
+	u16	csum_start;		/* checksum start (M_CSUM_PARTIAL) */
+	u16	csum_offset;		/* checksum field from csum_start */
+	u16	gso_size;		/* payload bytes per GSO segment */
+	u8	gso_type;		/* GSO type; see below */
 };
 
 struct m_ext {
@@ -136,6 +140,10 @@ struct vmm_mbuf {
 #define	m_len		m_hdr.mh_len
 #define	m_flags		m_hdr.mh_flags
 #define m_pktlen	m_pkthdr.len
+#define m_csum_start	m_pkthdr.csum_start
+#define m_csum_offset	m_pkthdr.csum_offset
+#define m_gso_size	m_pkthdr.gso_size
+#define m_gso_type	m_pkthdr.gso_type
 #define m_extbuf	m_ext.ext_buf
 #define m_extlen	m_ext.ext_size
 #define m_extref	m_ext.ext_refcnt
@@ -152,6 +160,12 @@ struct vmm_mbuf {
 
 /* mbuf flags */
 #define	M_PKTHDR	0x00001	/* start of record */
+#define	M_CSUM_PARTIAL	0x00002	/* L4 checksum from csum_start pending */
+
+/* GSO types (packet is a super-frame of gso_size segments) */
+#define	M_GSO_NONE	0
+#define	M_GSO_TCPV4	1
+#define	M_GSO_TCPV6	2
 
 /* additional flags for M_EXT mbufs */
 #define	M_EXT_FLAGS	0xff000000
@@ -163,7 +177,7 @@ struct vmm_mbuf {
 #define	M_EXT_DMA	0x20000000	/* ext storage is dma heap alloced */
 
 /* flags copied when copying m_pkthdr */
-#define	M_COPYFLAGS	(M_PKTHDR)
+#define	M_COPYFLAGS	(M_PKTHDR|M_CSUM_PARTIAL)
 
 /* flag copied when shallow-copying external storage */
 #define	M_EXTCOPYFLAGS	(M_EXT_FLAGS)
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_netoffload.h
+ * @author agent (agent@local)
+ * @brief Software fallback for checksum and segmentation offloads.
+ */
+
+#ifndef __VMM_NETOFFLOAD_H_
+#define __VMM_NETOFFLOAD_H_
+
+#include <vmm_types.h>
+#include <net/vmm_mbuf.h>
+#include <net/vmm_netport.h>
+
+/** Max size of GSO super-frame (ethernet + VLAN + 64KB IP packet) */
+#define VMM_NETOFFLOAD_GSO_MAX_SIZE	(14 + 4 + 65535)
+
+/** Min segment size of GSO super-frame (same as Linux TCPv4 min MSS) */
+#define VMM_NETOFFLOAD_GSO_MIN_MSS	88
+
+/** Max number of segments of GSO super-frame */
+#define VMM_NETOFFLOAD_GSO_MAX_SEGS	\
+	((VMM_NETOFFLOAD_GSO_MAX_SIZE + VMM_NETOFFLOAD_GSO_MIN_MSS - 1) / \
+	 VMM_NETOFFLOAD_GSO_MIN_MSS)
+
+/** Check whether given port can't handle offloads pending on mbuf */
+static inline bool vmm_netoffload_required(struct vmm_netport *port,
+					   struct vmm_mbuf *m)
+{
+	if (!(m->m_flags & M_PKTHDR)) {
+		return FALSE;
+	}
+
+	if ((m->m_gso_type != M_GSO_NONE) &&
+	    !(port->flags & VMM_NETPORT_GSO_OFFLOAD)) {
+		return TRUE;
+	}
+
+	if ((m->m_flags & M_CSUM_PARTIAL) &&
+	    !(port->flags & VMM_NETPORT_CSUM_OFFLOAD)) {
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/** Get length of ethernet, IP, and TCP headers of a GSO mbuf
+ *  Note: Returns zero if mbuf headers don't match its GSO type.
+ */
+u32 vmm_netoffload_hdrlen(struct vmm_mbuf *m);
+
+/** Do pending offloads of given mbuf in software
+ *  Note: The given mbuf is not consumed. Each resulting mbuf (a TCP
+ *  segment or a copy with complete checksum) has no offload pending
+ *  and it is consumed by xfer() same as switch2port_xfer.
+ */
+int vmm_netoffload_emulate(struct vmm_mbuf *m,
+			   int (*xfer)(struct vmm_mbuf *, void *),
+			   void *priv);
+
+#endif /* __VMM_NETOFFLOAD_H_ */
@@ -34,6 +34,14 @@
 
 /* Port Flags (should be defined as bits) */
 #define VMM_NETPORT_LINK_UP		1	/* If this bit is set link is up */
+#define VMM_NETPORT_MULTIQUEUE		2	/* If this bit is set port
+						 * serializes switch2port_xfer
+						 * on its own (per RX queue) */
+#define VMM_NETPORT_CSUM_OFFLOAD	4	/* If this bit is set port
+						 * accepts mbufs having
+						 * M_CSUM_PARTIAL */
+#define VMM_NETPORT_GSO_OFFLOAD		8	/* If this bit is set port
+						 * accepts TCP GSO mbufs */
 
 /* Default per-port queue size */
 #define VMM_NETPORT_MAX_QUEUE_SIZE	256
@@ -50,6 +58,9 @@ struct vmm_netport_lazy {
 	atomic_t sched_count;
 	struct dlist head;
 	int budget;
+	/* Host CPU whose netswitch bottom-half runs xfer
+	 * (negative value means current host CPU) */
+	int cpu;
 	void *arg;
 	void (*xfer)(struct vmm_netport *, void *, int);
 };
@@ -60,6 +71,7 @@ do { \
 	ARCH_ATOMIC_INIT(&(__lazy)->sched_count, 0); \
 	INIT_LIST_HEAD(&(__lazy)->head); \
 	(__lazy)->budget = (__budget); \
+	(__lazy)->cpu = -1; \
 	(__lazy)->arg = (__arg); \
 	(__lazy)->xfer = (__xfer); \
 } while (0)
@@ -81,6 +93,11 @@ struct vmm_netport {
 	/* Handle RX from switch to port */
 	vmm_spinlock_t switch2port_xfer_lock;
 	int (*switch2port_xfer) (struct vmm_netport *, struct vmm_mbuf *);
+	/* Handle a burst of RX from switch to port (optional)
+	 * Note: Each mbuf is consumed same as switch2port_xfer.
+	 */
+	int (*switch2port_xfer_burst) (struct vmm_netport *,
+				       struct vmm_mbuf **, u32);
 	/* Port private data */
 	void *priv;
 };
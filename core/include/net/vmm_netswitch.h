@@ -33,6 +33,9 @@
 
 #define VMM_NETSWITCH_CLASS_NAME	"netswitch"
 
+/* Maximum number of mbufs processed together as one burst */
+#define VMM_NETSWITCH_BURST_SIZE	32
+
 struct vmm_netswitch_policy;
 struct vmm_netswitch;
 struct vmm_netport;
@@ -58,6 +61,12 @@ struct vmm_netswitch {
 	int (*port2switch_xfer) (struct vmm_netswitch *,
 				 struct vmm_netport *,
 				 struct vmm_mbuf *);
+	/* Handle a burst of RX packets from same port to switch
+	 * (optional, port2switch_xfer is used for each mbuf if absent)
+	 */
+	int (*port2switch_xfer_burst) (struct vmm_netswitch *,
+				       struct vmm_netport *,
+				       struct vmm_mbuf **, u32);
 	/* Handle enabling of a port */
 	int (*port_add) (struct vmm_netswitch *,
 			 struct vmm_netport *);
@@ -84,6 +93,13 @@ struct vmm_netswitch_policy {
 int vmm_port2switch_xfer_mbuf(struct vmm_netport *src,
 			      struct vmm_mbuf *mbuf);
 
+/** Transfer a burst of packets from port to switch
+ *  Note: All mbufs are queued for netswitch bottom-half at once
+ *  and they are consumed even when this function fails.
+ */
+int vmm_port2switch_xfer_burst(struct vmm_netport *src,
+			       struct vmm_mbuf **mbufs, u32 count);
+
 /** Lazy transfer from port to switch */
 int vmm_port2switch_xfer_lazy(struct vmm_netport_lazy *lazy);
 
@@ -92,6 +108,13 @@ int vmm_switch2port_xfer_mbuf(struct vmm_netswitch *nsw,
 			      struct vmm_netport *dst,
 			      struct vmm_mbuf *mbuf);
 
+/** Transfer a burst of packets from switch to port
+ *  Note: The destination port is locked only once for entire burst.
+ */
+int vmm_switch2port_xfer_burst(struct vmm_netswitch *nsw,
+			       struct vmm_netport *dst,
+			       struct vmm_mbuf **mbufs, u32 count);
+
 /** Allocate new network switch (used by network switch policy)
  *  @name name of the network switch
  */
@@ -177,6 +177,17 @@ int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 			     enum vmm_vdisk_request_type type,
 			     u64 lba, void *data, u32 data_len);
 
+/** Submit scatter-gather IO request to virtual disk
+ *  Note: Each segment is a host physical address range of normal
+ *  memory (such as guest RAM) so that block device can transfer
+ *  data directly without any intermediate bounce buffer.
+ */
+int vmm_vdisk_submit_sg_request(struct vmm_vdisk *vdisk,
+				struct vmm_vdisk_request *vreq,
+				enum vmm_vdisk_request_type type,
+				u64 lba, struct vmm_request_sg *sg,
+				u32 sg_count);
+
 /* Abort IO request from virtual disk */
 int vmm_vdisk_abort_request(struct vmm_vdisk *vdisk,
 			    struct vmm_vdisk_request *vreq);
@@ -57,6 +57,18 @@ struct vmm_virtio_queue {
 
 	struct vmm_vring	vring;
 
+	/* Packed ring state (only valid when packed == TRUE) */
+	bool			packed;
+	bool			avail_wrap_counter;
+	bool			used_wrap_counter;
+	bool			signalled_used_valid;
+	u16			last_used_idx;
+	u16			pop_hist_idx;
+	/* Ring position and descriptor count of each popped buffer ID
+	 * followed by ring position and wrap counter of each pop.
+	 */
+	u16			*packed_state;
+
 	struct vmm_guest	*guest;
 	u32			desc_count;
 	u32			align;
@@ -67,6 +79,19 @@ struct vmm_virtio_queue {
 	physical_size_t		total_size;
 };
 
+/** Queue layout programmed by modern (VirtIO 1.x) transport
+ *  Note: Transport fills this before calling init_vq() of emulator
+ *  and queue setup uses it instead of legacy guest PFN.
+ */
+struct vmm_virtio_queue_layout {
+	bool valid;
+	bool packed;
+	u32 num;
+	physical_addr_t desc_addr;
+	physical_addr_t driver_addr;
+	physical_addr_t device_addr;
+};
+
 struct vmm_virtio_device_id {
 	u32 type;
 };
@@ -83,6 +108,8 @@ struct vmm_virtio_device {
 	struct vmm_virtio_emulator *emu;
 	void *emu_data;
 
+	struct vmm_virtio_queue_layout layout;
+
 	struct dlist node;
 	struct vmm_guest *guest;
 };
@@ -174,11 +201,20 @@ u32 vmm_virtio_queue_max_desc(struct vmm_virtio_queue *vq);
 int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
 			      struct vmm_vring_desc *desc);
 
+/** Head returned by vmm_virtio_queue_pop() on failure */
+#define VMM_VIRTIO_QUEUE_INVALID_HEAD		0xFFFF
+
 /** Pop the index of next available descriptor
  *  Note: works only after queue setup is done
+ *  Note: returns VMM_VIRTIO_QUEUE_INVALID_HEAD on failure
  */
 u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq);
 
+/** Give back last count popped descriptors to available ring
+ *  Note: works only after queue setup is done
+ */
+void vmm_virtio_queue_unpop(struct vmm_virtio_queue *vq, u16 count);
+
 /** Check whether any descriptor is available or not
  *  Note: works only after queue setup is done
  */
@@ -200,6 +236,14 @@ void vmm_virtio_queue_set_avail_event(struct vmm_virtio_queue *vq);
 void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 				    u32 head, u32 len);
 
+/** Update multiple used elements in vring with single update of
+ *  used index (i.e. guest sees all of them at once)
+ *  Note: works only after queue setup is done
+ */
+void vmm_virtio_queue_set_used_elems(struct vmm_virtio_queue *vq,
+				     const struct vmm_vring_used_elem *elems,
+				     u32 count);
+
 /** Check whether queue setup is done by guest or not */
 bool vmm_virtio_queue_setup_done(struct vmm_virtio_queue *vq);
 
@@ -210,9 +254,11 @@ int vmm_virtio_queue_cleanup(struct vmm_virtio_queue *vq);
 
 /** Setup or initialize the queue
  *  Note: If queue was already setup then it will cleanup first.
+ *  Note: If device has valid queue layout then legacy guest PFN,
+ *  guest page size, and align are not used for locating the queue.
  */
 int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
-			   struct vmm_guest *guest,
+			   struct vmm_virtio_device *dev,
 			   physical_addr_t guest_pfn,
 			   physical_size_t guest_page_size,
 			   u32 desc_count, u32 align);
@@ -61,6 +61,18 @@
   */
 #define VMM_VIRTIO_RING_F_EVENT_IDX	29
 
+/* Packed ring: bit positions of avail and used flags in descriptor */
+#define VMM_VRING_PACKED_DESC_F_AVAIL	7
+#define VMM_VRING_PACKED_DESC_F_USED	15
+
+/* Packed ring: event suppression flags */
+#define VMM_VRING_PACKED_EVENT_FLAG_ENABLE	0x0
+#define VMM_VRING_PACKED_EVENT_FLAG_DISABLE	0x1
+#define VMM_VRING_PACKED_EVENT_FLAG_DESC	0x2
+
+/* Packed ring: bit position of wrap counter in event off_wrap */
+#define VMM_VRING_PACKED_EVENT_F_WRAP_CTR	15
+
 /* Virtio ring descriptors: 16 bytes.  These can chain together via "next". */
 struct vmm_vring_desc {
 	/* Address (guest-physical). */
@@ -93,6 +105,26 @@ struct vmm_vring_used {
 	struct vmm_vring_used_elem ring[];
 };
 
+/* Packed ring descriptors: 16 bytes.  These chain via ring position. */
+struct vmm_vring_packed_desc {
+	/* Address (guest-physical). */
+	u64 addr;
+	/* Length. */
+	u32 len;
+	/* Buffer ID. */
+	u16 id;
+	/* The flags depending on descriptor type. */
+	u16 flags;
+};
+
+/* Packed ring event suppression structure (driver and device areas) */
+struct vmm_vring_packed_desc_event {
+	/* Descriptor ring change event offset and wrap counter */
+	u16 off_wrap;
+	/* Descriptor ring change event flags */
+	u16 flags;
+};
+
 struct vmm_vring {
 	unsigned int num;
 
@@ -142,6 +142,35 @@ struct vmm_emudev {
 #endif
 };
 
+/** Doorbell is in IO address space instead of memory address space */
+#define VMM_DEVEMU_DOORBELL_IO			0x00000001
+/** Doorbell only matches when written value equals doorbell value */
+#define VMM_DEVEMU_DOORBELL_MATCH_VALUE		0x00000002
+/** Doorbell handler is called from per-guest doorbell workqueue
+ *  instead of VCPU context. Back-to-back writes are coalesced.
+ */
+#define VMM_DEVEMU_DOORBELL_DEFERRED		0x00000004
+
+/** Doorbell is an exact guest write (address, size, and optionally
+ *  value) which is handled without decoding generic emulated MMIO/IO
+ *  path. The value is compared in host CPU byte order.
+ */
+struct vmm_devemu_doorbell {
+	/* Filled by emulator before registration */
+	physical_addr_t gphys_addr;
+	u32 len;
+	u32 flags;
+	u64 value;
+	void (*handle)(struct vmm_devemu_doorbell *db, u64 value);
+	void *priv;
+	/* Private to device emulation framework */
+	struct dlist head;
+	struct vmm_guest *guest;
+	struct dlist pending_head;
+	bool pending;
+	u64 last_value;
+};
+
 struct vmm_devemu_irqchip {
 	const char *name;
 	void (*handle) (u32 irq, int cpu, int level, void *opaque);
@@ -177,6 +206,19 @@ int vmm_devemu_emulate_iowrite(struct vmm_vcpu *vcpu,
 			       void *src, u32 src_len,
 			       enum vmm_devemu_endianness src_endian);
 
+/** Register doorbell for given guest
+ *  Note: Doorbell handler must not unregister the doorbell.
+ */
+int vmm_devemu_register_doorbell(struct vmm_guest *guest,
+				 struct vmm_devemu_doorbell *db);
+
+/** Unregister doorbell
+ *  Note: This does not sleep hence it can be called from VCPU context.
+ *  Note: On return, the deferred doorbell handler is neither running
+ *  nor pending so the doorbell can be freed by caller.
+ */
+int vmm_devemu_unregister_doorbell(struct vmm_devemu_doorbell *db);
+
 /** Internal function to emulate irq (should not be called directly) */
 extern int __vmm_devemu_emulate_irq(struct vmm_guest *guest,
 				    u32 irq, int cpu, int level);
@@ -103,6 +103,11 @@
 #define VMM_DEVTREE_DEADLINE_ATTR_NAME		"deadline"
 #define VMM_DEVTREE_PERIODICITY_ATTR_NAME	"periodicity"
 #define VMM_DEVTREE_ADDRSPACE_NODE_NAME		"aspace"
+#define VMM_DEVTREE_STAGE2_MAP_ATTR_NAME	"stage2_map"
+#define VMM_DEVTREE_STAGE2_MAP_VAL_FAULT	"fault"
+#define VMM_DEVTREE_STAGE2_MAP_VAL_FAULT_AROUND	"fault_around"
+#define VMM_DEVTREE_STAGE2_MAP_VAL_PREFAULT	"prefault"
+#define VMM_DEVTREE_STAGE2_FAULT_AROUND_ATTR_NAME "stage2_fault_around"
 #define VMM_DEVTREE_GUESTIRQCNT_ATTR_NAME	"guest_irq_count"
 #define VMM_DEVTREE_MANIFEST_TYPE_ATTR_NAME	"manifest_type"
 #define VMM_DEVTREE_MANIFEST_TYPE_VAL_REAL	"real"
@@ -120,6 +125,7 @@
 #define VMM_DEVTREE_NUM_COLORS_ATTR_NAME	"num_colors"
 #define VMM_DEVTREE_SHARED_MEM_ATTR_NAME	"shared_mem"
 #define VMM_DEVTREE_MAP_ORDER_ATTR_NAME		"map_order"
+#define VMM_DEVTREE_ONDEMAND_ATTR_NAME		"ondemand"
 #define VMM_DEVTREE_SWITCH_ATTR_NAME		"switch"
 #define VMM_DEVTREE_DOMAIN_ATTR_NAME		"domain"
 #define VMM_DEVTREE_NODE_ADDR_ATTR_NAME		"node_addr"
@@ -33,6 +33,21 @@
 /* Notifier event when guest aspace is reset */
 #define VMM_GUEST_ASPACE_EVENT_RESET		0x03
 
+/** Default number of blocks mapped around a stage2 translation fault */
+#define VMM_GUEST_STAGE2_FAULT_AROUND_DEFAULT	16
+/** Maximum number of blocks mapped around a stage2 translation fault */
+#define VMM_GUEST_STAGE2_FAULT_AROUND_MAX	512
+
+/** Stage2 (or nested) translation statistics of a guest */
+struct vmm_guest_stage2_stats {
+	/* Stage2 translation faults handled */
+	u64 fault_count;
+	/* Stage2 mappings created by translation faults */
+	u64 fault_map_count;
+	/* Stage2 mappings created in advance for RAM regions */
+	u64 prefault_map_count;
+};
+
 /** Representation of block device notifier event */
 struct vmm_guest_aspace_event {
 	struct vmm_guest *guest;
@@ -147,6 +162,41 @@ int vmm_guest_del_region(struct vmm_guest *guest,
 			 struct vmm_region *reg,
 			 bool del_node);
 
+/** Get stage2 map policy of a guest */
+static inline u32 vmm_guest_stage2_map_policy(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.stage2_map_policy :
+			 VMM_GUEST_STAGE2_MAP_FAULT;
+}
+
+/** Get number of blocks to be mapped around a stage2 translation fault */
+static inline u32 vmm_guest_stage2_fault_around(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.stage2_fault_around : 1;
+}
+
+/** Account stage2 translation fault and mappings created for it
+ *  Note: This is called by architecture specific code.
+ */
+void vmm_guest_stage2_fault_account(struct vmm_guest *guest, u32 map_count);
+
+/** Account stage2 mappings created in advance
+ *  Note: This is called by architecture specific code.
+ */
+void vmm_guest_stage2_prefault_account(struct vmm_guest *guest,
+				       u32 map_count);
+
+/** Get stage2 translation statistics of a guest */
+int vmm_guest_stage2_stats(struct vmm_guest *guest,
+			   struct vmm_guest_stage2_stats *stats);
+
+/** Get host RAM used by on-demand guest RAM of a guest (or all guests
+ *  when guest is NULL) along with hard cap on such host RAM.
+ */
+int vmm_guest_ondemand_ram_usage(struct vmm_guest *guest,
+				 physical_size_t *used,
+				 physical_size_t *limit);
+
 /** Reset guest address space */
 int vmm_guest_aspace_reset(struct vmm_guest *guest);
 
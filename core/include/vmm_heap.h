@@ -30,6 +30,20 @@
 
 struct vmm_chardev;
 
+/** Statistics of per-CPU magazine cache of a heap */
+struct vmm_heap_cache_stats {
+	/* Allocations served from (or missing) per-CPU magazine */
+	u64 alloc_hit;
+	u64 alloc_miss;
+	/* Frees absorbed by (or overflowing) per-CPU magazine */
+	u64 free_hit;
+	u64 free_miss;
+	/* Free space held in magazines and depots */
+	virtual_size_t cached_size;
+	/* Pages currently used as slab pages */
+	u32 slab_pages;
+};
+
 /** Allocate Normal memory */
 void *vmm_malloc(virtual_size_t size);
 
@@ -72,6 +86,9 @@ virtual_size_t vmm_normal_heap_hksize(void);
 /** Size of Normal heap free space */
 virtual_size_t vmm_normal_heap_free_size(void);
 
+/** Get Normal heap magazine cache statistics */
+void vmm_normal_heap_cache_stats(struct vmm_heap_cache_stats *stats);
+
 /** Print Normal heap state */
 int vmm_normal_heap_print_state(struct vmm_chardev *cdev);
 
@@ -138,6 +155,9 @@ virtual_size_t vmm_dma_heap_hksize(void);
 /** Size of DMA heap free space */
 virtual_size_t vmm_dma_heap_free_size(void);
 
+/** Get DMA heap magazine cache statistics */
+void vmm_dma_heap_cache_stats(struct vmm_heap_cache_stats *stats);
+
 /** Print DMA heap state */
 int vmm_dma_heap_print_state(struct vmm_chardev *cdev);
 
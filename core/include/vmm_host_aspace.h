@@ -127,6 +127,18 @@ virtual_addr_t vmm_host_memmap(physical_addr_t pa,
 /** Unmap virtual memory */
 int vmm_host_memunmap(virtual_addr_t va);
 
+/** Persistently map host RAM as normal cacheable memory
+ *  Note: Unlike vmm_host_memmap(), this returns zero (instead of
+ *  panicking) when the mapping cannot be created so that callers
+ *  can fall back to vmm_host_memory_read()/vmm_host_memory_write().
+ *  Note: Hugepages are used when both pa and sz are hugepage aligned.
+ */
+virtual_addr_t vmm_host_memmap_linear(physical_addr_t pa,
+				      virtual_size_t sz);
+
+/** Unmap virtual memory created by vmm_host_memmap_linear() */
+int vmm_host_memunmap_linear(virtual_addr_t va, virtual_size_t sz);
+
 /** Map IO physical memory to a virtual memory */
 static inline virtual_addr_t vmm_host_iomap(physical_addr_t pa, 
 					    virtual_size_t sz)
@@ -37,6 +37,7 @@ struct vmm_loadbal_algo {
 	char name[VMM_FIELD_NAME_SIZE];
 	int  (*start) (struct vmm_loadbal_algo *);
 	void (*balance) (struct vmm_loadbal_algo *);
+	bool (*idle) (struct vmm_loadbal_algo *, u32 hcpu);
 	void (*stop) (struct vmm_loadbal_algo *);
 	void *priv;
 };
@@ -59,6 +60,13 @@ static inline void *vmm_loadbal_get_algo_priv(struct vmm_loadbal_algo *lbalgo)
  */
 struct vmm_loadbal_algo *vmm_loadbal_current_algo(void);
 
+/** Let current load balancing algo pull work for this host CPU
+ *  Note: This function is called by IDLE VCPU before waiting for
+ *  interrupts hence the algo idle() callback must not sleep.
+ *  Note: Returns TRUE if new work was made available on this host CPU.
+ */
+bool vmm_loadbal_idle(void);
+
 /** Register load balancing algo instance
  *  Note: This function must be called from Orphan (or Thread) Context
  */
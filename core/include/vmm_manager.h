@@ -52,6 +52,7 @@ enum vmm_region_flags {
 	VMM_REGION_ISCOLORED=0x00002000,
 	VMM_REGION_ISSHARED=0x00004000,
 	VMM_REGION_ISDYNAMIC=0x00008000,
+	VMM_REGION_ISONDEMAND=0x00010000,
 };
 
 #define VMM_REGION_MANIFEST_MASK	(VMM_REGION_REAL | \
@@ -60,6 +61,7 @@ enum vmm_region_flags {
 
 enum vmm_region_mapping_flags {
 	VMM_REGION_MAPPING_ISHOSTRAM=0x00000001,
+	VMM_REGION_MAPPING_ISLINEAR=0x00000002,
 };
 
 struct vmm_region;
@@ -71,6 +73,7 @@ struct vmm_guest;
 
 struct vmm_region_mapping {
 	physical_addr_t hphys_addr;
+	virtual_addr_t hvirt_addr;
 	u32 flags;
 };
 
@@ -90,6 +93,15 @@ struct vmm_region {
 	u32 map_order;
 	u32 maps_count;
 	struct vmm_region_mapping *maps;
+	/* Bitmap of populated mappings of on-demand region */
+	vmm_spinlock_t ondemand_lock;
+	unsigned long *ondemand_bmap;
+	/* Final non-alias region covering entire alias region (or NULL)
+	 * and AND of flags of all regions on the alias chain.
+	 * Note: Updated whenever region tree changes.
+	 */
+	struct vmm_region *alias_reg;
+	u32 alias_flags;
 	void *devemu_priv;
 	void *priv;
 };
@@ -105,10 +117,25 @@ struct vmm_region {
 #define VMM_REGION_MAP_ORDER(reg)	((reg)->map_order)
 #define VMM_REGION_MAPS_COUNT(reg)	((reg)->maps_count)
 
+enum vmm_guest_stage2_map_policy {
+	/* Map one block per stage2 translation fault */
+	VMM_GUEST_STAGE2_MAP_FAULT=0,
+	/* Also map neighbouring RAM blocks on stage2 translation fault */
+	VMM_GUEST_STAGE2_MAP_FAULT_AROUND=1,
+	/* Map all RAM regions when they are added */
+	VMM_GUEST_STAGE2_MAP_PREFAULT=2,
+};
+
 struct vmm_guest_aspace {
 	struct vmm_devtree_node *node;
 	struct vmm_guest *guest;
 	bool initialized;
+	u32 stage2_map_policy;
+	u32 stage2_fault_around;
+	atomic64_t stage2_fault_count;
+	atomic64_t stage2_fault_map_count;
+	atomic64_t stage2_prefault_map_count;
+	physical_size_t ondemand_size;
 	vmm_rwlock_t reg_iotree_lock;
 	struct rb_root reg_iotree;
 	struct dlist reg_ioprobe_list;
@@ -127,11 +154,18 @@ struct vmm_guest_request {
 struct vmm_vcpu_irq {
 	atomic_t assert;
 	u64 reason;
+	u32 prio_level;
 };
 
 struct vmm_vcpu_irqs {
 	u32 irq_count;
 	struct vmm_vcpu_irq *irq;
+	/* Bitmaps of asserted irqs (one per priority level with
+	 * highest priority level first)
+	 */
+	u32 prio_levels;
+	u32 pending_longs;
+	unsigned long *pending;
 	atomic_t execute_pending;
 	atomic64_t assert_count;
 	atomic64_t execute_count;
@@ -236,6 +270,12 @@ struct vmm_vcpu {
 	u32 preempt_count;
 	bool resumed;
 	void *sched_priv;
+#ifdef CONFIG_SCHEDULER_STATS
+	u64 sched_ready_tstamp;
+	u64 sched_latency_count;
+	u64 sched_latency_nsecs;
+	u64 sched_latency_max_nsecs;
+#endif
 
 	/* Scheduler static context */
 	u8 priority;
@@ -57,4 +57,13 @@ int vmm_schedalgo_rq_destroy(void *rq);
 /** return the number of READY VCPU at given priority */
 int vmm_schedalgo_rq_length(void *rq, u8 priority);
 
+/** Iterate over VCPUs of a ready queue in dequeue order
+ *  Note: Iteration stops when iter() returns non-zero value which
+ *  is returned to the caller.
+ *  Note: iter() must not enqueue, dequeue, or detach VCPUs.
+ */
+int vmm_schedalgo_rq_iterate(void *rq,
+			     int (*iter)(struct vmm_vcpu *vcpu, void *priv),
+			     void *priv);
+
 #endif
@@ -91,6 +91,77 @@ u64 vmm_scheduler_irq_time(u32 hcpu);
 /** Last sampled idle time in nanosecs for given host CPU */
 u64 vmm_scheduler_idle_time(u32 hcpu);
 
+/** Migration statistics of a host CPU */
+struct vmm_scheduler_migrate_stats {
+	/* READY VCPUs migrated to this host CPU */
+	u64 in_count;
+	/* READY VCPUs migrated away from this host CPU */
+	u64 out_count;
+	/* READY VCPUs pulled by this host CPU (subset of in_count) */
+	u64 pull_count;
+};
+
+/** Retrive migration statistics of given host CPU */
+int vmm_scheduler_migrate_stats(u32 hcpu,
+				struct vmm_scheduler_migrate_stats *stats);
+
+#define VMM_SCHEDULER_HIST_BUCKETS	32
+
+/** Run-queue statistics of a host CPU
+ *  Note: All histograms are log2 histograms where bucket zero counts
+ *  zero samples and bucket N counts samples in range [2^(N-1), 2^N).
+ *  The last bucket also counts all larger samples.
+ */
+struct vmm_scheduler_rq_stats {
+	/* Nanoseconds since statistics were reset */
+	u64 since_nsecs;
+	/* Scheduling decisions (including same VCPU chosen again) */
+	u64 switch_count;
+	/* READY to RUNNING latency (nanosecs) for each VCPU priority */
+	u64 latency_count[VMM_VCPU_MAX_PRIORITY + 1];
+	u64 latency_total_nsecs[VMM_VCPU_MAX_PRIORITY + 1];
+	u64 latency_max_nsecs[VMM_VCPU_MAX_PRIORITY + 1];
+	u32 latency_hist[VMM_VCPU_MAX_PRIORITY + 1]
+			[VMM_SCHEDULER_HIST_BUCKETS];
+	/* READY VCPUs in ready queue sampled at each scheduling decision */
+	u64 rq_len_total;
+	u32 rq_len_max;
+	u32 rq_len_hist[VMM_SCHEDULER_HIST_BUCKETS];
+	/* Host IRQ processing time (nanosecs) between scheduling decisions */
+	u64 irq_total_nsecs;
+	u64 irq_max_nsecs;
+	u32 irq_hist[VMM_SCHEDULER_HIST_BUCKETS];
+};
+
+/** Retrive run-queue statistics of given host CPU
+ *  Note: Returns VMM_ENOTAVAIL when CONFIG_SCHEDULER_STATS is disabled.
+ */
+int vmm_scheduler_rq_stats(u32 hcpu, struct vmm_scheduler_rq_stats *stats);
+
+/** Reset run-queue statistics of given host CPU */
+int vmm_scheduler_rq_stats_reset(u32 hcpu);
+
+/** Retrive READY to RUNNING latency statistics of given VCPU
+ *  Note: Returns VMM_ENOTAVAIL when CONFIG_SCHEDULER_STATS is disabled.
+ */
+int vmm_scheduler_latency_stats(struct vmm_vcpu *vcpu, u64 *count,
+				u64 *total_nsecs, u64 *max_nsecs);
+
+/** Reset READY to RUNNING latency statistics of given VCPU */
+int vmm_scheduler_latency_stats_reset(struct vmm_vcpu *vcpu);
+
+/** Pull a READY VCPU from ready queue of given host CPU to ready
+ *  queue of current host CPU without any IPI
+ *  Note: VCPUs are tried in dequeue order and only VCPUs having current
+ *  host CPU in affinity and accepted by filter() (if any) are pulled.
+ *  Note: filter() is called with source ready queue locked hence it
+ *  must not sleep or call other scheduler APIs.
+ *  Note: Caller is responsible for re-scheduling current host CPU.
+ */
+struct vmm_vcpu *vmm_scheduler_pull_vcpu(u32 src_hcpu,
+				bool (*filter)(struct vmm_vcpu *, void *),
+				void *priv);
+
 /** Retrive idle vcpu for given host CPU */
 struct vmm_vcpu *vmm_scheduler_idle_vcpu(u32 hcpu);
 
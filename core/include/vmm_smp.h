@@ -130,6 +130,33 @@ int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
 			   void *arg0, void *arg1, void *arg2);
 #endif
 
+/** Inter-processor interrupt statistics of a host CPU */
+struct vmm_smp_ipi_stats {
+	/* Sync calls submitted to the host CPU */
+	u64 sync_count;
+	/* Async calls submitted to the host CPU */
+	u64 async_count;
+	/* IPIs actually triggered (multiple calls can share one IPI) */
+	u64 trigger_count;
+	/* Submit attempts which found IPI queue full */
+	u64 full_count;
+	/* Calls currently queued */
+	u32 sync_pending;
+	u32 async_pending;
+};
+
+/** Get inter-processor interrupt statistics of given host CPU
+ *  Note: This is only available for SMP systems.
+ */
+#if !defined(CONFIG_SMP)
+static inline int vmm_smp_ipi_stats(u32 cpu, struct vmm_smp_ipi_stats *stats)
+{
+	return VMM_ENOTAVAIL;
+}
+#else
+int vmm_smp_ipi_stats(u32 cpu, struct vmm_smp_ipi_stats *stats);
+#endif
+
 /** Initialize SMP synchronus inter-processor interrupts
  *  Note: This has to be done only for SMP systems.
  */
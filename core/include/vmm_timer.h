@@ -40,6 +40,12 @@ struct vmm_timer_event {
 	bool active_state;
 	struct dlist active_head;
 	u32 active_hcpu;
+#ifdef CONFIG_TIMER_EVENT_HEAP
+	/* Pairing heap links (prev is parent for first child) */
+	struct vmm_timer_event *heap_child;
+	struct vmm_timer_event *heap_next;
+	struct vmm_timer_event *heap_prev;
+#endif
 };
 
 #define INIT_TIMER_EVENT(ev, _hndl, _priv)	\
@@ -22,3 +22,4 @@
 # */
 
 core-objs-$(CONFIG_LOADBAL_CRUDE) += loadbal/vmm_loadbal_crude.o
+core-objs-$(CONFIG_LOADBAL_STEAL) += loadbal/vmm_loadbal_steal.o
@@ -0,0 +1,344 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_loadbal_steal.c
+ * @author agent (agent@local)
+ * @brief source file for work-stealing load balancing algo
+ *
+ * This load balancer is driven by idle host CPUs. Whenever a host CPU
+ * is about to go idle, it pulls a READY VCPU directly from ready queue
+ * of the busiest host CPU in its own cluster (as described by devtree
+ * "/cpus/cpu-map") and only looks at other clusters when they have
+ * a real backlog. Pulling does not require any IPI and VCPUs which
+ * were migrated recently are left alone to avoid ping-pong.
+ *
+ * The periodic balance only kicks idle host CPUs which are sleeping
+ * while some other host CPU has a backlog of READY VCPUs.
+ */
+
+#include <vmm_error.h>
+#include <vmm_limits.h>
+#include <vmm_heap.h>
+#include <vmm_timer.h>
+#include <vmm_stdio.h>
+#include <vmm_devtree.h>
+#include <vmm_manager.h>
+#include <vmm_scheduler.h>
+#include <vmm_modules.h>
+#include <vmm_loadbal.h>
+#include <libs/stringlib.h>
+
+#undef DEBUG
+
+#ifdef DEBUG
+#define DPRINTF(msg...)			vmm_printf(msg)
+#else
+#define DPRINTF(msg...)
+#endif
+
+#define MODULE_DESC			"Work-stealing Load Balancer"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		0
+#define	MODULE_INIT			steal_init
+#define	MODULE_EXIT			steal_exit
+
+/* Minimum gap between two pull attempts of an idle host CPU */
+#define STEAL_IDLE_INTERVAL_NSECS	1000000ULL
+
+/* Recently migrated VCPU is not migrated again for this long */
+#define STEAL_VCPU_HOLD_NSECS		(4 * VMM_VCPU_DEF_TIME_SLICE)
+
+/* READY VCPUs required on a host CPU of another cluster for pulling */
+#define STEAL_REMOTE_CLUSTER_READY	2
+
+struct steal_control {
+	u32 cluster[CONFIG_CPU_COUNT];
+	u64 idle_tstamp[CONFIG_CPU_COUNT];
+	u64 vcpu_tstamp[CONFIG_MAX_VCPU_COUNT];
+};
+
+static u32 steal_ready_count(u32 hcpu)
+{
+	u32 p, count = 0;
+	struct vmm_vcpu *idle = vmm_scheduler_idle_vcpu(hcpu);
+
+	for (p = VMM_VCPU_MIN_PRIORITY; p <= VMM_VCPU_MAX_PRIORITY; p++) {
+		count += vmm_scheduler_ready_count(hcpu, p);
+	}
+
+	/* IDLE VCPU waiting in ready queue is not a backlog */
+	if (count && idle &&
+	    (vmm_manager_vcpu_get_state(idle) == VMM_VCPU_STATE_READY)) {
+		count--;
+	}
+
+	return count;
+}
+
+/**
+ * Find out busiest hcpu to pull from.
+ *
+ * Host CPUs of same cluster are preferred because migrating VCPU
+ * within a cluster keeps its working set in shared cache.
+ */
+static bool steal_busiest_hcpu(struct steal_control *st,
+			       u32 hcpu, u32 *busiest)
+{
+	u32 c, count, local_count = 0, remote_count = 0;
+	u32 local = hcpu, remote = hcpu;
+
+	for_each_online_cpu(c) {
+		if (c == hcpu) {
+			continue;
+		}
+		count = steal_ready_count(c);
+		if (st->cluster[c] == st->cluster[hcpu]) {
+			if (count > local_count) {
+				local = c;
+				local_count = count;
+			}
+		} else {
+			if (count > remote_count) {
+				remote = c;
+				remote_count = count;
+			}
+		}
+	}
+
+	if (local_count) {
+		*busiest = local;
+		return TRUE;
+	}
+	if (remote_count >= STEAL_REMOTE_CLUSTER_READY) {
+		*busiest = remote;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static bool steal_vcpu_filter(struct vmm_vcpu *vcpu, void *priv)
+{
+	struct steal_control *st = priv;
+	u64 tstamp = st->vcpu_tstamp[vcpu->id];
+
+	/* Don't bounce VCPUs which were migrated recently */
+	if (tstamp &&
+	    (vmm_timer_timestamp() - tstamp) < STEAL_VCPU_HOLD_NSECS) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static bool steal_idle(struct vmm_loadbal_algo *algo, u32 hcpu)
+{
+	u64 tstamp;
+	u32 busiest;
+	struct vmm_vcpu *vcpu;
+	struct steal_control *st = vmm_loadbal_get_algo_priv(algo);
+
+	if (!st) {
+		return FALSE;
+	}
+
+	tstamp = vmm_timer_timestamp();
+	if ((tstamp - st->idle_tstamp[hcpu]) < STEAL_IDLE_INTERVAL_NSECS) {
+		return FALSE;
+	}
+	st->idle_tstamp[hcpu] = tstamp;
+
+	if (!steal_busiest_hcpu(st, hcpu, &busiest)) {
+		return FALSE;
+	}
+
+	vcpu = vmm_scheduler_pull_vcpu(busiest, steal_vcpu_filter, st);
+	if (!vcpu) {
+		return FALSE;
+	}
+	st->vcpu_tstamp[vcpu->id] = vmm_timer_timestamp();
+
+	DPRINTF("%s: vcpu=%s old_hcpu=%d new_hcpu=%d\n",
+		__func__, vcpu->name, busiest, hcpu);
+
+	return TRUE;
+}
+
+static void steal_balance(struct vmm_loadbal_algo *algo)
+{
+	u32 hcpu, busiest;
+	struct vmm_vcpu *idle;
+	struct steal_control *st = vmm_loadbal_get_algo_priv(algo);
+
+	if (!st) {
+		return;
+	}
+
+	/* Wakeup sleeping idle hcpus which have something to pull */
+	for_each_online_cpu(hcpu) {
+		idle = vmm_scheduler_idle_vcpu(hcpu);
+		if (!idle ||
+		    (vmm_manager_vcpu_get_state(idle) !=
+					VMM_VCPU_STATE_RUNNING)) {
+			continue;
+		}
+		if (!steal_busiest_hcpu(st, hcpu, &busiest)) {
+			continue;
+		}
+		DPRINTF("%s: kick hcpu=%d busiest=%d\n",
+			__func__, hcpu, busiest);
+		vmm_scheduler_force_resched(hcpu);
+	}
+}
+
+static int steal_hwid2hcpu(struct vmm_devtree_node *cpu_node, u32 *hcpu)
+{
+	int rc;
+	u32 c;
+	unsigned long hwid;
+	physical_addr_t reg;
+
+	rc = vmm_devtree_read_physaddr(cpu_node,
+				       VMM_DEVTREE_REG_ATTR_NAME, &reg);
+	if (rc) {
+		return rc;
+	}
+
+	for_each_possible_cpu(c) {
+		if (vmm_smp_map_hwid(c, &hwid)) {
+			continue;
+		}
+		if (hwid == (unsigned long)reg) {
+			*hcpu = c;
+			return VMM_OK;
+		}
+	}
+
+	return VMM_ENOTAVAIL;
+}
+
+static void steal_parse_core(struct steal_control *st,
+			     struct vmm_devtree_node *node, u32 cluster)
+{
+	u32 hcpu;
+	struct vmm_devtree_node *child, *cpu_node;
+
+	cpu_node = vmm_devtree_parse_phandle(node, "cpu", 0);
+	if (cpu_node) {
+		if (!steal_hwid2hcpu(cpu_node, &hcpu)) {
+			st->cluster[hcpu] = cluster;
+		}
+		vmm_devtree_dref_node(cpu_node);
+		return;
+	}
+
+	/* Core node having thread nodes */
+	vmm_devtree_for_each_child(child, node) {
+		steal_parse_core(st, child, cluster);
+	}
+}
+
+static void steal_parse_cluster(struct steal_control *st,
+				struct vmm_devtree_node *node,
+				u32 *next_cluster)
+{
+	u32 cluster = (*next_cluster)++;
+	struct vmm_devtree_node *child;
+
+	vmm_devtree_for_each_child(child, node) {
+		if (!strncmp(child->name, "cluster", 7)) {
+			steal_parse_cluster(st, child, next_cluster);
+		} else {
+			steal_parse_core(st, child, cluster);
+		}
+	}
+}
+
+/* All host CPUs are in cluster zero when cpu-map is not available */
+static void steal_parse_cpu_map(struct steal_control *st)
+{
+	u32 next_cluster = 0;
+	struct vmm_devtree_node *node;
+
+	node = vmm_devtree_getnode(VMM_DEVTREE_PATH_SEPARATOR_STRING
+				   VMM_DEVTREE_CPUS_NODE_NAME
+				   VMM_DEVTREE_PATH_SEPARATOR_STRING
+				   "cpu-map");
+	if (!node) {
+		return;
+	}
+
+	steal_parse_cluster(st, node, &next_cluster);
+
+	vmm_devtree_dref_node(node);
+}
+
+static int steal_start(struct vmm_loadbal_algo *algo)
+{
+	struct steal_control *st;
+
+	st = vmm_zalloc(sizeof(*st));
+	if (!st) {
+		return VMM_ENOMEM;
+	}
+
+	steal_parse_cpu_map(st);
+
+	vmm_loadbal_set_algo_priv(algo, st);
+
+	return VMM_OK;
+}
+
+static void steal_stop(struct vmm_loadbal_algo *algo)
+{
+	struct steal_control *st = vmm_loadbal_get_algo_priv(algo);
+
+	if (!st) {
+		return;
+	}
+
+	vmm_loadbal_set_algo_priv(algo, NULL);
+	vmm_free(st);
+}
+
+static struct vmm_loadbal_algo steal = {
+	.name = "Work-stealing Load Balancer",
+	.rating = 2,
+	.balance = steal_balance,
+	.idle = steal_idle,
+	.start = steal_start,
+	.stop = steal_stop,
+};
+
+static int __init steal_init(void)
+{
+	return vmm_loadbal_register_algo(&steal);
+}
+
+static void __exit steal_exit(void)
+{
+	vmm_loadbal_unregister_algo(&steal);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
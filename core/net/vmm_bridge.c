@@ -25,11 +25,16 @@
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
 #include <vmm_timer.h>
+#include <vmm_spinlocks.h>
+#include <vmm_modules.h>
+#include <arch_barrier.h>
 #include <net/vmm_protocol.h>
 #include <net/vmm_mbuf.h>
 #include <net/vmm_netswitch.h>
 #include <net/vmm_netport.h>
+#include <net/vmm_bridge.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 
 #undef DEBUG_BRIDGE
 
@@ -40,145 +45,264 @@
 #define DPRINTF(fmt, ...) do {} while(0)
 #endif
 
-#define BRIDGE_MAC_TABLE_SZ	32
-#define BRIDGE_MAC_EXPIRY	30000000000LLU
+#define BRIDGE_FDB_HASH_SHIFT	8
+#define BRIDGE_FDB_HASH_SIZE	(1 << BRIDGE_FDB_HASH_SHIFT)
+#define BRIDGE_FDB_HASH_MASK	(BRIDGE_FDB_HASH_SIZE - 1)
+#define BRIDGE_FDB_WAYS		4
+#define BRIDGE_FDB_REFRESH_NSECS	1000000000ULL
+#define BRIDGE_FDB_MIN_SCAN_NSECS	1000000000ULL
 
-/* We maintain a table of learned mac addresses
+/* We maintain a forwarding database of learned mac addresses
  * (please note that the mac of the immediate netports are not
- * kept in this table) */
-struct bridge_mac_entry {
+ * kept in this database).
+ *
+ * The database is a fixed size hash table where each bucket has
+ * BRIDGE_FDB_WAYS enteries and a sequence counter. Updates are
+ * serialized using fdb_lock and make the bucket sequence counter
+ * odd while in-progress. Lookups don't take any lock, they simply
+ * retry if the bucket sequence counter changed under them. The
+ * enteries are never freed so lockless readers are always safe.
+ */
+struct bridge_fdb_entry {
 	struct vmm_netport *port;
 	u8 macaddr[6];
+	bool is_static;
 	u64 timestamp;
 };
 
+struct bridge_fdb_bucket {
+	u32 seq;
+	struct bridge_fdb_entry ent[BRIDGE_FDB_WAYS];
+};
+
 struct bridge_ctrl {
 	struct vmm_netswitch *nsw;
 	struct vmm_timer_event ev;
-	vmm_rwlock_t mac_table_lock;
-	u32 mac_table_sz;
-	struct bridge_mac_entry *mac_table;
+	vmm_spinlock_t fdb_lock;
+	u64 ageing_nsecs;
+	struct bridge_fdb_bucket *fdb;
 };
 
-static void bridge_mactable_cleanup_port(struct bridge_ctrl *br,
-					 struct vmm_netport *port)
+static struct vmm_netswitch_policy bridge;
+
+static inline struct bridge_fdb_bucket *bridge_fdb_bucket(
+					struct bridge_ctrl *br,
+					const u8 *mac)
 {
-	u32 m;
-	irq_flags_t f;
+	u32 h;
 
-	vmm_write_lock_irqsave_lite(&br->mac_table_lock, f);
-	for (m = 0; m < br->mac_table_sz; m++) {
-		if (br->mac_table[m].port == port) {
-			br->mac_table[m].port = NULL;
-		}
-	}
-	vmm_write_unlock_irqrestore_lite(&br->mac_table_lock, f);
+	h = ((u32)mac[2] << 24) | ((u32)mac[3] << 16) |
+	    ((u32)mac[4] << 8) | (u32)mac[5];
+	h ^= ((u32)mac[0] << 8) | (u32)mac[1];
+	h *= 0x9e3779b1;
+
+	return &br->fdb[h >> (32 - BRIDGE_FDB_HASH_SHIFT)];
 }
 
-static struct vmm_netport *bridge_mactable_learn_find(struct bridge_ctrl *br,
-						      const u8 *dstmac,
-						      const u8 *srcmac,
-						      struct vmm_netport *src)
+static inline u32 bridge_fdb_read_begin(struct bridge_fdb_bucket *b)
 {
-	u32 i;
-	u64 tstamp;
-	irq_flags_t f;
-	bool learn, update, found;
-	struct vmm_netport *dst;
-	struct bridge_mac_entry *m;
+	u32 seq;
 
-	/* Acquire read lock */
-	vmm_read_lock_irqsave_lite(&br->mac_table_lock, f);
+	do {
+		seq = *((volatile u32 *)&b->seq);
+	} while (seq & 1);
+	arch_smp_rmb();
 
-	/* Check for for dstmac and whether we need
-	 * to Learn (srcmac, src) mapping ??
+	return seq;
+}
+
+static inline bool bridge_fdb_read_retry(struct bridge_fdb_bucket *b,
+					 u32 seq)
+{
+	arch_smp_rmb();
+	return *((volatile u32 *)&b->seq) != seq;
+}
+
+static inline void bridge_fdb_write_begin(struct bridge_fdb_bucket *b)
+{
+	b->seq++;
+	arch_smp_wmb();
+}
+
+static inline void bridge_fdb_write_end(struct bridge_fdb_bucket *b)
+{
+	arch_smp_wmb();
+	b->seq++;
+}
+
+static inline bool bridge_fdb_match(struct bridge_fdb_entry *e,
+				    const u8 *mac)
+{
+	return e->port && !compare_ether_addr(e->macaddr, mac);
+}
+
+static void bridge_fdb_clear(struct bridge_fdb_entry *e)
+{
+	e->port = NULL;
+	memset(e->macaddr, 0, 6);
+	e->is_static = FALSE;
+	e->timestamp = 0;
+}
+
+/* Note: Must be called with fdb_lock held */
+static int bridge_fdb_insert(struct bridge_ctrl *br,
+			     struct vmm_netport *port,
+			     const u8 *mac, bool is_static, u64 tstamp)
+{
+	u32 i;
+	struct bridge_fdb_entry *e, *victim = NULL;
+	struct bridge_fdb_bucket *b = bridge_fdb_bucket(br, mac);
+
+	/* If mac entry already exist then update it in-place.
+	 * Learning never overrides a static entry.
 	 */
-	learn = TRUE;
-	dst = NULL;
-	for (i = 0; i < br->mac_table_sz; i++) {
-		m = &br->mac_table[i];
-		/* If mac table entry is unused then continue */
-		if (!m->port) {
+	for (i = 0; i < BRIDGE_FDB_WAYS; i++) {
+		e = &b->ent[i];
+		if (!bridge_fdb_match(e, mac)) {
 			continue;
 		}
-		/* Match (srcmac, srcport) */
-		if (learn &&
-		    !compare_ether_addr(m->macaddr, srcmac) &&
-		    (m->port == src)) {
-			learn = FALSE;
-		}
-		/* Match (dstmac) */
-		if (!dst &&
-		    !compare_ether_addr(m->macaddr, dstmac)) {
-			dst = m->port;
+		if (e->is_static && !is_static) {
+			return VMM_EEXIST;
 		}
-		/* If no need to learn and found
-		 * destination port then break
-		 */
-		if (!learn && dst) {
+		bridge_fdb_write_begin(b);
+		e->port = port;
+		e->is_static = is_static;
+		e->timestamp = tstamp;
+		bridge_fdb_write_end(b);
+		return VMM_OK;
+	}
+
+	/* Find a free entry or else the oldest learned entry */
+	for (i = 0; i < BRIDGE_FDB_WAYS; i++) {
+		e = &b->ent[i];
+		if (!e->port) {
+			victim = e;
 			break;
 		}
+		if (!e->is_static &&
+		    (!victim || (e->timestamp < victim->timestamp))) {
+			victim = e;
+		}
+	}
+	if (!victim) {
+		return VMM_ENOSPC;
 	}
 
-	/* Release read lock */
-	vmm_read_unlock_irqrestore_lite(&br->mac_table_lock, f);
-
-	/* If leaning required then update mac table */
-	if (learn) {
-		/* Retrive current timestamp */
-		tstamp = vmm_timer_timestamp();
+	bridge_fdb_write_begin(b);
+	victim->port = port;
+	memcpy(victim->macaddr, mac, 6);
+	victim->is_static = is_static;
+	victim->timestamp = tstamp;
+	bridge_fdb_write_end(b);
 
-		/* Acquire write lock */
-		vmm_write_lock_irqsave_lite(&br->mac_table_lock, f);
+	return VMM_OK;
+}
 
-		/* If mac entry already exist then
-		 * update only port and timestamp
-		 */
-		update = TRUE;
-		for (i = 0; i < br->mac_table_sz; i++) {
-			m = &br->mac_table[i];
-			if (!compare_ether_addr(m->macaddr, srcmac)) {
-				m->port = src;
-				m->timestamp = tstamp;
-				update = FALSE;
-				break;
+static void bridge_fdb_cleanup_port(struct bridge_ctrl *br,
+				    struct vmm_netport *port)
+{
+	u32 i, w;
+	irq_flags_t f;
+	struct bridge_fdb_bucket *b;
+
+	for (i = 0; i < BRIDGE_FDB_HASH_SIZE; i++) {
+		b = &br->fdb[i];
+		vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+		for (w = 0; w < BRIDGE_FDB_WAYS; w++) {
+			if (b->ent[w].port == port) {
+				bridge_fdb_write_begin(b);
+				bridge_fdb_clear(&b->ent[w]);
+				bridge_fdb_write_end(b);
 			}
 		}
+		vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
+	}
+}
 
-		/* If mac entry does not exist then
-		 * save (mac, port, timestamp) in a
-		 * free mac table entry.
-		 */
-		if (update) {
-			found = FALSE;
-			for (i = 0; i < br->mac_table_sz; i++) {
-				m = &br->mac_table[i];
-				if (m->port == NULL) {
-					found = TRUE;
+static struct vmm_netport *bridge_fdb_learn_find(struct bridge_ctrl *br,
+						 const u8 *dstmac,
+						 const u8 *srcmac,
+						 struct vmm_netport *src)
+{
+	u32 i, seq;
+	u64 tstamp;
+	irq_flags_t f;
+	bool learn;
+	struct vmm_netport *dst = NULL;
+	struct bridge_fdb_entry *e;
+	struct bridge_fdb_bucket *b;
+
+	/* Lockless lookup of destination port */
+	if (is_unicast_ether_addr(dstmac)) {
+		b = bridge_fdb_bucket(br, dstmac);
+		do {
+			seq = bridge_fdb_read_begin(b);
+			dst = NULL;
+			for (i = 0; i < BRIDGE_FDB_WAYS; i++) {
+				e = &b->ent[i];
+				if (bridge_fdb_match(e, dstmac)) {
+					dst = e->port;
 					break;
 				}
 			}
-			if (found) {
-				m->port = src;
-				memcpy(m->macaddr, srcmac, 6);
-				m->timestamp = tstamp;
+		} while (bridge_fdb_read_retry(b, seq));
+	}
+
+	/* Multicast source address is never learned */
+	if (!is_valid_ether_addr(srcmac)) {
+		return dst;
+	}
+
+	/* Lockless check whether (srcmac, src) mapping is fresh */
+	tstamp = vmm_timer_timestamp();
+	b = bridge_fdb_bucket(br, srcmac);
+	do {
+		seq = bridge_fdb_read_begin(b);
+		learn = TRUE;
+		for (i = 0; i < BRIDGE_FDB_WAYS; i++) {
+			e = &b->ent[i];
+			if (bridge_fdb_match(e, srcmac)) {
+				learn = !e->is_static && ((e->port != src) ||
+					((tstamp - e->timestamp) >
+					 BRIDGE_FDB_REFRESH_NSECS));
+				break;
 			}
 		}
+	} while (bridge_fdb_read_retry(b, seq));
 
-		/* Release write lock */
-		vmm_write_unlock_irqrestore_lite(&br->mac_table_lock, f);
+	/* If learning (or refresh) required then update database */
+	if (learn) {
+		vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+		bridge_fdb_insert(br, src, srcmac, FALSE, tstamp);
+		vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
 	}
 
 	return dst;
 }
 
+static void bridge_timer_start(struct bridge_ctrl *br)
+{
+	u64 scan_nsecs = br->ageing_nsecs / 2;
+
+	if (!br->ageing_nsecs) {
+		return;
+	}
+
+	if (scan_nsecs < BRIDGE_FDB_MIN_SCAN_NSECS) {
+		scan_nsecs = BRIDGE_FDB_MIN_SCAN_NSECS;
+	}
+
+	vmm_timer_event_start(&br->ev, scan_nsecs);
+}
+
 static void bridge_timer_event(struct vmm_timer_event *ev)
 {
-	u32 i;
+	u32 i, w;
 	u64 tstamp;
 	irq_flags_t f;
 	struct bridge_ctrl *br = ev->priv;
-	struct bridge_mac_entry *m;
+	struct bridge_fdb_bucket *b;
+	struct bridge_fdb_entry *e;
 
 	DPRINTF("%s: bridge expiry event nsw=%s\n",
 		__func__, br->nsw->name);
@@ -186,85 +310,271 @@ static void bridge_timer_event(struct vmm_timer_event *ev)
 	/* Retrive current timestamp */
 	tstamp = vmm_timer_timestamp();
 
-	/* Acquire write lock */
-	vmm_write_lock_irqsave_lite(&br->mac_table_lock, f);
-
-	/* Purge old enteries */
-	for (i = 0; i < br->mac_table_sz; i++) {
-		m = &br->mac_table[i];
-		if (m->port &&
-		    ((m->timestamp - tstamp) > BRIDGE_MAC_EXPIRY)) {
+	/* Purge old learned enteries one bucket at a time */
+	for (i = 0; i < BRIDGE_FDB_HASH_SIZE; i++) {
+		b = &br->fdb[i];
+		vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+		for (w = 0; w < BRIDGE_FDB_WAYS; w++) {
+			e = &b->ent[w];
+			if (!e->port || e->is_static || !br->ageing_nsecs ||
+			    ((tstamp - e->timestamp) <= br->ageing_nsecs)) {
+				continue;
+			}
 			DPRINTF("%s: purge port=%s\n",
-				__func__, m->port->name);
-			m->port = NULL;
-			memset(m->macaddr, 0, 6);
-			m->timestamp = 0;
+				__func__, e->port->name);
+			bridge_fdb_write_begin(b);
+			bridge_fdb_clear(e);
+			bridge_fdb_write_end(b);
 		}
+		vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
 	}
 
-	/* Release write lock */
-	vmm_write_unlock_irqrestore_lite(&br->mac_table_lock, f);
-
 	/* Again start the bridge timer event */
-	vmm_timer_event_start(&br->ev, BRIDGE_MAC_EXPIRY);
+	bridge_timer_start(br);
+}
+
+bool vmm_bridge_check(struct vmm_netswitch *nsw)
+{
+	return (nsw && nsw->priv && (nsw->policy == &bridge)) ? TRUE : FALSE;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_check);
+
+int vmm_bridge_fdb_iterate(struct vmm_netswitch *nsw, void *data,
+			   int (*fn)(struct vmm_netswitch *nsw,
+				     struct vmm_bridge_fdb_info *info,
+				     void *data))
+{
+	int rc;
+	u32 i, w, seq;
+	u64 tstamp;
+	struct bridge_ctrl *br;
+	struct bridge_fdb_bucket *b;
+	struct bridge_fdb_entry snap[BRIDGE_FDB_WAYS];
+	struct vmm_bridge_fdb_info info;
+
+	if (!vmm_bridge_check(nsw) || !fn) {
+		return VMM_EINVALID;
+	}
+	br = nsw->priv;
+
+	for (i = 0; i < BRIDGE_FDB_HASH_SIZE; i++) {
+		b = &br->fdb[i];
+		do {
+			seq = bridge_fdb_read_begin(b);
+			memcpy(snap, b->ent, sizeof(snap));
+		} while (bridge_fdb_read_retry(b, seq));
+
+		tstamp = vmm_timer_timestamp();
+		for (w = 0; w < BRIDGE_FDB_WAYS; w++) {
+			if (!snap[w].port) {
+				continue;
+			}
+			info.port = snap[w].port;
+			memcpy(info.macaddr, snap[w].macaddr, 6);
+			info.is_static = snap[w].is_static;
+			info.age_nsecs = (tstamp > snap[w].timestamp) ?
+					 (tstamp - snap[w].timestamp) : 0;
+			rc = fn(nsw, &info, data);
+			if (rc) {
+				return rc;
+			}
+		}
+	}
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_fdb_iterate);
+
+int vmm_bridge_fdb_add_static(struct vmm_netswitch *nsw,
+			      struct vmm_netport *port,
+			      const u8 *macaddr)
+{
+	int rc;
+	irq_flags_t f;
+	struct bridge_ctrl *br;
+
+	if (!vmm_bridge_check(nsw) || !port || !macaddr ||
+	    (port->nsw != nsw) || !is_valid_ether_addr(macaddr)) {
+		return VMM_EINVALID;
+	}
+	br = nsw->priv;
+
+	vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+	rc = bridge_fdb_insert(br, port, macaddr, TRUE,
+			       vmm_timer_timestamp());
+	vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_fdb_add_static);
+
+int vmm_bridge_fdb_del(struct vmm_netswitch *nsw, const u8 *macaddr)
+{
+	u32 i;
+	irq_flags_t f;
+	int rc = VMM_ENOTAVAIL;
+	struct bridge_ctrl *br;
+	struct bridge_fdb_bucket *b;
+
+	if (!vmm_bridge_check(nsw) || !macaddr) {
+		return VMM_EINVALID;
+	}
+	br = nsw->priv;
+	b = bridge_fdb_bucket(br, macaddr);
+
+	vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+	for (i = 0; i < BRIDGE_FDB_WAYS; i++) {
+		if (bridge_fdb_match(&b->ent[i], macaddr)) {
+			bridge_fdb_write_begin(b);
+			bridge_fdb_clear(&b->ent[i]);
+			bridge_fdb_write_end(b);
+			rc = VMM_OK;
+			break;
+		}
+	}
+	vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_fdb_del);
+
+int vmm_bridge_get_ageing(struct vmm_netswitch *nsw, u32 *secs)
+{
+	struct bridge_ctrl *br;
+
+	if (!vmm_bridge_check(nsw) || !secs) {
+		return VMM_EINVALID;
+	}
+	br = nsw->priv;
+
+	*secs = udiv64(br->ageing_nsecs, 1000000000ULL);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_get_ageing);
+
+int vmm_bridge_set_ageing(struct vmm_netswitch *nsw, u32 secs)
+{
+	irq_flags_t f;
+	struct bridge_ctrl *br;
+
+	if (!vmm_bridge_check(nsw)) {
+		return VMM_EINVALID;
+	}
+	br = nsw->priv;
+
+	vmm_timer_event_stop(&br->ev);
+
+	vmm_spin_lock_irqsave_lite(&br->fdb_lock, f);
+	br->ageing_nsecs = (u64)secs * 1000000000ULL;
+	vmm_spin_unlock_irqrestore_lite(&br->fdb_lock, f);
+
+	bridge_timer_start(br);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_bridge_set_ageing);
+
+/* Transfer a group of mbufs having same forwarding decision */
+static void bridge_forward(struct vmm_netswitch *nsw,
+			   struct vmm_netport *src,
+			   struct vmm_netport *dst,
+			   struct vmm_mbuf **mbufs, u32 count)
+{
+	irq_flags_t f;
+	struct dlist *l, *l1;
+	struct vmm_netport *port;
+
+	if (dst) {
+		DPRINTF("%s: unicasting %d mbufs to \"%s\"\n",
+			__func__, count, dst->name);
+		vmm_switch2port_xfer_burst(nsw, dst, mbufs, count);
+		return;
+	}
+
+	DPRINTF("%s: broadcasting %d mbufs\n", __func__, count);
+	vmm_read_lock_irqsave_lite(&nsw->port_list_lock, f);
+	list_for_each_safe(l, l1, &nsw->port_list) {
+		port = list_port(l);
+		if (port == src) {
+			continue;
+		}
+		vmm_read_unlock_irqrestore_lite(&nsw->port_list_lock, f);
+		vmm_switch2port_xfer_burst(nsw, port, mbufs, count);
+		vmm_read_lock_irqsave_lite(&nsw->port_list_lock, f);
+	}
+	vmm_read_unlock_irqrestore_lite(&nsw->port_list_lock, f);
 }
 
 /**
- *  Thread body responsible for sending the RX buffer packets
+ *  Thread body responsible for sending a burst of RX buffer packets
  *  to the destination port(s)
+ *
+ *  Consecutive mbufs having same source and destination mac addresses
+ *  form one group which needs only one forwarding database lookup and
+ *  is transferred to destination port(s) as one burst. Packet order
+ *  is preserved because groups are transferred in order.
  */
-static int bridge_rx_handler(struct vmm_netswitch *nsw,
-			     struct vmm_netport *src,
-			     struct vmm_mbuf *mbuf)
+static int bridge_rx_burst_handler(struct vmm_netswitch *nsw,
+				   struct vmm_netport *src,
+				   struct vmm_mbuf **mbufs, u32 count)
 {
-	irq_flags_t f;
+	u32 i, start = 0;
 	const u8 *srcmac, *dstmac;
-	bool broadcast = TRUE;
-	struct dlist *l, *l1;
-	struct vmm_netport *dst, *port;
+	const u8 *group_srcmac = NULL, *group_dstmac = NULL;
+	struct vmm_netport *dst = NULL;
 	struct bridge_ctrl *br = nsw->priv;
 
-	/* Get source and destination mac addresses */
-	srcmac = ether_srcmac(mtod(mbuf, u8 *));
-	dstmac = ether_dstmac(mtod(mbuf, u8 *));
+	for (i = 0; i < count; i++) {
+		/* Get source and destination mac addresses */
+		srcmac = ether_srcmac(mtod(mbufs[i], u8 *));
+		dstmac = ether_dstmac(mtod(mbufs[i], u8 *));
 
-	/* Learn source mac address and find port
-	 * matching destination mac address
-	 */
-	dst = bridge_mactable_learn_find(br, dstmac, srcmac, src);
+		/* Same group as previous mbuf */
+		if (group_dstmac &&
+		    !compare_ether_addr(group_dstmac, dstmac) &&
+		    !compare_ether_addr(group_srcmac, srcmac)) {
+			continue;
+		}
 
-	/* If the frame below cases then it should be unicast.
-	 *
-	 * Case 1: destination MAC address is not broadcast address
-	 * Case 2: We found port matching destination mac address
-	 */
-	if (!is_broadcast_ether_addr(dstmac) && dst) {
-		/* Find port fordestination mac address */
-		broadcast = FALSE;
-	}
+		/* Transfer previous group */
+		if (start < i) {
+			bridge_forward(nsw, src, dst,
+				       &mbufs[start], i - start);
+		}
+		start = i;
+		group_srcmac = srcmac;
+		group_dstmac = dstmac;
 
-	/* Transfer mbuf to appropriate ports */
-	if (broadcast) {
-		DPRINTF("%s: broadcasting\n", __func__);
-		vmm_read_lock_irqsave_lite(&nsw->port_list_lock, f);
-		list_for_each_safe(l, l1, &nsw->port_list) {
-			port = list_port(l);
-			if (port == src) {
-				continue;
-			}
-			vmm_read_unlock_irqrestore_lite(&nsw->port_list_lock, f);
-			vmm_switch2port_xfer_mbuf(nsw, port, mbuf);
-			vmm_read_lock_irqsave_lite(&nsw->port_list_lock, f);
+		/* Learn source mac address and find port
+		 * matching destination mac address
+		 */
+		dst = bridge_fdb_learn_find(br, dstmac, srcmac, src);
+
+		/* The frame is unicast only when destination mac
+		 * address is not broadcast address and we found
+		 * port matching destination mac address.
+		 */
+		if (is_broadcast_ether_addr(dstmac)) {
+			dst = NULL;
 		}
-		vmm_read_unlock_irqrestore_lite(&nsw->port_list_lock, f);
-	} else {
-		DPRINTF("%s: unicasting to \"%s\"\n", __func__, dst->name);
-		vmm_switch2port_xfer_mbuf(nsw, dst, mbuf);
+	}
+
+	/* Transfer last group */
+	if (start < count) {
+		bridge_forward(nsw, src, dst, &mbufs[start], count - start);
 	}
 
 	return VMM_OK;
 }
 
+static int bridge_rx_handler(struct vmm_netswitch *nsw,
+			     struct vmm_netport *src,
+			     struct vmm_mbuf *mbuf)
+{
+	return bridge_rx_burst_handler(nsw, src, &mbuf, 1);
+}
+
 static int bridge_port_add(struct vmm_netswitch *nsw,
 			   struct vmm_netport *port)
 {
@@ -277,8 +587,8 @@ static int bridge_port_remove(struct vmm_netswitch *nsw,
 {
 	struct bridge_ctrl *br = nsw->priv;
 
-	/* Cleanup mactable enteries for this port */
-	bridge_mactable_cleanup_port(br, port);
+	/* Cleanup forwarding database enteries for this port */
+	bridge_fdb_cleanup_port(br, port);
 
 	return VMM_OK;
 }
@@ -288,14 +598,21 @@ static struct vmm_netswitch *bridge_create(
 				const char *name, int argc, char **argv)
 {
 	int rc;
+	u32 ageing_secs = CONFIG_NET_BRIDGE_AGEING_SECS;
 	struct bridge_ctrl *br;
 	struct vmm_netswitch *nsw = NULL;
 
+	/* Optional first argument is ageing time in seconds */
+	if (argc > 0) {
+		ageing_secs = strtoul(argv[0], NULL, 10);
+	}
+
 	nsw = vmm_netswitch_alloc(policy, name);
 	if (!nsw) {
 		goto bridge_netswitch_alloc_failed;
 	}
 	nsw->port2switch_xfer = bridge_rx_handler;
+	nsw->port2switch_xfer_burst = bridge_rx_burst_handler;
 	nsw->port_add = bridge_port_add;
 	nsw->port_remove = bridge_port_remove;
 
@@ -306,12 +623,12 @@ static struct vmm_netswitch *bridge_create(
 
 	br->nsw = nsw;
 	INIT_TIMER_EVENT(&br->ev, bridge_timer_event, br);
-	INIT_RW_LOCK(&br->mac_table_lock);
-	br->mac_table_sz = BRIDGE_MAC_TABLE_SZ;
-	br->mac_table = vmm_zalloc(sizeof(struct bridge_mac_entry) *
-				   br->mac_table_sz);
-	if (!br->mac_table) {
-		goto bridge_alloc_mac_table_fail;
+	INIT_SPIN_LOCK(&br->fdb_lock);
+	br->ageing_nsecs = (u64)ageing_secs * 1000000000ULL;
+	br->fdb = vmm_zalloc(sizeof(struct bridge_fdb_bucket) *
+			     BRIDGE_FDB_HASH_SIZE);
+	if (!br->fdb) {
+		goto bridge_alloc_fdb_fail;
 	}
 
 	rc = vmm_netswitch_register(nsw, NULL, br);
@@ -319,13 +636,13 @@ static struct vmm_netswitch *bridge_create(
 		goto bridge_netswitch_register_fail;
 	}
 
-	vmm_timer_event_start(&br->ev, BRIDGE_MAC_EXPIRY);
+	bridge_timer_start(br);
 
 	return nsw;
 
 bridge_netswitch_register_fail:
-	vmm_free(br->mac_table);
-bridge_alloc_mac_table_fail:
+	vmm_free(br->fdb);
+bridge_alloc_fdb_fail:
 	vmm_free(br);
 bridge_alloc_failed:
 	vmm_netswitch_free(nsw);
@@ -347,14 +664,14 @@ static void bridge_destroy(struct vmm_netswitch_policy *policy,
 
 	vmm_netswitch_unregister(nsw);
 
-	vmm_free(br->mac_table);
+	vmm_free(br->fdb);
 	vmm_free(br);
 
 	vmm_netswitch_free(nsw);
 }
 
 static struct vmm_netswitch_policy bridge = {
-	.name = "bridge",
+	.name = VMM_BRIDGE_POLICY_NAME,
 	.create = bridge_create,
 	.destroy = bridge_destroy,
 };
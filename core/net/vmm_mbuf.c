@@ -289,6 +289,10 @@ struct vmm_mbuf *m_get(int nowait, int flags)
 	m->m_flags = flags;
 	if (flags & M_PKTHDR) {
 		m->m_pktlen = 0;
+		m->m_csum_start = 0;
+		m->m_csum_offset = 0;
+		m->m_gso_size = 0;
+		m->m_gso_type = M_GSO_NONE;
 	}
 	m->m_ref = 1;
 
@@ -445,6 +449,10 @@ void m_dump(struct vmm_mbuf *m)
 	vmm_printf("  MBuf flags:    0x%x\n", m->m_flags);
 	vmm_printf("MBuf packet\n");
 	vmm_printf("  MBuf len:      %d\n", m->m_pktlen);
+	vmm_printf("  MBuf csum:     start=%d offset=%d\n",
+		   m->m_csum_start, m->m_csum_offset);
+	vmm_printf("  MBuf gso:      type=%d size=%d\n",
+		   m->m_gso_type, m->m_gso_size);
 	vmm_printf("MBuf ext\n");
 	vmm_printf("  MBuf buf:      %p\n", m->m_extbuf);
 	vmm_printf("  MBuf len:      %d\n", m->m_extlen);
@@ -0,0 +1,332 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_netoffload.c
+ * @author agent (agent@local)
+ * @brief Software fallback for checksum and segmentation offloads.
+ *
+ * Virtual ports which understand offload metadata of mbuf exchange
+ * TCP super-frames and packets with partial checksum as-is. Only when
+ * such a packet egresses to a port which does not understand offload
+ * metadata (real NIC, lwIP, etc) it is segmented and/or checksummed
+ * here. The original mbuf is never modified because same mbuf can be
+ * in-flight to multiple ports.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <net/vmm_protocol.h>
+#include <net/vmm_netoffload.h>
+#include <libs/stringlib.h>
+#include <libs/mathlib.h>
+
+#define ETHERTYPE_IPV4		0x0800
+#define ETHERTYPE_IPV6		0x86dd
+#define ETHERTYPE_VLAN		0x8100
+
+#define IPV6_HLEN		40
+#define IPPROTO_TCP		6
+
+#define TCP_FLAG_FIN		0x01
+#define TCP_FLAG_PSH		0x08
+#define TCP_FLAG_CWR		0x80
+
+static inline u16 netoffload_get16(const u8 *p)
+{
+	return ((u16)p[0] << 8) | p[1];
+}
+
+static inline void netoffload_put16(u8 *p, u16 val)
+{
+	p[0] = val >> 8;
+	p[1] = val & 0xff;
+}
+
+static inline u32 netoffload_get32(const u8 *p)
+{
+	return ((u32)netoffload_get16(p) << 16) | netoffload_get16(p + 2);
+}
+
+static inline void netoffload_put32(u8 *p, u32 val)
+{
+	netoffload_put16(p, val >> 16);
+	netoffload_put16(p + 2, val & 0xffff);
+}
+
+/* Add big-endian 16-bit words of buffer to ones-complement sum */
+static u32 netoffload_csum_add(u32 sum, const u8 *buf, u32 len)
+{
+	u32 i;
+
+	for (i = 0; (i + 1) < len; i += 2) {
+		sum += netoffload_get16(&buf[i]);
+	}
+	if (len & 1) {
+		sum += (u32)buf[len - 1] << 8;
+	}
+
+	return sum;
+}
+
+static u16 netoffload_csum_fold(u32 sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	sum = ~sum & 0xffff;
+
+	/* Zero checksum means "no checksum" for UDP */
+	return (sum) ? sum : 0xffff;
+}
+
+/* Find L3 offset, L4 offset, and total header length of TCP packet */
+static int netoffload_parse_tcp(const u8 *pkt, u32 len, u8 gso_type,
+				u32 *l3, u32 *l4, u32 *hlen)
+{
+	u32 off = ETHER_HLEN, ihl, doff;
+	u16 type;
+
+	if (len < ETHER_HLEN) {
+		return VMM_EINVALID;
+	}
+	type = netoffload_get16(&pkt[12]);
+	if (type == ETHERTYPE_VLAN) {
+		if (len < (ETHER_HLEN + 4)) {
+			return VMM_EINVALID;
+		}
+		type = netoffload_get16(&pkt[16]);
+		off += 4;
+	}
+	*l3 = off;
+
+	switch (gso_type) {
+	case M_GSO_TCPV4:
+		if ((type != ETHERTYPE_IPV4) || (len < (off + IP4_HLEN)) ||
+		    ((pkt[off] >> 4) != 4) ||
+		    (pkt[off + 9] != IPPROTO_TCP)) {
+			return VMM_EINVALID;
+		}
+		ihl = (pkt[off] & 0xf) << 2;
+		if (ihl < IP4_HLEN) {
+			return VMM_EINVALID;
+		}
+		off += ihl;
+		break;
+	case M_GSO_TCPV6:
+		/* IPv6 extension headers are not handled */
+		if ((type != ETHERTYPE_IPV6) || (len < (off + IPV6_HLEN)) ||
+		    (pkt[off + 6] != IPPROTO_TCP)) {
+			return VMM_EINVALID;
+		}
+		off += IPV6_HLEN;
+		break;
+	default:
+		return VMM_EINVALID;
+	};
+	*l4 = off;
+
+	if (len < (off + TCP_HLEN)) {
+		return VMM_EINVALID;
+	}
+	doff = (pkt[off + 12] >> 4) << 2;
+	if ((doff < TCP_HLEN) || (len < (off + doff))) {
+		return VMM_EINVALID;
+	}
+	*hlen = off + doff;
+
+	return VMM_OK;
+}
+
+static struct vmm_mbuf *netoffload_alloc(u32 len)
+{
+	struct vmm_mbuf *m;
+
+	MGETHDR(m, 0, 0);
+	if (!m) {
+		return NULL;
+	}
+	if (!MEXTMALLOC(m, len, 0)) {
+		m_freem(m);
+		return NULL;
+	}
+	m->m_len = m->m_pktlen = len;
+
+	return m;
+}
+
+static int netoffload_csum(struct vmm_mbuf *m, const u8 *pkt,
+			   int (*xfer)(struct vmm_mbuf *, void *),
+			   void *priv)
+{
+	u8 *d;
+	u32 sum, len = m->m_pktlen;
+	u32 start = m->m_csum_start;
+	u32 off = start + m->m_csum_offset;
+	struct vmm_mbuf *n;
+
+	if (len < (off + 2)) {
+		return VMM_EINVALID;
+	}
+
+	n = netoffload_alloc(len);
+	if (!n) {
+		return VMM_ENOMEM;
+	}
+	d = mtod(n, u8 *);
+	memcpy(d, pkt, len);
+
+	/* Checksum field already has pseudo-header sum */
+	sum = netoffload_csum_add(0, &d[start], len - start);
+	netoffload_put16(&d[off], netoffload_csum_fold(sum));
+
+	return xfer(n, priv);
+}
+
+static int netoffload_segment(struct vmm_mbuf *m, const u8 *pkt,
+			      int (*xfer)(struct vmm_mbuf *, void *),
+			      void *priv)
+{
+	int rc, ret = VMM_OK;
+	u8 *d, *tcp;
+	u16 ipid = 0;
+	u32 l3, l4, hlen, off, seglen, seq, sum, i = 0;
+	u32 len = m->m_pktlen, mss = m->m_gso_size;
+	struct vmm_mbuf *n;
+
+	rc = netoffload_parse_tcp(pkt, len, m->m_gso_type, &l3, &l4, &hlen);
+	if (rc || (mss < VMM_NETOFFLOAD_GSO_MIN_MSS) ||
+	    (udiv32(len - hlen + mss - 1, mss) > VMM_NETOFFLOAD_GSO_MAX_SEGS)) {
+		return VMM_EINVALID;
+	}
+
+	seq = netoffload_get32(&pkt[l4 + 4]);
+	if (m->m_gso_type == M_GSO_TCPV4) {
+		ipid = netoffload_get16(&pkt[l3 + 4]);
+	}
+
+	off = hlen;
+	do {
+		seglen = min(mss, len - off);
+
+		n = netoffload_alloc(hlen + seglen);
+		if (!n) {
+			return VMM_ENOMEM;
+		}
+		d = mtod(n, u8 *);
+		memcpy(d, pkt, hlen);
+		memcpy(d + hlen, pkt + off, seglen);
+		tcp = d + l4;
+
+		/* Fixup IP header */
+		if (m->m_gso_type == M_GSO_TCPV4) {
+			netoffload_put16(&d[l3 + 2], hlen - l3 + seglen);
+			netoffload_put16(&d[l3 + 4], ipid + i);
+			netoffload_put16(&d[l3 + 10], 0);
+			sum = netoffload_csum_add(0, &d[l3], l4 - l3);
+			sum = netoffload_csum_fold(sum);
+			netoffload_put16(&d[l3 + 10], sum);
+		} else {
+			netoffload_put16(&d[l3 + 4], hlen - l4 + seglen);
+		}
+
+		/* Fixup TCP header */
+		netoffload_put32(&tcp[4], seq + (off - hlen));
+		if (i) {
+			tcp[13] &= ~TCP_FLAG_CWR;
+		}
+		if ((off + seglen) < len) {
+			tcp[13] &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+		}
+
+		/* Full TCP checksum with pseudo-header */
+		if (m->m_gso_type == M_GSO_TCPV4) {
+			sum = netoffload_csum_add(0, &d[l3 + 12], 8);
+		} else {
+			sum = netoffload_csum_add(0, &d[l3 + 8], 32);
+		}
+		sum += IPPROTO_TCP + (hlen - l4 + seglen);
+		netoffload_put16(&tcp[16], 0);
+		sum = netoffload_csum_add(sum, tcp, hlen - l4 + seglen);
+		netoffload_put16(&tcp[16], netoffload_csum_fold(sum));
+
+		rc = xfer(n, priv);
+		if (rc) {
+			ret = rc;
+		}
+
+		off += seglen;
+		i++;
+	} while (off < len);
+
+	return ret;
+}
+
+u32 vmm_netoffload_hdrlen(struct vmm_mbuf *m)
+{
+	u32 l3, l4, hlen;
+
+	if (netoffload_parse_tcp(mtod(m, u8 *), m->m_len, m->m_gso_type,
+				 &l3, &l4, &hlen)) {
+		return 0;
+	}
+
+	return hlen;
+}
+VMM_EXPORT_SYMBOL(vmm_netoffload_hdrlen);
+
+int vmm_netoffload_emulate(struct vmm_mbuf *m,
+			   int (*xfer)(struct vmm_mbuf *, void *),
+			   void *priv)
+{
+	int rc;
+	u8 *pkt;
+
+	if (!m || !xfer || !(m->m_flags & M_PKTHDR)) {
+		return VMM_EINVALID;
+	}
+
+	/* Work on linear copy of chained mbuf */
+	if (m->m_next) {
+		pkt = vmm_malloc(m->m_pktlen);
+		if (!pkt) {
+			return VMM_ENOMEM;
+		}
+		m_copydata(m, 0, m->m_pktlen, pkt);
+	} else {
+		pkt = mtod(m, u8 *);
+	}
+
+	if (m->m_gso_type != M_GSO_NONE) {
+		rc = netoffload_segment(m, pkt, xfer, priv);
+	} else if (m->m_flags & M_CSUM_PARTIAL) {
+		rc = netoffload_csum(m, pkt, xfer, priv);
+	} else {
+		MADDREFERENCE(m);
+		MCLADDREFERENCE(m);
+		rc = xfer(m, priv);
+	}
+
+	if (pkt != mtod(m, u8 *)) {
+		vmm_free(pkt);
+	}
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_netoffload_emulate);
@@ -37,6 +37,7 @@
 #include <net/vmm_protocol.h>
 #include <net/vmm_netswitch.h>
 #include <net/vmm_netport.h>
+#include <net/vmm_netoffload.h>
 #include <libs/list.h>
 #include <libs/mathlib.h>
 #include <libs/stringlib.h>
@@ -172,13 +173,36 @@ static int netswitch_bh_enqueue(struct vmm_netswitch_bh_ctrl *nbp,
 	return VMM_OK;
 }
 
+static int netswitch_bh_enqueue_burst(struct vmm_netswitch_bh_ctrl *nbp,
+				      struct vmm_mbuf **mbufs, u32 count)
+{
+	u32 i;
+	irq_flags_t flags;
+
+	if (!nbp || !mbufs || !count) {
+		return VMM_EINVALID;
+	}
+
+	vmm_spin_lock_irqsave_lite(&nbp->bh_list_lock, flags);
+	for (i = 0; i < count; i++) {
+		list_add_tail(&mbufs[i]->m_list, &nbp->mbuf_list);
+	}
+	vmm_spin_unlock_irqrestore_lite(&nbp->bh_list_lock, flags);
+
+	vmm_completion_complete_once(&nbp->bh_cmpl);
+
+	return VMM_OK;
+}
+
+/* Dequeue upto VMM_NETSWITCH_BURST_SIZE mbufs and one lazy request */
 static int netswitch_bh_dequeue(struct vmm_netswitch_bh_ctrl *nbp,
-				struct vmm_mbuf **mbufp,
+				struct vmm_mbuf **mbufs, u32 *mbuf_count,
 				struct vmm_netport_lazy **lazyp)
 {
+	u32 count = 0;
 	irq_flags_t flags;
 
-	if (!nbp || !mbufp || !lazyp) {
+	if (!nbp || !mbufs || !mbuf_count || !lazyp) {
 		return VMM_EINVALID;
 	}
 
@@ -190,10 +214,12 @@ static int netswitch_bh_dequeue(struct vmm_netswitch_bh_ctrl *nbp,
 		vmm_spin_lock_irqsave_lite(&nbp->bh_list_lock, flags);
 	}
 
-	if (!list_empty(&nbp->mbuf_list)) {
-		*mbufp = list_entry(list_pop(&nbp->mbuf_list),
-				    struct vmm_mbuf, m_list);
+	while (!list_empty(&nbp->mbuf_list) &&
+	       (count < VMM_NETSWITCH_BURST_SIZE)) {
+		mbufs[count++] = list_entry(list_pop(&nbp->mbuf_list),
+					    struct vmm_mbuf, m_list);
 	}
+	*mbuf_count = count;
 
 	if (!list_empty(&nbp->lazy_list)) {
 		*lazyp = list_entry(list_pop(&nbp->lazy_list),
@@ -231,51 +257,75 @@ static void netswitch_bh_port_flush(struct vmm_netswitch_bh_ctrl *nbp,
 	vmm_spin_unlock_irqrestore_lite(&nbp->bh_list_lock, flags);
 }
 
+/* Process mbufs from same source port as one burst */
+static void netswitch_bh_xfer_burst(struct vmm_netport *port,
+				    struct vmm_mbuf **mbufs, u32 count)
+{
+	u32 i;
+	struct vmm_netswitch *nsw = (port) ? port->nsw : NULL;
+
+	for (i = 0; i < count; i++) {
+		mbufs[i]->m_list_priv = NULL;
+	}
+
+	/* Port might have been removed from netswitch */
+	if (!nsw) {
+		goto done;
+	}
+
+	/* Print debug info */
+	DPRINTF("%s: nsw=%s port=%s mbufs=%d\n", __func__,
+		nsw->name, port->name, count);
+
+	/* Dump packets */
+	for (i = 0; i < count; i++) {
+		DUMP_NETSWITCH_PKT(mbufs[i]);
+	}
+
+	/* Call the rx function of net switch */
+	if (nsw->port2switch_xfer_burst) {
+		nsw->port2switch_xfer_burst(nsw, port, mbufs, count);
+	} else {
+		for (i = 0; i < count; i++) {
+			nsw->port2switch_xfer(nsw, port, mbufs[i]);
+		}
+	}
+
+done:
+	/* Free mbufs */
+	for (i = 0; i < count; i++) {
+		m_freem(mbufs[i]);
+	}
+}
+
 static int netswitch_bh_main(void *param)
 {
 	int rc;
+	u32 i, j, mbuf_count;
 	struct vmm_netport *port;
 	struct vmm_netswitch *nsw;
-	struct vmm_mbuf *mbuf;
+	struct vmm_mbuf *mbufs[VMM_NETSWITCH_BURST_SIZE];
 	struct vmm_netport_lazy *lazy;
 	struct vmm_netswitch_bh_ctrl *nbp = param;
 
 	while (1) {
-		/* Try to get next request from list or block if empty */
+		/* Try to get next requests from list or block if empty */
 		lazy = NULL;
-		mbuf = NULL;
-		rc = netswitch_bh_dequeue(nbp, &mbuf, &lazy);
+		mbuf_count = 0;
+		rc = netswitch_bh_dequeue(nbp, mbufs, &mbuf_count, &lazy);
 		if (rc) {
 			continue;
 		}
 
-		/* Process mbuf request */
-		if (mbuf) {
-			/* Extract port from mbuf */
-			port = mbuf->m_list_priv;
-			nsw = port->nsw;
-			mbuf->m_list_priv = NULL;
-
-			/* Port might have been removed from netswitch */
-			if (!port || !nsw) {
-				if (mbuf) {
-					m_freem(mbuf);
+		/* Process mbuf requests in bursts of same source port */
+		for (i = 0; i < mbuf_count; i = j) {
+			port = mbufs[i]->m_list_priv;
+			for (j = i + 1; j < mbuf_count; j++) {
+				if (mbufs[j]->m_list_priv != port) {
+					break;
 				}
-				continue;
 			}
-
-			/* Print debug info */
-			DPRINTF("%s: nsw=%s port=%s mbuf\n", __func__,
-				nsw->name, port->name);
-
-			/* Dump packet */
-			DUMP_NETSWITCH_PKT(mbuf);
-
-			/* Call the rx function of net switch */
-			nsw->port2switch_xfer(nsw, port, mbuf);
-
-			/* Free mbuf */
-			m_freem(mbuf);
+			netswitch_bh_xfer_burst(port, &mbufs[i], j - i);
 		}
 
 		/* Process lazy request */
@@ -342,10 +392,59 @@ int vmm_port2switch_xfer_mbuf(struct vmm_netport *src, struct vmm_mbuf *mbuf)
 }
 VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_mbuf);
 
+int vmm_port2switch_xfer_burst(struct vmm_netport *src,
+			       struct vmm_mbuf **mbufs, u32 count)
+{
+	int rc;
+	u32 i;
+	struct vmm_netswitch *nsw;
+	struct vmm_netswitch_bh_ctrl *nbp;
+
+	if (!mbufs) {
+		return VMM_EFAIL;
+	}
+	if (!count) {
+		return VMM_OK;
+	}
+	if (!src || !src->nsw) {
+		vmm_printf("%s: invalid source port.\n", __func__);
+		for (i = 0; i < count; i++) {
+			m_freem(mbufs[i]);
+		}
+		return VMM_EFAIL;
+	}
+	nsw = src->nsw;
+	nbp = &this_cpu(nbctrl);
+
+	/* Print debug info */
+	DPRINTF("%s: nsw=%s src=%s count=%d\n",
+		__func__, nsw->name, src->name, count);
+
+	/* Save port in mbufs */
+	for (i = 0; i < count; i++) {
+		mbufs[i]->m_list_priv = src;
+	}
+
+	/* Add all mbufs to bh queue at once */
+	rc = netswitch_bh_enqueue_burst(nbp, mbufs, count);
+	if (rc) {
+		vmm_printf("%s: nsw=%s src=%s mbuf bh enqueue failed.\n",
+			   __func__, nsw->name, src->name);
+		for (i = 0; i < count; i++) {
+			mbufs[i]->m_list_priv = NULL;
+			m_freem(mbufs[i]);
+		}
+	}
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_burst);
+
 int vmm_port2switch_xfer_lazy(struct vmm_netport_lazy *lazy)
 {
 	int rc = VMM_EBUSY;
 	long sched_count;
+	struct vmm_netswitch_bh_ctrl *nbp;
 
 	if (!lazy || !lazy->xfer || !lazy->port || !lazy->port->nsw) {
 		vmm_printf("%s: invalid lazy instance.\n", __func__);
@@ -362,8 +461,15 @@ int vmm_port2switch_xfer_lazy(struct vmm_netport_lazy *lazy)
 		DPRINTF("%s: nsw=%s port=%s bh enqueue\n",
 			__func__, lazy->port->nsw->name, lazy->port->name);
 
+		/* Pick bottom-half of the host CPU preferred by lazy */
+		if ((lazy->cpu >= 0) && vmm_cpu_online(lazy->cpu)) {
+			nbp = &per_cpu(nbctrl, lazy->cpu);
+		} else {
+			nbp = &this_cpu(nbctrl);
+		}
+
 		/* Add xfer request to xfer ring */
-		rc = netswitch_bh_enqueue(&this_cpu(nbctrl), NULL, lazy);
+		rc = netswitch_bh_enqueue(nbp, NULL, lazy);
 		if (rc) {
 			vmm_printf("%s: nsw=%s port=%s lazy bh "
 				   "enqueue failed.\n", __func__,
@@ -377,34 +483,104 @@ int vmm_port2switch_xfer_lazy(struct vmm_netport_lazy *lazy)
 }
 VMM_EXPORT_SYMBOL(vmm_port2switch_xfer_lazy);
 
+static int netswitch_offload_xfer(struct vmm_mbuf *mbuf, void *priv)
+{
+	struct vmm_netport *dst = priv;
+
+	return dst->switch2port_xfer(dst, mbuf);
+}
+
+/* Must be called with destination port locked */
+static int netswitch_port_xfer_burst(struct vmm_netport *dst,
+				     struct vmm_mbuf **mbufs, u32 count)
+{
+	u32 i;
+	int rc = VMM_OK, rc1;
+
+	for (i = 0; i < count; i++) {
+		MADDREFERENCE(mbufs[i]);
+		MCLADDREFERENCE(mbufs[i]);
+	}
+
+	if (dst->switch2port_xfer_burst) {
+		return dst->switch2port_xfer_burst(dst, mbufs, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		rc1 = dst->switch2port_xfer(dst, mbufs[i]);
+		if (rc1) {
+			rc = rc1;
+		}
+	}
+
+	return rc;
+}
+
 int vmm_switch2port_xfer_mbuf(struct vmm_netswitch *nsw,
 			      struct vmm_netport *dst,
 			      struct vmm_mbuf *mbuf)
 {
-	int rc;
-	irq_flags_t f;
-
 	if (!nsw || !dst || !mbuf) {
 		return VMM_EFAIL;
 	}
 
+	return vmm_switch2port_xfer_burst(nsw, dst, &mbuf, 1);
+}
+VMM_EXPORT_SYMBOL(vmm_switch2port_xfer_mbuf);
+
+int vmm_switch2port_xfer_burst(struct vmm_netswitch *nsw,
+			       struct vmm_netport *dst,
+			       struct vmm_mbuf **mbufs, u32 count)
+{
+	u32 i, j;
+	int rc = VMM_OK, rc1;
+	irq_flags_t f = 0;
+
+	if (!nsw || !dst || !mbufs) {
+		return VMM_EFAIL;
+	}
+
 	/* Print debug info */
-	DPRINTF("%s: nsw=%s dst=%s\n", __func__, nsw->name, dst->name);
+	DPRINTF("%s: nsw=%s dst=%s count=%d\n",
+		__func__, nsw->name, dst->name, count);
 
-	if (dst->can_receive && !dst->can_receive(dst)) {
+	if (!count || (dst->can_receive && !dst->can_receive(dst))) {
 		return VMM_OK;
 	}
 
-	MADDREFERENCE(mbuf);
-	MCLADDREFERENCE(mbuf);
+	if (!(dst->flags & VMM_NETPORT_MULTIQUEUE)) {
+		vmm_spin_lock_irqsave_lite(&dst->switch2port_xfer_lock, f);
+	}
+
+	/*
+	 * Offloads which destination port can't handle are done in
+	 * software whereas remaining mbufs go to port as-is.
+	 */
+	for (i = 0; i < count; i = j) {
+		if (vmm_netoffload_required(dst, mbufs[i])) {
+			rc1 = vmm_netoffload_emulate(mbufs[i],
+					netswitch_offload_xfer, dst);
+			j = i + 1;
+		} else {
+			for (j = i + 1; j < count; j++) {
+				if (vmm_netoffload_required(dst, mbufs[j])) {
+					break;
+				}
+			}
+			rc1 = netswitch_port_xfer_burst(dst, &mbufs[i], j - i);
+		}
+		if (rc1) {
+			rc = rc1;
+		}
+	}
 
-	vmm_spin_lock_irqsave_lite(&dst->switch2port_xfer_lock, f);
-	rc = dst->switch2port_xfer(dst, mbuf);
-	vmm_spin_unlock_irqrestore_lite(&dst->switch2port_xfer_lock, f);
+	if (!(dst->flags & VMM_NETPORT_MULTIQUEUE)) {
+		vmm_spin_unlock_irqrestore_lite(&dst->switch2port_xfer_lock, f);
+	}
 
 	return rc;
 }
-VMM_EXPORT_SYMBOL(vmm_switch2port_xfer_mbuf);
+VMM_EXPORT_SYMBOL(vmm_switch2port_xfer_burst);
 
 struct vmm_netswitch *vmm_netswitch_alloc(struct vmm_netswitch_policy *nsp,
 					  const char *name)
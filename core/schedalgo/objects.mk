@@ -23,4 +23,4 @@
 
 core-objs-$(CONFIG_SCHEDALGO_PRR) += schedalgo/vmm_schedalgo_prr.o
 core-objs-$(CONFIG_SCHEDALGO_PRM) += schedalgo/vmm_schedalgo_prm.o
-
+core-objs-$(CONFIG_SCHEDALGO_EDF) += schedalgo/vmm_schedalgo_edf.o
@@ -0,0 +1,334 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_schedalgo_edf.c
+ * @author agent (agent@local)
+ * @brief Implementation of earliest deadline first scheduling algorithm
+ *
+ * Each VCPU is a constant bandwidth server (CBS) which can run for
+ * "deadline" nanoseconds (budget) in every "periodicity" nanoseconds
+ * (period). Within a priority level, the VCPU with earliest absolute
+ * deadline runs first and the budget is charged with the time spent
+ * by VCPU in RUNNING state (i.e. same running time as reported by
+ * vmm_scheduler_stats()).
+ *
+ * When a VCPU exhausts its budget, the budget is replenished and its
+ * absolute deadline is postponed by one period. This is a soft CBS so
+ * a VCPU which has exhausted its budget is not throttled but it only
+ * runs when VCPUs with earlier deadlines are not ready.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_timer.h>
+#include <vmm_schedalgo.h>
+#include <libs/rbtree_augmented.h>
+
+/* Minimum time slice given to a VCPU having small remaining budget */
+#define EDF_MIN_TIME_SLICE_NSECS	100000ULL
+
+struct vmm_schedalgo_rq_entry {
+	struct rb_node rb;
+	struct vmm_vcpu *vcpu;
+	s64 budget;
+	u64 abs_deadline;
+	u64 running_nsecs;
+};
+
+struct vmm_schedalgo_rq {
+	u32 count[VMM_VCPU_MAX_PRIORITY+1];
+	struct rb_root root[VMM_VCPU_MAX_PRIORITY+1];
+};
+
+/* Charge running time of VCPU to its budget and apply CBS rules */
+static void edf_update(struct vmm_schedalgo_rq_entry *rq_entry, u64 now)
+{
+	struct vmm_vcpu *vcpu = rq_entry->vcpu;
+	u64 budget = vcpu->deadline;
+	u64 period = vcpu->periodicity;
+
+	/* Running time is reset along with VCPU */
+	if (vcpu->state_running_nsecs < rq_entry->running_nsecs) {
+		rq_entry->running_nsecs = vcpu->state_running_nsecs;
+	}
+	rq_entry->budget -= vcpu->state_running_nsecs -
+			    rq_entry->running_nsecs;
+	rq_entry->running_nsecs = vcpu->state_running_nsecs;
+
+	/* Budget exhausted so replenish and postpone deadline */
+	while (rq_entry->budget <= 0) {
+		rq_entry->budget += budget;
+		rq_entry->abs_deadline += period;
+	}
+
+	/* Start new period when deadline has passed or when remaining
+	 * budget can't be consumed before deadline without exceeding
+	 * reserved bandwidth (i.e. budget / period).
+	 */
+	if ((rq_entry->abs_deadline <= now) ||
+	    ((u64)rq_entry->budget * period >
+	     (rq_entry->abs_deadline - now) * budget)) {
+		rq_entry->budget = budget;
+		rq_entry->abs_deadline = now + period;
+	}
+}
+
+int vmm_schedalgo_vcpu_setup(struct vmm_vcpu *vcpu)
+{
+	struct vmm_schedalgo_rq_entry *rq_entry;
+
+	if (!vcpu) {
+		return VMM_EFAIL;
+	}
+
+	rq_entry = vmm_malloc(sizeof(struct vmm_schedalgo_rq_entry));
+	if (!rq_entry) {
+		return VMM_EFAIL;
+	}
+
+	RB_CLEAR_NODE(&rq_entry->rb);
+	rq_entry->vcpu = vcpu;
+	rq_entry->budget = vcpu->deadline;
+	rq_entry->abs_deadline = 0;
+	rq_entry->running_nsecs = vcpu->state_running_nsecs;
+	vcpu->sched_priv = rq_entry;
+
+	return VMM_OK;
+}
+
+int vmm_schedalgo_vcpu_cleanup(struct vmm_vcpu *vcpu)
+{
+	if (!vcpu) {
+		return VMM_EFAIL;
+	}
+
+	if (vcpu->sched_priv) {
+		vmm_free(vcpu->sched_priv);
+		vcpu->sched_priv = NULL;
+	}
+
+	return VMM_OK;
+}
+
+int vmm_schedalgo_rq_length(void *rq, u8 priority)
+{
+	struct vmm_schedalgo_rq *rqi = rq;
+
+	if (!rqi) {
+		return -1;
+	}
+
+	return rqi->count[priority];
+}
+
+int vmm_schedalgo_rq_enqueue(void *rq, struct vmm_vcpu *vcpu)
+{
+	struct vmm_schedalgo_rq_entry *rq_entry, *parent_e;
+	struct vmm_schedalgo_rq *rqi = rq;
+	struct rb_node **new = NULL, *parent = NULL;
+
+	if (!rqi || !vcpu) {
+		return VMM_EFAIL;
+	}
+
+	rq_entry = vcpu->sched_priv;
+	if (!rq_entry) {
+		return VMM_EFAIL;
+	}
+
+	edf_update(rq_entry, vmm_timer_timestamp());
+
+	new = &(rqi->root[vcpu->priority].rb_node);
+	while (*new) {
+		parent = *new;
+		parent_e = rb_entry(parent, struct vmm_schedalgo_rq_entry, rb);
+		if (rq_entry->abs_deadline < parent_e->abs_deadline) {
+			new = &parent->rb_left;
+		} else {
+			new = &parent->rb_right;
+		}
+	}
+	rb_link_node(&rq_entry->rb, parent, new);
+	rb_insert_color(&rq_entry->rb, &rqi->root[vcpu->priority]);
+	rqi->count[vcpu->priority]++;
+
+	return VMM_OK;
+}
+
+int vmm_schedalgo_rq_dequeue(void *rq,
+			     struct vmm_vcpu **next,
+			     u64 *next_time_slice)
+{
+	int p;
+	u64 time_slice;
+	struct rb_node *n;
+	struct vmm_schedalgo_rq_entry *rq_entry;
+	struct vmm_schedalgo_rq *rqi = rq;
+
+	if (!rqi) {
+		return VMM_EFAIL;
+	}
+
+	p = VMM_VCPU_MAX_PRIORITY + 1;
+	while (p) {
+		if (rqi->count[p-1]) {
+			break;
+		}
+		p--;
+	}
+	if (!p) {
+		return VMM_ENOTAVAIL;
+	}
+	p = p - 1;
+
+	n = rb_first(&rqi->root[p]);
+	if (!n) {
+		return VMM_ENOTAVAIL;
+	}
+	rq_entry = rb_entry(n, struct vmm_schedalgo_rq_entry, rb);
+	rb_erase(&rq_entry->rb, &rqi->root[p]);
+	RB_CLEAR_NODE(&rq_entry->rb);
+	rqi->count[p]--;
+
+	/* Don't let VCPU run beyond its remaining budget */
+	time_slice = rq_entry->vcpu->time_slice;
+	if ((u64)rq_entry->budget < time_slice) {
+		time_slice = rq_entry->budget;
+	}
+	if (time_slice < EDF_MIN_TIME_SLICE_NSECS) {
+		time_slice = EDF_MIN_TIME_SLICE_NSECS;
+	}
+
+	if (next) {
+		*next = rq_entry->vcpu;
+	}
+	if (next_time_slice) {
+		*next_time_slice = time_slice;
+	}
+
+	return VMM_OK;
+}
+
+int vmm_schedalgo_rq_detach(void *rq, struct vmm_vcpu *vcpu)
+{
+	struct vmm_schedalgo_rq_entry *rq_entry;
+	struct vmm_schedalgo_rq *rqi = rq;
+
+	if (!vcpu || !rqi) {
+		return VMM_EFAIL;
+	}
+
+	rq_entry = vcpu->sched_priv;
+	if (!rq_entry) {
+		return VMM_EFAIL;
+	}
+
+	rb_erase(&rq_entry->rb, &rqi->root[vcpu->priority]);
+	RB_CLEAR_NODE(&rq_entry->rb);
+	rqi->count[vcpu->priority]--;
+
+	return VMM_OK;
+}
+
+int vmm_schedalgo_rq_iterate(void *rq,
+			     int (*iter)(struct vmm_vcpu *vcpu, void *priv),
+			     void *priv)
+{
+	int p, rc;
+	struct rb_node *n;
+	struct vmm_schedalgo_rq_entry *rq_entry;
+	struct vmm_schedalgo_rq *rqi = rq;
+
+	if (!rqi || !iter) {
+		return VMM_EFAIL;
+	}
+
+	for (p = VMM_VCPU_MAX_PRIORITY; p >= VMM_VCPU_MIN_PRIORITY; p--) {
+		for (n = rb_first(&rqi->root[p]); n; n = rb_next(n)) {
+			rq_entry = rb_entry(n, struct vmm_schedalgo_rq_entry,
+					    rb);
+			rc = iter(rq_entry->vcpu, priv);
+			if (rc) {
+				return rc;
+			}
+		}
+	}
+
+	return VMM_OK;
+}
+
+bool vmm_schedalgo_rq_prempt_needed(void *rq, struct vmm_vcpu *current)
+{
+	int p;
+	struct rb_node *n;
+	struct vmm_schedalgo_rq *rqi;
+	struct vmm_schedalgo_rq_entry *rq_entry, *current_e;
+
+	if (!rq || !current) {
+		return FALSE;
+	}
+
+	rqi = rq;
+
+	p = VMM_VCPU_MAX_PRIORITY;
+	while (p > current->priority) {
+		if (rqi->count[p]) {
+			return TRUE;
+		}
+		p--;
+	}
+
+	/* Ready VCPU of same priority having earlier deadline */
+	current_e = current->sched_priv;
+	n = rb_first(&rqi->root[current->priority]);
+	if (!current_e || !n) {
+		return FALSE;
+	}
+	rq_entry = rb_entry(n, struct vmm_schedalgo_rq_entry, rb);
+
+	return (rq_entry->abs_deadline < current_e->abs_deadline) ?
+		TRUE : FALSE;
+}
+
+void *vmm_schedalgo_rq_create(void)
+{
+	int p;
+	struct vmm_schedalgo_rq *rq =
+			vmm_zalloc(sizeof(struct vmm_schedalgo_rq));
+
+	if (!rq) {
+		return NULL;
+	}
+
+	for (p = 0; p <= VMM_VCPU_MAX_PRIORITY; p++) {
+		rq->count[p] = 0;
+		rq->root[p] = RB_ROOT;
+	}
+
+	return rq;
+}
+
+int vmm_schedalgo_rq_destroy(void *rq)
+{
+	if (!rq) {
+		return VMM_EFAIL;
+	}
+
+	vmm_free(rq);
+	return VMM_OK;
+}
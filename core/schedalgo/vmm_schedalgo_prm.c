@@ -187,6 +187,33 @@ int vmm_schedalgo_rq_detach(void *rq, struct vmm_vcpu *vcpu)
 	return VMM_OK;
 }
 
+int vmm_schedalgo_rq_iterate(void *rq,
+			     int (*iter)(struct vmm_vcpu *vcpu, void *priv),
+			     void *priv)
+{
+	int p, rc;
+	struct rb_node *n;
+	struct vmm_schedalgo_rq_entry *rq_entry;
+	struct vmm_schedalgo_rq *rqi = rq;
+
+	if (!rqi || !iter) {
+		return VMM_EFAIL;
+	}
+
+	for (p = VMM_VCPU_MAX_PRIORITY; p >= VMM_VCPU_MIN_PRIORITY; p--) {
+		for (n = rb_first(&rqi->root[p]); n; n = rb_next(n)) {
+			rq_entry = rb_entry(n, struct vmm_schedalgo_rq_entry,
+					    rb);
+			rc = iter(rq_entry->vcpu, priv);
+			if (rc) {
+				return rc;
+			}
+		}
+	}
+
+	return VMM_OK;
+}
+
 bool vmm_schedalgo_rq_prempt_needed(void *rq, struct vmm_vcpu *current)
 {
 	int p;
@@ -176,15 +176,17 @@ u32 vmm_vdisk_get_request_len(struct vmm_vdisk_request *vreq)
 }
 VMM_EXPORT_SYMBOL(vmm_vdisk_get_request_len);
 
-int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
-			     struct vmm_vdisk_request *vreq,
-			     enum vmm_vdisk_request_type type,
-			     u64 lba, void *data, u32 data_len)
+static int vdisk_submit_request(struct vmm_vdisk *vdisk,
+				struct vmm_vdisk_request *vreq,
+				enum vmm_vdisk_request_type type,
+				u64 lba, void *data,
+				struct vmm_request_sg *sg, u32 sg_count,
+				u32 data_len)
 {
 	int rc;
 	irq_flags_t flags;
 
-	if (!vdisk || !vreq || !data) {
+	if (!vdisk || !vreq || (!data && !sg_count) || (sg_count && !sg)) {
 		return VMM_EINVALID;
 	}
 	if (data_len < vdisk->block_size) {
@@ -203,6 +205,8 @@ int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 		vreq->r.bcnt =
 			udiv32(data_len, vdisk->block_size) * vdisk->blk_factor;
 		vreq->r.data = data;
+		vreq->r.sg = sg;
+		vreq->r.sg_count = sg_count;
 		vreq->r.completed = vdisk_req_completed;
 		vreq->r.failed = vdisk_req_failed;
 		vreq->r.priv = NULL;
@@ -213,13 +217,44 @@ int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 	}
 	vmm_spin_unlock_irqrestore_lite(&vdisk->blk_lock, flags);
 
-	DPRINTF("%s: vdisk=%s lba=0x%llx bcnt=%d rc=%d\n",
-		__func__, vdisk->name, (u64)vreq->r.lba, vreq->r.bcnt, rc);
+	DPRINTF("%s: vdisk=%s lba=0x%llx bcnt=%d sg_count=%d rc=%d\n",
+		__func__, vdisk->name, (u64)vreq->r.lba, vreq->r.bcnt,
+		sg_count, rc);
 
 	return rc;
 }
+
+int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
+			     struct vmm_vdisk_request *vreq,
+			     enum vmm_vdisk_request_type type,
+			     u64 lba, void *data, u32 data_len)
+{
+	return vdisk_submit_request(vdisk, vreq, type, lba,
+				    data, NULL, 0, data_len);
+}
 VMM_EXPORT_SYMBOL(vmm_vdisk_submit_request);
 
+int vmm_vdisk_submit_sg_request(struct vmm_vdisk *vdisk,
+				struct vmm_vdisk_request *vreq,
+				enum vmm_vdisk_request_type type,
+				u64 lba, struct vmm_request_sg *sg,
+				u32 sg_count)
+{
+	u32 i, data_len = 0;
+
+	if (!sg || !sg_count) {
+		return VMM_EINVALID;
+	}
+
+	for (i = 0; i < sg_count; i++) {
+		data_len += sg[i].len;
+	}
+
+	return vdisk_submit_request(vdisk, vreq, type, lba,
+				    NULL, sg, sg_count, data_len);
+}
+VMM_EXPORT_SYMBOL(vmm_vdisk_submit_sg_request);
+
 int vmm_vdisk_abort_request(struct vmm_vdisk *vdisk,
 			    struct vmm_vdisk_request *vreq)
 {
@@ -29,6 +29,7 @@
 #include <vmm_host_io.h>
 #include <vmm_guest_aspace.h>
 #include <vmm_modules.h>
+#include <arch_barrier.h>
 #include <vio/vmm_virtio.h>
 #include <libs/mathlib.h>
 #include <libs/stringlib.h>
@@ -111,17 +112,46 @@ u32 vmm_virtio_queue_max_desc(struct vmm_virtio_queue *vq)
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_max_desc);
 
-int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
-			      struct vmm_vring_desc *desc)
+/* Read descriptor from vring or from an indirect descriptor table */
+static int virtio_queue_read_desc(struct vmm_virtio_queue *vq,
+				  physical_addr_t table_pa, u32 indx,
+				  struct vmm_vring_desc *desc)
 {
 	u32 ret;
 	physical_addr_t desc_pa;
 
-	if (!vq || !vq->guest || !desc) {
-		return VMM_EINVALID;
+	desc_pa = table_pa + indx * sizeof(*desc);
+	ret = vmm_guest_memory_read(vq->guest, desc_pa,
+				    desc, sizeof(*desc), TRUE);
+	if (ret != sizeof(*desc)) {
+		return VMM_EIO;
 	}
 
-	desc_pa = vq->vring.desc_pa + indx * sizeof(*desc);
+	return VMM_OK;
+}
+
+/*
+ * Packed virtqueue (VIRTIO_F_RING_PACKED) has single descriptor ring
+ * shared by driver and device. The driver makes a descriptor available
+ * by flipping its AVAIL/USED flags to match driver wrap counter and
+ * device writes back used buffer ID in-place. The buffer ID (taken from
+ * last descriptor of a chain) is what emulators see as "head" so the
+ * ring position and descriptor count of each buffer ID is remembered
+ * at pop time.
+ */
+
+#define VIRTIO_PACKED_AVAIL_FLAG	(1 << VMM_VRING_PACKED_DESC_F_AVAIL)
+#define VIRTIO_PACKED_USED_FLAG		(1 << VMM_VRING_PACKED_DESC_F_USED)
+#define VIRTIO_PACKED_WRAP_FLAG		(1 << 15)
+
+static int virtio_packed_read_desc(struct vmm_virtio_queue *vq,
+				   physical_addr_t table_pa, u32 pos,
+				   struct vmm_vring_packed_desc *desc)
+{
+	u32 ret;
+	physical_addr_t desc_pa;
+
+	desc_pa = table_pa + pos * sizeof(*desc);
 	ret = vmm_guest_memory_read(vq->guest, desc_pa,
 				    desc, sizeof(*desc), TRUE);
 	if (ret != sizeof(*desc)) {
@@ -130,6 +160,328 @@ int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
 
 	return VMM_OK;
 }
+
+static inline bool virtio_packed_desc_avail(u16 flags, bool wrap_counter)
+{
+	bool avail = (flags & VIRTIO_PACKED_AVAIL_FLAG) ? TRUE : FALSE;
+	bool used = (flags & VIRTIO_PACKED_USED_FLAG) ? TRUE : FALSE;
+
+	return (avail == wrap_counter) && (used != wrap_counter);
+}
+
+static int virtio_packed_get_desc(struct vmm_virtio_queue *vq, u16 indx,
+				  struct vmm_vring_desc *desc)
+{
+	int rc;
+	struct vmm_vring_packed_desc pdesc;
+
+	if (indx >= vq->desc_count) {
+		return VMM_EINVALID;
+	}
+
+	rc = virtio_packed_read_desc(vq, vq->vring.desc_pa, indx, &pdesc);
+	if (rc) {
+		return rc;
+	}
+
+	desc->addr = pdesc.addr;
+	desc->len = pdesc.len;
+	desc->flags = pdesc.flags & (VMM_VRING_DESC_F_NEXT |
+				     VMM_VRING_DESC_F_WRITE |
+				     VMM_VRING_DESC_F_INDIRECT);
+	desc->next = ((indx + 1) < vq->desc_count) ? (indx + 1) : 0;
+
+	return VMM_OK;
+}
+
+static u16 virtio_packed_pop(struct vmm_virtio_queue *vq)
+{
+	u16 *state = vq->packed_state;
+	bool wrap_counter = vq->avail_wrap_counter;
+	u32 n = vq->desc_count, start, pos, count = 0;
+	struct vmm_vring_packed_desc desc;
+
+	/* Descriptor must be read after its flags were found available */
+	arch_smp_rmb();
+
+	/* Remember ring position and wrap counter for unpop. This is
+	 * done even on failure so that unpop after failure is a no-op.
+	 */
+	start = pos = vq->last_avail_idx;
+	state[2 * n + vq->pop_hist_idx] = pos |
+		((wrap_counter) ? VIRTIO_PACKED_WRAP_FLAG : 0);
+	vq->pop_hist_idx = ((vq->pop_hist_idx + 1) < n) ?
+			   (vq->pop_hist_idx + 1) : 0;
+
+	/* Ring position is only advanced after whole chain is valid */
+	do {
+		if (virtio_packed_read_desc(vq, vq->vring.desc_pa,
+					    pos, &desc)) {
+			vmm_printf("%s: read failed at pos=%d\n",
+				   __func__, pos);
+			return VMM_VIRTIO_QUEUE_INVALID_HEAD;
+		}
+		count++;
+		if (++pos >= n) {
+			pos = 0;
+			wrap_counter = !wrap_counter;
+		}
+	} while ((desc.flags & VMM_VRING_DESC_F_NEXT) && (count < n));
+
+	if (desc.id >= n) {
+		vmm_printf("%s: invalid buffer id=%d at pos=%d\n",
+			   __func__, desc.id, start);
+		return VMM_VIRTIO_QUEUE_INVALID_HEAD;
+	}
+
+	vq->last_avail_idx = pos;
+	vq->avail_wrap_counter = wrap_counter;
+	state[desc.id] = start;
+	state[n + desc.id] = count;
+
+	return desc.id;
+}
+
+static void virtio_packed_unpop(struct vmm_virtio_queue *vq, u16 count)
+{
+	u16 hist;
+	u32 n = vq->desc_count;
+
+	vq->pop_hist_idx = umod32(vq->pop_hist_idx + n - umod32(count, n), n);
+	hist = vq->packed_state[2 * n + vq->pop_hist_idx];
+	vq->last_avail_idx = hist & ~VIRTIO_PACKED_WRAP_FLAG;
+	vq->avail_wrap_counter = (hist & VIRTIO_PACKED_WRAP_FLAG) ?
+				 TRUE : FALSE;
+}
+
+static bool virtio_packed_available(struct vmm_virtio_queue *vq)
+{
+	u16 flags;
+	u32 ret;
+	physical_addr_t flags_pa;
+
+	flags_pa = vq->vring.desc_pa +
+		   vq->last_avail_idx * sizeof(struct vmm_vring_packed_desc) +
+		   offsetof(struct vmm_vring_packed_desc, flags);
+	ret = vmm_guest_memory_read(vq->guest, flags_pa,
+				    &flags, sizeof(flags), TRUE);
+	if (ret != sizeof(flags)) {
+		vmm_printf("%s: read failed at flags_pa=0x%"PRIPADDR"\n",
+			   __func__, flags_pa);
+		return FALSE;
+	}
+
+	return virtio_packed_desc_avail(flags, vq->avail_wrap_counter);
+}
+
+static bool virtio_packed_should_signal(struct vmm_virtio_queue *vq)
+{
+	int off;
+	u32 ret;
+	bool valid;
+	u16 old_idx, new_idx;
+	struct vmm_vring_packed_desc_event evt;
+
+	ret = vmm_guest_memory_read(vq->guest, vq->vring.avail_pa,
+				    &evt, sizeof(evt), TRUE);
+	if (ret != sizeof(evt)) {
+		vmm_printf("%s: read failed at driver_pa=0x%"PRIPADDR"\n",
+			   __func__, vq->vring.avail_pa);
+		return FALSE;
+	}
+
+	old_idx = vq->last_used_signalled;
+	new_idx = vq->last_used_signalled = vq->last_used_idx;
+	valid = vq->signalled_used_valid;
+	vq->signalled_used_valid = TRUE;
+
+	if (evt.flags == VMM_VRING_PACKED_EVENT_FLAG_DISABLE) {
+		return FALSE;
+	} else if (evt.flags == VMM_VRING_PACKED_EVENT_FLAG_ENABLE) {
+		return TRUE;
+	}
+
+	/* Event offset with other wrap counter is one ring behind */
+	off = evt.off_wrap & ~VIRTIO_PACKED_WRAP_FLAG;
+	if (((evt.off_wrap & VIRTIO_PACKED_WRAP_FLAG) ? TRUE : FALSE) !=
+	    vq->used_wrap_counter) {
+		off -= vq->desc_count;
+	}
+
+	return !valid || vmm_vring_need_event(off, new_idx, old_idx);
+}
+
+static void virtio_packed_set_used_elems(struct vmm_virtio_queue *vq,
+				const struct vmm_vring_used_elem *elems,
+				u32 count)
+{
+	u16 first_flags = 0;
+	u32 i, ret, wlen, used = 0, n = vq->desc_count;
+	u32 pos = vq->last_used_idx, first_pos = vq->last_used_idx;
+	struct vmm_vring_packed_desc desc;
+	physical_addr_t desc_pa;
+
+	for (i = 0; i < count; i++) {
+		if (elems[i].id >= n) {
+			vmm_printf("%s: invalid buffer id=%d\n",
+				   __func__, elems[i].id);
+			continue;
+		}
+
+		desc.len = elems[i].len;
+		desc.id = elems[i].id;
+		desc.flags = 0;
+		if (vq->used_wrap_counter) {
+			desc.flags = VIRTIO_PACKED_AVAIL_FLAG |
+				     VIRTIO_PACKED_USED_FLAG;
+		}
+
+		/*
+		 * Driver does not look beyond first used descriptor until
+		 * its flags are updated so flags of other descriptors are
+		 * written along with buffer ID and length.
+		 */
+		wlen = offsetof(struct vmm_vring_packed_desc, flags) -
+		       offsetof(struct vmm_vring_packed_desc, len);
+		if (used) {
+			wlen += sizeof(desc.flags);
+		} else {
+			first_flags = desc.flags;
+		}
+		desc_pa = vq->vring.desc_pa + pos * sizeof(desc) +
+			  offsetof(struct vmm_vring_packed_desc, len);
+		ret = vmm_guest_memory_write(vq->guest, desc_pa,
+					     &desc.len, wlen, TRUE);
+		if (ret != wlen) {
+			vmm_printf("%s: write failed at desc_pa=0x%"PRIPADDR
+				   "\n", __func__, desc_pa);
+		}
+		used++;
+
+		pos += (vq->packed_state[n + desc.id]) ?
+			vq->packed_state[n + desc.id] : 1;
+		if (pos >= n) {
+			pos -= n;
+			vq->used_wrap_counter = !vq->used_wrap_counter;
+		}
+	}
+
+	if (!used) {
+		return;
+	}
+
+	/* Buffer ID and length must be visible before flags */
+	arch_smp_wmb();
+
+	desc_pa = vq->vring.desc_pa + first_pos * sizeof(desc) +
+		  offsetof(struct vmm_vring_packed_desc, flags);
+	ret = vmm_guest_memory_write(vq->guest, desc_pa,
+				     &first_flags, sizeof(first_flags), TRUE);
+	if (ret != sizeof(first_flags)) {
+		vmm_printf("%s: write failed at desc_pa=0x%"PRIPADDR"\n",
+			   __func__, desc_pa);
+	}
+
+	vq->last_used_idx = pos;
+}
+
+static int virtio_packed_get_head_iovec(struct vmm_virtio_queue *vq,
+					u16 head, struct vmm_virtio_iovec *iov,
+					u32 *ret_iov_cnt, u32 *ret_total_len)
+{
+	int rc;
+	u32 i, pos, count, max = vq->desc_count;
+	physical_addr_t table_pa = vq->vring.desc_pa;
+	struct vmm_vring_packed_desc desc;
+
+	if (head >= max) {
+		vmm_printf("%s: invalid buffer id=%d\n", __func__, head);
+		return VMM_EINVALID;
+	}
+	pos = vq->packed_state[head];
+	count = vq->packed_state[max + head];
+
+	rc = virtio_packed_read_desc(vq, table_pa, pos, &desc);
+	if (rc) {
+		vmm_printf("%s: failed to get descriptor pos=%d error=%d\n",
+			   __func__, pos, rc);
+		return rc;
+	}
+
+	/* Indirect table is walked sequentially and can't be chained */
+	if (desc.flags & VMM_VRING_DESC_F_INDIRECT) {
+		if ((count != 1) || !desc.len || (desc.len % sizeof(desc)) ||
+		    (max < (desc.len / sizeof(desc)))) {
+			vmm_printf("%s: invalid indirect descriptor id=%d "
+				   "len=%d\n", __func__, head, desc.len);
+			return VMM_EINVALID;
+		}
+		max = count = desc.len / sizeof(desc);
+		table_pa = desc.addr;
+		pos = 0;
+
+		rc = virtio_packed_read_desc(vq, table_pa, pos, &desc);
+		if (rc) {
+			vmm_printf("%s: failed to get indirect descriptor "
+				   "error=%d\n", __func__, rc);
+			return rc;
+		}
+	}
+
+	i = 0;
+	while (1) {
+		if (desc.flags & VMM_VRING_DESC_F_INDIRECT) {
+			vmm_printf("%s: invalid descriptor chain id=%d\n",
+				   __func__, head);
+			return VMM_EINVALID;
+		}
+
+		iov[i].addr = desc.addr;
+		iov[i].len = desc.len;
+		iov[i].flags = (desc.flags & VMM_VRING_DESC_F_WRITE) ? 1 : 0;
+		if (ret_total_len) {
+			*ret_total_len += desc.len;
+		}
+
+		if (++i >= count) {
+			break;
+		}
+		if (++pos >= max) {
+			pos = 0;
+		}
+
+		rc = virtio_packed_read_desc(vq, table_pa, pos, &desc);
+		if (rc) {
+			vmm_printf("%s: failed to get descriptor pos=%d "
+				   "error=%d\n", __func__, pos, rc);
+			return rc;
+		}
+	}
+
+	if (ret_iov_cnt) {
+		*ret_iov_cnt = i;
+	}
+
+	return VMM_OK;
+}
+
+int vmm_virtio_queue_get_desc(struct vmm_virtio_queue *vq, u16 indx,
+			      struct vmm_vring_desc *desc)
+{
+	if (!vq || !vq->guest || !desc) {
+		return VMM_EINVALID;
+	}
+
+	if (vq->packed) {
+		return virtio_packed_get_desc(vq, indx, desc);
+	}
+
+	if (indx >= vq->desc_count) {
+		return VMM_EINVALID;
+	}
+
+	return virtio_queue_read_desc(vq, vq->vring.desc_pa, indx, desc);
+}
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_get_desc);
 
 u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq)
@@ -139,7 +491,11 @@ u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq)
 	physical_addr_t avail_pa;
 
 	if (!vq || !vq->guest) {
-		return 0;
+		return VMM_VIRTIO_QUEUE_INVALID_HEAD;
+	}
+
+	if (vq->packed) {
+		return virtio_packed_pop(vq);
 	}
 
 	ret = umod32(vq->last_avail_idx++, vq->desc_count);
@@ -151,13 +507,34 @@ u16 vmm_virtio_queue_pop(struct vmm_virtio_queue *vq)
 	if (ret != sizeof(val)) {
 		vmm_printf("%s: read failed at avail_pa=0x%"PRIPADDR"\n",
 			   __func__, avail_pa);
-		return 0;
+		return VMM_VIRTIO_QUEUE_INVALID_HEAD;
+	}
+
+	if (val >= vq->desc_count) {
+		vmm_printf("%s: invalid head=%d\n", __func__, val);
+		return VMM_VIRTIO_QUEUE_INVALID_HEAD;
 	}
 
 	return val;
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_pop);
 
+void vmm_virtio_queue_unpop(struct vmm_virtio_queue *vq, u16 count)
+{
+	if (!vq || !vq->guest || !count) {
+		return;
+	}
+
+	if (vq->packed) {
+		virtio_packed_unpop(vq, count);
+		return;
+	}
+
+	vq->last_avail_idx -= count;
+	vmm_virtio_queue_set_avail_event(vq);
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_queue_unpop);
+
 bool vmm_virtio_queue_available(struct vmm_virtio_queue *vq)
 {
 	u16 val;
@@ -168,6 +545,10 @@ bool vmm_virtio_queue_available(struct vmm_virtio_queue *vq)
 		return FALSE;
 	}
 
+	if (vq->packed) {
+		return virtio_packed_available(vq);
+	}
+
 	avail_pa = vq->vring.avail_pa +
 		   offsetof(struct vmm_vring_avail, idx);
 	ret = vmm_guest_memory_read(vq->guest, avail_pa,
@@ -192,6 +573,10 @@ bool vmm_virtio_queue_should_signal(struct vmm_virtio_queue *vq)
 		return FALSE;
 	}
 
+	if (vq->packed) {
+		return virtio_packed_should_signal(vq);
+	}
+
 	old_idx = vq->last_used_signalled;
 
 	used_pa = vq->vring.used_pa +
@@ -229,7 +614,10 @@ void vmm_virtio_queue_set_avail_event(struct vmm_virtio_queue *vq)
 	u32 ret;
 	physical_addr_t avail_evt_pa;
 
-	if (!vq || !vq->guest) {
+	/* Packed ring: device event suppression area is left zeroed
+	 * (i.e. notifications always enabled).
+	 */
+	if (!vq || !vq->guest || vq->packed) {
 		return;
 	}
 
@@ -258,6 +646,13 @@ void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 		return;
 	}
 
+	if (vq->packed) {
+		used_elem.id = head;
+		used_elem.len = len;
+		virtio_packed_set_used_elems(vq, &used_elem, 1);
+		return;
+	}
+
 	used_idx_pa = vq->vring.used_pa +
 		      offsetof(struct vmm_vring_used, idx);
 	ret = vmm_guest_memory_read(vq->guest, used_idx_pa,
@@ -289,6 +684,62 @@ void vmm_virtio_queue_set_used_elem(struct vmm_virtio_queue *vq,
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_set_used_elem);
 
+void vmm_virtio_queue_set_used_elems(struct vmm_virtio_queue *vq,
+				     const struct vmm_vring_used_elem *elems,
+				     u32 count)
+{
+	u32 ret, pos, len;
+	u16 used_idx;
+	physical_addr_t used_idx_pa, used_elem_pa;
+
+	if (!vq || !vq->guest || !elems || !count) {
+		return;
+	}
+
+	if (vq->packed) {
+		virtio_packed_set_used_elems(vq, elems, count);
+		return;
+	}
+
+	used_idx_pa = vq->vring.used_pa +
+		      offsetof(struct vmm_vring_used, idx);
+	ret = vmm_guest_memory_read(vq->guest, used_idx_pa,
+				    &used_idx, sizeof(used_idx), TRUE);
+	if (ret != sizeof(used_idx)) {
+		vmm_printf("%s: read failed at used_idx_pa=0x%"PRIPADDR"\n",
+			   __func__, used_idx_pa);
+	}
+
+	/* Write used elements in at most two chunks (ring wrap-around) */
+	pos = umod32(used_idx, vq->vring.num);
+	while (count) {
+		len = vq->vring.num - pos;
+		len = (count < len) ? count : len;
+		used_elem_pa = vq->vring.used_pa +
+			       offsetof(struct vmm_vring_used, ring[pos]);
+		ret = vmm_guest_memory_write(vq->guest, used_elem_pa,
+					     (void *)elems,
+					     len * sizeof(*elems), TRUE);
+		if (ret != (len * sizeof(*elems))) {
+			vmm_printf("%s: write failed at "
+				   "used_elem_pa=0x%"PRIPADDR"\n",
+				   __func__, used_elem_pa);
+		}
+		used_idx += len;
+		elems += len;
+		count -= len;
+		pos = 0;
+	}
+
+	ret = vmm_guest_memory_write(vq->guest, used_idx_pa,
+				     &used_idx, sizeof(used_idx), TRUE);
+	if (ret != sizeof(used_idx)) {
+		vmm_printf("%s: write failed at used_idx_pa=0x%"PRIPADDR"\n",
+			   __func__, used_idx_pa);
+	}
+}
+VMM_EXPORT_SYMBOL(vmm_virtio_queue_set_used_elems);
+
 bool vmm_virtio_queue_setup_done(struct vmm_virtio_queue *vq)
 {
 	return (vq) ? ((vq->guest) ? TRUE : FALSE) : FALSE;
@@ -304,6 +755,17 @@ int vmm_virtio_queue_cleanup(struct vmm_virtio_queue *vq)
 	vq->last_avail_idx = 0;
 	vq->last_used_signalled = 0;
 
+	vq->packed = FALSE;
+	vq->avail_wrap_counter = FALSE;
+	vq->used_wrap_counter = FALSE;
+	vq->signalled_used_valid = FALSE;
+	vq->last_used_idx = 0;
+	vq->pop_hist_idx = 0;
+	if (vq->packed_state) {
+		vmm_free(vq->packed_state);
+		vq->packed_state = NULL;
+	}
+
 	vq->guest = NULL;
 
 	vq->desc_count = 0;
@@ -320,18 +782,105 @@ done:
 }
 VMM_EXPORT_SYMBOL(vmm_virtio_queue_cleanup);
 
+/* Check that given guest area is entirely backed by guest RAM */
+static int virtio_queue_map_area(struct vmm_guest *guest,
+				 physical_addr_t gphys_addr,
+				 physical_size_t gphys_size,
+				 physical_addr_t *hphys_addr)
+{
+	u32 reg_flags;
+	physical_size_t avail_size;
+
+	if (vmm_guest_physical_map(guest, gphys_addr, gphys_size,
+				   hphys_addr, &avail_size, &reg_flags)) {
+		vmm_printf("%s: vmm_guest_physical_map() failed\n", __func__);
+		return VMM_EFAIL;
+	}
+
+	if (!(reg_flags & VMM_REGION_ISRAM)) {
+		vmm_printf("%s: region is not backed by RAM\n", __func__);
+		return VMM_EINVALID;
+	}
+
+	if (avail_size < gphys_size) {
+		vmm_printf("%s: available size less than required size\n",
+			   __func__);
+		return VMM_EINVALID;
+	}
+
+	return VMM_OK;
+}
+
+/* Setup queue from separate descriptor, driver, and device areas */
+static int virtio_queue_setup_layout(struct vmm_virtio_queue *vq,
+				     struct vmm_virtio_queue_layout *layout,
+				     struct vmm_guest *guest, u32 desc_count,
+				     physical_addr_t *hphys_addr)
+{
+	int rc;
+	physical_addr_t hphys;
+	physical_size_t desc_size, driver_size, device_size;
+
+	if (layout->packed) {
+		desc_size = desc_count * sizeof(struct vmm_vring_packed_desc);
+		driver_size = sizeof(struct vmm_vring_packed_desc_event);
+		device_size = sizeof(struct vmm_vring_packed_desc_event);
+	} else {
+		desc_size = desc_count * sizeof(struct vmm_vring_desc);
+		driver_size = offsetof(struct vmm_vring_avail,
+				       ring[desc_count]) + sizeof(u16);
+		device_size = offsetof(struct vmm_vring_used,
+				       ring[desc_count]) + sizeof(u16);
+	}
+
+	rc = virtio_queue_map_area(guest, layout->desc_addr,
+				   desc_size, hphys_addr);
+	if (rc) {
+		return rc;
+	}
+	rc = virtio_queue_map_area(guest, layout->driver_addr,
+				   driver_size, &hphys);
+	if (rc) {
+		return rc;
+	}
+	rc = virtio_queue_map_area(guest, layout->device_addr,
+				   device_size, &hphys);
+	if (rc) {
+		return rc;
+	}
+
+	if (layout->packed) {
+		vq->packed_state = vmm_zalloc(3 * desc_count * sizeof(u16));
+		if (!vq->packed_state) {
+			return VMM_ENOMEM;
+		}
+		vq->packed = TRUE;
+		vq->avail_wrap_counter = TRUE;
+		vq->used_wrap_counter = TRUE;
+	}
+
+	vq->vring.num = desc_count;
+	vq->vring.desc = NULL;
+	vq->vring.desc_pa = layout->desc_addr;
+	vq->vring.avail = NULL;
+	vq->vring.avail_pa = layout->driver_addr;
+	vq->vring.used = NULL;
+	vq->vring.used_pa = layout->device_addr;
+
+	return VMM_OK;
+}
+
 int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
-			   struct vmm_guest *guest,
+			   struct vmm_virtio_device *dev,
 			   physical_addr_t guest_pfn,
 			   physical_size_t guest_page_size,
 			   u32 desc_count, u32 align)
 {
 	int rc = VMM_OK;
-	u32 reg_flags;
 	physical_addr_t gphys_addr, hphys_addr;
-	physical_size_t gphys_size, avail_size;
+	physical_size_t gphys_size;
 
-	if (!vq || !guest) {
+	if (!vq || !dev || !dev->guest) {
 		return VMM_EFAIL;
 	}
 
@@ -340,30 +889,38 @@ int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
 		return rc;
 	}
 
-	gphys_addr = guest_pfn * guest_page_size;
-	gphys_size = vmm_vring_size(desc_count, align);
+	if (dev->layout.valid) {
+		/* Guest can choose smaller queue size */
+		if (dev->layout.num && (dev->layout.num < desc_count)) {
+			desc_count = dev->layout.num;
+		}
 
-	if ((rc = vmm_guest_physical_map(guest, gphys_addr, gphys_size,
-					 &hphys_addr, &avail_size,
-					 &reg_flags))) {
-		vmm_printf("%s: vmm_guest_physical_map() failed\n", __func__);
-		return VMM_EFAIL;
-	}
+		rc = virtio_queue_setup_layout(vq, &dev->layout, dev->guest,
+					       desc_count, &hphys_addr);
+		if (rc) {
+			return rc;
+		}
 
-	if (!(reg_flags & VMM_REGION_ISRAM)) {
-		vmm_printf("%s: region is not backed by RAM\n", __func__);
-		return VMM_EINVALID;
-	}
+		/* Areas are not contiguous so only descriptors are counted */
+		gphys_addr = dev->layout.desc_addr;
+		gphys_size = desc_count * ((vq->packed) ?
+				sizeof(struct vmm_vring_packed_desc) :
+				sizeof(struct vmm_vring_desc));
+	} else {
+		gphys_addr = guest_pfn * guest_page_size;
+		gphys_size = vmm_vring_size(desc_count, align);
+
+		rc = virtio_queue_map_area(dev->guest, gphys_addr,
+					   gphys_size, &hphys_addr);
+		if (rc) {
+			return rc;
+		}
 
-	if (avail_size < gphys_size) {
-		vmm_printf("%s: available size less than required size\n",
-			   __func__);
-		return VMM_EINVALID;
+		vmm_vring_init(&vq->vring, desc_count, NULL,
+			       gphys_addr, align);
 	}
 
-	vmm_vring_init(&vq->vring, desc_count, NULL, gphys_addr, align);
-
-	vq->guest = guest;
+	vq->guest = dev->guest;
 	vq->desc_count = desc_count;
 	vq->align = align;
 	vq->guest_pfn = guest_pfn;
@@ -379,30 +936,39 @@ VMM_EXPORT_SYMBOL(vmm_virtio_queue_setup);
 
 /*
  * Each buffer in the virtqueues is actually a chain of descriptors.  This
- * function returns the next descriptor in the chain, max descriptor count
- * if we're at the end.
+ * function reads the next descriptor in the chain and updates index to it,
+ * or to max descriptor count if we're at the end.
  */
-static unsigned next_desc(struct vmm_virtio_queue *vq,
-			  struct vmm_vring_desc *desc,
-			  u32 i, u32 max)
+static int next_desc(struct vmm_virtio_queue *vq,
+		     physical_addr_t table_pa,
+		     struct vmm_vring_desc *desc,
+		     u16 *idx, u16 max)
 {
 	int rc;
 	u32 next;
 
 	if (!(desc->flags & VMM_VRING_DESC_F_NEXT)) {
-		return max;
+		*idx = max;
+		return VMM_OK;
 	}
 
 	next = desc->next;
+	if (next >= max) {
+		vmm_printf("%s: invalid descriptor next=%d max=%d\n",
+			   __func__, next, max);
+		return VMM_EINVALID;
+	}
 
-	rc = vmm_virtio_queue_get_desc(vq, next, desc);
+	rc = virtio_queue_read_desc(vq, table_pa, next, desc);
 	if (rc) {
 		vmm_printf("%s: failed to get descriptor next=%d error=%d\n",
 			   __func__, next, rc);
-		return max;
+		return rc;
 	}
 
-	return next;
+	*idx = next;
+
+	return VMM_OK;
 }
 
 int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
@@ -412,6 +978,7 @@ int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 {
 	int i, rc = VMM_OK;
 	u16 idx, max;
+	physical_addr_t table_pa;
 	struct vmm_vring_desc desc;
 
 	if (!vq || !vq->guest || !iov) {
@@ -430,7 +997,17 @@ int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 		*ret_head = 0;
 	}
 
+	if (vq->packed) {
+		rc = virtio_packed_get_head_iovec(vq, head, iov,
+						  ret_iov_cnt, ret_total_len);
+		if (rc) {
+			goto fail;
+		}
+		goto done;
+	}
+
 	max = vmm_virtio_queue_max_desc(vq);
+	table_pa = vq->vring.desc_pa;
 
 	rc = vmm_virtio_queue_get_desc(vq, idx, &desc);
 	if (rc) {
@@ -439,20 +1016,42 @@ int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 		goto fail;
 	}
 
+	/*
+	 * Indirect descriptor points to a table of descriptors in
+	 * guest memory which is walked instead of vring descriptors.
+	 * The iovec array of emulator has one entry for each vring
+	 * descriptor so bigger tables are not allowed.
+	 */
 	if (desc.flags & VMM_VRING_DESC_F_INDIRECT) {
-#if 0
-		max = desc[idx].len / sizeof(struct vring_desc);
-		desc = guest_flat_to_host(kvm, desc[idx].addr);
+		if (!desc.len || (desc.len % sizeof(desc)) ||
+		    (max < (desc.len / sizeof(desc)))) {
+			vmm_printf("%s: invalid indirect descriptor idx=%d "
+				   "len=%d\n", __func__, idx, desc.len);
+			rc = VMM_EINVALID;
+			goto fail;
+		}
+		max = desc.len / sizeof(desc);
+		table_pa = desc.addr;
 		idx = 0;
-#endif
-		vmm_printf("%s: indirect descriptor not supported idx=%d\n",
-			   __func__, idx);
-		rc = VMM_ENOTSUPP;
-		goto fail;
+
+		rc = virtio_queue_read_desc(vq, table_pa, idx, &desc);
+		if (rc) {
+			vmm_printf("%s: failed to get indirect descriptor "
+				   "error=%d\n", __func__, rc);
+			goto fail;
+		}
 	}
 
 	i = 0;
 	do {
+		/* Descriptor chain loop or nested indirect is invalid */
+		if ((i >= max) || (desc.flags & VMM_VRING_DESC_F_INDIRECT)) {
+			vmm_printf("%s: invalid descriptor chain head=%d\n",
+				   __func__, head);
+			rc = VMM_EINVALID;
+			goto fail;
+		}
+
 		iov[i].addr = desc.addr;
 		iov[i].len = desc.len;
 
@@ -467,7 +1066,12 @@ int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 		}
 
 		i++;
-	} while ((idx = next_desc(vq, &desc, idx, max)) != max);
+
+		rc = next_desc(vq, table_pa, &desc, &idx, max);
+		if (rc) {
+			goto fail;
+		}
+	} while (idx != max);
 
 	if (ret_iov_cnt) {
 		*ret_iov_cnt = i;
@@ -475,6 +1079,7 @@ int vmm_virtio_queue_get_head_iovec(struct vmm_virtio_queue *vq,
 
 	vmm_virtio_queue_set_avail_event(vq);
 
+done:
 	if (ret_head) {
 		*ret_head = head;
 	}
@@ -499,6 +1104,16 @@ int vmm_virtio_queue_get_iovec(struct vmm_virtio_queue *vq,
 {
 	u16 head = vmm_virtio_queue_pop(vq);
 
+	if (head == VMM_VIRTIO_QUEUE_INVALID_HEAD) {
+		if (ret_iov_cnt) {
+			*ret_iov_cnt = 0;
+		}
+		if (ret_total_len) {
+			*ret_total_len = 0;
+		}
+		return VMM_EINVALID;
+	}
+
 	return vmm_virtio_queue_get_head_iovec(vq, head, iov,
 					       ret_iov_cnt, ret_total_len,
 					       ret_head);
@@ -602,6 +1217,9 @@ static int __virtio_connect_emulator(struct vmm_virtio_device *dev,
 
 static void __virtio_disconnect_emulator(struct vmm_virtio_device *dev)
 {
+	/* Reset so that emulator cleans up its queues */
+	__virtio_reset_emulator(dev);
+
 	if (dev && dev->emu && dev->emu->disconnect) {
 		dev->emu->disconnect(dev);
 	}
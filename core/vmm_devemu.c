@@ -27,6 +27,8 @@
 #include <vmm_host_io.h>
 #include <vmm_host_irq.h>
 #include <vmm_mutex.h>
+#include <vmm_threads.h>
+#include <vmm_workqueue.h>
 #include <vmm_guest_aspace.h>
 #include <vmm_devemu.h>
 #include <vmm_devemu_debug.h>
@@ -38,9 +40,19 @@ struct vmm_devemu_guest_irq {
 	void *opaque;
 };
 
+#define DEVEMU_DOORBELL_HASH_SIZE	32
+
 struct vmm_devemu_guest_context {
 	u32 g_irq_count;
 	struct dlist *g_irq;
+	vmm_rwlock_t db_lock;
+	u32 db_count;
+	struct dlist db_hash[DEVEMU_DOORBELL_HASH_SIZE];
+	vmm_spinlock_t db_pending_lock;
+	struct dlist db_pending;
+	vmm_spinlock_t db_run_lock;
+	struct vmm_work db_work;
+	struct vmm_workqueue *db_wq;
 };
 
 struct vmm_devemu_ctrl {
@@ -412,6 +424,214 @@ static int devemu_dowrite(struct vmm_emudev *edev,
 	return rc;
 }
 
+static inline u32 devemu_doorbell_hash(physical_addr_t gphys_addr)
+{
+	return ((u32)(gphys_addr >> 2) ^ (u32)(gphys_addr >> 12)) &
+		(DEVEMU_DOORBELL_HASH_SIZE - 1);
+}
+
+static bool devemu_doorbell(struct vmm_vcpu *vcpu, bool is_io,
+			    physical_addr_t gphys_addr,
+			    void *src, u32 src_len,
+			    enum vmm_devemu_endianness src_endian)
+{
+	u64 value;
+	bool found = FALSE;
+	irq_flags_t flags;
+	struct vmm_devemu_doorbell *db;
+	struct vmm_devemu_guest_context *eg = vcpu->guest->aspace.devemu_priv;
+
+	if (!eg || !eg->db_count) {
+		return FALSE;
+	}
+
+	switch (src_len) {
+	case 1:
+		value = *(u8 *)src;
+		break;
+	case 2:
+		value = *(u16 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			value = vmm_le16_to_cpu((u16)value);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			value = vmm_be16_to_cpu((u16)value);
+		}
+		break;
+	case 4:
+		value = *(u32 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			value = vmm_le32_to_cpu((u32)value);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			value = vmm_be32_to_cpu((u32)value);
+		}
+		break;
+	case 8:
+		value = *(u64 *)src;
+		if (src_endian == VMM_DEVEMU_LITTLE_ENDIAN) {
+			value = vmm_le64_to_cpu(value);
+		} else if (src_endian == VMM_DEVEMU_BIG_ENDIAN) {
+			value = vmm_be64_to_cpu(value);
+		}
+		break;
+	default:
+		return FALSE;
+	};
+
+	vmm_read_lock_irqsave_lite(&eg->db_lock, flags);
+
+	list_for_each_entry(db,
+		&eg->db_hash[devemu_doorbell_hash(gphys_addr)], head) {
+		if ((db->gphys_addr != gphys_addr) ||
+		    (db->len != src_len) ||
+		    (((db->flags & VMM_DEVEMU_DOORBELL_IO) ? TRUE : FALSE) !=
+								is_io)) {
+			continue;
+		}
+		if ((db->flags & VMM_DEVEMU_DOORBELL_MATCH_VALUE) &&
+		    (db->value != value)) {
+			continue;
+		}
+
+		if (db->flags & VMM_DEVEMU_DOORBELL_DEFERRED) {
+			vmm_spin_lock(&eg->db_pending_lock);
+			db->last_value = value;
+			if (!db->pending) {
+				db->pending = TRUE;
+				list_add_tail(&db->pending_head,
+					      &eg->db_pending);
+			}
+			vmm_spin_unlock(&eg->db_pending_lock);
+			vmm_workqueue_schedule_work(eg->db_wq, &eg->db_work);
+		} else {
+			db->handle(db, value);
+		}
+		found = TRUE;
+		break;
+	}
+
+	vmm_read_unlock_irqrestore_lite(&eg->db_lock, flags);
+
+	return found;
+}
+
+static void devemu_doorbell_work(struct vmm_work *work)
+{
+	u64 value;
+	irq_flags_t flags;
+	struct vmm_devemu_doorbell *db;
+	struct vmm_devemu_guest_context *eg =
+		container_of(work, struct vmm_devemu_guest_context, db_work);
+
+	while (1) {
+		/* Handler runs with db_run_lock held so that unregister
+		 * can wait for it without sleeping.
+		 */
+		vmm_spin_lock(&eg->db_run_lock);
+
+		vmm_spin_lock_irqsave(&eg->db_pending_lock, flags);
+		if (list_empty(&eg->db_pending)) {
+			vmm_spin_unlock_irqrestore(&eg->db_pending_lock, flags);
+			vmm_spin_unlock(&eg->db_run_lock);
+			break;
+		}
+		db = list_first_entry(&eg->db_pending,
+				      struct vmm_devemu_doorbell, pending_head);
+		list_del_init(&db->pending_head);
+		db->pending = FALSE;
+		value = db->last_value;
+		vmm_spin_unlock_irqrestore(&eg->db_pending_lock, flags);
+
+		db->handle(db, value);
+
+		vmm_spin_unlock(&eg->db_run_lock);
+	}
+}
+
+int vmm_devemu_register_doorbell(struct vmm_guest *guest,
+				 struct vmm_devemu_doorbell *db)
+{
+	irq_flags_t flags;
+	struct vmm_devemu_doorbell *tdb;
+	struct vmm_devemu_guest_context *eg;
+
+	if (!guest || !db || !db->handle) {
+		return VMM_EINVALID;
+	}
+	if ((db->len != 1) && (db->len != 2) &&
+	    (db->len != 4) && (db->len != 8)) {
+		return VMM_EINVALID;
+	}
+	eg = guest->aspace.devemu_priv;
+	if (!eg) {
+		return VMM_EINVALID;
+	}
+
+	INIT_LIST_HEAD(&db->head);
+	INIT_LIST_HEAD(&db->pending_head);
+	db->pending = FALSE;
+	db->guest = guest;
+	db->last_value = 0;
+
+	vmm_write_lock_irqsave_lite(&eg->db_lock, flags);
+
+	list_for_each_entry(tdb,
+		&eg->db_hash[devemu_doorbell_hash(db->gphys_addr)], head) {
+		if ((tdb->gphys_addr != db->gphys_addr) ||
+		    (tdb->len != db->len) ||
+		    ((tdb->flags ^ db->flags) & VMM_DEVEMU_DOORBELL_IO)) {
+			continue;
+		}
+		if (!(tdb->flags & VMM_DEVEMU_DOORBELL_MATCH_VALUE) ||
+		    !(db->flags & VMM_DEVEMU_DOORBELL_MATCH_VALUE) ||
+		    (tdb->value == db->value)) {
+			vmm_write_unlock_irqrestore_lite(&eg->db_lock, flags);
+			return VMM_EEXIST;
+		}
+	}
+
+	list_add_tail(&db->head,
+		      &eg->db_hash[devemu_doorbell_hash(db->gphys_addr)]);
+	eg->db_count++;
+
+	vmm_write_unlock_irqrestore_lite(&eg->db_lock, flags);
+
+	return VMM_OK;
+}
+
+int vmm_devemu_unregister_doorbell(struct vmm_devemu_doorbell *db)
+{
+	irq_flags_t flags;
+	struct vmm_devemu_guest_context *eg;
+
+	if (!db || !db->guest) {
+		return VMM_EINVALID;
+	}
+	eg = db->guest->aspace.devemu_priv;
+	if (!eg) {
+		return VMM_EINVALID;
+	}
+
+	vmm_write_lock_irqsave_lite(&eg->db_lock, flags);
+	list_del(&db->head);
+	eg->db_count--;
+	vmm_write_unlock_irqrestore_lite(&eg->db_lock, flags);
+
+	if (db->flags & VMM_DEVEMU_DOORBELL_DEFERRED) {
+		/* Wait for in-progress handler and drop pending one */
+		vmm_spin_lock(&eg->db_run_lock);
+		vmm_spin_lock_irqsave(&eg->db_pending_lock, flags);
+		if (db->pending) {
+			list_del_init(&db->pending_head);
+			db->pending = FALSE;
+		}
+		vmm_spin_unlock_irqrestore(&eg->db_pending_lock, flags);
+		vmm_spin_unlock(&eg->db_run_lock);
+	}
+	db->guest = NULL;
+
+	return VMM_OK;
+}
+
 int vmm_devemu_emulate_read(struct vmm_vcpu *vcpu,
 			    physical_addr_t gphys_addr,
 			    void *dst, u32 dst_len,
@@ -457,6 +677,11 @@ int vmm_devemu_emulate_write(struct vmm_vcpu *vcpu,
 		return VMM_EFAIL;
 	}
 
+	if (devemu_doorbell(vcpu, FALSE, gphys_addr,
+			    src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
 	reg = vmm_guest_find_region(vcpu->guest, gphys_addr,
 			VMM_REGION_VIRTUAL | VMM_REGION_MEMORY, FALSE);
 	if (!reg) {
@@ -523,6 +748,11 @@ int vmm_devemu_emulate_iowrite(struct vmm_vcpu *vcpu,
 		return VMM_EFAIL;
 	}
 
+	if (devemu_doorbell(vcpu, TRUE, gphys_addr,
+			    src, src_len, src_endian)) {
+		return VMM_OK;
+	}
+
 	reg = vmm_guest_find_region(vcpu->guest, gphys_addr,
 			VMM_REGION_VIRTUAL | VMM_REGION_IO, FALSE);
 	if (!reg) {
@@ -1380,6 +1610,7 @@ int vmm_devemu_init_context(struct vmm_guest *guest)
 	u32 ite;
 	int rc = VMM_OK;
 	struct vmm_devemu_guest_context *eg;
+	char name[VMM_FIELD_NAME_SIZE];
 
 	if (!guest) {
 		rc = VMM_EFAIL;
@@ -1413,10 +1644,32 @@ int vmm_devemu_init_context(struct vmm_guest *guest)
 		INIT_LIST_HEAD(&eg->g_irq[ite]);
 	}
 
+	INIT_RW_LOCK(&eg->db_lock);
+	eg->db_count = 0;
+	for (ite = 0; ite < DEVEMU_DOORBELL_HASH_SIZE; ite++) {
+		INIT_LIST_HEAD(&eg->db_hash[ite]);
+	}
+	INIT_SPIN_LOCK(&eg->db_pending_lock);
+	INIT_LIST_HEAD(&eg->db_pending);
+	INIT_SPIN_LOCK(&eg->db_run_lock);
+	INIT_WORK(&eg->db_work, devemu_doorbell_work);
+
+	/* Deferred doorbells are registered from VCPU context where
+	 * workqueue creation is not possible so create it upfront.
+	 */
+	vmm_snprintf(name, sizeof(name), "%s/doorbell", guest->name);
+	eg->db_wq = vmm_workqueue_create(name, VMM_THREAD_DEF_PRIORITY);
+	if (!eg->db_wq) {
+		rc = VMM_ENOMEM;
+		goto devemu_init_context_free_irq;
+	}
+
 	guest->aspace.devemu_priv = eg;
 
 	goto devemu_init_context_done;
 
+devemu_init_context_free_irq:
+	vmm_free(eg->g_irq);
 devemu_init_context_free:
 	vmm_free(eg);
 devemu_init_context_done:
@@ -1442,6 +1695,11 @@ int vmm_devemu_deinit_context(struct vmm_guest *guest)
 			eg->g_irq_count = 0;
 		}
 
+		if (eg->db_wq) {
+			vmm_workqueue_destroy(eg->db_wq);
+			eg->db_wq = NULL;
+		}
+
 		vmm_free(eg);
 	}
 
@@ -27,6 +27,7 @@
 
 #include <vmm_error.h>
 #include <vmm_heap.h>
+#include <vmm_percpu.h>
 #include <vmm_devtree.h>
 #include <vmm_devemu.h>
 #include <vmm_host_ram.h>
@@ -34,12 +35,164 @@
 #include <vmm_guest_aspace.h>
 #include <vmm_stdio.h>
 #include <vmm_notifier.h>
+#include <arch_atomic.h>
+#include <arch_atomic64.h>
+#include <arch_barrier.h>
+#include <arch_cpu_irq.h>
 #include <arch_guest.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
+#include <libs/bitops.h>
 
 static BLOCKING_NOTIFIER_CHAIN(guest_aspace_notifier_chain);
 
+/* Maximum length of alias chain resolved at region add/del time */
+#define REGION_ALIAS_MAX_DEPTH		8
+
+/* Generation of all region trees. Incremented with region tree
+ * write lock held whenever a region is added or removed so that
+ * stale region cache enteries are never used.
+ */
+static atomic_t region_gen = ARCH_ATOMIC_INITIALIZER(0);
+
+struct region_cache_entry {
+	struct vmm_guest_aspace *aspace;
+	bool is_io;
+	long gen;
+	struct vmm_region *reg;
+};
+
+/* Per-CPU cache of last found regions */
+struct region_cache {
+	u32 next;
+	struct region_cache_entry ent[CONFIG_VGPA2REG_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct region_cache, rcache);
+
+static struct vmm_region *region_cache_find(struct vmm_guest_aspace *aspace,
+					    bool is_io,
+					    physical_addr_t gphys_addr)
+{
+	u32 i;
+	long gen;
+	irq_flags_t flags;
+	struct region_cache *rc;
+	struct region_cache_entry *e;
+	struct vmm_region *reg = NULL;
+
+	gen = arch_atomic_read(&region_gen);
+
+	arch_cpu_irq_save(flags);
+	rc = &this_cpu(rcache);
+	for (i = 0; i < CONFIG_VGPA2REG_CACHE_SIZE; i++) {
+		e = &rc->ent[i];
+		if ((e->aspace != aspace) || (e->is_io != is_io) ||
+		    (e->gen != gen)) {
+			continue;
+		}
+		if ((VMM_REGION_GPHYS_START(e->reg) <= gphys_addr) &&
+		    (gphys_addr < VMM_REGION_GPHYS_END(e->reg))) {
+			reg = e->reg;
+			break;
+		}
+	}
+	arch_cpu_irq_restore(flags);
+
+	/* Discard hit if region trees changed meanwhile */
+	arch_smp_rmb();
+	if (reg && (arch_atomic_read(&region_gen) != gen)) {
+		reg = NULL;
+	}
+
+	return reg;
+}
+
+static void region_cache_update(struct vmm_guest_aspace *aspace,
+				bool is_io, long gen,
+				struct vmm_region *reg)
+{
+	irq_flags_t flags;
+	struct region_cache *rc;
+	struct region_cache_entry *e;
+
+	arch_cpu_irq_save(flags);
+	rc = &this_cpu(rcache);
+	e = &rc->ent[rc->next];
+	e->aspace = aspace;
+	e->is_io = is_io;
+	e->gen = gen;
+	e->reg = reg;
+	rc->next = (rc->next + 1) % CONFIG_VGPA2REG_CACHE_SIZE;
+	arch_cpu_irq_restore(flags);
+}
+
+/* Note: Must be called with region tree lock held */
+static struct vmm_region *__region_tree_find(struct rb_root *root,
+					     physical_addr_t gphys_addr)
+{
+	struct rb_node *pos = root->rb_node;
+	struct vmm_region *reg;
+
+	while (pos) {
+		reg = rb_entry(pos, struct vmm_region, head);
+		if (gphys_addr < VMM_REGION_GPHYS_START(reg)) {
+			pos = pos->rb_left;
+		} else if (VMM_REGION_GPHYS_END(reg) <= gphys_addr) {
+			pos = pos->rb_right;
+		} else {
+			return reg;
+		}
+	}
+
+	return NULL;
+}
+
+/* Note: Must be called with region tree write lock held */
+static void __region_tree_changed(struct rb_root *root)
+{
+	u32 depth, aflags;
+	physical_addr_t start, last;
+	struct rb_node *pos;
+	struct vmm_region *reg, *areg;
+
+	/* Resolve alias regions whose entire range ends-up in one region */
+	for (pos = rb_first(root); pos; pos = rb_next(pos)) {
+		reg = rb_entry(pos, struct vmm_region, head);
+		if (!(reg->flags & VMM_REGION_ALIAS)) {
+			continue;
+		}
+
+		areg = reg;
+		aflags = reg->flags;
+		start = VMM_REGION_GPHYS_START(reg);
+		last = VMM_REGION_GPHYS_END(reg) - 1;
+		for (depth = 0; depth < REGION_ALIAS_MAX_DEPTH; depth++) {
+			start = VMM_REGION_GPHYS_TO_APHYS(areg, start);
+			last = VMM_REGION_GPHYS_TO_APHYS(areg, last);
+			areg = __region_tree_find(root, start);
+			if (!areg || (VMM_REGION_GPHYS_END(areg) - 1) < last) {
+				areg = NULL;
+				break;
+			}
+			aflags &= areg->flags;
+			if (!(areg->flags & VMM_REGION_ALIAS)) {
+				break;
+			}
+		}
+		if (areg && (areg->flags & VMM_REGION_ALIAS)) {
+			areg = NULL;
+		}
+
+		reg->alias_reg = areg;
+		reg->alias_flags = aflags;
+	}
+
+	/* Invalidate region cache of all CPUs */
+	arch_smp_wmb();
+	arch_atomic_add(&region_gen, 1);
+}
+
 int vmm_guest_aspace_register_client(struct vmm_notifier_block *nb)
 {
 	int rc = vmm_blocking_notifier_register(&guest_aspace_notifier_chain,
@@ -96,12 +249,12 @@ struct vmm_region *vmm_guest_find_region(struct vmm_guest *guest,
 					 physical_addr_t gphys_addr,
 					 u32 reg_flags, bool resolve_alias)
 {
-	bool found = FALSE;
+	bool is_io;
+	long gen;
 	u32 cmp_flags;
 	irq_flags_t flags;
 	vmm_rwlock_t *root_lock = NULL;
 	struct rb_root *root = NULL;
-	struct rb_node *pos = NULL;
 	struct vmm_region *reg = NULL;
 	struct vmm_guest_aspace *aspace;
 
@@ -114,7 +267,8 @@ struct vmm_region *vmm_guest_find_region(struct vmm_guest *guest,
 	cmp_flags = reg_flags & ~VMM_REGION_MANIFEST_MASK;
 
 	/* Find out region tree root */
-	if (reg_flags & VMM_REGION_IO) {
+	is_io = (reg_flags & VMM_REGION_IO) ? TRUE : FALSE;
+	if (is_io) {
 		root = &aspace->reg_iotree;
 		root_lock = &aspace->reg_iotree_lock;
 	} else {
@@ -123,55 +277,42 @@ struct vmm_region *vmm_guest_find_region(struct vmm_guest *guest,
 	}
 
 	/* Try to find region ignoring required manifest flags */
-	reg = NULL;
-	found = FALSE;
-	vmm_read_lock_irqsave_lite(root_lock, flags);
-	pos = root->rb_node;
-	while (pos) {
-		reg = rb_entry(pos, struct vmm_region, head);
-		if (gphys_addr < VMM_REGION_GPHYS_START(reg)) {
-			pos = pos->rb_left;
-		} else if (VMM_REGION_GPHYS_END(reg) <= gphys_addr) {
-			pos = pos->rb_right;
-		} else {
-			if ((reg->flags & cmp_flags) == cmp_flags) {
-				found = TRUE;
-			}
-			break;
+	reg = region_cache_find(aspace, is_io, gphys_addr);
+	if (!reg) {
+		vmm_read_lock_irqsave_lite(root_lock, flags);
+		gen = arch_atomic_read(&region_gen);
+		reg = __region_tree_find(root, gphys_addr);
+		vmm_read_unlock_irqrestore_lite(root_lock, flags);
+		if (!reg) {
+			return NULL;
 		}
+		region_cache_update(aspace, is_io, gen, reg);
 	}
-	vmm_read_unlock_irqrestore_lite(root_lock, flags);
-	if (!found) {
+	if ((reg->flags & cmp_flags) != cmp_flags) {
 		return NULL;
 	}
 
 	/* Check if we can skip resolve alias */
-	if (!resolve_alias) {
+	if (!resolve_alias || !(reg->flags & VMM_REGION_ALIAS)) {
+		goto done;
+	}
+
+	/* Use alias resolved at region add/del time */
+	if (reg->alias_reg) {
+		if ((reg->alias_flags & cmp_flags) != cmp_flags) {
+			return NULL;
+		}
+		reg = reg->alias_reg;
 		goto done;
 	}
 
 	/* Resolve aliased regions */
 	while (reg->flags & VMM_REGION_ALIAS) {
 		gphys_addr = VMM_REGION_GPHYS_TO_APHYS(reg, gphys_addr);
-		reg = NULL;
-		found = FALSE;
 		vmm_read_lock_irqsave_lite(root_lock, flags);
-		pos = root->rb_node;
-		while (pos) {
-			reg = rb_entry(pos, struct vmm_region, head);
-			if (gphys_addr < VMM_REGION_GPHYS_START(reg)) {
-				pos = pos->rb_left;
-			} else if (VMM_REGION_GPHYS_END(reg) <= gphys_addr) {
-				pos = pos->rb_right;
-			} else {
-				if ((reg->flags & cmp_flags) == cmp_flags) {
-					found = TRUE;
-				}
-				break;
-			}
-		}
+		reg = __region_tree_find(root, gphys_addr);
 		vmm_read_unlock_irqrestore_lite(root_lock, flags);
-		if (!found) {
+		if (!reg || ((reg->flags & cmp_flags) != cmp_flags)) {
 			return NULL;
 		}
 	}
@@ -231,6 +372,307 @@ static struct vmm_region_mapping *mapping_find(struct vmm_guest *guest,
 	return &reg->maps[i];
 }
 
+static virtual_addr_t mapping_linear_va(struct vmm_guest *guest,
+					struct vmm_region *reg,
+					physical_addr_t gphys_addr)
+{
+	u32 i;
+	struct vmm_region_mapping *map;
+
+	map = mapping_find(guest, reg, &i, gphys_addr);
+	if (!map || !(map->flags & VMM_REGION_MAPPING_ISLINEAR)) {
+		return 0;
+	}
+
+	return map->hvirt_addr +
+	       (gphys_addr - (reg->gphys_addr + mapping_gphys_offset(reg, i)));
+}
+
+#ifdef CONFIG_GUEST_RAM_LINEAR_MAP
+static inline virtual_addr_t mapping_linear_memmap(physical_addr_t hpa,
+						   physical_size_t size)
+{
+	return vmm_host_memmap_linear(hpa, size);
+}
+
+static void mapping_linear_map(struct vmm_guest *guest,
+			       struct vmm_region *reg, u32 map_index)
+{
+	virtual_addr_t va;
+
+	/* Mappings which can't be linearly mapped (for example, when
+	 * VAPOOL is exhausted) will use slow-path of copying via
+	 * vmm_host_memory_read() and vmm_host_memory_write().
+	 */
+	va = vmm_host_memmap_linear(reg->maps[map_index].hphys_addr,
+				    mapping_phys_size(reg, map_index));
+	if (!va) {
+		return;
+	}
+	reg->maps[map_index].hvirt_addr = va;
+	reg->maps[map_index].flags |= VMM_REGION_MAPPING_ISLINEAR;
+}
+
+static void mapping_linear_map_all(struct vmm_guest *guest,
+				   struct vmm_region *reg)
+{
+	u32 i;
+
+	if ((reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) ||
+	    !(reg->flags & VMM_REGION_MEMORY) ||
+	    !(reg->flags & VMM_REGION_ISRAM)) {
+		return;
+	}
+
+	for (i = 0; i < reg->maps_count; i++) {
+		/* On-demand mappings are linearly mapped when populated */
+		if ((reg->flags & VMM_REGION_ISONDEMAND) &&
+		    !(reg->maps[i].flags & VMM_REGION_MAPPING_ISHOSTRAM)) {
+			continue;
+		}
+		mapping_linear_map(guest, reg, i);
+	}
+}
+#else
+static inline virtual_addr_t mapping_linear_memmap(physical_addr_t hpa,
+						   physical_size_t size)
+{
+	return 0;
+}
+
+static inline void mapping_linear_map(struct vmm_guest *guest,
+				      struct vmm_region *reg, u32 map_index)
+{
+}
+
+static void mapping_linear_map_all(struct vmm_guest *guest,
+				   struct vmm_region *reg)
+{
+}
+#endif
+
+#ifdef CONFIG_GUEST_RAM_ONDEMAND
+/* Host RAM used by on-demand guest RAM of all guests */
+static DEFINE_SPINLOCK(ondemand_lock);
+static physical_size_t ondemand_size;
+
+static physical_size_t ondemand_limit(void)
+{
+	return udiv64(vmm_host_ram_total_size(), 100) *
+	       CONFIG_GUEST_RAM_ONDEMAND_LIMIT_PERCENT;
+}
+
+static bool ondemand_account(struct vmm_guest *guest, physical_size_t size)
+{
+	bool ret = FALSE;
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&ondemand_lock, flags);
+	if ((ondemand_size + size) <= ondemand_limit()) {
+		ondemand_size += size;
+		guest->aspace.ondemand_size += size;
+		ret = TRUE;
+	}
+	vmm_spin_unlock_irqrestore_lite(&ondemand_lock, flags);
+
+	return ret;
+}
+
+static void ondemand_unaccount(struct vmm_guest *guest, physical_size_t size)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&ondemand_lock, flags);
+	ondemand_size -= size;
+	guest->aspace.ondemand_size -= size;
+	vmm_spin_unlock_irqrestore_lite(&ondemand_lock, flags);
+}
+
+static void mapping_ondemand_setup(struct vmm_guest *guest,
+				   struct vmm_region *reg)
+{
+	u32 hshift = vmm_host_hugepage_shift();
+
+	if ((reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) ||
+	    !(reg->flags & VMM_REGION_ISRAM) ||
+	    !(reg->flags & VMM_REGION_ISALLOCED) ||
+	    !vmm_devtree_getattr(reg->node, VMM_DEVTREE_ONDEMAND_ATTR_NAME)) {
+		return;
+	}
+
+	/* Stage2 blocks of on-demand region never span more than one
+	 * hugepage so hugepage aligned region ensures that a Stage2
+	 * block lies within one mapping.
+	 */
+	if (reg->gphys_addr & (((physical_addr_t)1 << hshift) - 1)) {
+		vmm_printf("%s: %s/%s not hugepage aligned hence "
+			   "allocating entire region\n", __func__,
+			   guest->name, reg->node->name);
+		return;
+	}
+
+	reg->flags |= VMM_REGION_ISONDEMAND;
+	reg->map_order = hshift;
+}
+
+static bool mapping_ondemand_populate(struct vmm_guest *guest,
+				      struct vmm_region *reg, u32 map_index)
+{
+	bool lost;
+	irq_flags_t flags;
+	virtual_addr_t va;
+	physical_addr_t hpa;
+	physical_size_t size;
+	struct vmm_region_mapping *map = &reg->maps[map_index];
+
+	if (test_bit(map_index, reg->ondemand_bmap)) {
+		/* Pairs with arch_smp_wmb() below */
+		arch_smp_rmb();
+		return TRUE;
+	}
+
+	size = mapping_phys_size(reg, map_index);
+
+	/* Allocate and zero host RAM without holding on-demand lock
+	 * because this can take long for a hugepage sized mapping.
+	 */
+	if (!ondemand_account(guest, size)) {
+		vmm_printf("%s: %s/%s on-demand host RAM limit reached\n",
+			   __func__, guest->name, reg->node->name);
+		return FALSE;
+	}
+
+	if (!vmm_host_ram_alloc(&hpa, size, reg->map_order)) {
+		ondemand_unaccount(guest, size);
+		vmm_printf("%s: Failed to alloc host RAM for %s/%s\n",
+			   __func__, guest->name, reg->node->name);
+		return FALSE;
+	}
+
+	/* Don't leak previous contents of host RAM to guest */
+	va = mapping_linear_memmap(hpa, size);
+	if (va) {
+		memset((void *)va, 0, size);
+	} else {
+		vmm_host_memory_set(hpa, 0, size, FALSE);
+	}
+
+	/* Publish the mapping unless some other CPU already did it */
+	vmm_spin_lock_irqsave_lite(&reg->ondemand_lock, flags);
+	lost = test_bit(map_index, reg->ondemand_bmap) ? TRUE : FALSE;
+	if (!lost) {
+		map->hphys_addr = hpa;
+		map->flags |= VMM_REGION_MAPPING_ISHOSTRAM;
+		if (va) {
+			map->hvirt_addr = va;
+			map->flags |= VMM_REGION_MAPPING_ISLINEAR;
+		}
+		arch_smp_wmb();
+		set_bit(map_index, reg->ondemand_bmap);
+	}
+	vmm_spin_unlock_irqrestore_lite(&reg->ondemand_lock, flags);
+
+	if (lost) {
+		if (va) {
+			vmm_host_memunmap_linear(va, size);
+		}
+		vmm_host_ram_free(hpa, size);
+		ondemand_unaccount(guest, size);
+		/* Pairs with arch_smp_wmb() above */
+		arch_smp_rmb();
+	}
+
+	return TRUE;
+}
+
+static void mapping_ondemand_cleanup(struct vmm_guest *guest,
+				     struct vmm_region *reg)
+{
+	u32 i;
+	physical_size_t size = 0;
+
+	if (!reg->ondemand_bmap) {
+		return;
+	}
+
+	for (i = 0; i < reg->maps_count; i++) {
+		if (test_bit(i, reg->ondemand_bmap)) {
+			size += mapping_phys_size(reg, i);
+		}
+	}
+	if (size) {
+		ondemand_unaccount(guest, size);
+	}
+
+	vmm_free(reg->ondemand_bmap);
+	reg->ondemand_bmap = NULL;
+}
+
+int vmm_guest_ondemand_ram_usage(struct vmm_guest *guest,
+				 physical_size_t *used,
+				 physical_size_t *limit)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&ondemand_lock, flags);
+	if (used) {
+		*used = (guest) ? guest->aspace.ondemand_size : ondemand_size;
+	}
+	vmm_spin_unlock_irqrestore_lite(&ondemand_lock, flags);
+
+	if (limit) {
+		*limit = ondemand_limit();
+	}
+
+	return VMM_OK;
+}
+#else
+static void mapping_ondemand_setup(struct vmm_guest *guest,
+				   struct vmm_region *reg)
+{
+}
+
+static bool mapping_ondemand_populate(struct vmm_guest *guest,
+				      struct vmm_region *reg, u32 map_index)
+{
+	return FALSE;
+}
+
+static void mapping_ondemand_cleanup(struct vmm_guest *guest,
+				     struct vmm_region *reg)
+{
+}
+
+int vmm_guest_ondemand_ram_usage(struct vmm_guest *guest,
+				 physical_size_t *used,
+				 physical_size_t *limit)
+{
+	return VMM_ENOTAVAIL;
+}
+#endif
+
+static void mapping_linear_unmap_all(struct vmm_guest *guest,
+				     struct vmm_region *reg)
+{
+	u32 i;
+	int rc;
+
+	for (i = 0; i < reg->maps_count; i++) {
+		if (!(reg->maps[i].flags & VMM_REGION_MAPPING_ISLINEAR))
+			continue;
+		rc = vmm_host_memunmap_linear(reg->maps[i].hvirt_addr,
+					      mapping_phys_size(reg, i));
+		if (rc) {
+			vmm_printf("%s: Failed to unmap linear mapping "
+				   "for %s/%s (error %d)\n",
+				   __func__, guest->name,
+				   reg->node->name, rc);
+		}
+		reg->maps[i].hvirt_addr = 0;
+		reg->maps[i].flags &= ~VMM_REGION_MAPPING_ISLINEAR;
+	}
+}
+
 void vmm_guest_find_mapping(struct vmm_guest *guest,
 			    struct vmm_region *reg,
 			    physical_addr_t gphys_addr,
@@ -251,6 +693,10 @@ void vmm_guest_find_mapping(struct vmm_guest *guest,
 	if (!map) {
 		goto done;
 	}
+	if ((reg->flags & VMM_REGION_ISONDEMAND) &&
+	    !mapping_ondemand_populate(guest, reg, i)) {
+		goto done;
+	}
 	map_gphys_addr = reg->gphys_addr + mapping_gphys_offset(reg, i);
 
 	hphys = map->hphys_addr + (gphys_addr - map_gphys_addr);
@@ -282,6 +728,10 @@ void vmm_guest_iterate_mapping(struct vmm_guest *guest,
 	}
 
 	for (i = 0; i < reg->maps_count; i++) {
+		if ((reg->flags & VMM_REGION_ISONDEMAND) &&
+		    !test_bit(i, reg->ondemand_bmap)) {
+			continue;
+		}
 		func(guest, reg,
 		     reg->gphys_addr + mapping_gphys_offset(reg, i),
 		     reg->maps[i].hphys_addr,
@@ -322,6 +772,7 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 	u32 bytes_read = 0, to_read;
 	physical_size_t avail_size;
 	physical_addr_t hphys_addr;
+	virtual_addr_t hvirt_addr;
 	struct vmm_region *reg = NULL;
 
 	if (!guest || !dst || !len) {
@@ -341,8 +792,14 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 		to_read = ((len - bytes_read) < to_read) ?
 			  (len - bytes_read) : to_read;
 
-		to_read = vmm_host_memory_read(hphys_addr,
-					       dst, to_read, cacheable);
+		hvirt_addr = (cacheable) ?
+			mapping_linear_va(guest, reg, gphys_addr) : 0;
+		if (hvirt_addr) {
+			memcpy(dst, (void *)hvirt_addr, to_read);
+		} else {
+			to_read = vmm_host_memory_read(hphys_addr,
+						dst, to_read, cacheable);
+		}
 		if (!to_read) {
 			break;
 		}
@@ -362,6 +819,7 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 	u32 bytes_written = 0, to_write;
 	physical_size_t avail_size;
 	physical_addr_t hphys_addr;
+	virtual_addr_t hvirt_addr;
 	struct vmm_region *reg = NULL;
 
 	if (!guest || !src || !len) {
@@ -381,8 +839,14 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 		to_write = ((len - bytes_written) < to_write) ?
 			   (len - bytes_written) : to_write;
 
-		to_write = vmm_host_memory_write(hphys_addr,
-						 src, to_write, cacheable);
+		hvirt_addr = (cacheable) ?
+			mapping_linear_va(guest, reg, gphys_addr) : 0;
+		if (hvirt_addr) {
+			memcpy((void *)hvirt_addr, src, to_write);
+		} else {
+			to_write = vmm_host_memory_write(hphys_addr,
+						src, to_write, cacheable);
+		}
 		if (!to_write) {
 			break;
 		}
@@ -914,6 +1378,9 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
+	/* Setup on-demand host RAM allocation for alloced RAM regions */
+	mapping_ondemand_setup(guest, reg);
+
 	/* Overwrite mapping order for colored RAM/ROM regions */
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
@@ -934,6 +1401,15 @@ static int region_add(struct vmm_guest *guest,
 		rc = VMM_ENOMEM;
 		goto region_dref_shm_fail;
 	}
+	INIT_SPIN_LOCK(&reg->ondemand_lock);
+	if (reg->flags & VMM_REGION_ISONDEMAND) {
+		reg->ondemand_bmap = vmm_zalloc(sizeof(unsigned long) *
+					BITS_TO_LONGS(reg->maps_count));
+		if (!reg->ondemand_bmap) {
+			rc = VMM_ENOMEM;
+			goto region_free_maps_fail;
+		}
+	}
 	reg->maps[0].hphys_addr = reg->gphys_addr +
 				  mapping_gphys_offset(reg, 0);
 	reg->maps[0].flags = 0;
@@ -999,10 +1475,13 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
-	/* Allocate host RAM for alloced RAM/ROM regions */
+	/* Allocate host RAM for alloced RAM/ROM regions
+	 * Note: On-demand regions are populated on first access
+	 */
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
-	    (reg->flags & VMM_REGION_ISALLOCED)) {
+	    (reg->flags & VMM_REGION_ISALLOCED) &&
+	    !(reg->flags & VMM_REGION_ISONDEMAND)) {
 		for (i = 0; i < reg->maps_count; i++) {
 			if (!vmm_host_ram_alloc(&reg->maps[i].hphys_addr,
 						mapping_phys_size(reg, i),
@@ -1052,6 +1531,9 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
+	/* Linear map RAM regions for faster guest memory read/write */
+	mapping_linear_map_all(guest, reg);
+
 	/* Probe device emulation for real & virtual device regions */
 	if ((reg->flags & VMM_REGION_ISDEVICE) &&
 	    !(reg->flags & VMM_REGION_ALIAS)) {
@@ -1095,6 +1577,7 @@ static int region_add(struct vmm_guest *guest,
 	}
 	rb_link_node(&reg->head, pnode, new);
 	rb_insert_color(&reg->head, root);
+	__region_tree_changed(root);
 	if (add_probe_list) {
 		list_add_tail(&reg->phead, root_plist);
 	}
@@ -1114,6 +1597,7 @@ region_unprobe_fail:
 		vmm_devemu_remove_region(guest, reg);
 	}
 region_ram_free_fail:
+	mapping_linear_unmap_all(guest, reg);
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM))) {
 		for (i = 0; i < reg->maps_count; i++) {
@@ -1127,6 +1611,7 @@ region_ram_free_fail:
 		}
 	}
 region_free_maps_fail:
+	mapping_ondemand_cleanup(guest, reg);
 	vmm_free(reg->maps);
 region_dref_shm_fail:
 	if (reg->shm) {
@@ -1164,6 +1649,7 @@ static int region_del(struct vmm_guest *guest,
 		}
 		vmm_write_lock_irqsave_lite(root_lock, flags);
 		rb_erase(&reg->head, root);
+		__region_tree_changed(root);
 		vmm_write_unlock_irqrestore_lite(root_lock, flags);
 	}
 
@@ -1193,6 +1679,9 @@ static int region_del(struct vmm_guest *guest,
 		vmm_devemu_remove_region(guest, reg);
 	}
 
+	/* Remove linear mappings of region */
+	mapping_linear_unmap_all(guest, reg);
+
 	/* Free host RAM if region has alloced/reserved host RAM */
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM))) {
@@ -1213,6 +1702,7 @@ static int region_del(struct vmm_guest *guest,
 	}
 
 	/* Free region mappings */
+	mapping_ondemand_cleanup(guest, reg);
 	vmm_free(reg->maps);
 
 	/* De-reference shared memory */
@@ -1230,6 +1720,100 @@ static int region_del(struct vmm_guest *guest,
 	return rc;
 }
 
+void vmm_guest_stage2_fault_account(struct vmm_guest *guest, u32 map_count)
+{
+	if (!guest) {
+		return;
+	}
+
+	arch_atomic64_inc(&guest->aspace.stage2_fault_count);
+	if (map_count) {
+		arch_atomic64_add(&guest->aspace.stage2_fault_map_count,
+				  map_count);
+	}
+}
+
+void vmm_guest_stage2_prefault_account(struct vmm_guest *guest,
+				       u32 map_count)
+{
+	if (!guest || !map_count) {
+		return;
+	}
+
+	arch_atomic64_add(&guest->aspace.stage2_prefault_map_count,
+			  map_count);
+}
+
+int vmm_guest_stage2_stats(struct vmm_guest *guest,
+			   struct vmm_guest_stage2_stats *stats)
+{
+	if (!guest || !stats) {
+		return VMM_EINVALID;
+	}
+
+	stats->fault_count =
+		arch_atomic64_read(&guest->aspace.stage2_fault_count);
+	stats->fault_map_count =
+		arch_atomic64_read(&guest->aspace.stage2_fault_map_count);
+	stats->prefault_map_count =
+		arch_atomic64_read(&guest->aspace.stage2_prefault_map_count);
+
+	return VMM_OK;
+}
+
+static void aspace_stage2_policy_init(struct vmm_guest_aspace *aspace)
+{
+	const char *attr;
+
+	aspace->stage2_map_policy = VMM_GUEST_STAGE2_MAP_FAULT;
+	if (!vmm_devtree_read_string(aspace->node,
+			VMM_DEVTREE_STAGE2_MAP_ATTR_NAME, &attr)) {
+		if (!strcmp(attr, VMM_DEVTREE_STAGE2_MAP_VAL_FAULT_AROUND)) {
+			aspace->stage2_map_policy =
+					VMM_GUEST_STAGE2_MAP_FAULT_AROUND;
+		} else if (!strcmp(attr, VMM_DEVTREE_STAGE2_MAP_VAL_PREFAULT)) {
+			aspace->stage2_map_policy =
+					VMM_GUEST_STAGE2_MAP_PREFAULT;
+		} else if (strcmp(attr, VMM_DEVTREE_STAGE2_MAP_VAL_FAULT)) {
+			vmm_printf("%s: %s/aspace invalid %s=%s\n", __func__,
+				   aspace->guest->name,
+				   VMM_DEVTREE_STAGE2_MAP_ATTR_NAME, attr);
+		}
+	}
+
+	/* Number of fault-around blocks is limited to avoid long
+	 * fault handling and rounded-down to power of 2 so that
+	 * fault-around window is naturally aligned.
+	 */
+	if (vmm_devtree_read_u32(aspace->node,
+			VMM_DEVTREE_STAGE2_FAULT_AROUND_ATTR_NAME,
+			&aspace->stage2_fault_around)) {
+		aspace->stage2_fault_around =
+				VMM_GUEST_STAGE2_FAULT_AROUND_DEFAULT;
+	}
+	if (!aspace->stage2_fault_around) {
+		aspace->stage2_fault_around = 1;
+	}
+	if (aspace->stage2_fault_around > VMM_GUEST_STAGE2_FAULT_AROUND_MAX) {
+		vmm_printf("%s: %s/aspace %s=%d clamped to %d\n", __func__,
+			   aspace->guest->name,
+			   VMM_DEVTREE_STAGE2_FAULT_AROUND_ATTR_NAME,
+			   aspace->stage2_fault_around,
+			   VMM_GUEST_STAGE2_FAULT_AROUND_MAX);
+		aspace->stage2_fault_around =
+				VMM_GUEST_STAGE2_FAULT_AROUND_MAX;
+	}
+	while (aspace->stage2_fault_around &
+	       (aspace->stage2_fault_around - 1)) {
+		aspace->stage2_fault_around &=
+				(aspace->stage2_fault_around - 1);
+	}
+
+	ARCH_ATOMIC64_INIT(&aspace->stage2_fault_count, 0);
+	ARCH_ATOMIC64_INIT(&aspace->stage2_fault_map_count, 0);
+	ARCH_ATOMIC64_INIT(&aspace->stage2_prefault_map_count, 0);
+}
+
 int vmm_guest_aspace_reset(struct vmm_guest *guest)
 {
 	irq_flags_t flags;
@@ -1531,6 +2115,7 @@ int vmm_guest_aspace_init(struct vmm_guest *guest)
 	aspace->reg_memtree = RB_ROOT;
 	INIT_LIST_HEAD(&aspace->reg_memprobe_list);
 	guest->aspace.devemu_priv = NULL;
+	aspace_stage2_policy_init(aspace);
 
 	/* Initialize device emulation context */
 	if ((rc = vmm_devemu_init_context(guest))) {
@@ -1605,6 +2190,7 @@ int vmm_guest_aspace_deinit(struct vmm_guest *guest)
 
 		/* Remove region from tree */
 		rb_erase(&reg->head, root);
+		__region_tree_changed(root);
 
 		/* Delete the region */
 		vmm_write_unlock_irqrestore_lite(root_lock, flags);
@@ -1626,6 +2212,7 @@ int vmm_guest_aspace_deinit(struct vmm_guest *guest)
 
 		/* Remove region from tree */
 		rb_erase(&reg->head, root);
+		__region_tree_changed(root);
 
 		/* Delete the region */
 		vmm_write_unlock_irqrestore_lite(root_lock, flags);
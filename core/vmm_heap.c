@@ -27,12 +27,82 @@
 #include <vmm_error.h>
 #include <vmm_cache.h>
 #include <vmm_heap.h>
+#include <vmm_smp.h>
 #include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
 #include <vmm_host_vapool.h>
 #include <vmm_host_aspace.h>
+#include <arch_cpu_irq.h>
 #include <libs/stringlib.h>
+#include <libs/list.h>
 #include <libs/buddy.h>
 
+#define HEAP_MIN_BIN		(VMM_CACHE_LINE_SHIFT)
+#define HEAP_MAX_BIN		(VMM_PAGE_SHIFT)
+
+#ifdef CONFIG_HEAP_MAGAZINE
+
+/*
+ * Small allocations (from HEAP_MIN_BIN upto page size) are served from
+ * per-CPU magazines of free objects. Objects are carved out of slab
+ * pages allocated from buddy allocator. Magazines exchange half of their
+ * objects with a per-size-class depot when they become empty or full
+ * and fully free slab pages in depot are given back to buddy allocator.
+ *
+ * Depot keeps free objects in per-slab-page free lists and links slab
+ * pages having free objects in a list where fully free slab pages are
+ * always at the tail. This keeps all depot operations O(1) per object
+ * or per slab page given back.
+ */
+
+#define HEAP_CACHE_CLASSES	(HEAP_MAX_BIN - HEAP_MIN_BIN + 1)
+#define HEAP_MAGAZINE_SIZE	(CONFIG_HEAP_MAGAZINE_SIZE)
+#define HEAP_MAGAZINE_BATCH	(HEAP_MAGAZINE_SIZE / 2)
+
+/* Number of objects of given bin in a slab page */
+#define HEAP_SLAB_OBJS(bin)	(1UL << (VMM_PAGE_SHIFT - (bin)))
+
+/* Depot is shrunk when it has more free objects than this */
+#define HEAP_DEPOT_LIMIT(bin)	(4 * HEAP_MAGAZINE_SIZE + HEAP_SLAB_OBJS(bin))
+
+struct heap_magazine {
+	u32 count;
+	u64 alloc_hit;
+	u64 alloc_miss;
+	u64 free_hit;
+	u64 free_miss;
+	void *objs[HEAP_MAGAZINE_SIZE];
+};
+
+struct heap_depot {
+	vmm_spinlock_t lock;
+	/* Slab pages having free objects in depot */
+	struct dlist page_list;
+	u32 count;
+	u32 slab_pages;
+};
+
+struct heap_slab_page {
+	/* Zero for pages not used as slab page */
+	u8 bin;
+	/* Number of free objects of this page in depot */
+	u16 depot_count;
+	/* Free objects of this page in depot */
+	void *free;
+	/* Entry in depot page list when depot_count is non-zero */
+	struct dlist head;
+};
+
+struct heap_cache {
+	bool enabled;
+	struct heap_slab_page *pages;
+	unsigned long page_count;
+	struct heap_magazine *mags;
+	struct heap_depot depots[HEAP_CACHE_CLASSES];
+};
+
+#endif
+
 struct vmm_heap_control {
 	struct buddy_allocator ba;
 	void *hk_start;
@@ -42,13 +112,414 @@ struct vmm_heap_control {
 	void *heap_start;
 	physical_addr_t heap_start_pa;
 	unsigned long heap_size;
+#ifdef CONFIG_HEAP_MAGAZINE
+	struct heap_cache cache;
+#endif
 };
 
 static struct vmm_heap_control normal_heap;
 static struct vmm_heap_control dma_heap;
 
-#define HEAP_MIN_BIN		(VMM_CACHE_LINE_SHIFT)
-#define HEAP_MAX_BIN		(VMM_PAGE_SHIFT)
+#ifdef CONFIG_HEAP_MAGAZINE
+
+static inline struct heap_slab_page *heap_cache_page(
+					struct vmm_heap_control *heap,
+					const void *ptr)
+{
+	return &heap->cache.pages[((unsigned long)ptr -
+			(unsigned long)heap->mem_start) >> VMM_PAGE_SHIFT];
+}
+
+static inline void *heap_cache_page_addr(struct vmm_heap_control *heap,
+					 struct heap_slab_page *pg)
+{
+	return heap->mem_start +
+		((unsigned long)(pg - heap->cache.pages) << VMM_PAGE_SHIFT);
+}
+
+/* Note: Must be called with depot lock held */
+static void __heap_depot_put(struct vmm_heap_control *heap,
+			     struct heap_depot *d, unsigned long bin,
+			     void *obj)
+{
+	struct heap_slab_page *pg = heap_cache_page(heap, obj);
+
+	*(void **)obj = pg->free;
+	pg->free = obj;
+	d->count++;
+
+	/* Partially free pages are used first and fully free pages
+	 * are kept at tail of depot page list for shrinking.
+	 */
+	if (!pg->depot_count++) {
+		list_add(&pg->head, &d->page_list);
+	}
+	if (pg->depot_count == HEAP_SLAB_OBJS(bin)) {
+		list_move_tail(&pg->head, &d->page_list);
+	}
+}
+
+/* Note: Must be called with depot lock held */
+static void *__heap_depot_get(struct vmm_heap_control *heap,
+			      struct heap_depot *d)
+{
+	void *obj;
+	struct heap_slab_page *pg;
+
+	if (list_empty(&d->page_list)) {
+		return NULL;
+	}
+	pg = list_first_entry(&d->page_list, struct heap_slab_page, head);
+
+	obj = pg->free;
+	pg->free = *(void **)obj;
+	d->count--;
+	if (!--pg->depot_count) {
+		list_del(&pg->head);
+	}
+
+	return obj;
+}
+
+/* Note: Must be called with depot lock held */
+static void __heap_depot_shrink(struct vmm_heap_control *heap,
+				struct heap_depot *d, unsigned long bin)
+{
+	int rc;
+	struct heap_slab_page *pg;
+
+	/* Give fully free slab pages at tail of depot page list
+	 * back to buddy allocator till depot is within its limit.
+	 */
+	while ((d->count > HEAP_DEPOT_LIMIT(bin)) &&
+	       !list_empty(&d->page_list)) {
+		pg = list_last_entry(&d->page_list,
+				     struct heap_slab_page, head);
+		if (pg->depot_count < HEAP_SLAB_OBJS(bin)) {
+			break;
+		}
+
+		list_del(&pg->head);
+		d->count -= pg->depot_count;
+		d->slab_pages--;
+		pg->bin = 0;
+		pg->depot_count = 0;
+		pg->free = NULL;
+		rc = buddy_mem_free(&heap->ba,
+			(unsigned long)heap_cache_page_addr(heap, pg));
+		if (rc) {
+			vmm_printf("%s: Failed to free slab page (error %d)\n",
+				   __func__, rc);
+		}
+	}
+}
+
+static void heap_depot_put(struct vmm_heap_control *heap,
+			   unsigned long bin, void **objs, u32 count)
+{
+	u32 i;
+	irq_flags_t f;
+	struct heap_depot *d = &heap->cache.depots[bin - HEAP_MIN_BIN];
+
+	vmm_spin_lock_irqsave_lite(&d->lock, f);
+
+	for (i = 0; i < count; i++) {
+		__heap_depot_put(heap, d, bin, objs[i]);
+	}
+
+	__heap_depot_shrink(heap, d, bin);
+
+	vmm_spin_unlock_irqrestore_lite(&d->lock, f);
+}
+
+static u32 heap_depot_get(struct vmm_heap_control *heap,
+			  unsigned long bin, void **objs, u32 count)
+{
+	u32 i, j;
+	irq_flags_t f;
+	unsigned long addr;
+	struct heap_slab_page *pg;
+	struct heap_depot *d = &heap->cache.depots[bin - HEAP_MIN_BIN];
+
+	vmm_spin_lock_irqsave_lite(&d->lock, f);
+	for (i = 0; i < count; i++) {
+		if (!(objs[i] = __heap_depot_get(heap, d))) {
+			break;
+		}
+	}
+	vmm_spin_unlock_irqrestore_lite(&d->lock, f);
+
+	if (i) {
+		return i;
+	}
+
+	/* Depot is empty so carve a new slab page */
+	if (buddy_mem_alloc(&heap->ba, VMM_PAGE_SIZE, &addr)) {
+		return 0;
+	}
+	pg = heap_cache_page(heap, (void *)addr);
+	pg->bin = bin;
+	pg->depot_count = 0;
+	pg->free = NULL;
+
+	vmm_spin_lock_irqsave_lite(&d->lock, f);
+	d->slab_pages++;
+	for (j = 0; j < HEAP_SLAB_OBJS(bin); j++) {
+		if (i < count) {
+			objs[i++] = (void *)(addr + (j << bin));
+		} else {
+			__heap_depot_put(heap, d, bin,
+					 (void *)(addr + (j << bin)));
+		}
+	}
+	vmm_spin_unlock_irqrestore_lite(&d->lock, f);
+
+	return i;
+}
+
+static struct heap_magazine *heap_cache_magazine(
+					struct vmm_heap_control *heap,
+					unsigned long bin)
+{
+	u32 cpu = vmm_smp_processor_id();
+
+	if (CONFIG_CPU_COUNT <= cpu) {
+		return NULL;
+	}
+
+	return &heap->cache.mags[cpu * HEAP_CACHE_CLASSES +
+				 (bin - HEAP_MIN_BIN)];
+}
+
+static void *heap_cache_alloc(struct vmm_heap_control *heap,
+			      virtual_size_t size)
+{
+	void *obj = NULL;
+	irq_flags_t flags;
+	unsigned long bin;
+	struct heap_magazine *mag;
+
+	if (!heap->cache.enabled || (VMM_PAGE_SIZE < size)) {
+		return NULL;
+	}
+	bin = buddy_estimate_bin(&heap->ba, size);
+
+	arch_cpu_irq_save(flags);
+
+	mag = heap_cache_magazine(heap, bin);
+	if (!mag) {
+		heap_depot_get(heap, bin, &obj, 1);
+		goto done;
+	}
+
+	if (mag->count) {
+		mag->alloc_hit++;
+	} else {
+		mag->alloc_miss++;
+		mag->count = heap_depot_get(heap, bin, mag->objs,
+					    HEAP_MAGAZINE_BATCH);
+	}
+	if (mag->count) {
+		obj = mag->objs[--mag->count];
+	}
+
+done:
+	arch_cpu_irq_restore(flags);
+
+	return obj;
+}
+
+static bool heap_cache_free(struct vmm_heap_control *heap, void *ptr)
+{
+	irq_flags_t flags;
+	unsigned long bin;
+	struct heap_magazine *mag;
+
+	if (!heap->cache.enabled) {
+		return FALSE;
+	}
+
+	bin = heap_cache_page(heap, ptr)->bin;
+	if (!bin) {
+		return FALSE;
+	}
+
+	arch_cpu_irq_save(flags);
+
+	mag = heap_cache_magazine(heap, bin);
+	if (!mag) {
+		heap_depot_put(heap, bin, &ptr, 1);
+		goto done;
+	}
+
+	if (mag->count < HEAP_MAGAZINE_SIZE) {
+		mag->free_hit++;
+	} else {
+		mag->free_miss++;
+		mag->count -= HEAP_MAGAZINE_BATCH;
+		heap_depot_put(heap, bin, &mag->objs[mag->count],
+			       HEAP_MAGAZINE_BATCH);
+	}
+	mag->objs[mag->count++] = ptr;
+
+done:
+	arch_cpu_irq_restore(flags);
+
+	return TRUE;
+}
+
+static virtual_size_t heap_cache_alloc_size(struct vmm_heap_control *heap,
+					    const void *ptr)
+{
+	unsigned long bin;
+
+	if (!heap->cache.enabled) {
+		return 0;
+	}
+
+	bin = heap_cache_page(heap, ptr)->bin;
+	if (!bin) {
+		return 0;
+	}
+
+	return (1UL << bin) - (((unsigned long)ptr -
+			(unsigned long)heap->mem_start) & ((1UL << bin) - 1));
+}
+
+static void heap_cache_stats(struct vmm_heap_control *heap,
+			     struct vmm_heap_cache_stats *stats)
+{
+	u32 cpu, c;
+	struct heap_magazine *mag;
+	struct heap_depot *d;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!heap->cache.enabled) {
+		return;
+	}
+
+	for (c = 0; c < HEAP_CACHE_CLASSES; c++) {
+		for (cpu = 0; cpu < CONFIG_CPU_COUNT; cpu++) {
+			mag = &heap->cache.mags[cpu * HEAP_CACHE_CLASSES + c];
+			stats->alloc_hit += mag->alloc_hit;
+			stats->alloc_miss += mag->alloc_miss;
+			stats->free_hit += mag->free_hit;
+			stats->free_miss += mag->free_miss;
+			stats->cached_size +=
+				(virtual_size_t)mag->count << (HEAP_MIN_BIN + c);
+		}
+		d = &heap->cache.depots[c];
+		stats->cached_size +=
+			(virtual_size_t)d->count << (HEAP_MIN_BIN + c);
+		stats->slab_pages += d->slab_pages;
+	}
+}
+
+static void heap_cache_print_state(struct vmm_heap_control *heap,
+				   struct vmm_chardev *cdev, const char *name)
+{
+	u32 cpu, c, mag_count;
+	struct heap_depot *d;
+
+	if (!heap->cache.enabled) {
+		return;
+	}
+
+	vmm_cprintf(cdev, "%s Heap Magazine State\n", name);
+	for (c = 0; c < HEAP_CACHE_CLASSES; c++) {
+		mag_count = 0;
+		for (cpu = 0; cpu < CONFIG_CPU_COUNT; cpu++) {
+			mag_count += heap->cache.mags[cpu *
+					HEAP_CACHE_CLASSES + c].count;
+		}
+		d = &heap->cache.depots[c];
+		vmm_cprintf(cdev, "  [OBJECT %4dB]: %5u slab page(s), "
+			    "%5u in magazines, %5u in depot\n",
+			    1 << (HEAP_MIN_BIN + c), d->slab_pages,
+			    mag_count, d->count);
+	}
+}
+
+static int heap_cache_init(struct vmm_heap_control *heap, bool is_normal)
+{
+	u32 c;
+	void *meta;
+	unsigned long addr, pages_size, mags_size;
+
+	pages_size = (heap->mem_size >> VMM_PAGE_SHIFT) *
+		     sizeof(struct heap_slab_page);
+	mags_size = CONFIG_CPU_COUNT * HEAP_CACHE_CLASSES *
+		    sizeof(struct heap_magazine);
+
+	/* Normal heap keeps cache metadata in itself whereas
+	 * other heaps keep it in normal heap.
+	 */
+	if (is_normal) {
+		if (buddy_mem_alloc(&heap->ba, pages_size + mags_size, &addr)) {
+			return VMM_ENOMEM;
+		}
+		meta = (void *)addr;
+	} else {
+		meta = vmm_malloc(pages_size + mags_size);
+		if (!meta) {
+			return VMM_ENOMEM;
+		}
+	}
+	memset(meta, 0, pages_size + mags_size);
+
+	heap->cache.page_count = heap->mem_size >> VMM_PAGE_SHIFT;
+	heap->cache.pages = meta;
+	heap->cache.mags = meta + pages_size;
+	for (c = 0; c < HEAP_CACHE_CLASSES; c++) {
+		INIT_SPIN_LOCK(&heap->cache.depots[c].lock);
+		INIT_LIST_HEAD(&heap->cache.depots[c].page_list);
+		heap->cache.depots[c].count = 0;
+		heap->cache.depots[c].slab_pages = 0;
+	}
+	heap->cache.enabled = TRUE;
+
+	return VMM_OK;
+}
+
+#else
+
+static inline void *heap_cache_alloc(struct vmm_heap_control *heap,
+				     virtual_size_t size)
+{
+	return NULL;
+}
+
+static inline bool heap_cache_free(struct vmm_heap_control *heap, void *ptr)
+{
+	return FALSE;
+}
+
+static inline virtual_size_t heap_cache_alloc_size(
+					struct vmm_heap_control *heap,
+					const void *ptr)
+{
+	return 0;
+}
+
+static inline void heap_cache_stats(struct vmm_heap_control *heap,
+				    struct vmm_heap_cache_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+static inline void heap_cache_print_state(struct vmm_heap_control *heap,
+					  struct vmm_chardev *cdev,
+					  const char *name)
+{
+}
+
+static inline int heap_cache_init(struct vmm_heap_control *heap,
+				  bool is_normal)
+{
+	return VMM_OK;
+}
+
+#endif
 
 static void *heap_malloc(struct vmm_heap_control *heap,
 			 virtual_size_t size)
@@ -60,6 +531,11 @@ static void *heap_malloc(struct vmm_heap_control *heap,
 		return NULL;
 	}
 
+	addr = (unsigned long)heap_cache_alloc(heap, size);
+	if (addr) {
+		return (void *)addr;
+	}
+
 	rc = buddy_mem_alloc(&heap->ba, size, &addr);
 	if (rc) {
 		vmm_printf("%s: Failed to alloc size=%"PRISIZE" (error %d)\n",
@@ -80,6 +556,11 @@ static virtual_size_t heap_alloc_size(struct vmm_heap_control *heap,
 	BUG_ON(ptr < heap->mem_start);
 	BUG_ON((heap->mem_start + heap->mem_size) <= ptr);
 
+	asize = heap_cache_alloc_size(heap, ptr);
+	if (asize) {
+		return asize;
+	}
+
 	rc = buddy_mem_find(&heap->ba, (unsigned long) ptr,
 					&aaddr, NULL, &asize);
 	if (rc) {
@@ -97,6 +578,10 @@ static void heap_free(struct vmm_heap_control *heap, void *ptr)
 	BUG_ON(ptr < heap->mem_start);
 	BUG_ON((heap->mem_start + heap->mem_size) <= ptr);
 
+	if (heap_cache_free(heap, ptr)) {
+		return;
+	}
+
 	rc = buddy_mem_free(&heap->ba, (unsigned long)ptr);
 	if (rc) {
 		vmm_printf("%s: Failed to free ptr=%p (error %d)\n",
@@ -160,6 +645,8 @@ static int heap_print_state(struct vmm_heap_control *heap,
 		    buddy_hk_area_free(&heap->ba),
 		    buddy_hk_area_total(&heap->ba));
 
+	heap_cache_print_state(heap, cdev, name);
+
 	return VMM_OK;
 }
 
@@ -231,6 +718,11 @@ static int heap_init(struct vmm_heap_control *heap,
 		goto fail_free_pages;
 	}
 
+	rc = heap_cache_init(heap, is_normal);
+	if (rc) {
+		goto fail_free_pages;
+	}
+
 	return VMM_OK;
 
 fail_free_pages:
@@ -307,9 +799,24 @@ virtual_size_t vmm_normal_heap_hksize(void)
 	return normal_heap.hk_size;
 }
 
+static virtual_size_t heap_free_size(struct vmm_heap_control *heap)
+{
+	struct vmm_heap_cache_stats stats;
+
+	/* Objects cached in magazines and depots are free space */
+	heap_cache_stats(heap, &stats);
+
+	return buddy_bins_free_space(&heap->ba) + stats.cached_size;
+}
+
 virtual_size_t vmm_normal_heap_free_size(void)
 {
-	return buddy_bins_free_space(&normal_heap.ba);
+	return heap_free_size(&normal_heap);
+}
+
+void vmm_normal_heap_cache_stats(struct vmm_heap_cache_stats *stats)
+{
+	heap_cache_stats(&normal_heap, stats);
 }
 
 int vmm_normal_heap_print_state(struct vmm_chardev *cdev)
@@ -474,7 +981,12 @@ virtual_size_t vmm_dma_heap_hksize(void)
 
 virtual_size_t vmm_dma_heap_free_size(void)
 {
-	return buddy_bins_free_space(&dma_heap.ba);
+	return heap_free_size(&dma_heap);
+}
+
+void vmm_dma_heap_cache_stats(struct vmm_heap_cache_stats *stats)
+{
+	heap_cache_stats(&dma_heap, stats);
 }
 
 int vmm_dma_heap_print_state(struct vmm_chardev *cdev)
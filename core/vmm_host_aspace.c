@@ -457,6 +457,95 @@ static int host_memunmap(virtual_addr_t va,
 	return VMM_OK;
 }
 
+static virtual_addr_t host_memmap_linear(physical_addr_t pa,
+					 virtual_size_t sz,
+					 u32 mem_flags,
+					 bool use_hugepage)
+{
+	int rc, page_shift;
+	virtual_addr_t ite, page_size, page_mask;
+	virtual_addr_t va = 0;
+	virtual_addr_t tsz = 0;
+	u32 tmem_flags = 0;
+
+	if (use_hugepage) {
+		page_shift = arch_cpu_aspace_hugepage_log2size();
+	} else {
+		page_shift = VMM_PAGE_SHIFT;
+	}
+	page_size = (1 << page_shift);
+	page_mask = (page_size - 1);
+
+	if (!sz || (pa & page_mask) || (sz & page_mask)) {
+		return 0;
+	}
+
+	/* Share existing mapping if it is compatible */
+	rc = host_mhash_pa2va(pa, &va, &tsz, &tmem_flags);
+	if (rc == VMM_OK) {
+		if ((mem_flags != tmem_flags) || (tsz < sz) ||
+		    (va & page_mask)) {
+			return 0;
+		}
+		if (host_mhash_add(pa, va, sz, mem_flags)) {
+			return 0;
+		}
+		return va;
+	} else if (rc != VMM_ENOTAVAIL) {
+		return 0;
+	}
+
+	/* Unlike host_memmap(), running out of virtual address
+	 * space is not fatal here so we simply return zero. We also
+	 * leave at least half of free VAPOOL for vmm_host_memmap()
+	 * users because they cannot handle failures.
+	 */
+	if ((vmm_host_vapool_free_page_count() / 2) <
+	    (sz >> VMM_PAGE_SHIFT)) {
+		return 0;
+	}
+	if (vmm_host_vapool_alloc(&va, sz)) {
+		return 0;
+	}
+	if (va & page_mask) {
+		goto fail_free_va;
+	}
+
+	for (ite = 0; ite < (sz >> page_shift); ite++) {
+		rc = arch_cpu_aspace_map(va + ite * page_size,
+					 page_size,
+					 pa + ite * page_size,
+					 mem_flags);
+		if (rc) {
+			goto fail_unmap;
+		}
+	}
+
+	if (host_mhash_add(pa, va, sz, mem_flags)) {
+		goto fail_unmap;
+	}
+
+	return va;
+
+fail_unmap:
+	while (ite > 0) {
+		ite--;
+		arch_cpu_aspace_unmap(va + ite * page_size);
+	}
+fail_free_va:
+	vmm_host_vapool_free(va, sz);
+	return 0;
+}
+
+static bool host_linear_use_hugepage(physical_addr_t pa,
+				     virtual_size_t sz)
+{
+	virtual_size_t hmask =
+		order_mask(arch_cpu_aspace_hugepage_log2size());
+
+	return (!(pa & hmask) && !(sz & hmask)) ? TRUE : FALSE;
+}
+
 static virtual_addr_t host_alloc_aligned_pages(u32 page_count,
 					       u32 align_order,
 					       u32 mem_flags,
@@ -551,6 +640,28 @@ int vmm_host_memunmap(virtual_addr_t va)
 	return host_memunmap(alloc_va, alloc_sz, false);
 }
 
+virtual_addr_t vmm_host_memmap_linear(physical_addr_t pa,
+				      virtual_size_t sz)
+{
+	return host_memmap_linear(pa, sz, VMM_MEMORY_FLAGS_NORMAL,
+				  host_linear_use_hugepage(pa, sz));
+}
+
+int vmm_host_memunmap_linear(virtual_addr_t va, virtual_size_t sz)
+{
+	physical_addr_t pa = 0x0;
+
+	if (!va || !sz) {
+		return VMM_EINVALID;
+	}
+
+	if (arch_cpu_aspace_va2pa(va, &pa)) {
+		return VMM_ENOTAVAIL;
+	}
+
+	return host_memunmap(va, sz, host_linear_use_hugepage(pa, sz));
+}
+
 u32 vmm_host_hugepage_shift(void)
 {
 	return arch_cpu_aspace_hugepage_log2size();
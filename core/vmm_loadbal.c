@@ -23,6 +23,8 @@
  */
 
 #include <vmm_error.h>
+#include <vmm_smp.h>
+#include <vmm_spinlocks.h>
 #include <vmm_timer.h>
 #include <vmm_manager.h>
 #include <vmm_threads.h>
@@ -38,6 +40,8 @@
 struct vmm_loadbal_ctrl {
 	struct vmm_mutex curr_algo_lock;
 	struct vmm_loadbal_algo *curr_algo;
+	vmm_rwlock_t idle_algo_lock;
+	struct vmm_loadbal_algo *idle_algo;
 	struct vmm_mutex algo_list_lock;
 	struct dlist algo_list;
 	struct vmm_completion loadbal_cmpl;
@@ -70,6 +74,31 @@ static int loadbal_main(void *data)
 	return VMM_OK;
 }
 
+/* IDLE VCPUs can't take mutex so they see current algo via spinlock */
+static void loadbal_set_idle_algo(struct vmm_loadbal_algo *algo)
+{
+	irq_flags_t flags;
+
+	vmm_write_lock_irqsave_lite(&lbctrl.idle_algo_lock, flags);
+	lbctrl.idle_algo = (algo && algo->idle) ? algo : NULL;
+	vmm_write_unlock_irqrestore_lite(&lbctrl.idle_algo_lock, flags);
+}
+
+bool vmm_loadbal_idle(void)
+{
+	bool ret = FALSE;
+	irq_flags_t flags;
+
+	vmm_read_lock_irqsave_lite(&lbctrl.idle_algo_lock, flags);
+	if (lbctrl.idle_algo) {
+		ret = lbctrl.idle_algo->idle(lbctrl.idle_algo,
+					     vmm_smp_processor_id());
+	}
+	vmm_read_unlock_irqrestore_lite(&lbctrl.idle_algo_lock, flags);
+
+	return ret;
+}
+
 struct vmm_loadbal_algo *vmm_loadbal_current_algo(void)
 {
 	struct vmm_loadbal_algo *ret;
@@ -139,10 +168,12 @@ int vmm_loadbal_register_algo(struct vmm_loadbal_algo *lbalgo)
 			rc = best_algo->start(best_algo);
 		}
 		if (rc == VMM_OK) {
+			loadbal_set_idle_algo(NULL);
 			if (lbctrl.curr_algo && lbctrl.curr_algo->stop) {
 				lbctrl.curr_algo->stop(lbctrl.curr_algo);
 			}
 			lbctrl.curr_algo = best_algo;
+			loadbal_set_idle_algo(best_algo);
 		}
 	}
 	vmm_mutex_unlock(&lbctrl.curr_algo_lock);
@@ -183,6 +214,7 @@ int vmm_loadbal_unregister_algo(struct vmm_loadbal_algo *lbalgo)
 	/* Update current algo */
 	vmm_mutex_lock(&lbctrl.curr_algo_lock);
 	if (lbctrl.curr_algo == lbalgo) {
+		loadbal_set_idle_algo(NULL);
 		if (lbctrl.curr_algo->stop) {
 			lbctrl.curr_algo->stop(lbctrl.curr_algo);
 		}
@@ -203,10 +235,12 @@ int vmm_loadbal_unregister_algo(struct vmm_loadbal_algo *lbalgo)
 			rc = best_algo->start(best_algo);
 		}
 		if (rc == VMM_OK) {
+			loadbal_set_idle_algo(NULL);
 			if (lbctrl.curr_algo && lbctrl.curr_algo->stop) {
 				lbctrl.curr_algo->stop(lbctrl.curr_algo);
 			}
 			lbctrl.curr_algo = best_algo;
+			loadbal_set_idle_algo(best_algo);
 		}
 	}
 	vmm_mutex_unlock(&lbctrl.curr_algo_lock);
@@ -224,6 +258,8 @@ int __init vmm_loadbal_init(void)
 	/* Initialize loadbal current algo */
 	INIT_MUTEX(&lbctrl.curr_algo_lock);
 	lbctrl.curr_algo = NULL;
+	INIT_RW_LOCK(&lbctrl.idle_algo_lock);
+	lbctrl.idle_algo = NULL;
 
 	/* Initialize loadbal algo list */
 	INIT_MUTEX(&lbctrl.algo_list_lock);
@@ -31,11 +31,14 @@
 #include <vmm_timer.h>
 #include <vmm_schedalgo.h>
 #include <vmm_scheduler.h>
+#include <vmm_loadbal.h>
 #include <vmm_stdio.h>
 #include <arch_regs.h>
+#include <arch_atomic64.h>
 #include <arch_cpu_irq.h>
 #include <arch_vcpu.h>
 #include <libs/stringlib.h>
+#include <libs/bitops.h>
 
 #define IDLE_VCPU_STACK_SZ 	CONFIG_THREAD_STACK_SIZE
 #define IDLE_VCPU_PRIORITY 	VMM_VCPU_MIN_PRIORITY
@@ -73,10 +76,34 @@ struct vmm_scheduler_ctrl {
 	u64 sample_idle_last_ns;
 	u64 sample_irq_ns;
 	u64 sample_irq_last_ns;
+	atomic64_t migrate_in_count;
+	atomic64_t migrate_out_count;
+	atomic64_t pull_count;
+#ifdef CONFIG_SCHEDULER_STATS
+	u32 stats_rq_len;
+	u64 stats_irq_last_ns;
+	u64 stats_reset_tstamp;
+	vmm_spinlock_t stats_lock;
+	struct vmm_scheduler_rq_stats stats;
+#endif
 };
 
 static DEFINE_PER_CPU(struct vmm_scheduler_ctrl, sched);
 
+#ifdef CONFIG_SCHEDULER_STATS
+/* Must be called with schedp->rq_lock held */
+static u32 __rq_total_length(struct vmm_scheduler_ctrl *schedp)
+{
+	u32 p, ret = 0;
+
+	for (p = VMM_VCPU_MIN_PRIORITY; p <= VMM_VCPU_MAX_PRIORITY; p++) {
+		ret += vmm_schedalgo_rq_length(schedp->rq, p);
+	}
+
+	return ret;
+}
+#endif
+
 static int rq_dequeue(struct vmm_scheduler_ctrl *schedp,
 		      struct vmm_vcpu **next,
 		      u64 *next_time_slice)
@@ -85,6 +112,10 @@ static int rq_dequeue(struct vmm_scheduler_ctrl *schedp,
 	irq_flags_t flags;
 
 	vmm_spin_lock_irqsave_lite(&schedp->rq_lock, flags);
+#ifdef CONFIG_SCHEDULER_STATS
+	/* Sample ready queue length before dequeue */
+	schedp->stats_rq_len = __rq_total_length(schedp);
+#endif
 	ret = vmm_schedalgo_rq_dequeue(schedp->rq, next, next_time_slice);
 	vmm_spin_unlock_irqrestore_lite(&schedp->rq_lock, flags);
 
@@ -143,6 +174,70 @@ static u32 rq_length(struct vmm_scheduler_ctrl *schedp, u32 priority)
 	return ret;
 }
 
+#ifdef CONFIG_SCHEDULER_STATS
+static inline u32 scheduler_stats_bucket(u64 val)
+{
+	u32 b = fls64(val);
+
+	return (b < VMM_SCHEDULER_HIST_BUCKETS) ?
+		b : (VMM_SCHEDULER_HIST_BUCKETS - 1);
+}
+
+/* Must be called with write lock held on next->sched_lock
+ * Note: READY to RUNNING latency is only recorded when next VCPU was
+ * actually waiting in READY state (i.e. dispatched).
+ */
+static void __vmm_scheduler_stats_update(struct vmm_scheduler_ctrl *schedp,
+					 struct vmm_vcpu *next, u64 tstamp,
+					 bool dispatched)
+{
+	irq_flags_t flags;
+	u64 latency = 0, irq_ns;
+	u32 p = next->priority;
+	struct vmm_scheduler_rq_stats *st = &schedp->stats;
+
+	if (dispatched) {
+		latency = (tstamp > next->sched_ready_tstamp) ?
+			  (tstamp - next->sched_ready_tstamp) : 0;
+		next->sched_latency_count++;
+		next->sched_latency_nsecs += latency;
+		if (next->sched_latency_max_nsecs < latency) {
+			next->sched_latency_max_nsecs = latency;
+		}
+	}
+
+	irq_ns = schedp->irq_process_ns - schedp->stats_irq_last_ns;
+	schedp->stats_irq_last_ns = schedp->irq_process_ns;
+
+	vmm_spin_lock_irqsave_lite(&schedp->stats_lock, flags);
+
+	st->switch_count++;
+
+	if (dispatched) {
+		st->latency_count[p]++;
+		st->latency_total_nsecs[p] += latency;
+		if (st->latency_max_nsecs[p] < latency) {
+			st->latency_max_nsecs[p] = latency;
+		}
+		st->latency_hist[p][scheduler_stats_bucket(latency)]++;
+	}
+
+	st->rq_len_total += schedp->stats_rq_len;
+	if (st->rq_len_max < schedp->stats_rq_len) {
+		st->rq_len_max = schedp->stats_rq_len;
+	}
+	st->rq_len_hist[scheduler_stats_bucket(schedp->stats_rq_len)]++;
+
+	st->irq_total_nsecs += irq_ns;
+	if (st->irq_max_nsecs < irq_ns) {
+		st->irq_max_nsecs = irq_ns;
+	}
+	st->irq_hist[scheduler_stats_bucket(irq_ns)]++;
+
+	vmm_spin_unlock_irqrestore_lite(&schedp->stats_lock, flags);
+}
+#endif
+
 /* Should not be called from anywhere else */
 static struct vmm_vcpu *__vmm_scheduler_next1(struct vmm_scheduler_ctrl *schedp,
 					      arch_regs_t *regs)
@@ -162,6 +257,9 @@ static struct vmm_vcpu *__vmm_scheduler_next1(struct vmm_scheduler_ctrl *schedp,
 	vmm_write_lock_irqsave_lite(&next->sched_lock, nf);
 
 	arch_vcpu_switch(NULL, next, regs);
+#ifdef CONFIG_SCHEDULER_STATS
+	__vmm_scheduler_stats_update(schedp, next, tstamp, TRUE);
+#endif
 	next->state_ready_nsecs += tstamp - next->state_tstamp;
 	arch_atomic_write(&next->state, VMM_VCPU_STATE_RUNNING);
 	next->resumed = FALSE;
@@ -212,6 +310,9 @@ static struct vmm_vcpu *__vmm_scheduler_next2(struct vmm_scheduler_ctrl *schedp,
 				tstamp - current->state_tstamp;
 			arch_atomic_write(&current->state, VMM_VCPU_STATE_READY);
 			current->state_tstamp = tstamp;
+#ifdef CONFIG_SCHEDULER_STATS
+			current->sched_ready_tstamp = tstamp;
+#endif
 			rq_enqueue(schedp, current);
 		}
 		tcurrent = current;
@@ -242,6 +343,12 @@ dequeue_again:
 		arch_vcpu_switch(tcurrent, next, regs);
 	}
 
+#ifdef CONFIG_SCHEDULER_STATS
+	/* Still RUNNING current VCPU re-picked is not a dispatch */
+	__vmm_scheduler_stats_update(schedp, next, tstamp,
+			(next != current) ||
+			(current_state != VMM_VCPU_STATE_RUNNING));
+#endif
 	next->state_ready_nsecs += tstamp - next->state_tstamp;
 	arch_atomic_write(&next->state, VMM_VCPU_STATE_RUNNING);
 	next->resumed = FALSE;
@@ -661,7 +768,17 @@ int vmm_scheduler_state_change(struct vmm_vcpu *vcpu, u32 new_state)
 			vcpu->state_halted_nsecs = 0;
 			vcpu->system_nsecs = 0;
 			vcpu->reset_tstamp = tstamp;
+#ifdef CONFIG_SCHEDULER_STATS
+			vcpu->sched_latency_count = 0;
+			vcpu->sched_latency_nsecs = 0;
+			vcpu->sched_latency_max_nsecs = 0;
+#endif
+		}
+#ifdef CONFIG_SCHEDULER_STATS
+		if (new_state == VMM_VCPU_STATE_READY) {
+			vcpu->sched_ready_tstamp = tstamp;
 		}
+#endif
 		arch_atomic_write(&vcpu->state, new_state);
 		vcpu->state_tstamp = tstamp;
 	}
@@ -754,6 +871,8 @@ static void scheduler_ipi_migrate_vcpu(void *arg0, void *arg1, void *arg2)
 	/* Enqueue VCPU to new hcpu ready queue */
 	vcpu->hcpu = new_hcpu;
 	rq_enqueue(&per_cpu(sched, new_hcpu), vcpu);
+	arch_atomic64_inc(&per_cpu(sched, old_hcpu).migrate_out_count);
+	arch_atomic64_inc(&per_cpu(sched, new_hcpu).migrate_in_count);
 
 	/* Trigger re-scheduling on new hcpu */
 	vmm_scheduler_force_resched(new_hcpu);
@@ -1037,6 +1156,219 @@ struct vmm_vcpu *vmm_scheduler_idle_vcpu(u32 hcpu)
 	return per_cpu(sched, hcpu).idle_vcpu;
 }
 
+struct scheduler_pull_vcpu {
+	u32 src_hcpu;
+	u32 dst_hcpu;
+	bool (*filter)(struct vmm_vcpu *, void *);
+	void *priv;
+	struct vmm_vcpu *vcpu;
+};
+
+/* Must be called with ready queue lock of source hcpu held */
+static int scheduler_pull_vcpu_iter(struct vmm_vcpu *vcpu, void *priv)
+{
+	struct scheduler_pull_vcpu *pull = priv;
+
+	if (!vmm_cpumask_test_cpu(pull->dst_hcpu, vcpu->cpu_affinity)) {
+		return VMM_OK;
+	}
+
+	if (pull->filter && !pull->filter(vcpu, pull->priv)) {
+		return VMM_OK;
+	}
+
+	/* The VCPU lock is taken before ready queue lock everywhere
+	 * else so we only try to lock VCPU scheduling over here.
+	 */
+	if (!vmm_write_trylock_lite(&vcpu->sched_lock)) {
+		return VMM_OK;
+	}
+
+	if ((arch_atomic_read(&vcpu->state) != VMM_VCPU_STATE_READY) ||
+	    (vcpu->hcpu != pull->src_hcpu)) {
+		vmm_write_unlock_lite(&vcpu->sched_lock);
+		return VMM_OK;
+	}
+
+	/* Found VCPU which is returned with VCPU scheduling locked */
+	pull->vcpu = vcpu;
+
+	return 1;
+}
+
+struct vmm_vcpu *vmm_scheduler_pull_vcpu(u32 src_hcpu,
+				bool (*filter)(struct vmm_vcpu *, void *),
+				void *priv)
+{
+	irq_flags_t flags;
+	struct scheduler_pull_vcpu pull;
+	struct vmm_scheduler_ctrl *src_schedp, *dst_schedp;
+
+	if ((CONFIG_CPU_COUNT <= src_hcpu) ||
+	    !vmm_cpu_online(src_hcpu)) {
+		return NULL;
+	}
+
+	pull.src_hcpu = src_hcpu;
+	pull.filter = filter;
+	pull.priv = priv;
+	pull.vcpu = NULL;
+
+	arch_cpu_irq_save(flags);
+
+	pull.dst_hcpu = vmm_smp_processor_id();
+	if (pull.dst_hcpu == src_hcpu) {
+		arch_cpu_irq_restore(flags);
+		return NULL;
+	}
+	src_schedp = &per_cpu(sched, src_hcpu);
+	dst_schedp = &per_cpu(sched, pull.dst_hcpu);
+
+	/* Find and detach VCPU from source hcpu ready queue */
+	vmm_spin_lock_lite(&src_schedp->rq_lock);
+	vmm_schedalgo_rq_iterate(src_schedp->rq,
+				 scheduler_pull_vcpu_iter, &pull);
+	if (pull.vcpu) {
+		vmm_schedalgo_rq_detach(src_schedp->rq, pull.vcpu);
+	}
+	vmm_spin_unlock_lite(&src_schedp->rq_lock);
+
+	if (!pull.vcpu) {
+		arch_cpu_irq_restore(flags);
+		return NULL;
+	}
+
+	/* Enqueue VCPU to ready queue of this hcpu */
+	pull.vcpu->hcpu = pull.dst_hcpu;
+	vmm_spin_lock_lite(&dst_schedp->rq_lock);
+	vmm_schedalgo_rq_enqueue(dst_schedp->rq, pull.vcpu);
+	vmm_spin_unlock_lite(&dst_schedp->rq_lock);
+
+	arch_atomic64_inc(&src_schedp->migrate_out_count);
+	arch_atomic64_inc(&dst_schedp->migrate_in_count);
+	arch_atomic64_inc(&dst_schedp->pull_count);
+
+	vmm_write_unlock_lite(&pull.vcpu->sched_lock);
+
+	arch_cpu_irq_restore(flags);
+
+	return pull.vcpu;
+}
+
+int vmm_scheduler_migrate_stats(u32 hcpu,
+				struct vmm_scheduler_migrate_stats *stats)
+{
+	struct vmm_scheduler_ctrl *schedp;
+
+	if ((CONFIG_CPU_COUNT <= hcpu) ||
+	    !vmm_cpu_online(hcpu) || !stats) {
+		return VMM_EINVALID;
+	}
+	schedp = &per_cpu(sched, hcpu);
+
+	stats->in_count = arch_atomic64_read(&schedp->migrate_in_count);
+	stats->out_count = arch_atomic64_read(&schedp->migrate_out_count);
+	stats->pull_count = arch_atomic64_read(&schedp->pull_count);
+
+	return VMM_OK;
+}
+
+int vmm_scheduler_rq_stats(u32 hcpu, struct vmm_scheduler_rq_stats *stats)
+{
+#ifdef CONFIG_SCHEDULER_STATS
+	irq_flags_t flags;
+	struct vmm_scheduler_ctrl *schedp;
+
+	if ((CONFIG_CPU_COUNT <= hcpu) ||
+	    !vmm_cpu_online(hcpu) || !stats) {
+		return VMM_EINVALID;
+	}
+	schedp = &per_cpu(sched, hcpu);
+
+	vmm_spin_lock_irqsave_lite(&schedp->stats_lock, flags);
+	memcpy(stats, &schedp->stats, sizeof(*stats));
+	stats->since_nsecs = vmm_timer_timestamp() -
+			     schedp->stats_reset_tstamp;
+	vmm_spin_unlock_irqrestore_lite(&schedp->stats_lock, flags);
+
+	return VMM_OK;
+#else
+	return VMM_ENOTAVAIL;
+#endif
+}
+
+int vmm_scheduler_rq_stats_reset(u32 hcpu)
+{
+#ifdef CONFIG_SCHEDULER_STATS
+	irq_flags_t flags;
+	struct vmm_scheduler_ctrl *schedp;
+
+	if ((CONFIG_CPU_COUNT <= hcpu) ||
+	    !vmm_cpu_online(hcpu)) {
+		return VMM_EINVALID;
+	}
+	schedp = &per_cpu(sched, hcpu);
+
+	vmm_spin_lock_irqsave_lite(&schedp->stats_lock, flags);
+	memset(&schedp->stats, 0, sizeof(schedp->stats));
+	schedp->stats_reset_tstamp = vmm_timer_timestamp();
+	vmm_spin_unlock_irqrestore_lite(&schedp->stats_lock, flags);
+
+	return VMM_OK;
+#else
+	return VMM_ENOTAVAIL;
+#endif
+}
+
+int vmm_scheduler_latency_stats(struct vmm_vcpu *vcpu, u64 *count,
+				u64 *total_nsecs, u64 *max_nsecs)
+{
+#ifdef CONFIG_SCHEDULER_STATS
+	irq_flags_t flags;
+
+	if (!vcpu) {
+		return VMM_EINVALID;
+	}
+
+	vmm_read_lock_irqsave_lite(&vcpu->sched_lock, flags);
+	if (count) {
+		*count = vcpu->sched_latency_count;
+	}
+	if (total_nsecs) {
+		*total_nsecs = vcpu->sched_latency_nsecs;
+	}
+	if (max_nsecs) {
+		*max_nsecs = vcpu->sched_latency_max_nsecs;
+	}
+	vmm_read_unlock_irqrestore_lite(&vcpu->sched_lock, flags);
+
+	return VMM_OK;
+#else
+	return VMM_ENOTAVAIL;
+#endif
+}
+
+int vmm_scheduler_latency_stats_reset(struct vmm_vcpu *vcpu)
+{
+#ifdef CONFIG_SCHEDULER_STATS
+	irq_flags_t flags;
+
+	if (!vcpu) {
+		return VMM_EINVALID;
+	}
+
+	vmm_write_lock_irqsave_lite(&vcpu->sched_lock, flags);
+	vcpu->sched_latency_count = 0;
+	vcpu->sched_latency_nsecs = 0;
+	vcpu->sched_latency_max_nsecs = 0;
+	vmm_write_unlock_irqrestore_lite(&vcpu->sched_lock, flags);
+
+	return VMM_OK;
+#else
+	return VMM_ENOTAVAIL;
+#endif
+}
+
 struct vmm_vcpu *vmm_scheduler_current_vcpu(void)
 {
 	return this_cpu(sched).current_vcpu;
@@ -1080,7 +1412,11 @@ static void idle_orphan(void)
 
 	while (1) {
 		if (rq_length(schedp, IDLE_VCPU_PRIORITY) == 0) {
-			arch_cpu_wait_for_irq();
+#ifdef CONFIG_LOADBAL
+			/* Give load balancer a chance to pull work */
+			if (!vmm_loadbal_idle())
+#endif
+				arch_cpu_wait_for_irq();
 		}
 
 		vmm_scheduler_yield();
@@ -1134,6 +1470,17 @@ static int scheduler_startup(struct vmm_cpuhp_notify *cpuhp, u32 cpu)
 	schedp->sample_irq_ns = 0;
 	schedp->sample_irq_last_ns = 0;
 
+	/* Initialize migration stats (Per Host CPU) */
+	ARCH_ATOMIC64_INIT(&schedp->migrate_in_count, 0);
+	ARCH_ATOMIC64_INIT(&schedp->migrate_out_count, 0);
+	ARCH_ATOMIC64_INIT(&schedp->pull_count, 0);
+
+#ifdef CONFIG_SCHEDULER_STATS
+	/* Initialize run-queue stats (Per Host CPU) */
+	INIT_SPIN_LOCK(&schedp->stats_lock);
+	schedp->stats_reset_tstamp = vmm_timer_timestamp();
+#endif
+
 	/* Mark this CPU online
 	 * Note: must be done before creating IDLE VCPU and
 	 * setting affinity
@@ -31,7 +31,10 @@
 #include <vmm_timer.h>
 #include <vmm_completion.h>
 #include <vmm_manager.h>
-#include <libs/fifo.h>
+#include <arch_atomic.h>
+#include <arch_atomic64.h>
+#include <arch_barrier.h>
+#include <libs/mpsc_ring.h>
 
 /* SMP processor ID for Boot CPU */
 static u32 smp_bootcpu_id = UINT_MAX;
@@ -92,58 +95,84 @@ struct smp_ipi_call {
 };
 
 struct smp_ipi_ctrl {
-	struct fifo *sync_fifo;
-	struct fifo *async_fifo;
+	struct mpsc_ring *sync_ring;
+	struct mpsc_ring *async_ring;
 	struct vmm_completion async_avail;
 	struct vmm_vcpu *async_vcpu;
+	/* Non-zero when IPI is already triggered but not yet handled */
+	atomic_t ipi_pending;
+	/* Statistics */
+	atomic64_t sync_count;
+	atomic64_t async_count;
+	atomic64_t trigger_count;
+	atomic64_t full_count;
 };
 
 static DEFINE_PER_CPU(struct smp_ipi_ctrl, ictl);
 
-static void smp_ipi_sync_submit(struct smp_ipi_ctrl *ictlp,
-				struct smp_ipi_call *ipic)
+/* Mark IPI pending for destination CPU and add it to trigger mask
+ * only if IPI was not already pending. This allows multiple calls
+ * submitted before destination CPU handles IPI to share one trigger.
+ */
+static void smp_ipi_mark_pending(u32 dst_cpu, struct vmm_cpumask *trig_mask)
 {
-	int try;
+	struct smp_ipi_ctrl *ictlp = &per_cpu(ictl, dst_cpu);
 
-	if (!ipic || !ipic->func) {
-		return;
+	if (arch_atomic_cmpxchg(&ictlp->ipi_pending, 0, 1) == 0) {
+		vmm_cpumask_set_cpu(dst_cpu, trig_mask);
 	}
+}
 
-	try = SMP_IPI_WAIT_TRY_COUNT;
-	while (!fifo_enqueue(ictlp->sync_fifo, ipic, FALSE) && try) {
-		arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
-		vmm_udelay(SMP_IPI_WAIT_UDELAY);
-		try--;
+static void smp_ipi_trigger(const struct vmm_cpumask *trig_mask)
+{
+	u32 c;
+
+	if (vmm_cpumask_empty(trig_mask)) {
+		return;
 	}
 
-	if (!try) {
-		vmm_panic("CPU%d: IPI sync fifo full\n", ipic->dst_cpu);
+	for_each_cpu(c, trig_mask) {
+		arch_atomic64_inc(&per_cpu(ictl, c).trigger_count);
 	}
 
-	arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
+	arch_smp_ipi_trigger(trig_mask);
 }
 
-static void smp_ipi_async_submit(struct smp_ipi_ctrl *ictlp,
-				 struct smp_ipi_call *ipic)
+static void smp_ipi_submit(struct mpsc_ring *ring,
+			   struct smp_ipi_call *ipic,
+			   struct vmm_cpumask *trig_mask)
 {
 	int try;
+	struct smp_ipi_ctrl *ictlp;
 
 	if (!ipic || !ipic->func) {
 		return;
 	}
+	ictlp = &per_cpu(ictl, ipic->dst_cpu);
 
+	/* Cross-CPU calls are never dropped because callers rely on
+	 * them being executed so we keep waiting till destination CPU
+	 * drains its queues.
+	 */
 	try = SMP_IPI_WAIT_TRY_COUNT;
-	while (!fifo_enqueue(ictlp->async_fifo, ipic, FALSE) && try) {
+	while (!mpsc_ring_enqueue(ring, ipic)) {
+		arch_atomic64_inc(&ictlp->full_count);
+		if (!try) {
+			vmm_printf("CPU%d: IPI ring full, waiting to submit "
+				   "call from CPU%d\n",
+				   ipic->dst_cpu, ipic->src_cpu);
+			try = SMP_IPI_WAIT_TRY_COUNT;
+		}
+
+		/* Force destination CPU to drain its queues */
+		arch_atomic_write(&ictlp->ipi_pending, 1);
+		arch_atomic64_inc(&ictlp->trigger_count);
 		arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
 		vmm_udelay(SMP_IPI_WAIT_UDELAY);
 		try--;
 	}
 
-	if (!try) {
-		vmm_panic("CPU%d: IPI async fifo full\n", ipic->dst_cpu);
-	}
-
-	arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
+	smp_ipi_mark_pending(ipic->dst_cpu, trig_mask);
 }
 
 static void smp_ipi_main(void)
@@ -156,7 +185,7 @@ static void smp_ipi_main(void)
 		vmm_completion_wait(&ictlp->async_avail);
 
 		/* Process async IPIs */
-		while (fifo_dequeue(ictlp->async_fifo, &ipic)) {
+		while (mpsc_ring_dequeue(ictlp->async_ring, &ipic)) {
 			if (ipic.func) {
 				ipic.func(ipic.arg0, ipic.arg1, ipic.arg2);
 			}
@@ -169,15 +198,21 @@ void vmm_smp_ipi_exec(void)
 	struct smp_ipi_call ipic;
 	struct smp_ipi_ctrl *ictlp = &this_cpu(ictl);
 
+	/* Clear pending state before draining so that calls submitted
+	 * after this point trigger a new IPI.
+	 */
+	arch_atomic_write(&ictlp->ipi_pending, 0);
+	arch_smp_mb();
+
 	/* Process Sync IPIs */
-	while (fifo_dequeue(ictlp->sync_fifo, &ipic)) {
+	while (mpsc_ring_dequeue(ictlp->sync_ring, &ipic)) {
 		if (ipic.func) {
 			ipic.func(ipic.arg0, ipic.arg1, ipic.arg2);
 		}
 	}
 
 	/* Signal IPI available event */
-	if (!fifo_isempty(ictlp->async_fifo)) {
+	if (!mpsc_ring_isempty(ictlp->async_ring)) {
 		vmm_completion_complete(&ictlp->async_avail);
 	}
 }
@@ -187,6 +222,7 @@ void vmm_smp_ipi_async_call(const struct vmm_cpumask *dest,
 			     void *arg0, void *arg1, void *arg2)
 {
 	u32 c, cpu = vmm_smp_processor_id();
+	struct vmm_cpumask trig_mask = VMM_CPU_MASK_NONE;
 	struct smp_ipi_call ipic;
 
 	if (!dest || !func) {
@@ -207,9 +243,13 @@ void vmm_smp_ipi_async_call(const struct vmm_cpumask *dest,
 			ipic.arg0 = arg0;
 			ipic.arg1 = arg1;
 			ipic.arg2 = arg2;
-			smp_ipi_async_submit(&per_cpu(ictl, c), &ipic);
+			arch_atomic64_inc(&per_cpu(ictl, c).async_count);
+			smp_ipi_submit(per_cpu(ictl, c).async_ring,
+				       &ipic, &trig_mask);
 		}
 	}
+
+	smp_ipi_trigger(&trig_mask);
 }
 
 int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
@@ -217,9 +257,10 @@ int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
 			   void (*func)(void *, void *, void *),
 			   void *arg0, void *arg1, void *arg2)
 {
-	int rc = VMM_OK;
+	int rc = VMM_OK, rc1;
 	u64 timeout_tstamp;
 	u32 c, trig_count, cpu = vmm_smp_processor_id();
+	struct vmm_cpumask wait_mask = VMM_CPU_MASK_NONE;
 	struct vmm_cpumask trig_mask = VMM_CPU_MASK_NONE;
 	struct smp_ipi_call ipic;
 	struct smp_ipi_ctrl *ictlp;
@@ -243,54 +284,80 @@ int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
 			ipic.arg0 = arg0;
 			ipic.arg1 = arg1;
 			ipic.arg2 = arg2;
-			smp_ipi_sync_submit(&per_cpu(ictl, c), &ipic);
-			vmm_cpumask_set_cpu(c, &trig_mask);
+			arch_atomic64_inc(&per_cpu(ictl, c).sync_count);
+			smp_ipi_submit(per_cpu(ictl, c).sync_ring,
+				       &ipic, &trig_mask);
+			vmm_cpumask_set_cpu(c, &wait_mask);
 			trig_count++;
 		}
 	}
 
+	smp_ipi_trigger(&trig_mask);
+
 	if (trig_count && timeout_msecs) {
-		rc = VMM_ETIMEDOUT;
+		rc1 = VMM_ETIMEDOUT;
 		timeout_tstamp = vmm_timer_timestamp();
 		timeout_tstamp += (u64)timeout_msecs * 1000000ULL;
 		while (vmm_timer_timestamp() < timeout_tstamp) {
-			for_each_cpu(c, &trig_mask) {
+			for_each_cpu(c, &wait_mask) {
 				ictlp = &per_cpu(ictl, c);
-				if (!fifo_avail(ictlp->sync_fifo)) {
-					vmm_cpumask_clear_cpu(c, &trig_mask);
+				if (!mpsc_ring_avail(ictlp->sync_ring)) {
+					vmm_cpumask_clear_cpu(c, &wait_mask);
 					trig_count--;
 				}
 			}
 
 			if (!trig_count) {
-				rc = VMM_OK;
+				rc1 = VMM_OK;
 				break;
 			}
 
 			vmm_udelay(SMP_IPI_WAIT_UDELAY);
 		}
+		if (rc1) {
+			rc = rc1;
+		}
 	}
 
 	return rc;
 }
 
+int vmm_smp_ipi_stats(u32 cpu, struct vmm_smp_ipi_stats *stats)
+{
+	struct smp_ipi_ctrl *ictlp;
+
+	if (!stats || !vmm_cpu_possible(cpu)) {
+		return VMM_EINVALID;
+	}
+	ictlp = &per_cpu(ictl, cpu);
+
+	stats->sync_count = arch_atomic64_read(&ictlp->sync_count);
+	stats->async_count = arch_atomic64_read(&ictlp->async_count);
+	stats->trigger_count = arch_atomic64_read(&ictlp->trigger_count);
+	stats->full_count = arch_atomic64_read(&ictlp->full_count);
+	stats->sync_pending = mpsc_ring_avail(ictlp->sync_ring);
+	stats->async_pending = mpsc_ring_avail(ictlp->async_ring);
+
+	return VMM_OK;
+}
+
 static int smp_sync_ipi_startup(struct vmm_cpuhp_notify *cpuhp, u32 cpu)
 {
 	int rc = VMM_EFAIL;
 	struct smp_ipi_ctrl *ictlp = &per_cpu(ictl, cpu);
 
-	/* Initialize Sync IPI FIFO */
-	ictlp->sync_fifo = fifo_alloc(sizeof(struct smp_ipi_call),
+	/* Initialize Sync IPI ring */
+	ictlp->sync_ring = mpsc_ring_alloc(sizeof(struct smp_ipi_call),
 					   SMP_IPI_MAX_SYNC_PER_CPU);
-	if (!ictlp->sync_fifo) {
+	if (!ictlp->sync_ring) {
 		rc = VMM_ENOMEM;
 		goto fail;
 	}
 
-	/* Initialize Async IPI FIFO */
-	ictlp->async_fifo = fifo_alloc(sizeof(struct smp_ipi_call),
-					   SMP_IPI_MAX_ASYNC_PER_CPU);
-	if (!ictlp->async_fifo) {
+	/* Initialize Async IPI ring */
+	ictlp->async_ring = mpsc_ring_alloc(sizeof(struct smp_ipi_call),
+					    SMP_IPI_MAX_ASYNC_PER_CPU);
+	if (!ictlp->async_ring) {
 		rc = VMM_ENOMEM;
 		goto fail_free_sync;
 	}
@@ -301,6 +368,13 @@ static int smp_sync_ipi_startup(struct vmm_cpuhp_notify *cpuhp, u32 cpu)
 	/* Clear async VCPU pointer */
 	ictlp->async_vcpu = NULL;
 
+	/* Clear pending state and statistics */
+	ARCH_ATOMIC_INIT(&ictlp->ipi_pending, 0);
+	ARCH_ATOMIC64_INIT(&ictlp->sync_count, 0);
+	ARCH_ATOMIC64_INIT(&ictlp->async_count, 0);
+	ARCH_ATOMIC64_INIT(&ictlp->trigger_count, 0);
+	ARCH_ATOMIC64_INIT(&ictlp->full_count, 0);
+
 	/* Arch specific IPI initialization */
 	if ((rc = arch_smp_ipi_init())) {
 		goto fail_free_async;
@@ -309,9 +383,9 @@ static int smp_sync_ipi_startup(struct vmm_cpuhp_notify *cpuhp, u32 cpu)
 	return VMM_OK;
 
 fail_free_async:
-	fifo_free(ictlp->async_fifo);
+	mpsc_ring_free(ictlp->async_ring);
 fail_free_sync:
-	fifo_free(ictlp->sync_fifo);
+	mpsc_ring_free(ictlp->sync_ring);
 fail:
 	return rc;
 }
@@ -42,7 +42,11 @@ struct vmm_timer_local_ctrl {
 	u64 next_event;
 	struct vmm_timer_event *curr;
 	vmm_rwlock_t event_list_lock;
+#ifdef CONFIG_TIMER_EVENT_HEAP
+	struct vmm_timer_event *event_heap;
+#else
 	struct dlist event_list;
+#endif
 };
 
 static DEFINE_PER_CPU(struct vmm_timer_local_ctrl, tlc);
@@ -111,6 +115,186 @@ u64 vmm_timer_timestamp(void)
 	return ret;
 }
 
+/*
+ * Per-CPU event queue helpers
+ * Note: These functions must be called with tlcp->event_list_lock held.
+ */
+#ifdef CONFIG_TIMER_EVENT_HEAP
+
+static void __timer_queue_init(struct vmm_timer_local_ctrl *tlcp)
+{
+	tlcp->event_heap = NULL;
+}
+
+static inline bool __timer_queue_empty(struct vmm_timer_local_ctrl *tlcp)
+{
+	return (tlcp->event_heap) ? FALSE : TRUE;
+}
+
+static inline struct vmm_timer_event *__timer_queue_first(
+					struct vmm_timer_local_ctrl *tlcp)
+{
+	return tlcp->event_heap;
+}
+
+/* Meld two heap roots and return the new root */
+static struct vmm_timer_event *__timer_heap_meld(struct vmm_timer_event *a,
+						 struct vmm_timer_event *b)
+{
+	struct vmm_timer_event *t;
+
+	/* Earlier root wins and on tie older root wins */
+	if (b->expiry_tstamp < a->expiry_tstamp) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	/* Make b first child of a */
+	b->heap_prev = a;
+	b->heap_next = a->heap_child;
+	if (a->heap_child) {
+		a->heap_child->heap_prev = b;
+	}
+	a->heap_child = b;
+	a->heap_next = NULL;
+	a->heap_prev = NULL;
+
+	return a;
+}
+
+/* Standard two-pass pairing of a sibling list */
+static struct vmm_timer_event *__timer_heap_merge_pairs(
+					struct vmm_timer_event *first)
+{
+	struct vmm_timer_event *a, *b, *next, *stack = NULL, *root = NULL;
+
+	/* First pass: meld pairs from left to right */
+	while (first) {
+		a = first;
+		b = a->heap_next;
+		if (!b) {
+			a->heap_prev = NULL;
+			a->heap_next = stack;
+			stack = a;
+			break;
+		}
+		next = b->heap_next;
+		a->heap_next = a->heap_prev = NULL;
+		b->heap_next = b->heap_prev = NULL;
+		a = __timer_heap_meld(a, b);
+		a->heap_next = stack;
+		stack = a;
+		first = next;
+	}
+
+	/* Second pass: meld results from right to left */
+	while (stack) {
+		next = stack->heap_next;
+		stack->heap_next = NULL;
+		root = (root) ? __timer_heap_meld(root, stack) : stack;
+		stack = next;
+	}
+
+	return root;
+}
+
+static void __timer_queue_add(struct vmm_timer_local_ctrl *tlcp,
+			      struct vmm_timer_event *ev)
+{
+	ev->heap_child = NULL;
+	ev->heap_next = NULL;
+	ev->heap_prev = NULL;
+
+	if (tlcp->event_heap) {
+		tlcp->event_heap = __timer_heap_meld(tlcp->event_heap, ev);
+	} else {
+		tlcp->event_heap = ev;
+	}
+}
+
+static void __timer_queue_del(struct vmm_timer_local_ctrl *tlcp,
+			      struct vmm_timer_event *ev)
+{
+	struct vmm_timer_event *sub;
+
+	if (ev == tlcp->event_heap) {
+		tlcp->event_heap = __timer_heap_merge_pairs(ev->heap_child);
+	} else {
+		/* Unlink from parent (or previous sibling) */
+		if (ev->heap_prev->heap_child == ev) {
+			ev->heap_prev->heap_child = ev->heap_next;
+		} else {
+			ev->heap_prev->heap_next = ev->heap_next;
+		}
+		if (ev->heap_next) {
+			ev->heap_next->heap_prev = ev->heap_prev;
+		}
+
+		/* Meld children back into heap */
+		sub = __timer_heap_merge_pairs(ev->heap_child);
+		if (sub) {
+			tlcp->event_heap = __timer_heap_meld(tlcp->event_heap,
+							     sub);
+		}
+	}
+
+	ev->heap_child = NULL;
+	ev->heap_next = NULL;
+	ev->heap_prev = NULL;
+}
+
+#else
+
+static void __timer_queue_init(struct vmm_timer_local_ctrl *tlcp)
+{
+	INIT_LIST_HEAD(&tlcp->event_list);
+}
+
+static inline bool __timer_queue_empty(struct vmm_timer_local_ctrl *tlcp)
+{
+	return list_empty(&tlcp->event_list);
+}
+
+static inline struct vmm_timer_event *__timer_queue_first(
+					struct vmm_timer_local_ctrl *tlcp)
+{
+	if (list_empty(&tlcp->event_list)) {
+		return NULL;
+	}
+
+	return list_entry(list_first(&tlcp->event_list),
+			  struct vmm_timer_event, active_head);
+}
+
+static void __timer_queue_add(struct vmm_timer_local_ctrl *tlcp,
+			      struct vmm_timer_event *ev)
+{
+	bool found_pos = FALSE;
+	struct vmm_timer_event *e = NULL;
+
+	list_for_each_entry(e, &tlcp->event_list, active_head) {
+		if (ev->expiry_tstamp < e->expiry_tstamp) {
+			found_pos = TRUE;
+			break;
+		}
+	}
+
+	if (!found_pos) {
+		list_add_tail(&ev->active_head, &tlcp->event_list);
+	} else {
+		list_add_tail(&ev->active_head, &e->active_head);
+	}
+}
+
+static void __timer_queue_del(struct vmm_timer_local_ctrl *tlcp,
+			      struct vmm_timer_event *ev)
+{
+	list_del(&ev->active_head);
+}
+
+#endif
+
 /* Note: This function must be called with tlcp->event_list_lock held. */
 static void __timer_schedule_next_event(struct vmm_timer_local_ctrl *tlcp)
 {
@@ -123,14 +307,12 @@ static void __timer_schedule_next_event(struct vmm_timer_local_ctrl *tlcp)
 	}
 
 	/* If no events, we give up */
-	if (list_empty(&tlcp->event_list)) {
+	if (__timer_queue_empty(tlcp)) {
 		return;
 	}
 
 	/* Retrieve first event from list of active events */
-	e = list_entry(list_first(&tlcp->event_list),
-		       struct vmm_timer_event,
-		       active_head);
+	e = __timer_queue_first(tlcp);
 
 	/* Configure clockevent device for first event */
 	tlcp->curr = e;
@@ -160,7 +342,7 @@ static void __timer_event_stop(struct vmm_timer_event *ev)
 	vmm_write_lock_irqsave_lite(&tlcp->event_list_lock, flags);
 
 	ev->active_state = FALSE;
-	list_del(&ev->active_head);
+	__timer_queue_del(tlcp, ev);
 	ev->expiry_tstamp = 0;
 
 	vmm_write_unlock_irqrestore_lite(&tlcp->event_list_lock, flags);
@@ -180,9 +362,8 @@ static void timer_clockchip_event_handler(struct vmm_clockchip *cc)
 	tlcp->inprocess = TRUE;
 
 	/* Process expired active events */
-	while (!list_empty(&tlcp->event_list)) {
-		e = list_entry(list_first(&tlcp->event_list),
-			       struct vmm_timer_event, active_head);
+	while (!__timer_queue_empty(tlcp)) {
+		e = __timer_queue_first(tlcp);
 		/* Current timestamp */
 		if (e->expiry_tstamp <= vmm_timer_timestamp()) {
 			/* Unlock event list for processing expired event */
@@ -248,9 +429,7 @@ int vmm_timer_event_start2(struct vmm_timer_event *ev,
 {
 	u32 hcpu;
 	u64 tstamp;
-	bool found_pos = FALSE;
 	irq_flags_t flags, flags1;
-	struct vmm_timer_event *e = NULL;
 	struct vmm_timer_local_ctrl *tlcp;
 
 	if (!ev) {
@@ -276,18 +455,7 @@ int vmm_timer_event_start2(struct vmm_timer_event *ev,
 
 	vmm_write_lock_irqsave_lite(&tlcp->event_list_lock, flags1);
 
-	list_for_each_entry(e, &tlcp->event_list, active_head) {
-		if (ev->expiry_tstamp < e->expiry_tstamp) {
-			found_pos = TRUE;
-			break;
-		}
-	}
-
-	if (!found_pos) {
-		list_add_tail(&ev->active_head, &tlcp->event_list);
-	} else {
-		list_add_tail(&ev->active_head, &e->active_head);
-	}
+	__timer_queue_add(tlcp, ev);
 
 	__timer_schedule_next_event(tlcp);
 
@@ -371,7 +539,7 @@ static int timer_startup(struct vmm_cpuhp_notify *cpuhp, u32 cpu)
 
 	/* Initialize Per CPU event list */
 	INIT_RW_LOCK(&tlcp->event_list_lock);
-	INIT_LIST_HEAD(&tlcp->event_list);
+	__timer_queue_init(tlcp);
 
 	/* Bind suitable clockchip to current host CPU */
 	tlcp->cc = vmm_clockchip_bind_best(cpu);
@@ -29,31 +29,63 @@
 #include <vmm_scheduler.h>
 #include <vmm_devtree.h>
 #include <vmm_vcpu_irq.h>
+#include <libs/bitops.h>
 #include <libs/stringlib.h>
 
 #define DEASSERTED	0
 #define ASSERTED	1
 #define PENDING		2
 
+static inline unsigned long *vcpu_irq_pending_map(struct vmm_vcpu *vcpu,
+						  u32 prio_level)
+{
+	return &vcpu->irqs.pending[prio_level * vcpu->irqs.pending_longs];
+}
+
+/* Mark irq as asserted in pending bitmap of its priority level */
+static inline void vcpu_irq_pending_set(struct vmm_vcpu *vcpu, u32 irq_no)
+{
+	u32 prio_level = vcpu->irqs.irq[irq_no].prio_level;
+
+	if (prio_level < vcpu->irqs.prio_levels) {
+		set_bit(irq_no, vcpu_irq_pending_map(vcpu, prio_level));
+	}
+}
+
+/* Clear irq from pending bitmap of its priority level */
+static inline void vcpu_irq_pending_clear(struct vmm_vcpu *vcpu, u32 irq_no)
+{
+	u32 prio_level = vcpu->irqs.irq[irq_no].prio_level;
+
+	if (prio_level < vcpu->irqs.prio_levels) {
+		clear_bit(irq_no, vcpu_irq_pending_map(vcpu, prio_level));
+	}
+}
+
+/* Find lowest asserted irq number of highest priority level */
+static int vcpu_irq_pending_find(struct vmm_vcpu *vcpu)
+{
+	u32 l, irq_no, irq_count = vcpu->irqs.irq_count;
+
+	for (l = 0; l < vcpu->irqs.prio_levels; l++) {
+		irq_no = find_first_bit(vcpu_irq_pending_map(vcpu, l),
+					irq_count);
+		if (irq_no < irq_count) {
+			return irq_no;
+		}
+	}
+
+	return -1;
+}
+
 static bool vcpu_irq_process_one(struct vmm_vcpu *vcpu, arch_regs_t *regs)
 {
 	/* Proceed only if we have pending execute */
 	if (arch_atomic_dec_if_positive(&vcpu->irqs.execute_pending) >= 0) {
-		int irq_no = -1;
-		u32 i, tmp_prio, irq_count = vcpu->irqs.irq_count;
-		u32 irq_prio = 0;
+		int irq_no;
 
 		/* Find the irq number to process */
-		for (i = 0; i < irq_count; i++) {
-			if (arch_atomic_read(&vcpu->irqs.irq[i].assert) ==
-			    ASSERTED) {
-				tmp_prio = arch_vcpu_irq_priority(vcpu, i);
-				if (tmp_prio > irq_prio) {
-					irq_no = i;
-					irq_prio = tmp_prio;
-				}
-			}
-		}
+		irq_no = vcpu_irq_pending_find(vcpu);
 		if (irq_no == -1) {
 			return FALSE;
 		}
@@ -61,6 +93,7 @@ static bool vcpu_irq_process_one(struct vmm_vcpu *vcpu, arch_regs_t *regs)
 		/* If irq number found then execute it */
 		if (arch_atomic_cmpxchg(&vcpu->irqs.irq[irq_no].assert,
 					ASSERTED, PENDING) == ASSERTED) {
+			vcpu_irq_pending_clear(vcpu, irq_no);
 			if (arch_vcpu_irq_execute(vcpu, regs, irq_no,
 			    	vcpu->irqs.irq[irq_no].reason) == VMM_OK) {
 				arch_atomic_write(&vcpu->irqs.
@@ -79,6 +112,17 @@ static bool vcpu_irq_process_one(struct vmm_vcpu *vcpu, arch_regs_t *regs)
 				arch_atomic_write(&vcpu->irqs.
 						  irq[irq_no].assert,
 						  ASSERTED);
+				vcpu_irq_pending_set(vcpu, irq_no);
+			}
+		} else {
+			/* Stale pending bit (irq deasserted in parallel)
+			 * so clear it and set it back only if the irq
+			 * got asserted again meanwhile.
+			 */
+			vcpu_irq_pending_clear(vcpu, irq_no);
+			if (arch_atomic_read(&vcpu->irqs.irq[irq_no].assert) ==
+			    ASSERTED) {
+				vcpu_irq_pending_set(vcpu, irq_no);
 			}
 		}
 
@@ -164,7 +208,7 @@ void vmm_vcpu_irq_assert(struct vmm_vcpu *vcpu, u32 irq_no, u64 reason)
 	}
 
 	/* Check irq number */
-	if (irq_no > vcpu->irqs.irq_count) {
+	if (irq_no >= vcpu->irqs.irq_count) {
 		return;
 	}
 
@@ -173,6 +217,7 @@ void vmm_vcpu_irq_assert(struct vmm_vcpu *vcpu, u32 irq_no, u64 reason)
 				DEASSERTED, ASSERTED) == DEASSERTED) {
 		if (arch_vcpu_irq_assert(vcpu, irq_no, reason) == VMM_OK) {
 			vcpu->irqs.irq[irq_no].reason = reason;
+			vcpu_irq_pending_set(vcpu, irq_no);
 			arch_atomic_inc(&vcpu->irqs.execute_pending);
 			arch_atomic64_inc(&vcpu->irqs.assert_count);
 			asserted = TRUE;
@@ -198,7 +243,7 @@ void vmm_vcpu_irq_clear(struct vmm_vcpu *vcpu, u32 irq_no)
 	}
 
 	/* Check irq number */
-	if (irq_no > vcpu->irqs.irq_count) {
+	if (irq_no >= vcpu->irqs.irq_count) {
 		return;
 	}
 
@@ -213,6 +258,7 @@ void vmm_vcpu_irq_clear(struct vmm_vcpu *vcpu, u32 irq_no)
 
 	/* Reset VCPU irq assert state */
 	arch_atomic_write(&vcpu->irqs.irq[irq_no].assert, DEASSERTED);
+	vcpu_irq_pending_clear(vcpu, irq_no);
 
 	/* Ensure irq reason is zeroed */
 	vcpu->irqs.irq[irq_no].reason = 0x0;
@@ -226,7 +272,7 @@ void vmm_vcpu_irq_deassert(struct vmm_vcpu *vcpu, u32 irq_no)
 	}
 
 	/* Check irq number */
-	if (irq_no > vcpu->irqs.irq_count) {
+	if (irq_no >= vcpu->irqs.irq_count) {
 		return;
 	}
 
@@ -238,6 +284,7 @@ void vmm_vcpu_irq_deassert(struct vmm_vcpu *vcpu, u32 irq_no)
 
 	/* Reset VCPU irq assert state */
 	arch_atomic_write(&vcpu->irqs.irq[irq_no].assert, DEASSERTED);
+	vcpu_irq_pending_clear(vcpu, irq_no);
 
 	/* Ensure irq reason is zeroed */
 	vcpu->irqs.irq[irq_no].reason = 0x0;
@@ -320,6 +367,44 @@ bool vmm_vcpu_irq_wait_state(struct vmm_vcpu *vcpu)
 	return ret;
 }
 
+/* Group irqs by distinct non-zero arch priority (highest first)
+ * Note: Priority zero irqs are never picked by vcpu_irq_process_one()
+ * hence they don't get any priority level.
+ */
+static u32 vcpu_irq_setup_prio_levels(struct vmm_vcpu *vcpu, u32 irq_count)
+{
+	u32 i, j, prio, next, levels = 0, curr = UINT_MAX;
+
+	for (i = 0; i < irq_count; i++) {
+		vcpu->irqs.irq[i].prio_level = UINT_MAX;
+	}
+
+	while (1) {
+		/* Find next lower priority value */
+		next = 0;
+		for (i = 0; i < irq_count; i++) {
+			prio = arch_vcpu_irq_priority(vcpu, i);
+			if ((prio < curr) && (prio > next)) {
+				next = prio;
+			}
+		}
+		if (!next) {
+			break;
+		}
+
+		for (j = 0; j < irq_count; j++) {
+			if (arch_vcpu_irq_priority(vcpu, j) == next) {
+				vcpu->irqs.irq[j].prio_level = levels;
+			}
+		}
+
+		curr = next;
+		levels++;
+	}
+
+	return levels;
+}
+
 int vmm_vcpu_irq_init(struct vmm_vcpu *vcpu)
 {
 	int rc;
@@ -351,9 +436,28 @@ int vmm_vcpu_irq_init(struct vmm_vcpu *vcpu)
 			return VMM_ENOMEM;
 		}
 
+		/* Allocate pending bitmaps for each priority level */
+		vcpu->irqs.prio_levels =
+			vcpu_irq_setup_prio_levels(vcpu, irq_count);
+		vcpu->irqs.pending_longs = BITS_TO_LONGS(irq_count);
+		if (vcpu->irqs.prio_levels) {
+			vcpu->irqs.pending = vmm_zalloc(sizeof(unsigned long) *
+						vcpu->irqs.pending_longs *
+						vcpu->irqs.prio_levels);
+			if (!vcpu->irqs.pending) {
+				vmm_free(vcpu->irqs.irq);
+				vcpu->irqs.irq = NULL;
+				return VMM_ENOMEM;
+			}
+		}
+
 		/* Create wfi_timeout event */
 		ev = vmm_zalloc(sizeof(struct vmm_timer_event));
 		if (!ev) {
+			if (vcpu->irqs.pending) {
+				vmm_free(vcpu->irqs.pending);
+				vcpu->irqs.pending = NULL;
+			}
 			vmm_free(vcpu->irqs.irq);
 			vcpu->irqs.irq = NULL;
 			return VMM_ENOMEM;
@@ -384,11 +488,19 @@ int vmm_vcpu_irq_init(struct vmm_vcpu *vcpu)
 		vcpu->irqs.irq[ite].reason = 0;
 		arch_atomic_write(&vcpu->irqs.irq[ite].assert, DEASSERTED);
 	}
+	if (vcpu->irqs.pending) {
+		memset(vcpu->irqs.pending, 0, sizeof(unsigned long) *
+		       vcpu->irqs.pending_longs * vcpu->irqs.prio_levels);
+	}
 
 	/* Setup wait for irq context */
 	vcpu->irqs.wfi.state = FALSE;
 	rc = vmm_timer_event_stop(vcpu->irqs.wfi.priv);
 	if (rc != VMM_OK) {
+		if (vcpu->irqs.pending) {
+			vmm_free(vcpu->irqs.pending);
+			vcpu->irqs.pending = NULL;
+		}
 		vmm_free(vcpu->irqs.irq);
 		vcpu->irqs.irq = NULL;
 		vmm_free(vcpu->irqs.wfi.priv);
@@ -417,6 +529,12 @@ int vmm_vcpu_irq_deinit(struct vmm_vcpu *vcpu)
 	vmm_free(vcpu->irqs.wfi.priv);
 	vcpu->irqs.wfi.priv = NULL;
 
+	/* Free pending bitmaps */
+	if (vcpu->irqs.pending) {
+		vmm_free(vcpu->irqs.pending);
+		vcpu->irqs.pending = NULL;
+	}
+
 	/* Free flags */
 	vmm_free(vcpu->irqs.irq);
 	vcpu->irqs.irq = NULL;
@@ -43,6 +43,34 @@
 static LIST_HEAD(rbd_list);
 static DEFINE_SPINLOCK(rbd_list_lock);
 
+static int rbd_sg_rw(struct rbd *d, struct vmm_request *r, bool read)
+{
+	u32 i;
+	virtual_addr_t va;
+	u64 nblocks = udiv64(d->size, RBD_BLOCK_SIZE);
+
+	/* Never access beyond the requested blocks or the RAM disk */
+	if ((vmm_request_sg_len(r) != ((u64)r->bcnt * RBD_BLOCK_SIZE)) ||
+	    (nblocks <= r->lba) || ((nblocks - r->lba) < r->bcnt)) {
+		return VMM_EIO;
+	}
+
+	va = d->va + r->lba * RBD_BLOCK_SIZE;
+
+	for (i = 0; i < r->sg_count; i++) {
+		if (read) {
+			vmm_host_memory_write(r->sg[i].addr, (void *)va,
+					      r->sg[i].len, TRUE);
+		} else {
+			vmm_host_memory_read(r->sg[i].addr, (void *)va,
+					     r->sg[i].len, TRUE);
+		}
+		va += r->sg[i].len;
+	}
+
+	return VMM_OK;
+}
+
 static int rbd_read_cache(struct vmm_blockrq *brq,
 			  struct vmm_request *r, void *priv)
 {
@@ -50,6 +78,10 @@ static int rbd_read_cache(struct vmm_blockrq *brq,
 	physical_addr_t pa;
 	physical_size_t sz;
 
+	if (r->sg_count) {
+		return rbd_sg_rw(d, r, TRUE);
+	}
+
 	pa = d->addr + r->lba * RBD_BLOCK_SIZE;
 	sz = r->bcnt * RBD_BLOCK_SIZE;
 
@@ -65,6 +97,10 @@ static int rbd_write_cache(struct vmm_blockrq *brq,
 	physical_addr_t pa;
 	physical_size_t sz;
 
+	if (r->sg_count) {
+		return rbd_sg_rw(d, r, FALSE);
+	}
+
 	pa = d->addr + r->lba * RBD_BLOCK_SIZE;
 	sz = r->bcnt * RBD_BLOCK_SIZE;
 
@@ -122,9 +158,17 @@ static struct rbd *__rbd_create(struct vmm_device *dev,
 	}
 	d->bdev->rq = vmm_blockrq_to_rq(brq);
 
+	/* Scatter-gather requests are only supported when we are
+	 * able to linearly map the RAM backing this device.
+	 */
+	d->va = vmm_host_memmap_linear(d->addr, d->size);
+	if (d->va) {
+		d->bdev->rq->sg_supported = TRUE;
+	}
+
 	/* Register block device instance */
 	if (vmm_blockdev_register(d->bdev)) {
-		goto free_bdev_rq;
+		goto unmap_rbd;
 	}
 
 	/* Reserve RAM space If required */
@@ -154,7 +198,10 @@ static struct rbd *__rbd_create(struct vmm_device *dev,
 
 unreg_bdev:
 	vmm_blockdev_unregister(d->bdev);
-free_bdev_rq:
+unmap_rbd:
+	if (d->va) {
+		vmm_host_memunmap_linear(d->va, d->size);
+	}
 	vmm_blockrq_destroy(vmm_rq_to_blockrq(d->bdev->rq));
 free_bdev:
 	vmm_blockdev_free(d->bdev);
@@ -193,6 +240,11 @@ void rbd_destroy(struct rbd *d)
 	/* Unregister block device */
 	vmm_blockdev_unregister(d->bdev);
 
+	/* Remove linear mapping */
+	if (d->va) {
+		vmm_host_memunmap_linear(d->va, d->size);
+	}
+
 	/* Free block device request queue */
 	vmm_blockrq_destroy(vmm_rq_to_blockrq(d->bdev->rq));
 
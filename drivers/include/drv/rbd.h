@@ -37,6 +37,7 @@ struct rbd {
 	struct vmm_blockdev *bdev;
 	physical_addr_t addr;
 	physical_size_t size;
+	virtual_addr_t va; /* Non-zero if linearly mapped */
 };
 
 /** Create RBD instance */
@@ -27,6 +27,7 @@
 #include <vmm_spinlocks.h>
 #include <vmm_modules.h>
 #include <vmm_devemu.h>
+#include <vmm_guest_aspace.h>
 #include <vio/vmm_vdisk.h>
 #include <vio/vmm_virtio.h>
 #include <vio/vmm_virtio_blk.h>
@@ -62,6 +63,9 @@ struct virtio_blk_dev_req {
 	u32				len;
 	struct vmm_virtio_iovec		status_iov;
 	void				*data;
+	struct vmm_request_sg		*sg;
+	u32				sg_count;
+	u32				sg_max;
 	struct vmm_vdisk_request	r;
 };
 
@@ -109,7 +113,7 @@ static int virtio_blk_init_vq(struct vmm_virtio_device *dev,
 
 	switch (vq) {
 	case VIRTIO_BLK_IO_QUEUE:
-		rc = vmm_virtio_queue_setup(&vbdev->vqs[vq], dev->guest,
+		rc = vmm_virtio_queue_setup(&vbdev->vqs[vq], dev,
 				pfn, page_size, VIRTIO_BLK_QUEUE_SIZE, align);
 		break;
 	default:
@@ -197,6 +201,95 @@ static void virtio_blk_req_done(struct virtio_blk_dev *vbdev,
 	}
 }
 
+static int virtio_blk_req_add_sg(struct virtio_blk_dev_req *req,
+				 physical_addr_t addr, u32 len)
+{
+	u32 new_max;
+	struct vmm_request_sg *new_sg, *last;
+
+	if (req->sg_count) {
+		last = &req->sg[req->sg_count - 1];
+		if ((last->addr + last->len) == addr) {
+			last->len += len;
+			return VMM_OK;
+		}
+	}
+
+	if (req->sg_count == req->sg_max) {
+		new_max = (req->sg_max) ? req->sg_max * 2 : 8;
+		new_sg = vmm_malloc(sizeof(*new_sg) * new_max);
+		if (!new_sg) {
+			return VMM_ENOMEM;
+		}
+		if (req->sg) {
+			memcpy(new_sg, req->sg,
+			       sizeof(*new_sg) * req->sg_count);
+			vmm_free(req->sg);
+		}
+		req->sg = new_sg;
+		req->sg_max = new_max;
+	}
+
+	req->sg[req->sg_count].addr = addr;
+	req->sg[req->sg_count].len = len;
+	req->sg_count++;
+
+	return VMM_OK;
+}
+
+/* Translate data iovecs of request to host physical segments so
+ * that block device can directly transfer data to/from guest RAM.
+ */
+static int virtio_blk_req_map_sg(struct vmm_virtio_device *dev,
+				 struct virtio_blk_dev_req *req,
+				 struct vmm_virtio_iovec *iov, u32 iov_cnt)
+{
+	int rc;
+	u32 i, reg_flags;
+	physical_addr_t gphys, hphys;
+	physical_size_t len, avail;
+
+	req->sg_count = 0;
+
+	for (i = 0; i < iov_cnt; i++) {
+		gphys = iov[i].addr;
+		len = iov[i].len;
+		while (len) {
+			rc = vmm_guest_physical_map(dev->guest, gphys, len,
+						    &hphys, &avail,
+						    &reg_flags);
+			if (rc || !avail) {
+				goto fail;
+			}
+			if (!(reg_flags & VMM_REGION_REAL) ||
+			    !(reg_flags & VMM_REGION_ISRAM)) {
+				goto fail;
+			}
+			if (virtio_blk_req_add_sg(req, hphys, avail)) {
+				goto fail;
+			}
+			gphys += avail;
+			len -= avail;
+		}
+	}
+
+	return VMM_OK;
+
+fail:
+	req->sg_count = 0;
+	return VMM_EFAIL;
+}
+
+static void virtio_blk_req_free_sg(struct virtio_blk_dev_req *req)
+{
+	if (req->sg) {
+		vmm_free(req->sg);
+	}
+	req->sg = NULL;
+	req->sg_count = 0;
+	req->sg_max = 0;
+}
+
 static void virtio_blk_attached(struct vmm_vdisk *vdisk)
 {
 	struct virtio_blk_dev *vbdev = vmm_vdisk_priv(vdisk);
@@ -255,19 +348,24 @@ static void virtio_blk_do_io(struct vmm_virtio_device *dev,
 
 	while (vmm_virtio_queue_available(vq)) {
 		thead = vmm_virtio_queue_pop(vq);
+		if (thead == VMM_VIRTIO_QUEUE_INVALID_HEAD) {
+			vmm_printf("%s: failed to pop queue\n", __func__);
+			break;
+		}
 		req = &vbdev->reqs[thead];
 		rc = vmm_virtio_queue_get_head_iovec(vq, thead, vbdev->iov,
 						     &iov_cnt, &len, &head);
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
 		req->vq = vq;
 		req->head = head;
 		req->read_iov = NULL;
 		req->read_iov_cnt = 0;
+		req->sg_count = 0;
 		req->len = 0;
 		for (i = 1; i < (iov_cnt - 1); i++) {
 			req->len += vbdev->iov[i].len;
@@ -287,6 +385,19 @@ static void virtio_blk_do_io(struct vmm_virtio_device *dev,
 		case VMM_VIRTIO_BLK_T_IN:
 			vmm_vdisk_set_request_type(&req->r,
 						   VMM_VDISK_REQUEST_READ);
+			if (!virtio_blk_req_map_sg(dev, req, &vbdev->iov[1],
+						   iov_cnt - 2)) {
+				DPRINTF("%s: VIRTIO_BLK_T_IN dev=%s "
+					"hdr.sector=%"PRIu64" req->len=%d "
+					"sg_count=%d\n", __func__, dev->name,
+					(u64)hdr.sector, req->len,
+					req->sg_count);
+				vmm_vdisk_submit_sg_request(vbdev->vdisk,
+						&req->r, VMM_VDISK_REQUEST_READ,
+						hdr.sector, req->sg,
+						req->sg_count);
+				break;
+			}
 			req->data = vmm_malloc(req->len);
 			if (!req->data) {
 				virtio_blk_req_done(vbdev, req,
@@ -319,6 +430,19 @@ static void virtio_blk_do_io(struct vmm_virtio_device *dev,
 		case VMM_VIRTIO_BLK_T_OUT:
 			vmm_vdisk_set_request_type(&req->r,
 						   VMM_VDISK_REQUEST_WRITE);
+			if (!virtio_blk_req_map_sg(dev, req, &vbdev->iov[1],
+						   iov_cnt - 2)) {
+				DPRINTF("%s: VIRTIO_BLK_T_OUT dev=%s "
+					"hdr.sector=%"PRIu64" req->len=%d "
+					"sg_count=%d\n", __func__, dev->name,
+					(u64)hdr.sector, req->len,
+					req->sg_count);
+				vmm_vdisk_submit_sg_request(vbdev->vdisk,
+						&req->r, VMM_VDISK_REQUEST_WRITE,
+						hdr.sector, req->sg,
+						req->sg_count);
+				break;
+			}
 			req->data = vmm_malloc(req->len);
 			if (!req->data) {
 				virtio_blk_req_done(vbdev, req,
@@ -467,6 +591,7 @@ static int virtio_blk_reset(struct vmm_virtio_device *dev)
 					VMM_VDISK_REQUEST_UNKNOWN) {
 			vmm_vdisk_abort_request(vbdev->vdisk, &req->r);
 		}
+		virtio_blk_req_free_sg(req);
 		memset(req, 0, sizeof(*req));
 		vmm_vdisk_set_request_type(&req->r,
 					   VMM_VDISK_REQUEST_UNKNOWN);
@@ -523,11 +648,15 @@ static int virtio_blk_connect(struct vmm_virtio_device *dev,
 
 static void virtio_blk_disconnect(struct vmm_virtio_device *dev)
 {
+	int i;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
 	DPRINTF("%s: dev=%s\n", __func__, dev->name);
 
 	vmm_vdisk_destroy(vbdev->vdisk);
+	for (i = 0; i < VIRTIO_BLK_QUEUE_SIZE; i++) {
+		virtio_blk_req_free_sg(&vbdev->reqs[i]);
+	}
 	vmm_free(vbdev);
 }
 
@@ -83,7 +83,7 @@ static int virtio_console_init_vq(struct vmm_virtio_device *dev,
 	switch (vq) {
 	case VIRTIO_CONSOLE_RX_QUEUE:
 	case VIRTIO_CONSOLE_TX_QUEUE:
-		rc = vmm_virtio_queue_setup(&cdev->vqs[vq], dev->guest,
+		rc = vmm_virtio_queue_setup(&cdev->vqs[vq], dev,
 			pfn, page_size, VIRTIO_CONSOLE_QUEUE_SIZE, align);
 		break;
 	default:
@@ -153,7 +153,7 @@ static int virtio_console_do_tx(struct vmm_virtio_device *dev,
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
 		for (i = 0; i < iov_cnt; i++) {
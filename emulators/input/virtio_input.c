@@ -113,7 +113,7 @@ static int virtio_input_init_vq(struct vmm_virtio_device *dev,
 	switch (vq) {
 	case VIRTIO_INPUT_EVENT_QUEUE:
 	case VIRTIO_INPUT_STATUS_QUEUE:
-		rc = vmm_virtio_queue_setup(&videv->vqs[vq], dev->guest,
+		rc = vmm_virtio_queue_setup(&videv->vqs[vq], dev,
 			pfn, page_size, VIRTIO_INPUT_QUEUE_SIZE, align);
 		break;
 	default:
@@ -353,7 +353,7 @@ static void virtio_input_do_status(struct vmm_virtio_device *dev,
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
 		DPRINTF("%s: dev=%s iov_cnt=%d total_len=%d\n",
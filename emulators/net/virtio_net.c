@@ -24,6 +24,8 @@
 #include <vmm_error.h>
 #include <vmm_heap.h>
 #include <vmm_modules.h>
+#include <vmm_spinlocks.h>
+#include <vmm_manager.h>
 #include <vmm_devemu.h>
 #include <vio/vmm_virtio.h>
 #include <vio/vmm_virtio_net.h>
@@ -33,7 +35,8 @@
 #include <net/vmm_net.h>
 #include <net/vmm_netswitch.h>
 #include <net/vmm_netport.h>
-#include <net/vmm_mbuf.h>
+#include <net/vmm_netoffload.h>
+#include <libs/mathlib.h>
 
 #define MODULE_DESC			"VirtIO Net Emulator"
 #define MODULE_AUTHOR			"Pranav Sawargaonkar"
@@ -57,9 +60,11 @@ struct virtio_net_queue {
 	int num;
 	int valid;
 	int type;
+	vmm_spinlock_t lock;
 	struct vmm_netport_lazy lazy;
 	struct vmm_virtio_queue vq;
 	struct vmm_virtio_iovec iov[VIRTIO_NET_QUEUE_SIZE];
+	struct vmm_vring_used_elem used[VIRTIO_NET_QUEUE_SIZE];
 	struct virtio_net_dev *ndev;
 };
 
@@ -69,6 +74,7 @@ struct virtio_net_dev {
 	struct virtio_net_queue *vqs;
 	u32 cq;		/* Configuration queue number */
 	u32 max_queues;
+	u32 curr_queue_pairs;
 	u32 can_receive;
 	struct vmm_virtio_net_config config;
 	u64 features;
@@ -81,19 +87,19 @@ struct virtio_net_dev {
 static u64 virtio_net_get_host_features(struct vmm_virtio_device *dev)
 {
 	return 1UL << VMM_VIRTIO_NET_F_MAC
-#if 0
 		| 1UL << VMM_VIRTIO_NET_F_CSUM
-		| 1UL << VMM_VIRTIO_NET_F_HOST_UFO
 		| 1UL << VMM_VIRTIO_NET_F_HOST_TSO4
 		| 1UL << VMM_VIRTIO_NET_F_HOST_TSO6
-		| 1UL << VMM_VIRTIO_NET_F_GUEST_UFO
+		| 1UL << VMM_VIRTIO_NET_F_GUEST_CSUM
 		| 1UL << VMM_VIRTIO_NET_F_GUEST_TSO4
 		| 1UL << VMM_VIRTIO_NET_F_GUEST_TSO6
+		| 1UL << VMM_VIRTIO_NET_F_MRG_RXBUF
+#if 0
+		| 1UL << VMM_VIRTIO_NET_F_HOST_UFO
+		| 1UL << VMM_VIRTIO_NET_F_GUEST_UFO
 #endif
 		| 1UL << VMM_VIRTIO_RING_F_EVENT_IDX
-#if 0
 		| 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC
-#endif
 		| 1UL << VMM_VIRTIO_NET_F_MQ
 		| 1UL << VMM_VIRTIO_NET_F_CTRL_VQ
 		;
@@ -117,7 +123,7 @@ static int virtio_net_init_vq(struct vmm_virtio_device *dev,
 	int rc;
 	struct virtio_net_dev *ndev = dev->emu_data;
 
-	rc = vmm_virtio_queue_setup(&ndev->vqs[vq].vq, dev->guest,
+	rc = vmm_virtio_queue_setup(&ndev->vqs[vq].vq, dev,
 				pfn, page_size, VIRTIO_NET_QUEUE_SIZE, align);
 	if (rc == VMM_OK) {
 		ndev->vqs[vq].valid = 1;
@@ -154,6 +160,77 @@ static int virtio_net_set_size_vq(struct vmm_virtio_device *dev,
 
 static void virtio_net_tx_poke(struct virtio_net_dev *ndev, u32 vq);
 
+/* Modern (VirtIO 1.x) guest always has num_buffers in header */
+static u32 virtio_net_hdr_len(struct virtio_net_dev *ndev)
+{
+	if (ndev->features & ((1ULL << VMM_VIRTIO_NET_F_MRG_RXBUF) |
+			      (1ULL << VMM_VIRTIO_F_VERSION_1))) {
+		return sizeof(struct vmm_virtio_net_hdr_mrg_rxbuf);
+	}
+
+	return sizeof(struct vmm_virtio_net_hdr);
+}
+
+/* Skip given number of bytes (and empty vectors) at start of IO vectors
+ * because header and packet data can share descriptors (ANY_LAYOUT).
+ */
+static struct vmm_virtio_iovec *virtio_net_iov_skip(
+					struct vmm_virtio_iovec *iov,
+					u32 *iov_cnt, u32 len)
+{
+	while (*iov_cnt && (len || !iov->len)) {
+		if (iov->len <= len) {
+			len -= iov->len;
+			iov++;
+			(*iov_cnt)--;
+		} else {
+			iov->addr += len;
+			iov->len -= len;
+			len = 0;
+		}
+	}
+
+	return iov;
+}
+
+/* Translate offload info of guest TX packet into mbuf */
+static bool virtio_net_tx_offload(struct vmm_virtio_net_hdr *hdr,
+				  struct vmm_mbuf *mb)
+{
+	if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+		if (mb->m_pktlen < (hdr->csum_start + hdr->csum_offset + 2)) {
+			return FALSE;
+		}
+		mb->m_flags |= M_CSUM_PARTIAL;
+		mb->m_csum_start = hdr->csum_start;
+		mb->m_csum_offset = hdr->csum_offset;
+	}
+
+	switch (hdr->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) {
+	case VIRTIO_NET_HDR_GSO_NONE:
+		return (mb->m_pktlen <= VIRTIO_NET_MTU) ? TRUE : FALSE;
+	case VIRTIO_NET_HDR_GSO_TCPV4:
+		mb->m_gso_type = M_GSO_TCPV4;
+		break;
+	case VIRTIO_NET_HDR_GSO_TCPV6:
+		mb->m_gso_type = M_GSO_TCPV6;
+		break;
+	default:
+		return FALSE;
+	};
+
+	/* Tiny segments make software segmentation too costly */
+	if ((hdr->gso_size < VMM_NETOFFLOAD_GSO_MIN_MSS) ||
+	    (hdr->gso_size > VIRTIO_NET_MTU) ||
+	    (udiv32(mb->m_pktlen + hdr->gso_size - 1, hdr->gso_size) >
+					VMM_NETOFFLOAD_GSO_MAX_SEGS)) {
+		return FALSE;
+	}
+	mb->m_gso_size = hdr->gso_size;
+
+	return TRUE;
+}
+
 static void virtio_net_tx_lazy(struct vmm_netport *port, void *arg, int budget)
 {
 	int rc;
@@ -163,8 +240,12 @@ static void virtio_net_tx_lazy(struct vmm_netport *port, void *arg, int budget)
 	struct virtio_net_dev *ndev = q->ndev;
 	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_device *dev = ndev->vdev;
-	struct vmm_virtio_iovec *iov = q->iov;
-	struct vmm_mbuf *mb;
+	struct vmm_virtio_iovec *data, *iov = q->iov;
+	u32 hdr_len = virtio_net_hdr_len(ndev);
+	struct vmm_virtio_net_hdr hdr;
+	struct vmm_mbuf *mb, *mbs[VMM_NETSWITCH_BURST_SIZE];
+	struct vmm_vring_used_elem used[VMM_NETSWITCH_BURST_SIZE];
+	u32 mb_cnt = 0, used_cnt = 0;
 
 	while ((budget > 0) && vmm_virtio_queue_available(vq)) {
 		rc = vmm_virtio_queue_get_iovec(vq, iov,
@@ -172,27 +253,53 @@ static void virtio_net_tx_lazy(struct vmm_netport *port, void *arg, int budget)
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
-		/* iov[0] is offload info */
-		pkt_len = total_len - iov[0].len;
+		/* Offload info is followed by packet data */
+		pkt_len = (total_len > hdr_len) ? (total_len - hdr_len) : 0;
+		memset(&hdr, 0, sizeof(hdr));
+		vmm_virtio_iovec_to_buf_read(dev, iov, iov_cnt,
+					     &hdr, sizeof(hdr));
+		data = virtio_net_iov_skip(iov, &iov_cnt, hdr_len);
 
-		if (pkt_len <= VIRTIO_NET_MTU) {
+		/* GSO super-frames are forwarded without segmentation */
+		mb = NULL;
+		if (pkt_len && (pkt_len <= VMM_NETOFFLOAD_GSO_MAX_SIZE)) {
 			MGETHDR(mb, 0, 0);
-			MEXTMALLOC(mb, pkt_len, 0);
-			vmm_virtio_iovec_to_buf_read(dev,
-						 &iov[1], iov_cnt - 1,
-						 M_BUFADDR(mb), pkt_len);
+		}
+		if (mb && !MEXTMALLOC(mb, pkt_len, 0)) {
+			m_freem(mb);
+			mb = NULL;
+		}
+		if (mb) {
+			vmm_virtio_iovec_to_buf_read(dev, data, iov_cnt,
+						     M_BUFADDR(mb), pkt_len);
 			mb->m_len = mb->m_pktlen = pkt_len;
-			vmm_port2switch_xfer_mbuf(ndev->port, mb);
+			if (virtio_net_tx_offload(&hdr, mb)) {
+				mbs[mb_cnt++] = mb;
+			} else {
+				m_freem(mb);
+			}
 		}
 
-		vmm_virtio_queue_set_used_elem(vq, head, total_len);
+		used[used_cnt].id = head;
+		used[used_cnt].len = total_len;
+		used_cnt++;
+
+		/* Hand over full burst to netswitch */
+		if (used_cnt == VMM_NETSWITCH_BURST_SIZE) {
+			vmm_port2switch_xfer_burst(ndev->port, mbs, mb_cnt);
+			vmm_virtio_queue_set_used_elems(vq, used, used_cnt);
+			mb_cnt = used_cnt = 0;
+		}
 
 		budget--;
 	}
 
+	vmm_port2switch_xfer_burst(ndev->port, mbs, mb_cnt);
+	vmm_virtio_queue_set_used_elems(vq, used, used_cnt);
+
 	if (vmm_virtio_queue_should_signal(vq)) {
 		dev->tra->notify(dev, q->num);
 	}
@@ -202,9 +309,23 @@ static void virtio_net_tx_lazy(struct vmm_netport *port, void *arg, int budget)
 
 static void virtio_net_tx_poke(struct virtio_net_dev *ndev, u32 vq)
 {
+	u32 hcpu;
+	struct vmm_vcpu *vcpu;
 	struct virtio_net_queue *q = &ndev->vqs[vq];
 
 	if (vmm_virtio_queue_available(&q->vq)) {
+		/*
+		 * Queue pair N is affine to guest VCPU N (same as what
+		 * guest drivers assume) so we process TX of queue pair N
+		 * on host CPU currently running guest VCPU N. This keeps
+		 * different queue pairs on different netswitch bottom-halves.
+		 */
+		vcpu = vmm_manager_guest_vcpu(ndev->vdev->guest, vq / 2);
+		if (vcpu && !vmm_manager_vcpu_get_hcpu(vcpu, &hcpu)) {
+			q->lazy.cpu = hcpu;
+		} else {
+			q->lazy.cpu = -1;
+		}
 		vmm_port2switch_xfer_lazy(&q->lazy);
 	}
 }
@@ -228,7 +349,7 @@ static void virtio_net_handle_ctrl(struct virtio_net_dev *ndev, u32 qnum)
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
 		status = VMM_VIRTIO_NET_ERR;
@@ -254,9 +375,18 @@ static void virtio_net_handle_ctrl(struct virtio_net_dev *ndev, u32 qnum)
 			vmm_virtio_iovec_to_buf_read(dev, &iov[1], 1,
 						     &ctrl_mq, sizeof(ctrl_mq));
 
-			if (ctrl_mq.virtqueue_pairs < ndev->max_queues) {
-				status = VMM_VIRTIO_NET_OK;
+			if (!(ndev->features & (1UL << VMM_VIRTIO_NET_F_MQ)) ||
+			    (ctrl_hdr.cmd !=
+				VMM_VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET) ||
+			    (ctrl_mq.virtqueue_pairs <
+				VMM_VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MIN) ||
+			    (ndev->config.max_virtqueue_pairs <
+				ctrl_mq.virtqueue_pairs)) {
+				break;
 			}
+
+			ndev->curr_queue_pairs = ctrl_mq.virtqueue_pairs;
+			status = VMM_VIRTIO_NET_OK;
 			break;
 		default:
 			vmm_printf("%s: IOV Class %d is not handled\n",
@@ -317,6 +447,20 @@ static void virtio_net_status_changed(struct vmm_virtio_device *dev,
 	} else {
 		ndev->can_receive = 0;
 	}
+
+	/* Let netswitch do offloads which guest did not negotiate */
+	ndev->port->flags &= ~(VMM_NETPORT_CSUM_OFFLOAD |
+			       VMM_NETPORT_GSO_OFFLOAD);
+	if (ndev->can_receive &&
+	    (ndev->features & (1UL << VMM_VIRTIO_NET_F_GUEST_CSUM))) {
+		ndev->port->flags |= VMM_NETPORT_CSUM_OFFLOAD;
+		if ((ndev->features &
+		     (1UL << VMM_VIRTIO_NET_F_GUEST_TSO4)) &&
+		    (ndev->features &
+		     (1UL << VMM_VIRTIO_NET_F_GUEST_TSO6))) {
+			ndev->port->flags |= VMM_NETPORT_GSO_OFFLOAD;
+		}
+	}
 }
 
 static void virtio_net_link_changed(struct vmm_netport *p)
@@ -331,22 +475,95 @@ static int virtio_net_can_receive(struct vmm_netport *p)
 	return ndev->can_receive;
 }
 
-static int virtio_net_switch2port_xfer(struct vmm_netport *p,
-				       struct vmm_mbuf *mb)
+static u32 virtio_net_flow_hash(struct vmm_mbuf *mb)
+{
+	u32 h, ihl, ports = 0;
+	u8 *ip, *l4, *pkt = mtod(mb, u8 *);
+	struct ip_header *iph;
+
+	if ((mb->m_len < (ETHER_HLEN + IP4_HLEN)) ||
+	    (ether_type(pkt) != 0x0800 /* IPv4 */)) {
+		return 0;
+	}
+
+	ip = ether_payload(pkt);
+	iph = (struct ip_header *)ip;
+	ihl = (iph->vhl & 0xf) << 2;
+	if (ihl < IP4_HLEN) {
+		return 0;
+	}
+
+	/* Use ports only for non-fragmented TCP (6) and UDP (17) */
+	l4 = ip + ihl;
+	if (((ip_protocol(ip) == 0x06) || (ip_protocol(ip) == 0x11)) &&
+	    !(vmm_be16_to_cpu(iph->ipoffset) & 0x3fff) &&
+	    ((l4 + 4) <= (pkt + mb->m_len))) {
+		ports = ((u32)tcp_srcport(l4) << 16) | tcp_dstport(l4);
+	}
+
+	/* Simple 5-tuple hash (same flow always maps to same queue) */
+	h = ((u32)ip_srcaddr(ip)[0] << 24) | ((u32)ip_srcaddr(ip)[1] << 16) |
+	    ((u32)ip_srcaddr(ip)[2] << 8) | (u32)ip_srcaddr(ip)[3];
+	h ^= ((u32)ip_dstaddr(ip)[0] << 24) | ((u32)ip_dstaddr(ip)[1] << 16) |
+	     ((u32)ip_dstaddr(ip)[2] << 8) | (u32)ip_dstaddr(ip)[3];
+	h ^= ports ^ ip_protocol(ip);
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static struct virtio_net_queue *virtio_net_rx_queue(
+					struct virtio_net_dev *ndev,
+					struct vmm_mbuf *mb)
+{
+	return &ndev->vqs[2 * (virtio_net_flow_hash(mb) %
+			       ndev->curr_queue_pairs)];
+}
+
+/* Translate offload info of mbuf for guest RX */
+static void virtio_net_rx_offload(struct vmm_virtio_net_hdr *hdr,
+				  struct vmm_mbuf *mb)
+{
+	memset(hdr, 0, sizeof(*hdr));
+
+	if (mb->m_flags & M_CSUM_PARTIAL) {
+		hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr->csum_start = mb->m_csum_start;
+		hdr->csum_offset = mb->m_csum_offset;
+	}
+
+	switch (mb->m_gso_type) {
+	case M_GSO_TCPV4:
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+		break;
+	case M_GSO_TCPV6:
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+		break;
+	default:
+		return;
+	};
+	hdr->gso_size = mb->m_gso_size;
+	hdr->hdr_len = vmm_netoffload_hdrlen(mb);
+}
+
+/* Must be called with q->lock held */
+static bool virtio_net_rx_one(struct virtio_net_dev *ndev,
+			      struct virtio_net_queue *q,
+			      struct vmm_mbuf *mb,
+			      struct vmm_vring_used_elem *used)
 {
 	int rc;
 	u16 head = 0;
 	u64 iov0_addr;
 	u32 iov_cnt = 0, iov0_len, total_len = 0, pkt_len = 0;
-	struct virtio_net_dev *ndev = p->priv;
-	/* FIXME: Select correct RX queue here  */
-	struct virtio_net_queue *q = &ndev->vqs[0];
 	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_iovec *iov = q->iov;
 	struct vmm_virtio_device *dev = ndev->vdev;
 	struct vmm_virtio_net_hdr hdr;
 
-	pkt_len = min(VIRTIO_NET_MTU, mb->m_pktlen);
+	pkt_len = mb->m_pktlen;
 
 	if (vmm_virtio_queue_available(vq)) {
 		rc = vmm_virtio_queue_get_iovec(vq, iov,
@@ -354,11 +571,21 @@ static int virtio_net_switch2port_xfer(struct vmm_netport *p,
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			return rc;
+			/* Don't lose the popped guest buffer */
+			vmm_virtio_queue_unpop(vq, 1);
+			return FALSE;
 		}
 	}
 
-	memset(&hdr, 0, sizeof(hdr));
+	/* Drop packet which does not fit in guest buffer */
+	if (((iov_cnt == 1) && (total_len < (sizeof(hdr) + pkt_len))) ||
+	    ((iov_cnt > 1) && ((total_len - iov[0].len) < pkt_len))) {
+		used->id = head;
+		used->len = 0;
+		return TRUE;
+	}
+
+	virtio_net_rx_offload(&hdr, mb);
 	if (iov_cnt == 1) {
 		vmm_virtio_buf_to_iovec_write(dev, &iov[0], 1,
 					      &hdr, sizeof(hdr));
@@ -368,8 +595,7 @@ static int virtio_net_switch2port_xfer(struct vmm_netport *p,
 		iov[0].len -= sizeof(hdr);
 		vmm_virtio_buf_to_iovec_write(dev, &iov[0], 1,
 					      M_BUFADDR(mb), pkt_len);
-		vmm_virtio_queue_set_used_elem(vq, head,
-					       sizeof(hdr) + pkt_len);
+		used->len = sizeof(hdr) + pkt_len;
 		iov[0].addr = iov0_addr;
 		iov[0].len = iov0_len;
 	} else if (iov_cnt > 1) {
@@ -377,19 +603,169 @@ static int virtio_net_switch2port_xfer(struct vmm_netport *p,
 					      &hdr, sizeof(hdr));
 		vmm_virtio_buf_to_iovec_write(dev, &iov[1], iov_cnt - 1,
 					      M_BUFADDR(mb), pkt_len);
-		vmm_virtio_queue_set_used_elem(vq, head, iov[0].len + pkt_len);
+		used->len = iov[0].len + pkt_len;
+	} else {
+		return FALSE;
 	}
+	used->id = head;
 
-	if (vmm_virtio_queue_should_signal(vq)) {
-		/* FIXME: Select correct RX queue here  */
-		dev->tra->notify(dev, 0);
+	return TRUE;
+}
+
+/*
+ * With mergeable RX buffers, packet is spread over as many guest
+ * buffers as required and header in first buffer has number of
+ * buffers used. Modern guest without mergeable RX buffers has same
+ * header so it is called with max_used = 1. Must be called with
+ * q->lock held.
+ */
+static u32 virtio_net_rx_mrg(struct virtio_net_dev *ndev,
+			     struct virtio_net_queue *q,
+			     struct vmm_mbuf *mb,
+			     struct vmm_vring_used_elem *used,
+			     u32 max_used)
+{
+	int rc;
+	u16 head = 0;
+	u32 iov_cnt = 0, total_len = 0, pkt_len, pos = 0, len, skip;
+	u32 cnt = 0;
+	struct vmm_virtio_queue *vq = &q->vq;
+	struct vmm_virtio_iovec hdr_iov, *data, *iov = q->iov;
+	struct vmm_virtio_device *dev = ndev->vdev;
+	struct vmm_virtio_net_hdr_mrg_rxbuf hdr;
+
+	pkt_len = mb->m_pktlen;
+
+	do {
+		if ((cnt == max_used) || !vmm_virtio_queue_available(vq)) {
+			goto fail;
+		}
+		rc = vmm_virtio_queue_get_iovec(vq, iov,
+						&iov_cnt, &total_len, &head);
+		if (rc) {
+			vmm_printf("%s: failed to get iovec (error %d)\n",
+				   __func__, rc);
+			/* Give back popped guest buffer along with others */
+			cnt++;
+			goto fail;
+		}
+
+		/* Header is in first descriptor of first buffer */
+		skip = 0;
+		data = iov;
+		if (!cnt) {
+			if (!iov_cnt || (iov[0].len < sizeof(hdr))) {
+				used->id = head;
+				used->len = 0;
+				return 1;
+			}
+			hdr_iov = iov[0];
+			hdr_iov.len = sizeof(hdr);
+			skip = sizeof(hdr);
+			data = virtio_net_iov_skip(iov, &iov_cnt, skip);
+		}
+
+		len = min(total_len - skip, pkt_len - pos);
+		vmm_virtio_buf_to_iovec_write(dev, data, iov_cnt,
+					      M_BUFADDR(mb) + pos, len);
+		used[cnt].id = head;
+		used[cnt].len = skip + len;
+		cnt++;
+		pos += len;
+	} while (pos < pkt_len);
+
+	virtio_net_rx_offload(&hdr.hdr, mb);
+	hdr.num_buffers = cnt;
+	vmm_virtio_buf_to_iovec_write(dev, &hdr_iov, 1, &hdr, sizeof(hdr));
+
+	return cnt;
+
+fail:
+	/* Give back partially filled buffers and drop packet */
+	vmm_virtio_queue_unpop(vq, cnt);
+	return 0;
+}
+
+/* Fill mbufs in given RX queue with one used index update and
+ * atmost one guest notification for every VMM_NETSWITCH_BURST_SIZE
+ * used guest buffers.
+ */
+static void virtio_net_rx_fill(struct virtio_net_dev *ndev,
+			       struct virtio_net_queue *q,
+			       struct vmm_mbuf **mbs, u32 count)
+{
+	irq_flags_t flags;
+	u32 i, used_cnt = 0;
+	struct vmm_virtio_queue *vq = &q->vq;
+	struct vmm_virtio_device *dev = ndev->vdev;
+	struct vmm_vring_used_elem *used = q->used;
+
+	/* Each RX queue is filled independently */
+	vmm_spin_lock_irqsave_lite(&q->lock, flags);
+
+	for (i = 0; i < count; i++) {
+		if (ndev->features & (1UL << VMM_VIRTIO_NET_F_MRG_RXBUF)) {
+			used_cnt += virtio_net_rx_mrg(ndev, q, mbs[i],
+					&used[used_cnt],
+					VIRTIO_NET_QUEUE_SIZE - used_cnt);
+		} else if (ndev->features &
+			   (1ULL << VMM_VIRTIO_F_VERSION_1)) {
+			used_cnt += virtio_net_rx_mrg(ndev, q, mbs[i],
+						      &used[used_cnt], 1);
+		} else if (virtio_net_rx_one(ndev, q, mbs[i],
+					     &used[used_cnt])) {
+			used_cnt++;
+		}
+		if ((used_cnt >= VMM_NETSWITCH_BURST_SIZE) ||
+		    (used_cnt && (i == (count - 1)))) {
+			vmm_virtio_queue_set_used_elems(vq, used, used_cnt);
+			used_cnt = 0;
+			if (vmm_virtio_queue_should_signal(vq)) {
+				dev->tra->notify(dev, q->num);
+			}
+		}
+	}
+
+	vmm_spin_unlock_irqrestore_lite(&q->lock, flags);
+
+	for (i = 0; i < count; i++) {
+		m_freem(mbs[i]);
+	}
+}
+
+static int virtio_net_switch2port_xfer_burst(struct vmm_netport *p,
+					     struct vmm_mbuf **mbs, u32 count)
+{
+	u32 i, j;
+	struct virtio_net_dev *ndev = p->priv;
+	struct virtio_net_queue *q, *nq = NULL;
+
+	if (!count) {
+		return VMM_OK;
 	}
 
-	m_freem(mb);
+	/* Consecutive mbufs of same RX queue are filled together */
+	q = virtio_net_rx_queue(ndev, mbs[0]);
+	for (i = 0; i < count; i = j) {
+		for (j = i + 1; j < count; j++) {
+			nq = virtio_net_rx_queue(ndev, mbs[j]);
+			if (nq != q) {
+				break;
+			}
+		}
+		virtio_net_rx_fill(ndev, q, &mbs[i], j - i);
+		q = nq;
+	}
 
 	return VMM_OK;
 }
 
+static int virtio_net_switch2port_xfer(struct vmm_netport *p,
+				       struct vmm_mbuf *mb)
+{
+	return virtio_net_switch2port_xfer_burst(p, &mb, 1);
+}
+
 static int virtio_net_read_config(struct vmm_virtio_device *dev,
 				  u32 offset, void *dst, u32 dst_len)
 {
@@ -432,7 +808,10 @@ static int virtio_net_reset(struct vmm_virtio_device *dev)
 		}
 		ndev->vqs[i].valid = 0;
 	}
+	ndev->curr_queue_pairs = 1;
 	ndev->can_receive = 0;
+	ndev->port->flags &= ~(VMM_NETPORT_CSUM_OFFLOAD |
+			       VMM_NETPORT_GSO_OFFLOAD);
 
 	return VMM_OK;
 }
@@ -463,6 +842,8 @@ static int virtio_net_connect(struct vmm_virtio_device *dev,
 	ndev->port->link_changed = virtio_net_link_changed;
 	ndev->port->can_receive = virtio_net_can_receive;
 	ndev->port->switch2port_xfer = virtio_net_switch2port_xfer;
+	ndev->port->switch2port_xfer_burst = virtio_net_switch2port_xfer_burst;
+	ndev->port->flags |= VMM_NETPORT_MULTIQUEUE;
 	ndev->port->priv = ndev;
 
 	ndev->config.max_virtqueue_pairs = dev->guest->vcpu_count;
@@ -479,11 +860,13 @@ static int virtio_net_connect(struct vmm_virtio_device *dev,
 	ndev->config.status = VMM_VIRTIO_NET_S_LINK_UP;
 	ndev->cq = ndev->config.max_virtqueue_pairs * 2;
 	ndev->max_queues = ndev->config.max_virtqueue_pairs * 2 + 1;
+	ndev->curr_queue_pairs = 1;
 	dev->emu_data = ndev;
 
 	for (i = 0; i < ndev->max_queues; i++) {
 		ndev->vqs[i].num = i;
 		ndev->vqs[i].valid = 0;
+		INIT_SPIN_LOCK(&ndev->vqs[i].lock);
 		ndev->vqs[i].ndev = ndev;
 		if (i == ndev->cq) {
 			ndev->vqs[i].type = VIRTIO_NET_CTRL_QUEUE;
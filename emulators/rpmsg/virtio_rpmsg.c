@@ -113,7 +113,7 @@ static int virtio_rpmsg_init_vq(struct vmm_virtio_device *dev,
 	switch (vq) {
 	case VIRTIO_RPMSG_RX_QUEUE:
 	case VIRTIO_RPMSG_TX_QUEUE:
-		rc = vmm_virtio_queue_setup(&rdev->vqs[vq], dev->guest,
+		rc = vmm_virtio_queue_setup(&rdev->vqs[vq], dev,
 			pfn, page_size, VIRTIO_RPMSG_QUEUE_SIZE, align);
 		break;
 	default:
@@ -207,7 +207,7 @@ void virtio_rpmsg_tx_msgs(struct vmm_vmsg_node *node, void *data, int budget)
 		if (rc) {
 			vmm_printf("%s: failed to get iovec (error %d)\n",
 				   __func__, rc);
-			continue;
+			break;
 		}
 
 		DPRINTF("%s: node=%s iov_cnt=%d total_len=0x%x\n",
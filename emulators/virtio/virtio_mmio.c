@@ -24,6 +24,8 @@
 #include <vmm_error.h>
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
+#include <vmm_host_aspace.h>
 #include <vmm_modules.h>
 #include <vmm_devemu.h>
 #include <vio/vmm_virtio.h>
@@ -36,11 +38,27 @@
 #define	MODULE_INIT			virtio_mmio_init
 #define	MODULE_EXIT			virtio_mmio_exit
 
+struct virtio_mmio_doorbell {
+	struct dlist head;
+	struct vmm_devemu_doorbell db;
+};
+
+/* Max queues which can be marked ready in version 2 (modern) */
+#define VIRTIO_MMIO_MAX_READY_QUEUES	64
+
 struct virtio_mmio_dev {
 	struct vmm_guest *guest;
 	struct vmm_virtio_device dev;
 	struct vmm_virtio_mmio_config config;
+	/* Version 2 (modern) only state */
+	u64 guest_features;
+	u64 queue_ready;
+	physical_addr_t queue_desc;
+	physical_addr_t queue_avail;
+	physical_addr_t queue_used;
 	u32 irq;
+	vmm_spinlock_t db_lock;
+	struct dlist db_list;
 };
 
 static int virtio_mmio_notify(struct vmm_virtio_device *dev, u32 vq)
@@ -54,6 +72,162 @@ static int virtio_mmio_notify(struct vmm_virtio_device *dev, u32 vq)
 	return VMM_OK;
 }
 
+static void virtio_mmio_doorbell_handle(struct vmm_devemu_doorbell *db,
+					u64 value)
+{
+	struct virtio_mmio_dev *m = db->priv;
+
+	m->dev.emu->notify_vq(&m->dev, (u32)value);
+}
+
+/* Let QueueNotify writes for given queue bypass MMIO emulation and
+ * get processed from doorbell workqueue. On failure, QueueNotify
+ * writes continue to be handled by virtio_mmio_config_write().
+ */
+static void virtio_mmio_add_doorbell(struct virtio_mmio_dev *m, u32 vq)
+{
+	irq_flags_t flags;
+	struct virtio_mmio_doorbell *vdb;
+
+	vmm_spin_lock_irqsave(&m->db_lock, flags);
+	list_for_each_entry(vdb, &m->db_list, head) {
+		if (vdb->db.value == vq) {
+			vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+			return;
+		}
+	}
+	vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+
+	vdb = vmm_zalloc(sizeof(*vdb));
+	if (!vdb) {
+		return;
+	}
+	INIT_LIST_HEAD(&vdb->head);
+	vdb->db.gphys_addr = m->dev.edev->reg->gphys_addr +
+			     VMM_VIRTIO_MMIO_QUEUE_NOTIFY;
+	vdb->db.len = 4;
+	vdb->db.flags = VMM_DEVEMU_DOORBELL_MATCH_VALUE |
+			VMM_DEVEMU_DOORBELL_DEFERRED;
+	vdb->db.value = vq;
+	vdb->db.handle = virtio_mmio_doorbell_handle;
+	vdb->db.priv = m;
+
+	if (vmm_devemu_register_doorbell(m->guest, &vdb->db)) {
+		vmm_free(vdb);
+		return;
+	}
+
+	vmm_spin_lock_irqsave(&m->db_lock, flags);
+	list_add_tail(&vdb->head, &m->db_list);
+	vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+}
+
+/* Remove doorbell of given queue so that no deferred notification
+ * can run while the queue is being torn down or re-initialized.
+ */
+static void virtio_mmio_del_doorbell(struct virtio_mmio_dev *m, u32 vq)
+{
+	irq_flags_t flags;
+	struct virtio_mmio_doorbell *vdb, *found = NULL;
+
+	vmm_spin_lock_irqsave(&m->db_lock, flags);
+	list_for_each_entry(vdb, &m->db_list, head) {
+		if (vdb->db.value == vq) {
+			found = vdb;
+			list_del(&found->head);
+			break;
+		}
+	}
+	vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+
+	if (found) {
+		vmm_devemu_unregister_doorbell(&found->db);
+		vmm_free(found);
+	}
+}
+
+static u64 virtio_mmio_host_features(struct virtio_mmio_dev *m)
+{
+	u64 features = m->dev.emu->get_host_features(&m->dev);
+
+	/* Modern transport is always able to offer packed virtqueue */
+	if (m->config.version > 1) {
+		features |= (1ULL << VMM_VIRTIO_F_VERSION_1) |
+			    (1ULL << VMM_VIRTIO_F_RING_PACKED);
+	}
+
+	return features;
+}
+
+static void virtio_mmio_set_addr(physical_addr_t *addr, bool high, u32 val)
+{
+	u64 tmp = *addr;
+
+	if (high) {
+		tmp = (tmp & 0xFFFFFFFFULL) | ((u64)val << 32);
+	} else {
+		tmp = (tmp & ~0xFFFFFFFFULL) | val;
+	}
+
+	*addr = (physical_addr_t)tmp;
+}
+
+/* Setup selected queue using addresses programmed by modern guest */
+static void virtio_mmio_queue_ready(struct virtio_mmio_dev *m, u32 val)
+{
+	int rc;
+	u32 sel = m->config.queue_sel;
+
+	if (sel >= VIRTIO_MMIO_MAX_READY_QUEUES) {
+		return;
+	}
+
+	virtio_mmio_del_doorbell(m, sel);
+
+	if (!val) {
+		m->queue_ready &= ~(1ULL << sel);
+		return;
+	}
+
+	m->dev.layout.valid = TRUE;
+	m->dev.layout.packed = (m->guest_features &
+			(1ULL << VMM_VIRTIO_F_RING_PACKED)) ? TRUE : FALSE;
+	m->dev.layout.num = m->config.queue_num;
+	m->dev.layout.desc_addr = m->queue_desc;
+	m->dev.layout.driver_addr = m->queue_avail;
+	m->dev.layout.device_addr = m->queue_used;
+
+	rc = m->dev.emu->init_vq(&m->dev, sel, VMM_PAGE_SIZE, VMM_PAGE_SIZE,
+				 m->queue_desc >> VMM_PAGE_SHIFT);
+
+	m->dev.layout.valid = FALSE;
+
+	if (!rc) {
+		m->queue_ready |= (1ULL << sel);
+		virtio_mmio_add_doorbell(m, sel);
+	}
+}
+
+static void virtio_mmio_del_doorbells(struct virtio_mmio_dev *m)
+{
+	irq_flags_t flags;
+	struct virtio_mmio_doorbell *vdb;
+
+	vmm_spin_lock_irqsave(&m->db_lock, flags);
+	while (!list_empty(&m->db_list)) {
+		vdb = list_first_entry(&m->db_list,
+				       struct virtio_mmio_doorbell, head);
+		list_del(&vdb->head);
+		vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+
+		vmm_devemu_unregister_doorbell(&vdb->db);
+		vmm_free(vdb);
+
+		vmm_spin_lock_irqsave(&m->db_lock, flags);
+	}
+	vmm_spin_unlock_irqrestore(&m->db_lock, flags);
+}
+
 int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 			    u32 offset, void *dst, u32 dst_len)
 {
@@ -83,11 +257,11 @@ int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 		break;
 	case VMM_VIRTIO_MMIO_HOST_FEATURES:
 		if (m->config.host_features_sel == 0)
-			*(u32 *)dst =
-			(u32)m->dev.emu->get_host_features(&m->dev);
+			*(u32 *)dst = (u32)virtio_mmio_host_features(m);
+		else if (m->config.host_features_sel == 1)
+			*(u32 *)dst = (u32)(virtio_mmio_host_features(m) >> 32);
 		else
-			*(u32 *)dst =
-			(u32)(m->dev.emu->get_host_features(&m->dev) >> 32);
+			*(u32 *)dst = 0;
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_PFN:
 		*(u32 *)dst = m->dev.emu->get_pfn_vq(&m->dev,
@@ -100,7 +274,24 @@ int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 	case VMM_VIRTIO_MMIO_STATUS:
 		*(u32 *)dst = *((u32 *)((void *)&m->config.status));
 		break;
+	case VMM_VIRTIO_MMIO_QUEUE_READY:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		*(u32 *)dst = 0;
+		if (m->config.queue_sel < VIRTIO_MMIO_MAX_READY_QUEUES) {
+			*(u32 *)dst =
+			(u32)(m->queue_ready >> m->config.queue_sel) & 0x1;
+		}
+		break;
+	case VMM_VIRTIO_MMIO_CONFIG_GENERATION:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		*(u32 *)dst = 0;
+		break;
 	default:
+invalid_offset:
 		vmm_printf("%s: guest=%s invalid offset=0x%x\n",
 			   __func__, m->guest->name, offset);
 		rc = VMM_EINVALID;
@@ -142,6 +333,13 @@ static int virtio_mmio_config_write(struct virtio_mmio_dev *m,
 		m->config.guest_features_sel = val;
 		break;
 	case VMM_VIRTIO_MMIO_GUEST_FEATURES:
+		if (m->config.guest_features_sel == 0) {
+			m->guest_features &= ~0xFFFFFFFFULL;
+			m->guest_features |= val;
+		} else if (m->config.guest_features_sel == 1) {
+			m->guest_features &= 0xFFFFFFFFULL;
+			m->guest_features |= (u64)val << 32;
+		}
 		m->dev.emu->set_guest_features(&m->dev,
 					m->config.guest_features_sel, val);
 		break;
@@ -161,11 +359,44 @@ static int virtio_mmio_config_write(struct virtio_mmio_dev *m,
 		m->config.queue_align = val;
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_PFN:
-		m->dev.emu->init_vq(&m->dev,
-				    m->config.queue_sel,
-				    m->config.guest_page_size,
-				    m->config.queue_align,
-				    val);
+		virtio_mmio_del_doorbell(m, m->config.queue_sel);
+		if (!m->dev.emu->init_vq(&m->dev,
+					 m->config.queue_sel,
+					 m->config.guest_page_size,
+					 m->config.queue_align,
+					 val) && val) {
+			virtio_mmio_add_doorbell(m, m->config.queue_sel);
+		}
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_READY:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		virtio_mmio_queue_ready(m, val);
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_DESC_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_DESC_HIGH:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		virtio_mmio_set_addr(&m->queue_desc,
+			(offset == VMM_VIRTIO_MMIO_QUEUE_DESC_HIGH), val);
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_AVAIL_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_AVAIL_HIGH:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		virtio_mmio_set_addr(&m->queue_avail,
+			(offset == VMM_VIRTIO_MMIO_QUEUE_AVAIL_HIGH), val);
+		break;
+	case VMM_VIRTIO_MMIO_QUEUE_USED_LOW:
+	case VMM_VIRTIO_MMIO_QUEUE_USED_HIGH:
+		if (m->config.version < 2) {
+			goto invalid_offset;
+		}
+		virtio_mmio_set_addr(&m->queue_used,
+			(offset == VMM_VIRTIO_MMIO_QUEUE_USED_HIGH), val);
 		break;
 	case VMM_VIRTIO_MMIO_QUEUE_NOTIFY:
 		m->dev.emu->notify_vq(&m->dev, val);
@@ -175,12 +406,16 @@ static int virtio_mmio_config_write(struct virtio_mmio_dev *m,
 		vmm_devemu_emulate_irq(m->guest, m->irq, 0);
 		break;
 	case VMM_VIRTIO_MMIO_STATUS:
+		if (!val) {
+			virtio_mmio_del_doorbells(m);
+		}
 		if (val != m->config.status) {
 			m->dev.emu->status_changed(&m->dev, val);
 		}
 		m->config.status = val;
 		break;
 	default:
+invalid_offset:
 		vmm_printf("%s: guest=%s invalid offset=0x%x\n",
 			   __func__, m->guest->name, offset);
 		rc = VMM_EINVALID;
@@ -271,8 +506,15 @@ static int virtio_mmio_reset(struct vmm_emudev *edev)
 	m->config.queue_sel = 0x0;
 	m->config.interrupt_state = 0x0;
 	m->config.status = 0x0;
+	m->guest_features = 0x0;
+	m->queue_ready = 0x0;
+	m->queue_desc = 0x0;
+	m->queue_avail = 0x0;
+	m->queue_used = 0x0;
 	vmm_devemu_emulate_irq(m->guest, m->irq, 0);
 
+	virtio_mmio_del_doorbells(m);
+
 	return vmm_virtio_reset(&m->dev);
 }
 
@@ -296,6 +538,8 @@ static int virtio_mmio_probe(struct vmm_guest *guest,
 	}
 
 	m->guest = guest;
+	INIT_SPIN_LOCK(&m->db_lock);
+	INIT_LIST_HEAD(&m->db_list);
 
 	vmm_snprintf(m->dev.name, VMM_VIRTIO_DEVICE_MAX_NAME_LEN,
 		     "%s/%s", guest->name, edev->node->name);
@@ -319,6 +563,15 @@ static int virtio_mmio_probe(struct vmm_guest *guest,
 	m->config.device_id = val;
 	m->dev.id.type = m->config.device_id;
 
+	/* Optional version 2 (modern) register layout */
+	if (!vmm_devtree_read_u32(edev->node, "virtio_version", &val)) {
+		if ((val < 1) || (2 < val)) {
+			rc = VMM_EINVALID;
+			goto virtio_mmio_probe_freestate_fail;
+		}
+		m->config.version = val;
+	}
+
 	rc = vmm_devtree_read_u32_atindex(edev->node,
 					  VMM_DEVTREE_INTERRUPTS_ATTR_NAME,
 					  &m->irq, 0);
@@ -345,6 +598,7 @@ static int virtio_mmio_remove(struct vmm_emudev *edev)
 	struct virtio_mmio_dev *m = edev->priv;
 
 	if (m) {
+		virtio_mmio_del_doorbells(m);
 		vmm_virtio_unregister_device(&m->dev);
 		vmm_free(m);
 		edev->priv = NULL;
@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mpsc_ring.c
+ * @author agent (agent@local)
+ * @brief source file for lock-free multi-producer single-consumer ring.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
+#include <libs/stringlib.h>
+#include <libs/mpsc_ring.h>
+
+#define __mpsc_ring_elem(r, slot)	\
+	((u8 *)(r)->elements + (slot) * (r)->element_size)
+
+struct mpsc_ring *mpsc_ring_alloc(u32 element_size, u32 element_count)
+{
+	u32 i, count;
+	struct mpsc_ring *r;
+
+	if (!element_size || !element_count ||
+	    (element_count > (1UL << 30))) {
+		return NULL;
+	}
+
+	count = 1;
+	while (count < element_count) {
+		count <<= 1;
+	}
+
+	r = vmm_zalloc(sizeof(struct mpsc_ring));
+	if (!r) {
+		return NULL;
+	}
+
+	r->elements = vmm_zalloc(element_size * count);
+	if (!r->elements) {
+		vmm_free(r);
+		return NULL;
+	}
+
+	r->seqs = vmm_zalloc(sizeof(*r->seqs) * count);
+	if (!r->seqs) {
+		vmm_free(r->elements);
+		vmm_free(r);
+		return NULL;
+	}
+
+	r->element_size = element_size;
+	r->element_count = count;
+	r->mask = count - 1;
+
+	/* Slot i is free for enqueue position i */
+	for (i = 0; i < count; i++) {
+		ARCH_ATOMIC_INIT(&r->seqs[i], i);
+	}
+	ARCH_ATOMIC_INIT(&r->enqueue_pos, 0);
+	r->dequeue_pos = 0;
+
+	return r;
+}
+
+int mpsc_ring_free(struct mpsc_ring *r)
+{
+	if (!r) {
+		return VMM_EINVALID;
+	}
+
+	vmm_free(r->seqs);
+	vmm_free(r->elements);
+	vmm_free(r);
+
+	return VMM_OK;
+}
+
+bool mpsc_ring_isempty(struct mpsc_ring *r)
+{
+	unsigned long pos;
+
+	if (!r) {
+		return TRUE;
+	}
+
+	pos = r->dequeue_pos;
+
+	return ((unsigned long)arch_atomic_read(&r->seqs[pos & r->mask]) ==
+		(pos + 1)) ? FALSE : TRUE;
+}
+
+bool mpsc_ring_enqueue(struct mpsc_ring *r, void *src)
+{
+	long diff;
+	unsigned long pos, seq, slot;
+
+	if (!r || !src) {
+		return FALSE;
+	}
+
+	pos = arch_atomic_read(&r->enqueue_pos);
+	while (1) {
+		slot = pos & r->mask;
+		seq = arch_atomic_read(&r->seqs[slot]);
+		diff = (long)(seq - pos);
+		if (diff == 0) {
+			/* Slot is free so try to claim it */
+			seq = arch_atomic_cmpxchg(&r->enqueue_pos, pos, pos + 1);
+			if (seq == pos) {
+				break;
+			}
+			pos = seq;
+		} else if (diff < 0) {
+			/* Slot still holds element of previous round */
+			return FALSE;
+		} else {
+			/* Some other producer claimed this slot */
+			pos = arch_atomic_read(&r->enqueue_pos);
+		}
+	}
+
+	/* Don't write slot before consumer is done reading it */
+	arch_smp_mb();
+
+	memcpy(__mpsc_ring_elem(r, slot), src, r->element_size);
+
+	/* Element must be visible before slot is published */
+	arch_smp_wmb();
+	arch_atomic_write(&r->seqs[slot], pos + 1);
+
+	return TRUE;
+}
+
+bool mpsc_ring_dequeue(struct mpsc_ring *r, void *dst)
+{
+	unsigned long pos, slot;
+
+	if (!r || !dst) {
+		return FALSE;
+	}
+
+	pos = r->dequeue_pos;
+	slot = pos & r->mask;
+	if ((unsigned long)arch_atomic_read(&r->seqs[slot]) != (pos + 1)) {
+		/* Empty or producer has not yet published the slot */
+		return FALSE;
+	}
+
+	/* Don't read element before reading slot sequence */
+	arch_smp_rmb();
+
+	memcpy(dst, __mpsc_ring_elem(r, slot), r->element_size);
+
+	/* Element must be read before slot is released to producers */
+	arch_smp_mb();
+	arch_atomic_write(&r->seqs[slot], pos + r->mask + 1);
+	r->dequeue_pos = pos + 1;
+
+	return TRUE;
+}
+
+u32 mpsc_ring_avail(struct mpsc_ring *r)
+{
+	unsigned long epos, dpos;
+
+	if (!r) {
+		return 0;
+	}
+
+	dpos = r->dequeue_pos;
+	arch_smp_rmb();
+	epos = arch_atomic_read(&r->enqueue_pos);
+
+	return (u32)(epos - dpos);
+}
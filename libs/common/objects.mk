@@ -33,6 +33,7 @@ libs-objs-y+= common/stacktrace.o
 libs-objs-y+= common/smoothsort.o
 libs-objs-y+= common/list_sort.o
 libs-objs-y+= common/fifo.o
+libs-objs-y+= common/mpsc_ring.o
 libs-objs-y+= common/lifo.o
 libs-objs-y+= common/rbtree.o
 libs-objs-y+= common/radix-tree.o
@@ -391,6 +391,32 @@ int str2ipaddr(unsigned char *ipaddr, const char *str)
 	return 1;
 }
 
+int str2ethaddr(unsigned char *ethaddr, const char *str)
+{
+	unsigned long long tmp;
+	const char *end;
+	int i;
+
+	for (i = 0; i < 6; i++, ethaddr++) {
+		tmp = strtoull(str, (char **)&end, 16);
+
+		if ((end == str) || (tmp > 255)) {
+			return 0;
+		}
+		str = end;
+
+		if (*str == ':') {
+			str++;
+		} else if (i != 5) {
+			return 0;
+		}
+
+		*ethaddr = (unsigned char)tmp;
+	}
+
+	return 1;
+}
+
 char *strpbrk(const char *cs, const char *ct)
 {
 	char *ret = NULL;
@@ -464,6 +490,7 @@ void *memcpy_fromio(void *dest, const void *src, size_t count)
 	return dest;
 }
 
+#if !defined(ARCH_HAS_MEMMOVE)
 void *memmove(void *dest, const void *src, size_t count)
 {
 	u8 *dst8 = (u8 *) dest;
@@ -506,6 +533,7 @@ void *memmove(void *dest, const void *src, size_t count)
 
 	return dest;
 }
+#endif
 
 #if !defined(ARCH_HAS_MEMSET)
 void *memset(void *dest, int c, size_t count)
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mpsc_ring.h
+ * @author agent (agent@local)
+ * @brief header file for lock-free multi-producer single-consumer ring.
+ *
+ * The ring is a bounded array of slots where each slot has a sequence
+ * number. Producers claim a slot using compare-and-exchange on enqueue
+ * position and publish it by updating slot sequence number. The only
+ * consumer reads published slots in-order without any atomic operation.
+ *
+ * Note: Producers never block each other for more than a compare-and-
+ * exchange retry hence ring can be used from any context (including
+ * interrupt context) without disabling interrupts.
+ * Note: At any point in time, there must be only one consumer.
+ */
+
+#ifndef __MPSC_RING_H__
+#define __MPSC_RING_H__
+
+#include <vmm_types.h>
+
+/** MPSC ring representation */
+struct mpsc_ring {
+	void *elements;
+	atomic_t *seqs;
+	u32 element_size;
+	u32 element_count;
+	unsigned long mask;
+	atomic_t enqueue_pos;
+	volatile unsigned long dequeue_pos;
+};
+
+/** Alloc a new MPSC ring
+ *  Note: element_count is rounded-up to power of two
+ */
+struct mpsc_ring *mpsc_ring_alloc(u32 element_size, u32 element_count);
+
+/** Free a MPSC ring */
+int mpsc_ring_free(struct mpsc_ring *r);
+
+/** Check if MPSC ring is empty */
+bool mpsc_ring_isempty(struct mpsc_ring *r);
+
+/** Enqueue an element to MPSC ring (any number of producers)
+ *  @returns TRUE on success and FALSE if ring is full
+ */
+bool mpsc_ring_enqueue(struct mpsc_ring *r, void *src);
+
+/** Dequeue an element from MPSC ring (only one consumer)
+ *  @returns TRUE on success and FALSE if ring is empty
+ */
+bool mpsc_ring_dequeue(struct mpsc_ring *r, void *dst);
+
+/** Get count of elements enqueued but not yet dequeued
+ *  Note: This includes elements which are still being written
+ *  by producers hence it is only a snapshot.
+ */
+u32 mpsc_ring_avail(struct mpsc_ring *r);
+
+#endif /* __MPSC_RING_H__ */
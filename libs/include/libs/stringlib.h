@@ -87,6 +87,8 @@ unsigned long long strtoull(const char *s, char **endptr, int base);
 
 int str2ipaddr(unsigned char *ipaddr, const char *str);
 
+int str2ethaddr(unsigned char *ethaddr, const char *str);
+
 char *strpbrk(const char *cs, const char *ct);
 
 char *strsep(char **s, const char *ct);
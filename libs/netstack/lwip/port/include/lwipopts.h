@@ -164,7 +164,7 @@
 /**
  * PBUF_POOL_SIZE: the number of buffers in the pbuf pool. 
  */
-#define PBUF_POOL_SIZE                  8
+#define PBUF_POOL_SIZE                  CONFIG_LWIP_PBUF_POOL_SIZE
 
 /*
    ---------------------------------
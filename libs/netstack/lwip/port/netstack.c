@@ -29,6 +29,7 @@
 #include <vmm_mutex.h>
 #include <vmm_completion.h>
 #include <vmm_modules.h>
+#include <libs/mempool.h>
 #include <libs/netstack.h>
 
 #include "lwip/opt.h"
@@ -39,6 +40,8 @@
 #include "lwip/stats.h"
 #include "lwip/raw.h"
 #include "lwip/icmp.h"
+#include "lwip/ip.h"
+#include "lwip/tcp_impl.h"
 #include "lwip/tcpip.h"
 #include "lwip/netif.h"
 #include "lwip/ip_addr.h"
@@ -72,9 +75,20 @@
 /** ping identifier - must fit on a u16_t */
 #define PING_ID				0xAFAF
 
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+/** Custom pbuf referring to payload of a received mbuf */
+struct lwip_rx_pbuf {
+	struct pbuf_custom pc;
+	struct vmm_mbuf *mbuf;
+};
+#endif
+
 struct lwip_netstack {
 	struct netif nif;
 	struct vmm_netport *port;
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+	struct mempool *rx_pbuf_pool;
+#endif
 #if !defined(PING_USE_SOCKETS)
 	struct vmm_mutex ping_lock;
 	ip_addr_t ping_addr;
@@ -705,25 +719,118 @@ static int lwip_can_receive(struct vmm_netport *port)
 	return FALSE;
 }
 
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+static void lwip_rx_pbuf_free(struct pbuf *p)
+{
+	struct lwip_rx_pbuf *rp = (struct lwip_rx_pbuf *)p;
+
+	m_freem(rp->mbuf);
+	mempool_free(lns.rx_pbuf_pool, rp);
+}
+
+/*
+ * Create pbuf chain for received TCP segment without copying payload.
+ *
+ * lwIP updates protocol headers in-place (e.g. TCP header is converted
+ * to host byte order) whereas the received mbuf data can be shared
+ * with other ports so ethernet, IP, and TCP headers are copied to a
+ * PBUF_RAM pbuf. The TCP payload is chained as PBUF_REF custom pbuf
+ * which frees the mbuf when lwIP frees it. lwIP only hides headers of
+ * PBUF_REF pbufs hence other protocols (ICMP echo, UDP, ARP, etc) which
+ * reuse received pbufs for reply are not handled here.
+ */
+static struct pbuf *lwip_rx_zerocopy(struct lwip_netstack *lns,
+				     struct vmm_mbuf *mbuf)
+{
+	u8 *pkt;
+	u32 hlen, len;
+	struct eth_hdr *ethhdr;
+	struct ip_hdr *iphdr;
+	struct tcp_hdr *tcphdr;
+	struct lwip_rx_pbuf *rp;
+	struct pbuf *p, *q;
+
+	if (mbuf->m_next || (mbuf->m_len != mbuf->m_pktlen)) {
+		return NULL;
+	}
+	pkt = mtod(mbuf, u8 *);
+	len = mbuf->m_len;
+	if ((MAX_FRAME_LEN < len) || (len < (SIZEOF_ETH_HDR + IP_HLEN))) {
+		return NULL;
+	}
+
+	/* Only non-fragmented IPv4 TCP segments */
+	ethhdr = (struct eth_hdr *)pkt;
+	iphdr = (struct ip_hdr *)(pkt + SIZEOF_ETH_HDR);
+	if ((ethhdr->type != PP_HTONS(ETHTYPE_IP)) ||
+	    (IPH_V(iphdr) != 4) || (IPH_PROTO(iphdr) != IP_PROTO_TCP) ||
+	    (IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) ||
+	    ((IPH_HL(iphdr) * 4) < IP_HLEN)) {
+		return NULL;
+	}
+	hlen = SIZEOF_ETH_HDR + IPH_HL(iphdr) * 4;
+	if (len < (hlen + TCP_HLEN)) {
+		return NULL;
+	}
+	tcphdr = (struct tcp_hdr *)(pkt + hlen);
+	hlen += TCPH_HDRLEN(tcphdr) * 4;
+	if ((len < hlen) ||
+	    ((len - hlen) < CONFIG_LWIP_RX_ZEROCOPY_MIN_LEN)) {
+		return NULL;
+	}
+
+	rp = mempool_malloc(lns->rx_pbuf_pool);
+	if (!rp) {
+		return NULL;
+	}
+
+	p = pbuf_alloc(PBUF_LINK, hlen, PBUF_RAM);
+	if (!p) {
+		mempool_free(lns->rx_pbuf_pool, rp);
+		return NULL;
+	}
+	memcpy(p->payload, pkt, hlen);
+
+	rp->pc.custom_free_function = lwip_rx_pbuf_free;
+	rp->mbuf = mbuf;
+	q = pbuf_alloced_custom(PBUF_RAW, len - hlen, PBUF_REF, &rp->pc,
+				pkt + hlen, len - hlen);
+	pbuf_cat(p, q);
+
+	return p;
+}
+#endif
+
 static int lwip_switch2port_xfer(struct vmm_netport *port,
 			 	 struct vmm_mbuf *mbuf)
 {
 	u32 pbuf_len;
 	struct eth_hdr *ethhdr;
-	struct pbuf *p, *q;
+	struct pbuf *p = NULL, *q;
 	struct lwip_netstack *lns = port->priv;
 	u32 lcopied = 0;
 
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+	/* Zero-copy pbuf owns the mbuf */
+	p = lwip_rx_zerocopy(lns, mbuf);
+	if (p) {
+		mbuf = NULL;
+	}
+#endif
+
 	/* Move received packet into a new pbuf */
-	pbuf_len = min(MAX_FRAME_LEN, mbuf->m_pktlen);
-	p = pbuf_alloc(PBUF_LINK, pbuf_len, PBUF_POOL);
 	if (!p) {
-		return VMM_ENOMEM;
-	}
+		pbuf_len = min(MAX_FRAME_LEN, mbuf->m_pktlen);
+		p = pbuf_alloc(PBUF_LINK, pbuf_len, PBUF_POOL);
+		if (!p) {
+			m_freem(mbuf);
+			return VMM_ENOMEM;
+		}
 
-	for (q = p; q != NULL; q = q->next) {
-		m_copydata(mbuf, lcopied, q->len, q->payload);
-		lcopied += q->len;
+		for (q = p; q != NULL; q = q->next) {
+			m_copydata(mbuf, lcopied, q->len, q->payload);
+			lcopied += q->len;
+		}
 	}
 
 	/* Points to packet ethernet header */
@@ -744,8 +851,10 @@ static int lwip_switch2port_xfer(struct vmm_netport *port,
 		break;
 	}
 
-	/* Free the mbuf */
-	m_freem(mbuf);
+	/* Free the mbuf (if not owned by zero-copy pbuf) */
+	if (mbuf) {
+		m_freem(mbuf);
+	}
 
 	/* Return success */
 	return VMM_OK;
@@ -834,6 +943,15 @@ static int __init lwip_netstack_init(void)
 	/* Clear lwIP state */
 	memset(&lns, 0, sizeof(lns));
 
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+	/* Create pool of zero-copy receive pbufs */
+	lns.rx_pbuf_pool = mempool_heap_create(sizeof(struct lwip_rx_pbuf),
+					CONFIG_LWIP_RX_ZEROCOPY_PBUFS);
+	if (!lns.rx_pbuf_pool) {
+		return VMM_ENOMEM;
+	}
+#endif
+
 	/* Get netstack device tree node if available */
 	node = vmm_devtree_getnode(VMM_DEVTREE_PATH_SEPARATOR_STRING
 				   VMM_DEVTREE_VMMINFO_NODE_NAME
@@ -923,6 +1041,9 @@ fail2:
 fail1:
 	vmm_netport_free(lns.port);
 fail:
+#if defined(CONFIG_LWIP_RX_ZEROCOPY)
+	mempool_destroy(lns.rx_pbuf_pool);
+#endif
 	return rc;
 }
 
@@ -930,6 +1051,10 @@ static void __exit lwip_netstack_exit(void)
 {
 	vmm_netport_unregister(lns.port);
 	vmm_netport_free(lns.port);
+
+	/* Zero-copy pbufs can still be held by lwIP so
+	 * pool of zero-copy pbufs is not destroyed here.
+	 */
 }
 
 VMM_DECLARE_MODULE(MODULE_DESC, 
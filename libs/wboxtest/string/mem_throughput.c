@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mem_throughput.c
+ * @author agent (agent@local)
+ * @brief mem_throughput test implementation
+ *
+ * This test checks memcpy(), memmove(), and memset() for different
+ * sizes and alignments (including overlapping memmove() in both
+ * directions) and reports their throughput in MB/s.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"mem_throughput test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			mem_throughput_init
+#define	MODULE_EXIT			mem_throughput_exit
+
+#define MEM_MAX_SIZE			65536
+#define MEM_GUARD			64
+#define MEM_BUF_SIZE			(MEM_MAX_SIZE + 2 * MEM_GUARD)
+#define MEM_BENCH_BYTES			(4 * 1024 * 1024)
+#define MEM_GUARD_BYTE			0xa5
+
+static u32 mem_sizes[] = { 16, 64, 256, 1024, 4096, 65536 };
+
+/* Pairs of destination and source offsets */
+static u32 mem_aligns[][2] = { { 0, 0 }, { 1, 1 }, { 0, 3 }, { 5, 2 } };
+
+static u8 *mem_src;
+static u8 *mem_dst;
+static u8 *mem_ref;
+
+static void mem_fill(u8 *buf, u32 len, u32 seed)
+{
+	u32 i;
+
+	for (i = 0; i < len; i++) {
+		buf[i] = (u8)((i * 31) + seed);
+	}
+}
+
+static int mem_check(struct vmm_chardev *cdev, const char *name,
+		     u32 size, u32 doff, u32 soff)
+{
+	u32 i;
+
+	for (i = 0; i < MEM_BUF_SIZE; i++) {
+		if (mem_dst[i] != mem_ref[i]) {
+			vmm_cprintf(cdev, "error: %s size=%d dst_off=%d "
+				    "src_off=%d mismatch at %d\n",
+				    name, size, doff, soff, i);
+			return VMM_EFAIL;
+		}
+	}
+
+	return VMM_OK;
+}
+
+static int mem_verify(struct vmm_chardev *cdev, u32 size, u32 doff, u32 soff)
+{
+	int rc;
+	u32 i;
+	u8 *dst = mem_dst + MEM_GUARD + doff;
+	u8 *src = mem_src + MEM_GUARD + soff;
+	u8 *ref = mem_ref + MEM_GUARD + doff;
+
+	/* memcpy() */
+	mem_fill(mem_src, MEM_BUF_SIZE, size);
+	for (i = 0; i < MEM_BUF_SIZE; i++) {
+		mem_dst[i] = mem_ref[i] = MEM_GUARD_BYTE;
+	}
+	for (i = 0; i < size; i++) {
+		ref[i] = src[i];
+	}
+	memcpy(dst, src, size);
+	rc = mem_check(cdev, "memcpy", size, doff, soff);
+	if (rc) {
+		return rc;
+	}
+
+	/* memset() */
+	for (i = 0; i < size; i++) {
+		ref[i] = (u8)(size + doff);
+	}
+	memset(dst, 0x100 | (size + doff), size);
+	rc = mem_check(cdev, "memset", size, doff, soff);
+	if (rc) {
+		return rc;
+	}
+
+	/* Overlapping memmove() with dest above src */
+	mem_fill(mem_dst, MEM_BUF_SIZE, doff);
+	mem_fill(mem_ref, MEM_BUF_SIZE, doff);
+	for (i = size; i > 0; i--) {
+		mem_ref[doff + soff + i - 1] = mem_ref[soff + i - 1];
+	}
+	memmove(mem_dst + doff + soff, mem_dst + soff, size);
+	rc = mem_check(cdev, "memmove-up", size, doff, soff);
+	if (rc) {
+		return rc;
+	}
+
+	/* Overlapping memmove() with dest below src */
+	mem_fill(mem_dst, MEM_BUF_SIZE, soff);
+	mem_fill(mem_ref, MEM_BUF_SIZE, soff);
+	for (i = 0; i < size; i++) {
+		mem_ref[doff + i] = mem_ref[doff + soff + 1 + i];
+	}
+	memmove(mem_dst + doff, mem_dst + doff + soff + 1, size);
+
+	return mem_check(cdev, "memmove-down", size, doff, soff);
+}
+
+static u64 mem_bench(u32 type, u32 size, u32 doff, u32 soff)
+{
+	u64 tstamp;
+	u32 i, iter = udiv64(MEM_BENCH_BYTES, size);
+	u8 *dst = mem_dst + MEM_GUARD + doff;
+	u8 *src = mem_src + MEM_GUARD + soff;
+
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < iter; i++) {
+		switch (type) {
+		case 0:
+			memcpy(dst, src, size);
+			break;
+		case 1:
+			memmove(dst, src, size);
+			break;
+		default:
+			memset(dst, i, size);
+			break;
+		};
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+
+	/* Bytes per nanosecond to MB/s */
+	return (tstamp) ? udiv64((u64)iter * size * 1000, tstamp) : 0;
+}
+
+static int mem_throughput_run(struct wboxtest *test,
+			      struct vmm_chardev *cdev, u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 s, a, size, doff, soff;
+
+	mem_src = vmm_malloc(MEM_BUF_SIZE);
+	mem_dst = vmm_malloc(MEM_BUF_SIZE);
+	mem_ref = vmm_malloc(MEM_BUF_SIZE);
+	if (!mem_src || !mem_dst || !mem_ref) {
+		rc = VMM_ENOMEM;
+		goto done;
+	}
+
+	/* Sizes which are not multiple of word size are also checked */
+	for (size = 0; size <= 300; size++) {
+		for (a = 0; a < array_size(mem_aligns); a++) {
+			rc = mem_verify(cdev, size, mem_aligns[a][0],
+					mem_aligns[a][1]);
+			if (rc) {
+				goto done;
+			}
+		}
+	}
+
+	for (s = 0; s < array_size(mem_sizes); s++) {
+		size = mem_sizes[s];
+		for (a = 0; a < array_size(mem_aligns); a++) {
+			doff = mem_aligns[a][0];
+			soff = mem_aligns[a][1];
+			rc = mem_verify(cdev, size, doff, soff);
+			if (rc) {
+				goto done;
+			}
+			vmm_cprintf(cdev, "size=%d dst_off=%d src_off=%d "
+				    "memcpy=%"PRIu64"MB/s "
+				    "memmove=%"PRIu64"MB/s "
+				    "memset=%"PRIu64"MB/s\n",
+				    size, doff, soff,
+				    mem_bench(0, size, doff, soff),
+				    mem_bench(1, size, doff, soff),
+				    mem_bench(2, size, doff, soff));
+		}
+	}
+
+done:
+	if (mem_ref) {
+		vmm_free(mem_ref);
+		mem_ref = NULL;
+	}
+	if (mem_dst) {
+		vmm_free(mem_dst);
+		mem_dst = NULL;
+	}
+	if (mem_src) {
+		vmm_free(mem_src);
+		mem_src = NULL;
+	}
+
+	return rc;
+}
+
+static struct wboxtest mem_throughput = {
+	.name = "mem_throughput",
+	.run = mem_throughput_run,
+};
+
+static int __init mem_throughput_init(void)
+{
+	return wboxtest_register("string", &mem_throughput);
+}
+
+static void __exit mem_throughput_exit(void)
+{
+	wboxtest_unregister(&mem_throughput);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file event_cost.c
+ * @author agent (agent@local)
+ * @brief event_cost test implementation
+ *
+ * This test measures average cost of arming and cancelling a timer
+ * event when 10, 100, and 1000 other timer events are pending on the
+ * same host CPU. It also checks that a short timer event still expires
+ * first (and alone) when lot of longer timer events are pending.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_delay.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <libs/mathlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"event_cost test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			event_cost_init
+#define	MODULE_EXIT			event_cost_exit
+
+#define EVENT_COST_ITERATIONS		1000
+#define EVENT_COST_MAX_PENDING		1000
+#define EVENT_COST_LONG_NSECS		(3600ULL * 1000000000ULL)
+#define EVENT_COST_SHORT_NSECS		(1000000ULL)
+
+static u32 event_cost_pending[] = { 10, 100, 1000 };
+
+static struct vmm_timer_event *events;
+static struct vmm_timer_event probe;
+static u32 events_fired;
+static u32 probe_fired;
+
+static void event_cost_handler(struct vmm_timer_event *ev)
+{
+	if (ev == &probe) {
+		probe_fired++;
+	} else {
+		events_fired++;
+	}
+}
+
+static u64 event_cost_long_duration(u32 i)
+{
+	/* Spread expiry times in pseudo-random order */
+	return EVENT_COST_LONG_NSECS +
+	       (u64)((i * 7919) % EVENT_COST_MAX_PENDING) * 1000000ULL;
+}
+
+static int event_cost_measure(struct vmm_chardev *cdev, u32 pending)
+{
+	u32 i;
+	int rc = VMM_OK;
+	u64 tstamp, arm_nsecs = 0, cancel_nsecs = 0;
+
+	events_fired = 0;
+	probe_fired = 0;
+
+	for (i = 0; i < pending; i++) {
+		vmm_timer_event_start(&events[i],
+				      event_cost_long_duration(i));
+	}
+
+	/* Arm and cancel probe which lands in middle of pending events */
+	for (i = 0; i < EVENT_COST_ITERATIONS; i++) {
+		tstamp = vmm_timer_timestamp();
+		vmm_timer_event_start(&probe,
+				event_cost_long_duration(i % pending));
+		arm_nsecs += vmm_timer_timestamp() - tstamp;
+
+		if (!vmm_timer_event_pending(&probe)) {
+			vmm_cprintf(cdev, "error: probe not pending "
+				    "after arm\n");
+			rc = VMM_EFAIL;
+			goto done;
+		}
+
+		tstamp = vmm_timer_timestamp();
+		vmm_timer_event_stop(&probe);
+		cancel_nsecs += vmm_timer_timestamp() - tstamp;
+
+		if (vmm_timer_event_pending(&probe)) {
+			vmm_cprintf(cdev, "error: probe pending "
+				    "after cancel\n");
+			rc = VMM_EFAIL;
+			goto done;
+		}
+	}
+
+	vmm_cprintf(cdev, "pending=%d arm=%"PRIu64"ns cancel=%"PRIu64"ns\n",
+		    pending,
+		    udiv64(arm_nsecs, EVENT_COST_ITERATIONS),
+		    udiv64(cancel_nsecs, EVENT_COST_ITERATIONS));
+
+	/* Short probe must expire first and alone */
+	vmm_timer_event_start(&probe, EVENT_COST_SHORT_NSECS);
+	vmm_msleep(10);
+	if ((probe_fired != 1) || events_fired) {
+		vmm_cprintf(cdev, "error: probe_fired=%d events_fired=%d\n",
+			    probe_fired, events_fired);
+		rc = VMM_EFAIL;
+	}
+
+done:
+	vmm_timer_event_stop(&probe);
+	for (i = 0; i < pending; i++) {
+		vmm_timer_event_stop(&events[i]);
+	}
+
+	return rc;
+}
+
+static int event_cost_run(struct wboxtest *test, struct vmm_chardev *cdev,
+			  u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 i;
+
+	events = vmm_zalloc(sizeof(*events) * EVENT_COST_MAX_PENDING);
+	if (!events) {
+		return VMM_ENOMEM;
+	}
+
+	for (i = 0; i < EVENT_COST_MAX_PENDING; i++) {
+		INIT_TIMER_EVENT(&events[i], event_cost_handler, NULL);
+	}
+	INIT_TIMER_EVENT(&probe, event_cost_handler, NULL);
+
+	for (i = 0; i < array_size(event_cost_pending); i++) {
+		rc = event_cost_measure(cdev, event_cost_pending[i]);
+		if (rc) {
+			break;
+		}
+	}
+
+	vmm_free(events);
+	events = NULL;
+
+	return rc;
+}
+
+static struct wboxtest event_cost = {
+	.name = "event_cost",
+	.run = event_cost_run,
+};
+
+static int __init event_cost_init(void)
+{
+	return wboxtest_register("timer", &event_cost);
+}
+
+static void __exit event_cost_exit(void)
+{
+	wboxtest_unregister(&event_cost);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);